@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "webcam.h"
+#include "yuyv_convert.h"
+
+// Usage: webcam_convert_benchmark [num_frames] [device]
+// Times RGB24 and luma conversion of a 1920x1080 YUYV frame on every path
+// supported by this machine and checks the result against the scalar path.
+// With a device, also times acquire_frame/release_frame and gray conversion
+// of the lent buffers.
+
+typedef void (*convert_function)(const unsigned char *, unsigned char *, int, int, int, YUYVConvertPath);
+
+static double time_conversion(convert_function convert, const std::vector<unsigned char>& src,
+                              std::vector<unsigned char>& dest, int width, int height, int stride,
+                              YUYVConvertPath path, int num_frames)
+{
+    auto time_begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_frames; i++) {
+        convert(src.data(), dest.data(), width, height, stride, path);
+    }
+    std::chrono::duration<double> time_elapsed = std::chrono::steady_clock::now() - time_begin;
+    return time_elapsed.count() / num_frames;
+}
+
+int main(int argc, char *argv[])
+{
+    int num_frames = (argc > 1) ? std::stoi(argv[1]) : 100;
+    const int width = 1920;
+    const int height = 1080;
+    const int stride = width * 2;
+
+    std::vector<unsigned char> src(stride * height);
+    srand(0);
+    for (auto& value : src) {
+        value = rand() & 0xFF;
+    }
+
+    std::vector<unsigned char> rgb_reference(width * height * 3);
+    std::vector<unsigned char> gray_reference(width * height);
+    yuyv_to_rgb24(src.data(), rgb_reference.data(), width, height, stride, YUYVConvertPath::SCALAR);
+    yuyv_to_gray(src.data(), gray_reference.data(), width, height, stride, YUYVConvertPath::SCALAR);
+
+    std::cout << "Best path: " << yuyv_path_name(yuyv_best_path()) << std::endl;
+    std::cout << "Per frame conversion of " << width << "x" << height << " YUYV (ms):" << std::endl;
+
+    bool success = true;
+    for (auto path : {YUYVConvertPath::SCALAR, YUYVConvertPath::SSSE3, YUYVConvertPath::AVX2, YUYVConvertPath::NEON}) {
+        if (!yuyv_path_supported(path)) {
+            continue;
+        }
+
+        std::vector<unsigned char> rgb(rgb_reference.size());
+        std::vector<unsigned char> gray(gray_reference.size());
+        double rgb_time = time_conversion(yuyv_to_rgb24, src, rgb, width, height, stride, path, num_frames);
+        double gray_time = time_conversion(yuyv_to_gray, src, gray, width, height, stride, path, num_frames);
+        bool equal = (rgb == rgb_reference) && (gray == gray_reference);
+        success &= equal;
+
+        std::cout << "\t" << yuyv_path_name(path)
+                  << "\trgb24 " << rgb_time * 1000.0
+                  << "\tgray " << gray_time * 1000.0
+                  << (equal ? "" : "\tMISMATCH") << std::endl;
+    }
+
+    if (argc > 2) {
+        try {
+            Webcam webcam(argv[2], width, height);
+            std::vector<unsigned char> gray;
+            double acquire_time = 0.0;
+            double gray_time = 0.0;
+            for (int i = 0; i < num_frames; i++) {
+                auto time_begin = std::chrono::steady_clock::now();
+                YUYVFrame frame = webcam.acquire_frame();
+                auto time_acquired = std::chrono::steady_clock::now();
+                gray.resize(frame.width * frame.height);
+                yuyv_to_gray(frame.data, gray.data(), frame.width, frame.height, frame.stride);
+                webcam.release_frame(frame);
+                std::chrono::duration<double> acquire_elapsed = time_acquired - time_begin;
+                std::chrono::duration<double> gray_elapsed = std::chrono::steady_clock::now() - time_acquired;
+                acquire_time += acquire_elapsed.count();
+                gray_time += gray_elapsed.count();
+            }
+            std::cout << argv[2] << ": acquire "
+                      << acquire_time * 1000.0 / num_frames << " ms, gray "
+                      << gray_time * 1000.0 / num_frames << " ms per frame" << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    return success ? 0 : 1;
+}
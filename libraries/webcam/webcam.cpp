@@ -36,6 +36,7 @@
 #include <linux/videodev2.h>
 
 #include "webcam.h"
+#include "yuyv_convert.h"
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 
@@ -52,53 +53,15 @@ static int xioctl(int fh, unsigned long int request, void *arg)
       return r;
 }
 
-/*****
- * Taken from libv4l2 (in v4l-utils)
- *
- * (C) 2008 Hans de Goede <hdegoede@redhat.com>
- *
- * Released under LGPL
- */
-#define CLIP(color) (unsigned char)(((color) > 0xFF) ? 0xff : (((color) < 0) ? 0 : (color)))
-
-static void v4lconvert_yuyv_to_rgb24(const unsigned char *src, 
-                                     unsigned char *dest,
-                                     int width, int height, 
-                                     int stride)
-{
-    int j;
-
-    while (--height >= 0) {
-        for (j = 0; j + 1 < width; j += 2) {
-            int u = src[1];
-            int v = src[3];
-            int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
-            int rg = (((u - 128) << 1) +  (u - 128) +
-                    ((v - 128) << 2) + ((v - 128) << 1)) >> 3;
-            int v1 = (((v - 128) << 1) +  (v - 128)) >> 1;
-
-            *dest++ = CLIP(src[0] + v1);
-            *dest++ = CLIP(src[0] - rg);
-            *dest++ = CLIP(src[0] + u1);
-
-            *dest++ = CLIP(src[2] + v1);
-            *dest++ = CLIP(src[2] - rg);
-            *dest++ = CLIP(src[2] + u1);
-            src += 4;
-        }
-        src += stride - (width * 2);
-    }
-}
-/*******************************************************************/
 
 
-Webcam::Webcam(const string& device, int width, int height) : 
+Webcam::Webcam(const string& device, int width, int height, int num_buffers) : 
                         device(device),
                         xres(width),
                         yres(height)
 {
     open_device();
-    init_device();
+    init_device(num_buffers);
     // xres and yres are set to the actual resolution provided by the cam
 
     // frame stored as RGB888 (ie, RGB24)
@@ -112,14 +75,59 @@ Webcam::Webcam(const string& device, int width, int height) :
 
 Webcam::~Webcam()
 {
-      stop_capturing();
-      uninit_device();
-      close_device();
+      /* Do not throw from the destructor, the device may be gone already. */
+      try {
+            stop_capturing();
+      } catch (const runtime_error&) {}
+      try {
+            uninit_device();
+      } catch (const runtime_error&) {}
+      try {
+            close_device();
+      } catch (const runtime_error&) {}
 
       free(rgb_frame.data);
 }
 
 const RGBImage& Webcam::frame(int timeout)
+{
+    for (;;) {
+        wait_frame(timeout);
+        if (read_frame()) {
+            return rgb_frame;
+        }
+        /* EAGAIN - continue select loop. */
+    }
+}
+
+YUYVFrame Webcam::acquire_frame(int timeout)
+{
+    struct v4l2_buffer buf;
+
+    for (;;) {
+        wait_frame(timeout);
+        if (dequeue_buffer(&buf)) {
+            break;
+        }
+        /* EAGAIN - continue select loop. */
+    }
+
+    YUYVFrame lent;
+    lent.data = (const unsigned char *) buffers[buf.index].data;
+    lent.width = xres;
+    lent.height = yres;
+    lent.stride = stride;
+    lent.index = buf.index;
+    lent.timestamp = buf.timestamp;
+    return lent;
+}
+
+void Webcam::release_frame(const YUYVFrame& frame)
+{
+    queue_buffer(frame.index);
+}
+
+void Webcam::wait_frame(int timeout)
 {
     for (;;) {
         fd_set fds;
@@ -144,26 +152,18 @@ const RGBImage& Webcam::frame(int timeout)
         if (0 == r) {
             throw runtime_error(device + ": select timeout");
         }
-        if (read_frame()) {
-            return rgb_frame;
-        }
-        /* EAGAIN - continue select loop. */
+        return;
     }
-
 }
 
-bool Webcam::read_frame()
+bool Webcam::dequeue_buffer(struct v4l2_buffer *buf)
 {
+    CLEAR(*buf);
 
-    struct v4l2_buffer buf;
-    unsigned int i;
-
-    CLEAR(buf);
-
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf->memory = V4L2_MEMORY_MMAP;
 
-    if (-1 == xioctl(fd, VIDIOC_DQBUF, &buf)) {
+    if (-1 == xioctl(fd, VIDIOC_DQBUF, buf)) {
         switch (errno) {
             case EAGAIN:
                 return false;
@@ -178,17 +178,38 @@ bool Webcam::read_frame()
         }
     }
 
-    assert(buf.index < n_buffers);
+    assert(buf->index < n_buffers);
+    return true;
+}
 
-    v4lconvert_yuyv_to_rgb24((unsigned char *) buffers[buf.index].data,
-                             rgb_frame.data,
-                             xres,
-                             yres,
-                             stride);
+void Webcam::queue_buffer(unsigned int index)
+{
+    struct v4l2_buffer buf;
+
+    CLEAR(buf);
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
 
     if (-1 == xioctl(fd, VIDIOC_QBUF, &buf))
         throw runtime_error("VIDIOC_QBUF");
+}
+
+bool Webcam::read_frame()
+{
+    struct v4l2_buffer buf;
+
+    if (!dequeue_buffer(&buf)) {
+        return false;
+    }
 
+    yuyv_to_rgb24((unsigned char *) buffers[buf.index].data,
+                  rgb_frame.data,
+                  xres,
+                  yres,
+                  stride);
+
+    queue_buffer(buf.index);
     return true;
 }
 
@@ -212,13 +233,13 @@ void Webcam::open_device(void)
 }
 
 
-void Webcam::init_mmap(void)
+void Webcam::init_mmap(unsigned int count)
 {
       struct v4l2_requestbuffers req;
 
       CLEAR(req);
 
-      req.count = 4;
+      req.count = count;
       req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
       req.memory = V4L2_MEMORY_MMAP;
 
@@ -273,7 +294,7 @@ void Webcam::close_device(void)
       fd = -1;
 }
 
-void Webcam::init_device(void)
+void Webcam::init_device(unsigned int count)
 {
     struct v4l2_capability cap;
     struct v4l2_cropcap cropcap;
@@ -351,9 +372,13 @@ void Webcam::init_device(void)
         /* Preserve original settings as set by v4l2-ctl for example */
         if (-1 == xioctl(fd, VIDIOC_G_FMT, &fmt))
             throw runtime_error("VIDIOC_G_FMT");
+
+        xres = fmt.fmt.pix.width;
+        yres = fmt.fmt.pix.height;
+        stride = fmt.fmt.pix.bytesperline;
     }
 
-    init_mmap();
+    init_mmap(count);
 }
 
 
@@ -374,15 +399,7 @@ void Webcam::start_capturing(void)
     enum v4l2_buf_type type;
 
     for (i = 0; i < n_buffers; ++i) {
-        struct v4l2_buffer buf;
-
-        CLEAR(buf);
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-
-        if (-1 == xioctl(fd, VIDIOC_QBUF, &buf))
-            throw runtime_error("VIDIOC_QBUF");
+        queue_buffer(i);
     }
     type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (-1 == xioctl(fd, VIDIOC_STREAMON, &type))
@@ -4,6 +4,12 @@
 #include <string>
 #include <memory>
 
+#include <sys/time.h>
+
+#include "yuyv_convert.h"
+
+struct v4l2_buffer;
+
 struct buffer {
       void   *data;
       size_t  size;
@@ -16,13 +22,25 @@ struct RGBImage {
       size_t          size; // width * height * 3
 };
 
+struct YUYVFrame {
+      const unsigned char *data; // YUYV 4:2:2, mmap'ed driver buffer
+      size_t          width;
+      size_t          height;
+      size_t          stride; // bytes per row
+      unsigned int    index; // V4L2 buffer index
+      struct timeval  timestamp;
+};
+
 
 class Webcam {
 
 public:
+    /** Opens the device and starts streaming into 'num_buffers' mmap'ed
+     * buffers (the driver may allocate more). */
     Webcam(const std::string& device = "/dev/video0", 
            int width = 640, 
-           int height = 480);
+           int height = 480,
+           int num_buffers = 4);
 
     ~Webcam();
 
@@ -39,18 +57,40 @@ public:
      */
     const RGBImage& frame(int timeout = 1);
 
+    /** Dequeues a frame and lends the mmap'ed driver buffer without any copy
+     * or conversion.
+     *
+     * The buffer stays valid until it is handed back with release_frame().
+     * The driver cannot fill a lent buffer, so hold at most a few of them
+     * (see num_buffers()) and release them as soon as possible. Luma can
+     * be extracted with yuyv_to_gray().
+     *
+     * Blocks like frame() and throws a runtime_error if the timeout is
+     * reached.
+     */
+    YUYVFrame acquire_frame(int timeout = 1);
+
+    /** Re-queues a buffer returned by acquire_frame() to the driver. */
+    void release_frame(const YUYVFrame& frame);
+
+    unsigned int num_buffers() const { return n_buffers; }
+
 private:
-    void init_mmap();
+    void init_mmap(unsigned int count);
 
     void open_device();
     void close_device();
 
-    void init_device();
+    void init_device(unsigned int count);
     void uninit_device();
 
     void start_capturing();
     void stop_capturing();
 
+    void wait_frame(int timeout);
+    bool dequeue_buffer(struct v4l2_buffer *buf);
+    void queue_buffer(unsigned int index);
+
     bool read_frame();
 
     std::string device;
@@ -0,0 +1,361 @@
+#include "yuyv_convert.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define YUYV_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define YUYV_NEON
+#include <arm_neon.h>
+#endif
+
+#define CLIP(color) (unsigned char)(((color) > 0xFF) ? 0xff : (((color) < 0) ? 0 : (color)))
+
+/*****
+ * Scalar conversion taken from libv4l2 (in v4l-utils)
+ *
+ * (C) 2008 Hans de Goede <hdegoede@redhat.com>
+ *
+ * Released under LGPL
+ */
+static void yuyv_to_rgb24_row_scalar(const unsigned char *src, unsigned char *dest, int width)
+{
+    for (int j = 0; j + 1 < width; j += 2) {
+        int u = src[1];
+        int v = src[3];
+        int u1 = (((u - 128) << 7) +  (u - 128)) >> 6;
+        int rg = (((u - 128) << 1) +  (u - 128) +
+                ((v - 128) << 2) + ((v - 128) << 1)) >> 3;
+        int v1 = (((v - 128) << 1) +  (v - 128)) >> 1;
+
+        *dest++ = CLIP(src[0] + v1);
+        *dest++ = CLIP(src[0] - rg);
+        *dest++ = CLIP(src[0] + u1);
+
+        *dest++ = CLIP(src[2] + v1);
+        *dest++ = CLIP(src[2] - rg);
+        *dest++ = CLIP(src[2] + u1);
+        src += 4;
+    }
+}
+/*******************************************************************/
+
+static void yuyv_to_gray_row_scalar(const unsigned char *src, unsigned char *dest, int width)
+{
+    for (int j = 0; j < width; j++) {
+        dest[j] = src[2 * j];
+    }
+}
+
+#ifdef YUYV_X86
+
+/* Eight pixels (16 bytes of YUYV) to 16-bit R, G, B with the libv4l2 integer formulas. */
+static inline void yuyv_rgb16_sse2(__m128i yuyv, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i offset = _mm_set1_epi16(128);
+
+    __m128i y = _mm_and_si128(yuyv, mask);
+    __m128i uv = _mm_srli_epi16(yuyv, 8);  // U0 V0 U1 V1 ...
+
+    // Duplicate chroma for both pixels of a pair
+    __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+    u = _mm_sub_epi16(u, offset);
+    v = _mm_sub_epi16(v, offset);
+
+    __m128i u1 = _mm_srai_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(129)), 6);
+    __m128i rg = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(3)),
+                                              _mm_mullo_epi16(v, _mm_set1_epi16(6))), 3);
+    __m128i v1 = _mm_srai_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(3)), 1);
+
+    *r = _mm_add_epi16(y, v1);
+    *g = _mm_sub_epi16(y, rg);
+    *b = _mm_add_epi16(y, u1);
+}
+
+static void yuyv_to_gray_row_sse2(const unsigned char *src, unsigned char *dest, int width)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *) (src + 2 * j)), mask);
+        __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *) (src + 2 * j + 16)), mask);
+        _mm_storeu_si128((__m128i *) (dest + j), _mm_packus_epi16(a, b));
+    }
+    yuyv_to_gray_row_scalar(src + 2 * j, dest + j, width - j);
+}
+
+/* Byte shuffles that interleave 16 R, G and B values into 48 bytes of RGB24.
+ * masks[i][c] selects channel c for output vector i (-1 leaves a zero). */
+struct RGB24ShuffleMasks {
+    alignas(16) int8_t masks[3][3][16];
+};
+
+static constexpr RGB24ShuffleMasks make_rgb24_shuffle_masks()
+{
+    RGB24ShuffleMasks result{};
+    for (int i = 0; i < 3; i++) {
+        for (int c = 0; c < 3; c++) {
+            for (int k = 0; k < 16; k++) {
+                int byte = 16 * i + k;
+                result.masks[i][c][k] = static_cast<int8_t>((byte % 3 == c) ? byte / 3 : -1);
+            }
+        }
+    }
+    return result;
+}
+
+static constexpr RGB24ShuffleMasks rgb24_shuffle_masks = make_rgb24_shuffle_masks();
+
+__attribute__((target("ssse3")))
+static inline void store_rgb24_ssse3(__m128i r, __m128i g, __m128i b, unsigned char *dest)
+{
+    for (int i = 0; i < 3; i++) {
+        __m128i mr = _mm_load_si128((const __m128i *) rgb24_shuffle_masks.masks[i][0]);
+        __m128i mg = _mm_load_si128((const __m128i *) rgb24_shuffle_masks.masks[i][1]);
+        __m128i mb = _mm_load_si128((const __m128i *) rgb24_shuffle_masks.masks[i][2]);
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, mr), _mm_shuffle_epi8(g, mg)),
+                                   _mm_shuffle_epi8(b, mb));
+        _mm_storeu_si128((__m128i *) (dest + 16 * i), out);
+    }
+}
+
+__attribute__((target("ssse3")))
+static void yuyv_to_rgb24_row_ssse3(const unsigned char *src, unsigned char *dest, int width)
+{
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m128i r0, g0, b0, r1, g1, b1;
+        yuyv_rgb16_sse2(_mm_loadu_si128((const __m128i *) (src + 2 * j)), &r0, &g0, &b0);
+        yuyv_rgb16_sse2(_mm_loadu_si128((const __m128i *) (src + 2 * j + 16)), &r1, &g1, &b1);
+
+        // Saturate to 8 bits (same as CLIP) and interleave with byte shuffles
+        store_rgb24_ssse3(_mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1),
+                          dest + 3 * j);
+    }
+    yuyv_to_rgb24_row_scalar(src + 2 * j, dest + 3 * j, width - j);
+}
+
+/* Sixteen pixels (32 bytes of YUYV) to 16-bit R, G, B. */
+__attribute__((target("avx2")))
+static inline void yuyv_rgb16_avx2(__m256i yuyv, __m256i *r, __m256i *g, __m256i *b)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    const __m256i offset = _mm256_set1_epi16(128);
+
+    __m256i y = _mm256_and_si256(yuyv, mask);
+    __m256i uv = _mm256_srli_epi16(yuyv, 8);
+
+    __m256i u = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    __m256i v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+    u = _mm256_sub_epi16(u, offset);
+    v = _mm256_sub_epi16(v, offset);
+
+    __m256i u1 = _mm256_srai_epi16(_mm256_mullo_epi16(u, _mm256_set1_epi16(129)), 6);
+    __m256i rg = _mm256_srai_epi16(_mm256_add_epi16(_mm256_mullo_epi16(u, _mm256_set1_epi16(3)),
+                                                    _mm256_mullo_epi16(v, _mm256_set1_epi16(6))), 3);
+    __m256i v1 = _mm256_srai_epi16(_mm256_mullo_epi16(v, _mm256_set1_epi16(3)), 1);
+
+    *r = _mm256_add_epi16(y, v1);
+    *g = _mm256_sub_epi16(y, rg);
+    *b = _mm256_add_epi16(y, u1);
+}
+
+/* Pack two vectors of sixteen 16-bit values to 32 bytes in order. */
+__attribute__((target("avx2")))
+static inline __m256i pack_ordered_avx2(__m256i a, __m256i b)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+__attribute__((target("avx2")))
+static void yuyv_to_rgb24_row_avx2(const unsigned char *src, unsigned char *dest, int width)
+{
+    int j = 0;
+    for (; j + 32 <= width; j += 32) {
+        __m256i r0, g0, b0, r1, g1, b1;
+        yuyv_rgb16_avx2(_mm256_loadu_si256((const __m256i *) (src + 2 * j)), &r0, &g0, &b0);
+        yuyv_rgb16_avx2(_mm256_loadu_si256((const __m256i *) (src + 2 * j + 32)), &r1, &g1, &b1);
+
+        __m256i r = pack_ordered_avx2(r0, r1);
+        __m256i g = pack_ordered_avx2(g0, g1);
+        __m256i b = pack_ordered_avx2(b0, b1);
+
+        unsigned char *out = dest + 3 * j;
+        store_rgb24_ssse3(_mm256_castsi256_si128(r), _mm256_castsi256_si128(g),
+                          _mm256_castsi256_si128(b), out);
+        store_rgb24_ssse3(_mm256_extracti128_si256(r, 1), _mm256_extracti128_si256(g, 1),
+                          _mm256_extracti128_si256(b, 1), out + 48);
+    }
+    yuyv_to_rgb24_row_ssse3(src + 2 * j, dest + 3 * j, width - j);
+}
+
+__attribute__((target("avx2")))
+static void yuyv_to_gray_row_avx2(const unsigned char *src, unsigned char *dest, int width)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+
+    int j = 0;
+    for (; j + 32 <= width; j += 32) {
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *) (src + 2 * j)), mask);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *) (src + 2 * j + 32)), mask);
+        _mm256_storeu_si256((__m256i *) (dest + j), pack_ordered_avx2(a, b));
+    }
+    yuyv_to_gray_row_sse2(src + 2 * j, dest + j, width - j);
+}
+
+#endif // YUYV_X86
+
+#ifdef YUYV_NEON
+
+static void yuyv_to_rgb24_row_neon(const unsigned char *src, unsigned char *dest, int width)
+{
+    const int16x8_t offset = vdupq_n_s16(128);
+
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        // Deinterleave 16 pixels: val[0] = Y0 U0 Y1 V0 ... as (Y, chroma) byte pairs
+        uint8x16x2_t yuyv = vld2q_u8(src + 2 * j);
+        uint8x8x2_t uv = vuzp_u8(vget_low_u8(yuyv.val[1]), vget_high_u8(yuyv.val[1]));
+
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uv.val[0])), offset);
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uv.val[1])), offset);
+
+        int16x8_t u1 = vshrq_n_s16(vmulq_n_s16(u, 129), 6);
+        int16x8_t rg = vshrq_n_s16(vaddq_s16(vmulq_n_s16(u, 3), vmulq_n_s16(v, 6)), 3);
+        int16x8_t v1 = vshrq_n_s16(vmulq_n_s16(v, 3), 1);
+
+        // Duplicate chroma for both pixels of a pair
+        int16x8x2_t u1_pair = vzipq_s16(u1, u1);
+        int16x8x2_t rg_pair = vzipq_s16(rg, rg);
+        int16x8x2_t v1_pair = vzipq_s16(v1, v1);
+
+        int16x8_t y_low = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yuyv.val[0])));
+        int16x8_t y_high = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yuyv.val[0])));
+
+        uint8x16x3_t rgb;
+        rgb.val[0] = vcombine_u8(vqmovun_s16(vaddq_s16(y_low, v1_pair.val[0])),
+                                 vqmovun_s16(vaddq_s16(y_high, v1_pair.val[1])));
+        rgb.val[1] = vcombine_u8(vqmovun_s16(vsubq_s16(y_low, rg_pair.val[0])),
+                                 vqmovun_s16(vsubq_s16(y_high, rg_pair.val[1])));
+        rgb.val[2] = vcombine_u8(vqmovun_s16(vaddq_s16(y_low, u1_pair.val[0])),
+                                 vqmovun_s16(vaddq_s16(y_high, u1_pair.val[1])));
+        vst3q_u8(dest + 3 * j, rgb);
+    }
+    yuyv_to_rgb24_row_scalar(src + 2 * j, dest + 3 * j, width - j);
+}
+
+static void yuyv_to_gray_row_neon(const unsigned char *src, unsigned char *dest, int width)
+{
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        uint8x16x2_t yuyv = vld2q_u8(src + 2 * j);
+        vst1q_u8(dest + j, yuyv.val[0]);
+    }
+    yuyv_to_gray_row_scalar(src + 2 * j, dest + j, width - j);
+}
+
+#endif // YUYV_NEON
+
+bool yuyv_path_supported(YUYVConvertPath path)
+{
+    switch (path) {
+        case YUYVConvertPath::AUTO:
+        case YUYVConvertPath::SCALAR:
+            return true;
+#ifdef YUYV_X86
+        case YUYVConvertPath::SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case YUYVConvertPath::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef YUYV_NEON
+        case YUYVConvertPath::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+YUYVConvertPath yuyv_best_path()
+{
+    static const YUYVConvertPath best = [] {
+        if (yuyv_path_supported(YUYVConvertPath::AVX2)) return YUYVConvertPath::AVX2;
+        if (yuyv_path_supported(YUYVConvertPath::SSSE3)) return YUYVConvertPath::SSSE3;
+        if (yuyv_path_supported(YUYVConvertPath::NEON)) return YUYVConvertPath::NEON;
+        return YUYVConvertPath::SCALAR;
+    }();
+    return best;
+}
+
+const char* yuyv_path_name(YUYVConvertPath path)
+{
+    switch (path) {
+        case YUYVConvertPath::AUTO: return "auto";
+        case YUYVConvertPath::SCALAR: return "scalar";
+        case YUYVConvertPath::SSSE3: return "ssse3";
+        case YUYVConvertPath::AVX2: return "avx2";
+        case YUYVConvertPath::NEON: return "neon";
+    }
+    return "unknown";
+}
+
+typedef void (*row_function)(const unsigned char *, unsigned char *, int);
+
+static row_function rgb24_row_function(YUYVConvertPath path)
+{
+    if (path == YUYVConvertPath::AUTO || !yuyv_path_supported(path)) {
+        path = yuyv_best_path();
+    }
+    switch (path) {
+#ifdef YUYV_X86
+        case YUYVConvertPath::AVX2: return yuyv_to_rgb24_row_avx2;
+        case YUYVConvertPath::SSSE3: return yuyv_to_rgb24_row_ssse3;
+#endif
+#ifdef YUYV_NEON
+        case YUYVConvertPath::NEON: return yuyv_to_rgb24_row_neon;
+#endif
+        default: return yuyv_to_rgb24_row_scalar;
+    }
+}
+
+static row_function gray_row_function(YUYVConvertPath path)
+{
+    if (path == YUYVConvertPath::AUTO || !yuyv_path_supported(path)) {
+        path = yuyv_best_path();
+    }
+    switch (path) {
+#ifdef YUYV_X86
+        case YUYVConvertPath::AVX2: return yuyv_to_gray_row_avx2;
+        case YUYVConvertPath::SSSE3: return yuyv_to_gray_row_sse2;
+#endif
+#ifdef YUYV_NEON
+        case YUYVConvertPath::NEON: return yuyv_to_gray_row_neon;
+#endif
+        default: return yuyv_to_gray_row_scalar;
+    }
+}
+
+void yuyv_to_rgb24(const unsigned char *src, unsigned char *dest,
+                   int width, int height, int stride, YUYVConvertPath path)
+{
+    row_function convert_row = rgb24_row_function(path);
+    for (int i = 0; i < height; i++) {
+        convert_row(src + i * stride, dest + i * width * 3, width);
+    }
+}
+
+void yuyv_to_gray(const unsigned char *src, unsigned char *dest,
+                  int width, int height, int stride, YUYVConvertPath path)
+{
+    row_function convert_row = gray_row_function(path);
+    for (int i = 0; i < height; i++) {
+        convert_row(src + i * stride, dest + i * width, width);
+    }
+}
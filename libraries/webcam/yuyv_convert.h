@@ -0,0 +1,42 @@
+#ifndef REALTIME_RECONSTRUCTION_YUYV_CONVERT_H
+#define REALTIME_RECONSTRUCTION_YUYV_CONVERT_H
+
+#include <cstddef>
+
+/** Conversions of packed YUYV (YUV 4:2:2) frames as delivered by V4L2.
+ *
+ * 'stride' is the number of bytes per source row (bytesperline), the
+ * destination rows are tightly packed. Width must be even.
+ *
+ * The RGB conversion gives the same result as the scalar conversion from
+ * libv4l2 on all code paths. The implementation is selected at runtime
+ * (AVX2 or SSSE3 on x86-64, NEON on ARM, scalar otherwise).
+ */
+
+enum class YUYVConvertPath {
+    AUTO,
+    SCALAR,
+    SSSE3,
+    AVX2,
+    NEON
+};
+
+void yuyv_to_rgb24(const unsigned char *src, unsigned char *dest,
+                   int width, int height, int stride,
+                   YUYVConvertPath path = YUYVConvertPath::AUTO);
+
+/** Extracts luma only (one byte per pixel), which is all that feature
+ * extraction needs. */
+void yuyv_to_gray(const unsigned char *src, unsigned char *dest,
+                  int width, int height, int stride,
+                  YUYVConvertPath path = YUYVConvertPath::AUTO);
+
+/** Returns the path AUTO resolves to on this machine. */
+YUYVConvertPath yuyv_best_path();
+
+/** Returns true if the path can run on this machine. */
+bool yuyv_path_supported(YUYVConvertPath path);
+
+const char* yuyv_path_name(YUYVConvertPath path);
+
+#endif //REALTIME_RECONSTRUCTION_YUYV_CONVERT_H
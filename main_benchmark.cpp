@@ -0,0 +1,73 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "reconstruction/Helpers.h"
+#include "reconstruction/RealtimeReconstructionBuilder.h"
+#include "util/ReplayBenchmark.h"
+
+// Usage: reconstruction_benchmark [project] [num_images] [vocabtree|allpairs|load] [max_num_images] [max_num_features]
+// Replay saves the session at the end and times saving and loading it (e.g. 500 images for the
+// 500 view session benchmark), "load" times loading of a saved session instead of replaying.
+int main(int argc, char *argv[]) {
+
+    std::string root_folder = RECONSTRUCTION_ROOT"/dataset/";
+
+    // Dataset setting
+    std::string project = (argc > 1) ? argv[1] : "statues";
+    int num_images = (argc > 2) ? std::stoi(argv[2]) : 31;
+    std::string strategy = (argc > 3) ? argv[3] : "vocabtree";
+
+    std::string project_folder = root_folder + project + "/";
+    std::string image_ext = ".jpg";
+    std::string images_folder = project_folder + "images/";
+    std::string reconstruction_folder = project_folder + "reconstruction/";
+    std::string calibration_file = project_folder + "prior_calibration.txt";
+
+    // Setup reconstruction objects
+    theia::CameraIntrinsicsPrior intrinsics_prior = ReadCalibration(calibration_file);
+    RealtimeReconstructionBuilder::Options options = SetRealtimeReconstructionBuilderOptions();
+    options.intrinsics_prior = intrinsics_prior;
+    options.exhaustive_matching = (strategy == "allpairs");
+    if (argc > 4) {
+        options.image_retrieval_options.query_options.max_num_images = std::stoi(argv[4]);
+    }
+    if (argc > 5) {
+        options.image_retrieval_options.max_num_features = std::stoi(argv[5]);
+    }
+    auto reconstruction_builder = std::make_shared<RealtimeReconstructionBuilder>(options);
+
+    // Replay image sequence
+    ReplayBenchmark::Options benchmark_options;
+    benchmark_options.label = project + "_" + strategy;
+    if (strategy == "vocabtree") {
+        benchmark_options.label += "_" + std::to_string(options.image_retrieval_options.query_options.max_num_images);
+    }
+    benchmark_options.images_path = images_folder;
+    for (int i = 0; i <= num_images; i++) {
+        std::stringstream ss;
+        ss << std::setw(3) << std::setfill('0') << std::to_string(i);
+        benchmark_options.image_names.emplace_back("frame" + ss.str() + image_ext);
+    }
+
+    ReplayBenchmark benchmark(benchmark_options, reconstruction_builder);
+    std::string session_file = reconstruction_folder + "benchmark_" + project + ".session";
+    bool success;
+    if (strategy == "load") {
+        success = benchmark.RunLoadSession(session_file, 5, std::cout);
+    } else {
+        success = benchmark.Run(std::cout);
+        if (success && benchmark.RunSaveSession(session_file, std::cout)) {
+            std::cout << "Session written to: \n\t" << session_file << std::endl;
+            success = benchmark.RunLoadSession(session_file, 5, std::cout);
+        }
+    }
+
+    std::string output_prefix = reconstruction_folder + "benchmark_" + benchmark_options.label;
+    benchmark.WriteCSV(output_prefix + ".csv");
+    benchmark.WriteJSON(output_prefix + ".json");
+    std::cout << "Benchmark written to: \n\t" << output_prefix << ".{csv,json}" << std::endl;
+
+    return success ? 0 : 1;
+}
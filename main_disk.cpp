@@ -8,6 +8,7 @@
 #include "reconstruction/Helpers.h"
 #include "reconstruction/RealtimeReconstructionBuilder.h"
 #include "nbv/QualityMeasure.h"
+#include "render/MeshResource.h"
 #include "plugins/ReconstructionPlugin.h"
 #include "plugins/EditMeshPlugin.h"
 #include "plugins/PTAMExportPlugin.h"
@@ -76,6 +77,7 @@ int main(int argc, char *argv[]) {
     options.intrinsics_prior = intrinsics_prior;
     auto reconstruction_builder = std::make_shared<RealtimeReconstructionBuilder>(options);
     auto mvs_scene = std::make_shared<MVS::Scene>(options.num_threads);
+    auto mesh_resource = std::make_shared<MeshResource>(mvs_scene, options.num_threads);
     auto quality_measure = std::make_shared<QualityMeasure>(mvs_scene);
 
     // Attach reconstruction plugin
@@ -93,16 +95,17 @@ int main(int argc, char *argv[]) {
                                                image_names,
                                                reconstruction_builder,
                                                mvs_scene,
+                                               mesh_resource,
                                                quality_measure);
     viewer.plugins.push_back(&reconstruction_plugin);
 
     // Attach edit mesh plugin
     EditMeshPlugin::Parameters edit_mesh_parameters;
-    EditMeshPlugin edit_mesh_plugin(mvs_scene);
+    EditMeshPlugin edit_mesh_plugin(mvs_scene, mesh_resource);
     viewer.plugins.push_back(&edit_mesh_plugin);
 
     // Attach PTAM export plugin
-    PTAMExportPlugin ptam_export_plugin(reconstruction_folder, reconstruction_builder, mvs_scene);
+    PTAMExportPlugin ptam_export_plugin(reconstruction_folder, reconstruction_builder, mvs_scene, mesh_resource);
     viewer.plugins.push_back(&ptam_export_plugin);
 
     // Start viewer
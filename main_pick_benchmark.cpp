@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "util/MeshBVH.h"
+
+// Closest hit by testing every triangle, reference for the BVH
+static int PickBruteForce(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F,
+                          const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, float* best_t) {
+    int best_face = -1;
+    *best_t = std::numeric_limits<float>::max();
+    for (int i = 0; i < F.rows(); i++) {
+        Eigen::Vector3f a = V.row(F(i, 0)).transpose().cast<float>();
+        Eigen::Vector3f e1 = V.row(F(i, 1)).transpose().cast<float>() - a;
+        Eigen::Vector3f e2 = V.row(F(i, 2)).transpose().cast<float>() - a;
+        Eigen::Vector3f p = direction.cross(e2);
+        float det = e1.dot(p);
+        if (std::abs(det) < 1e-12f) {
+            continue;
+        }
+        Eigen::Vector3f s = origin - a;
+        float u = s.dot(p) / det;
+        Eigen::Vector3f q = s.cross(e1);
+        float v = direction.dot(q) / det;
+        float t = e2.dot(q) / det;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < *best_t) {
+            *best_t = t;
+            best_face = i;
+        }
+    }
+    return best_face;
+}
+
+// Usage: reconstruction_pick_benchmark [grid_size] [num_picks]
+// Picks random rays on a displaced grid of 2 * grid_size^2 faces (default ~2M).
+int main(int argc, char *argv[]) {
+    int grid_size = (argc > 1) ? std::stoi(argv[1]) : 1000;
+    int num_picks = (argc > 2) ? std::stoi(argv[2]) : 1000;
+    int num_brute_force = std::min(num_picks, 20);
+
+    // Displaced grid
+    const int n = grid_size + 1;
+    Eigen::MatrixXd V(n * n, 3);
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            double u = static_cast<double>(x) / grid_size;
+            double v = static_cast<double>(y) / grid_size;
+            V.row(y * n + x) << u, v, 0.05 * std::sin(20.0 * u) * std::cos(15.0 * v);
+        }
+    }
+    Eigen::MatrixXi F(2 * grid_size * grid_size, 3);
+    for (int y = 0; y < grid_size; y++) {
+        for (int x = 0; x < grid_size; x++) {
+            int i = y * n + x;
+            int f = 2 * (y * grid_size + x);
+            F.row(f) << i, i + 1, i + n;
+            F.row(f + 1) << i + 1, i + n + 1, i + n;
+        }
+    }
+    std::cout << "Mesh: " << V.rows() << " vertices, " << F.rows() << " faces" << std::endl;
+
+    MeshBVH bvh;
+    auto start = std::chrono::steady_clock::now();
+    bvh.Build(V, F);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Build: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    bvh.Refit(V, F);
+    end = std::chrono::steady_clock::now();
+    std::cout << "Refit: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+    // Random rays from above towards the grid
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.05f, 0.95f);
+    std::vector<Eigen::Vector3f> origins(num_picks), directions(num_picks);
+    for (int i = 0; i < num_picks; i++) {
+        Eigen::Vector3f target(distribution(generator), distribution(generator), 0.0f);
+        origins[i] = Eigen::Vector3f(distribution(generator), distribution(generator), 2.0f);
+        directions[i] = target - origins[i];
+    }
+
+    int num_hits = 0;
+    start = std::chrono::steady_clock::now();
+    std::vector<MeshBVH::Hit> hits(num_picks);
+    for (int i = 0; i < num_picks; i++) {
+        num_hits += bvh.Intersect(origins[i], directions[i], &hits[i]) ? 1 : 0;
+    }
+    end = std::chrono::steady_clock::now();
+    double bvh_ms = std::chrono::duration<double, std::milli>(end - start).count() / num_picks;
+    std::cout << "BVH pick: " << bvh_ms * 1000.0 << " us (" << num_hits << "/" << num_picks << " hits)" << std::endl;
+
+    int num_mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_brute_force; i++) {
+        float t;
+        int face = PickBruteForce(V, F, origins[i], directions[i], &t);
+        if (face != hits[i].face && std::abs(t - hits[i].t) > 1e-5f) {
+            num_mismatches++;
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    double brute_force_ms = std::chrono::duration<double, std::milli>(end - start).count() / num_brute_force;
+    std::cout << "Brute force pick: " << brute_force_ms << " ms (" << num_mismatches << " mismatches)" << std::endl;
+    std::cout << "Speedup: " << brute_force_ms / bvh_ms << "x" << std::endl;
+
+    // Box selection of the central quarter and region growing from the center face
+    std::vector<Eigen::Vector4f> planes = {
+            Eigen::Vector4f(1, 0, 0, -0.25f), Eigen::Vector4f(-1, 0, 0, 0.75f),
+            Eigen::Vector4f(0, 1, 0, -0.25f), Eigen::Vector4f(0, -1, 0, 0.75f)};
+    std::vector<int> faces;
+    start = std::chrono::steady_clock::now();
+    bvh.FacesInFrustum(planes, &faces);
+    end = std::chrono::steady_clock::now();
+    std::cout << "Frustum selection: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+              << faces.size() << " faces)" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    bvh.GrowRegion(hits[0].face, static_cast<float>(M_PI) / 12.0f, &faces);
+    end = std::chrono::steady_clock::now();
+    std::cout << "Region growing: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+              << faces.size() << " faces)" << std::endl;
+
+    return num_mismatches == 0 ? 0 : 1;
+}
@@ -14,6 +14,7 @@
 #include "reconstruction/RealtimeReconstructionBuilder.h"
 #include "nbv/QualityMeasure.h"
 #include "render/Render.h"
+#include "render/MeshResource.h"
 #include "plugins/ReconstructionPlugin.h"
 #include "plugins/EditMeshPlugin.h"
 #include "plugins/NextBestViewPlugin.h"
@@ -85,6 +86,7 @@ int main(int argc, char *argv[]) {
     options.intrinsics_prior = intrinsics;
     auto reconstruction_builder = std::make_shared<RealtimeReconstructionBuilder>(options);
     auto mvs_scene = std::make_shared<MVS::Scene>(options.num_threads);
+    auto mesh_resource = std::make_shared<MeshResource>(mvs_scene, options.num_threads);
     auto quality_measure = std::make_shared<QualityMeasure>(mvs_scene);
 
     // Attach render plugin
@@ -108,17 +110,18 @@ int main(int argc, char *argv[]) {
                                                image_names,
                                                reconstruction_builder,
                                                mvs_scene,
+                                               mesh_resource,
                                                quality_measure);
     viewer.plugins.push_back(&reconstruction_plugin);
 
     // Attach next best view plugin
     // auto next_best_view = std::make_shared<NextBestView>(mvs_scene);
-    // NextBestViewPlugin nbv_plugin(next_best_view);
+    // NextBestViewPlugin nbv_plugin(next_best_view, mesh_resource);
     // viewer.plugins.push_back(&nbv_plugin);
 
     // Attach edit mesh plugin
     // EditMeshPlugin::Parameters edit_mesh_parameters;
-    // EditMeshPlugin edit_mesh_plugin(mvs_scene);
+    // EditMeshPlugin edit_mesh_plugin(mvs_scene, mesh_resource);
     // viewer.plugins.push_back(&edit_mesh_plugin);
 
     // Start viewer
@@ -7,13 +7,17 @@
 
 #include "reconstruction/Helpers.h"
 #include "reconstruction/RealtimeReconstructionBuilder.h"
+#include "render/MeshResource.h"
 #include "plugins/WebcamPlugin.h"
 #include "plugins/ReconstructionPlugin.h"
 #include "plugins/EditMeshPlugin.h"
+#include "plugins/NextBestViewPlugin.h"
 
+// Usage: reconstruction_webcam [device]
+// A v4l2loopback device fed with a recorded video can be used instead of a webcam.
 int main(int argc, char *argv[]) {
 
-    std::string camera_device = "/dev/video1";
+    std::string camera_device = (argc > 1) ? argv[1] : "/dev/video0";
     std::string project_path = RECONSTRUCTION_ROOT"/dataset/webcam/";
 
     std::string images_path = project_path + "images/";
@@ -60,15 +64,15 @@ int main(int argc, char *argv[]) {
 
     // Setup reconstruction objects
     theia::CameraIntrinsicsPrior intrinsics_prior = ReadCalibration(calibration_file);
-    theia::RealtimeReconstructionBuilder::Options options = SetRealtimeReconstructionBuilderOptions();
-    auto reconstruction_builder = std::make_shared<theia::RealtimeReconstructionBuilder>(options, intrinsics_prior);
+    RealtimeReconstructionBuilder::Options options = SetRealtimeReconstructionBuilderOptions();
+    options.intrinsics_prior = intrinsics_prior;
+    auto reconstruction_builder = std::make_shared<RealtimeReconstructionBuilder>(options);
     auto mvs_scene = std::make_shared<MVS::Scene>(options.num_threads);
-    auto next_best_view = std::make_shared<NextBestView>(mvs_scene);
+    auto mesh_resource = std::make_shared<MeshResource>(mvs_scene, options.num_threads);
+    auto quality_measure = std::make_shared<QualityMeasure>(mvs_scene);
 
     // Attach camera plugin
-    int image_width = intrinsics_prior.image_width;
-    int image_height = intrinsics_prior.image_height;
-    WebcamPlugin camera_plugin(camera_device, image_width, image_height, images_path);
+    WebcamPlugin camera_plugin(camera_device, images_path, reconstruction_builder);
     viewer.plugins.push_back(&camera_plugin);
 
     // Attach reconstruction plugin
@@ -81,12 +85,18 @@ int main(int argc, char *argv[]) {
                                                image_names,
                                                reconstruction_builder,
                                                mvs_scene,
-                                               next_best_view);
+                                               mesh_resource,
+                                               quality_measure);
     viewer.plugins.push_back(&reconstruction_plugin);
 
+    // Attach next best view plugin
+    auto next_best_view = std::make_shared<NextBestView>(mvs_scene);
+    NextBestViewPlugin nbv_plugin(next_best_view, mesh_resource);
+    viewer.plugins.push_back(&nbv_plugin);
+
     // Attach edit mesh plugin
     EditMeshPlugin::Parameters edit_mesh_parameters;
-    EditMeshPlugin edit_mesh_plugin(mvs_scene);
+    EditMeshPlugin edit_mesh_plugin(mvs_scene, mesh_resource);
     viewer.plugins.push_back(&edit_mesh_plugin);
 
     // Start viewer
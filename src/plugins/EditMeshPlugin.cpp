@@ -1,14 +1,14 @@
 #include "EditMeshPlugin.h"
 
+#include <cassert>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <imgui_impl_glfw_gl3.h>
-#include <igl/unproject_onto_mesh.h>
-#include <igl/qslim.h>
-#include <igl/decimate.h>
 
-EditMeshPlugin::EditMeshPlugin(std::shared_ptr<MVS::Scene> mvs_scene)
-        : mvs_scene_(std::move(mvs_scene)) {}
+EditMeshPlugin::EditMeshPlugin(std::shared_ptr<MVS::Scene> mvs_scene, std::shared_ptr<MeshResource> mesh_resource)
+        : mvs_scene_(std::move(mvs_scene)),
+          mesh_resource_(std::move(mesh_resource)) {}
 
 void EditMeshPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
     ViewerPlugin::init(_viewer);
@@ -32,6 +32,9 @@ void EditMeshPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
 
 bool EditMeshPlugin::pre_draw() {
     ImGuizmo::BeginFrame();
+    if (decimation_job_ && decimation_job_->Done()) {
+        finish_decimation();
+    }
     return false;
 }
 
@@ -86,6 +89,12 @@ bool EditMeshPlugin::post_draw() {
         if (ImGui::RadioButton("Ravnina", parameters_.selection_mode == SelectionMode::PLANE)) {
             parameters_.selection_mode = SelectionMode::PLANE;
         }
+        if (ImGui::RadioButton("Laso [shift doda]", parameters_.selection_mode == SelectionMode::LASSO)) {
+            parameters_.selection_mode = SelectionMode::LASSO;
+        }
+        ImGui::PushItemWidth(150.0f);
+        ImGui::SliderFloat("Kot regije [r]", &parameters_.region_angle, 1.0f, 90.0f, "%.0f deg");
+        ImGui::PopItemWidth();
         show_bounding_box(parameters_.selection_mode == SelectionMode::BOX);
         show_plane(parameters_.selection_mode == SelectionMode::PLANE);
 
@@ -132,6 +141,23 @@ bool EditMeshPlugin::post_draw() {
 
     // Modify
     if (ImGui::TreeNodeEx("Prilagodi", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::Button("Razveljavi [ctrl+z]", ImVec2(160.0f, 0))) {
+            undo_callback();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Ponovi [ctrl+y]", ImVec2(-1, 0))) {
+            redo_callback();
+        }
+        std::ostringstream history_os;
+        history_os << "Zgodovina:\t" << history_.NumUndo() << " / " << history_.NumRedo()
+                   << "\t" << history_.MemoryUsage() / (1 << 20) << " MB";
+        ImGui::TextUnformatted(history_os.str().c_str());
+        ImGui::PushItemWidth(150.0f);
+        if (ImGui::InputInt("Zgodovina (MB)", &parameters_.history_memory_mb)) {
+            parameters_.history_memory_mb = std::max(parameters_.history_memory_mb, 0);
+            history_.SetMemoryLimit(static_cast<size_t>(parameters_.history_memory_mb) << 20);
+        }
+        ImGui::PopItemWidth();
         if (ImGui::Button("Obrni izbiro", ImVec2(-1, 0))) {
             invert_selection_callback();
         }
@@ -141,13 +167,26 @@ bool EditMeshPlugin::post_draw() {
         if (ImGui::Button("Poravnaj ravnino z izbiro", ImVec2(-1, 0))) {
             fit_plane_callback();
         }
+        if (decimation_job_) {
+            ImGui::ProgressBar(decimation_job_->Progress(), ImVec2(150.0f, 0));
+            ImGui::SameLine();
+            if (ImGui::Button("Preklici", ImVec2(-1, 0))) {
+                decimation_job_->Cancel();
+            }
+        } else {
+            ImGui::PushItemWidth(150.0f);
+            ImGui::InputInt("##decimate", &parameters_.decimate_target);
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+            if (ImGui::Button("Decimiraj", ImVec2(-1, 0))) {
+                decimate_callback();
+            }
+        }
         ImGui::PushItemWidth(150.0f);
-        ImGui::InputInt("##decimate", &parameters_.decimate_target);
-        ImGui::PopItemWidth();
-        ImGui::SameLine();
-        if (ImGui::Button("Decimiraj", ImVec2(-1, 0))) {
-            decimate_callback();
+        if (ImGui::InputInt("Nivoji LOD", &parameters_.lod_levels)) {
+            parameters_.lod_levels = std::max(1, std::min(parameters_.lod_levels, 8));
         }
+        ImGui::PopItemWidth();
         /*ImGui::PushItemWidth(150.0f);
         ImGui::InputInt("##resize", &parameters_.texture_size);
         ImGui::PopItemWidth();
@@ -183,6 +222,8 @@ bool EditMeshPlugin::post_draw() {
     }
 
     ImGui::End();
+
+    draw_lasso();
     return false;
 }
 
@@ -230,38 +271,20 @@ void EditMeshPlugin::center_object_callback() {
 void EditMeshPlugin::select_inside_callback() {
     viewer->selected_data_index = VIEWER_DATA_BOUNDING_BOX;
     Eigen::MatrixXd V_box = viewer->data().V;
-    Eigen::Vector3d u = V_box.row(4) - V_box.row(0);
-    Eigen::Vector3d v = V_box.row(2) - V_box.row(0);
-    Eigen::Vector3d w = V_box.row(1) - V_box.row(0);
-
-    // Check which points are in bounding box
+    Eigen::Matrix3d axes;
+    axes.row(0) = V_box.row(4) - V_box.row(0);
+    axes.row(1) = V_box.row(2) - V_box.row(0);
+    axes.row(2) = V_box.row(1) - V_box.row(0);
+    Eigen::Vector3d lower = axes * V_box.row(0).transpose();
+    Eigen::Vector3d upper(axes.row(0).dot(V_box.row(4)),
+                          axes.row(1).dot(V_box.row(2)),
+                          axes.row(2).dot(V_box.row(1)));
+
+    // Check which points are in bounding box and transform to selected faces
     viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-    std::unordered_set<int> selected_vertices_idx;
-    for (int i = 0; i < viewer->data().V.rows(); i++) {
-        Eigen::Vector3d x = viewer->data().V.row(i);
-
-        double ux = u.dot(x);
-        double vx = v.dot(x);
-        double wx = w.dot(x);
-
-        if (ux > u.dot(V_box.row(0)) && ux < u.dot(V_box.row(4)) &&
-            vx > v.dot(V_box.row(0)) && vx < v.dot(V_box.row(2)) &&
-            wx > w.dot(V_box.row(0)) && wx < w.dot(V_box.row(1))) {
-            selected_vertices_idx.insert(i);
-        }
-    }
-
-    // Transform to selected faces
-    selected_faces_idx_.clear();
-    for (int i = 0; i < viewer->data().F.rows(); i++) {
-        Eigen::Vector3i f = viewer->data().F.row(i);
-
-        if (selected_vertices_idx.find(f(0)) != selected_vertices_idx.end() ||
-            selected_vertices_idx.find(f(1)) != selected_vertices_idx.end() ||
-            selected_vertices_idx.find(f(2)) != selected_vertices_idx.end()) {
-            selected_faces_idx_.insert(i);
-        }
-    }
+    std::vector<uint8_t> selected_vertices;
+    VerticesInsideBox(viewer->data().V, axes, lower, upper, &selected_vertices);
+    selection_.SelectFromVertices(viewer->data().F, selected_vertices);
 
     // Set colors of selected faces
     color_selection();
@@ -276,26 +299,71 @@ void EditMeshPlugin::select_faces_below_callback() {
     Eigen::Vector3d plane_normal = u.cross(v).normalized();
     Eigen::Vector3d plane_center = V_plane.colwise().mean();
 
-    // Check which points are below plane
+    // Check which points are below plane and transform to selected faces
     viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-    std::unordered_set<int> selected_vertices_idx;
-    for (int i = 0; i < viewer->data().V.rows(); i++) {
-        Eigen::Vector3d point = viewer->data().V.row(i);
+    std::vector<uint8_t> selected_vertices;
+    VerticesBelowPlane(viewer->data().V, plane_normal, plane_center, &selected_vertices);
+    selection_.SelectFromVertices(viewer->data().F, selected_vertices);
 
-        if (plane_normal.dot(point - plane_center) < 0) {
-            selected_vertices_idx.insert(i);
-        }
-    }
+    // Set colors of selected faces
+    color_selection();
+}
 
-    // Transform to selected faces
-    selected_faces_idx_.clear();
-    for (int i = 0; i < viewer->data().F.rows(); i++) {
-        Eigen::Vector3i f = viewer->data().F.row(i);
+void EditMeshPlugin::select_lasso_callback() {
+    viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
+    const int num_faces = viewer->data().F.rows();
+    if (selection_.Size() != num_faces) {
+        selection_.Resize(num_faces);
+    }
+    if (!lasso_add_) {
+        selection_.Clear();
+    }
 
-        if (selected_vertices_idx.find(f(0)) != selected_vertices_idx.end() ||
-            selected_vertices_idx.find(f(1)) != selected_vertices_idx.end() ||
-            selected_vertices_idx.find(f(2)) != selected_vertices_idx.end()) {
-            selected_faces_idx_.insert(i);
+    // Frustum through the lasso bounds (clip space rows of the projection)
+    Eigen::Vector2f min = lasso_points_[0];
+    Eigen::Vector2f max = lasso_points_[0];
+    for (const auto& point : lasso_points_) {
+        min = min.cwiseMin(point);
+        max = max.cwiseMax(point);
+    }
+    const Eigen::Vector4f viewport = viewer->core.viewport;
+    Eigen::Vector2f ndc_min = 2.0f * (min - viewport.head<2>()).cwiseQuotient(viewport.tail<2>()) - Eigen::Vector2f::Ones();
+    Eigen::Vector2f ndc_max = 2.0f * (max - viewport.head<2>()).cwiseQuotient(viewport.tail<2>()) - Eigen::Vector2f::Ones();
+    Eigen::Matrix4f projection = viewer->core.proj * viewer->core.view;
+    std::vector<Eigen::Vector4f> planes = {
+            projection.row(0).transpose() - ndc_min(0) * projection.row(3).transpose(),
+            ndc_max(0) * projection.row(3).transpose() - projection.row(0).transpose(),
+            projection.row(1).transpose() - ndc_min(1) * projection.row(3).transpose(),
+            ndc_max(1) * projection.row(3).transpose() - projection.row(1).transpose(),
+            projection.row(2).transpose() + projection.row(3).transpose()};
+
+    // Faces in the frustum whose projected centroid is inside the polygon (occluded faces included)
+    const MeshBVH& bvh = mesh_resource_->BVH();
+    std::vector<int> candidates;
+    bvh.FacesInFrustum(planes, &candidates);
+    std::vector<uint8_t> inside(candidates.size(), 0);
+    const int num_points = static_cast<int>(lasso_points_.size());
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < static_cast<int>(candidates.size()); i++) {
+        Eigen::Vector4f clip = projection * bvh.Centroid(candidates[i]).homogeneous();
+        Eigen::Vector2f point = viewport.head<2>() +
+                (clip.head<2>() / clip(3) + Eigen::Vector2f::Ones()).cwiseProduct(0.5f * viewport.tail<2>());
+
+        // Even-odd rule
+        bool odd = false;
+        for (int a = 0, b = num_points - 1; a < num_points; b = a++) {
+            const Eigen::Vector2f& p = lasso_points_[a];
+            const Eigen::Vector2f& q = lasso_points_[b];
+            if ((p.y() > point.y()) != (q.y() > point.y()) &&
+                point.x() < (q.x() - p.x()) * (point.y() - p.y()) / (q.y() - p.y()) + p.x()) {
+                odd = !odd;
+            }
+        }
+        inside[i] = odd ? 1 : 0;
+    }
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (inside[i]) {
+            selection_.Set(candidates[i]);
         }
     }
 
@@ -303,50 +371,85 @@ void EditMeshPlugin::select_faces_below_callback() {
     color_selection();
 }
 
-void EditMeshPlugin::invert_selection_callback() {
+void EditMeshPlugin::pick_face_callback() {
+    viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
+    double x = viewer->current_mouse_x;
+    double y = viewer->core.viewport(3) - viewer->current_mouse_y;
+
+    // Cast a ray
+    MeshBVH::Hit hit;
+    if (mesh_resource_->BVH().Pick(Eigen::Vector2f(x, y), viewer->core.view, viewer->core.proj,
+                                   viewer->core.viewport, &hit)) {
+        // Toggle face selection
+        if (selection_.Size() != viewer->data().F.rows()) {
+            selection_.Resize(viewer->data().F.rows());
+        }
+        selection_.Toggle(hit.face);
+        // Set colors of selected faces
+        color_selection();
+    }
+}
+
+void EditMeshPlugin::grow_region_callback() {
     viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-    std::unordered_set<int> selection_inverse;
-    for (int i = 0; i < viewer->data().F.rows(); i++) {
-        if (selected_faces_idx_.find(i) == selected_faces_idx_.end()) {
-            selection_inverse.insert(i);
+    double x = viewer->current_mouse_x;
+    double y = viewer->core.viewport(3) - viewer->current_mouse_y;
+
+    // Add faces connected to the picked one with similar normals
+    const MeshBVH& bvh = mesh_resource_->BVH();
+    MeshBVH::Hit hit;
+    if (bvh.Pick(Eigen::Vector2f(x, y), viewer->core.view, viewer->core.proj, viewer->core.viewport, &hit)) {
+        std::vector<int> region;
+        bvh.GrowRegion(hit.face, static_cast<float>(parameters_.region_angle * M_PI / 180.0), &region);
+        if (selection_.Size() != viewer->data().F.rows()) {
+            selection_.Resize(viewer->data().F.rows());
         }
+        for (int face : region) {
+            selection_.Set(face);
+        }
+        color_selection();
     }
-    selected_faces_idx_ = selection_inverse;
+}
+
+void EditMeshPlugin::invert_selection_callback() {
+    viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
+    selection_.Invert();
     color_selection();
 }
 
 void EditMeshPlugin::remove_selection_callback() {
+    begin_edit();
+
     // Get vertices from faces
-    std::unordered_set<int> selected_vertices_idx;
-    for (const auto& i : selected_faces_idx_) {
-        MVS::Mesh::Face face = mvs_scene_->mesh.faces[i];
-        selected_vertices_idx.insert(face.x);
-        selected_vertices_idx.insert(face.y);
-        selected_vertices_idx.insert(face.z);
-    }
+    std::vector<uint8_t> selected_vertices(mvs_scene_->mesh.vertices.size(), 0);
+    MVS::Mesh::FaceIdxArr faces_to_remove;
+    faces_to_remove.Reserve(selection_.Count());
+    selection_.ForEach([&](int i) {
+        const MVS::Mesh::Face& face = mvs_scene_->mesh.faces[i];
+        selected_vertices[face.x] = 1;
+        selected_vertices[face.y] = 1;
+        selected_vertices[face.z] = 1;
+        faces_to_remove.Insert((MVS::Mesh::FIndex) i);
+    });
 
     // Remove faces
-    MVS::Mesh::FaceIdxArr faces_to_remove;
-    for (const auto& i : selected_faces_idx_) {
-        MVS::Mesh::FIndex& tmp = faces_to_remove.AddEmpty();
-        tmp = (MVS::Mesh::FIndex) i;
-    }
     mvs_scene_->mesh.RemoveFaces(faces_to_remove, false);
     mvs_scene_->mesh.ListIncidenteFaces();
 
     // Remove vertices without incident faces
     MVS::Mesh::VertexIdxArr vertices_to_remove;
-    for (const auto& i : selected_vertices_idx) {
-        if (mvs_scene_->mesh.vertexFaces[i].IsEmpty()) {
-            MVS::Mesh::VIndex& tmp = vertices_to_remove.AddEmpty();
-            tmp = (MVS::Mesh::VIndex) i;
+    for (int i = 0; i < static_cast<int>(selected_vertices.size()); i++) {
+        if (selected_vertices[i] && mvs_scene_->mesh.vertexFaces[i].IsEmpty()) {
+            vertices_to_remove.Insert((MVS::Mesh::VIndex) i);
         }
     }
     mvs_scene_->mesh.RemoveVertices(vertices_to_remove, true);
     mvs_scene_->mesh.ListIncidenteFaces();
-    selected_faces_idx_.clear();
+    selection_.Clear();
 
     // Reset mesh in viewer
+    mesh_resource_->Invalidate();
+    end_edit();
     set_mesh();
     show_mesh(true);
     set_bounding_box();
@@ -354,27 +457,28 @@ void EditMeshPlugin::remove_selection_callback() {
 }
 
 void EditMeshPlugin::fit_plane_callback() {
-    if (!selected_faces_idx_.empty()) {
+    if (!selection_.Empty()) {
         viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
+        const int num_selected = selection_.Count();
 
         // Set vertex mean as plane center
-        Eigen::MatrixXd vertices(selected_faces_idx_.size() * 3, 3);
+        Eigen::MatrixXd vertices(num_selected * 3, 3);
         int i = 0;
-        for (const auto& idx : selected_faces_idx_) {
+        selection_.ForEach([&](int idx) {
             Eigen::RowVector3i face = viewer->data().F.row(idx);
             vertices.row(i++) = viewer->data().V.row(face(0));
             vertices.row(i++) = viewer->data().V.row(face(1));
             vertices.row(i++) = viewer->data().V.row(face(2));
-        }
+        });
         Eigen::Vector3d plane_center = vertices.colwise().mean();
         Eigen::Affine3f translation(Eigen::Translation3f(plane_center.cast<float>()));
 
         // Set face normals mean as plane normal
-        Eigen::MatrixXd face_normals(selected_faces_idx_.size(), 3);
+        Eigen::MatrixXd face_normals(num_selected, 3);
         i = 0;
-        for (const auto& idx : selected_faces_idx_) {
+        selection_.ForEach([&](int idx) {
             face_normals.row(i++) = viewer->data().F_normals.row(idx);
-        }
+        });
         Eigen::Vector3d plane_normal = face_normals.colwise().mean();
         Eigen::Vector3f initial_normal = Eigen::Vector3f::UnitZ();
         Eigen::Affine3f rotation(Eigen::Quaternionf().setFromTwoVectors(initial_normal, plane_normal.cast<float>()));
@@ -389,164 +493,183 @@ void EditMeshPlugin::fit_plane_callback() {
 }
 
 void EditMeshPlugin::decimate_callback() {
+    if (decimation_job_) {
+        return;
+    }
     if (parameters_.decimate_target < mvs_scene_->mesh.faces.size()) {
-        viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-        Eigen::MatrixXd vertices = viewer->data().V;
-        Eigen::MatrixXi faces = viewer->data().F;
-        Eigen::MatrixXd V_dec;
-        Eigen::MatrixXi F_dec;
-        Eigen::VectorXi F_idx;
-        Eigen::VectorXi V_idx;
-        igl::decimate(vertices, faces, static_cast<size_t>(parameters_.decimate_target), V_dec, F_dec, F_idx, V_idx);
-
-        // Set MVS mesh
-        MVS::Mesh::VertexArr vertices_dec;
-        for (int i = 0; i < V_dec.rows(); i++) {
-            Eigen::RowVector3d vertex = V_dec.row(i);
-            MVS::Mesh::Vertex& tmp = vertices_dec.AddEmpty();
-            tmp.x = static_cast<MVS::Mesh::Type>(vertex(0));
-            tmp.y = static_cast<MVS::Mesh::Type>(vertex(1));
-            tmp.z = static_cast<MVS::Mesh::Type>(vertex(2));
-        }
-        mvs_scene_->mesh.vertices.Release();
-        mvs_scene_->mesh.vertices = vertices_dec;
-
-        MVS::Mesh::FaceArr faces_dec;
-        for (int i = 0; i < F_dec.rows(); i++) {
-            Eigen::RowVector3i face = F_dec.row(i);
-            MVS::Mesh::Face& tmp = faces_dec.AddEmpty();
-            tmp.x = static_cast<MVS::Mesh::VIndex>(face(0));
-            tmp.y = static_cast<MVS::Mesh::VIndex>(face(1));
-            tmp.z = static_cast<MVS::Mesh::VIndex>(face(2));
-        }
-        mvs_scene_->mesh.faces.Release();
-        mvs_scene_->mesh.faces = faces_dec;
-
-        mvs_scene_->mesh.ListIncidenteFaces();
-
-        // Set UVs
-        if (!mvs_scene_->mesh.faceTexcoords.IsEmpty()) {
-            Eigen::MatrixXd TC = viewer->data().V_uv;
-            MVS::Mesh::TexCoordArr tex_coords;
-            for (int i = 0; i < F_idx.size(); i++) {
-                MVS::Mesh::TexCoord& tc1 = tex_coords.AddEmpty();
-                tc1.x = static_cast<MVS::Mesh::Type>(TC(F_idx(i) * 3, 0));
-                tc1.y = static_cast<MVS::Mesh::Type>(TC(F_idx(i) * 3, 1));
-
-                MVS::Mesh::TexCoord& tc2 = tex_coords.AddEmpty();
-                tc2.x = static_cast<MVS::Mesh::Type>(TC(F_idx(i) * 3 + 1, 0));
-                tc2.y = static_cast<MVS::Mesh::Type>(TC(F_idx(i) * 3 + 1, 1));
-
-                MVS::Mesh::TexCoord& tc3 = tex_coords.AddEmpty();
-                tc3.x = static_cast<MVS::Mesh::Type>(TC(F_idx(i) * 3 + 2, 0));
-                tc3.y = static_cast<MVS::Mesh::Type>(TC(F_idx(i) * 3 + 2, 1));
-            }
-            mvs_scene_->mesh.faceTexcoords.Release();
-            mvs_scene_->mesh.faceTexcoords = tex_coords;
-        }
+        MeshDecimationJob::Options options;
+        options.target_faces = parameters_.decimate_target;
+        options.num_levels = parameters_.lod_levels;
 
-        set_mesh();
-        set_bounding_box();
-        set_plane();
+        // Works on a copy, the result is swapped in by finish_decimation
+        decimation_generation_ = mesh_resource_->Generation();
+        decimation_job_ = std::make_unique<MeshDecimationJob>(mvs_scene_->mesh, options);
         log_stream_ << std::endl;
-        log_stream_ << "Decimate success: new number of faces is " << mvs_scene_->mesh.faces.size() << "." << std::endl;
+        log_stream_ << "Decimating mesh ..." << std::endl;
     } else {
         log_stream_ << std::endl;
         log_stream_ << "Decimate failed: target number of faces has to be lower than current number." << std::endl;
     }
 }
 
+void EditMeshPlugin::finish_decimation() {
+    std::unique_ptr<MeshDecimationJob> job = std::move(decimation_job_);
+    log_stream_ << std::endl;
+    if (job->Cancelled()) {
+        log_stream_ << "Decimate cancelled." << std::endl;
+        return;
+    }
+    if (mesh_resource_->Generation() != decimation_generation_) {
+        log_stream_ << "Decimate failed: mesh changed during decimation." << std::endl;
+        return;
+    }
+
+    // LOD chain is shown instead of the mesh, the mesh itself is kept for refinement and texturing
+    std::vector<std::shared_ptr<MVS::Mesh>> levels = job->TakeLevels();
+    if (levels.size() > 1) {
+        mesh_resource_->SetLevels(levels);
+        // LOD chain has its own generation, undo history of the mesh stays valid
+        assert(mesh_resource_->Generation() == decimation_generation_);
+        log_stream_ << "Decimate success: " << levels.size() << " levels, coarsest has "
+                    << levels.back()->faces.size() << " faces (" << job->Time() << " s)." << std::endl;
+        return;
+    }
+
+    // Swap the decimated arrays in
+    begin_edit();
+    MVS::Mesh& decimated = *levels.front();
+    mvs_scene_->mesh.vertices.Swap(decimated.vertices);
+    mvs_scene_->mesh.faces.Swap(decimated.faces);
+    if (!mvs_scene_->mesh.faceTexcoords.IsEmpty()) {
+        mvs_scene_->mesh.faceTexcoords.Swap(decimated.faceTexcoords);
+    }
+    mvs_scene_->mesh.ListIncidenteFaces();
+
+    mesh_resource_->Invalidate();
+    end_edit();
+    set_mesh();
+    set_bounding_box();
+    set_plane();
+    log_stream_ << "Decimate success: new number of faces is " << mvs_scene_->mesh.faces.size()
+                << " (" << job->Time() << " s)." << std::endl;
+}
+
 void EditMeshPlugin::fill_holes_callback() {
+    begin_edit();
+
     // Clean the mesh
     mvs_scene_->mesh.Clean(1.0, 0.0, false, parameters_.fill_hole_size, 0, false);
 
     // Recompute array of vertices incident to each vertex
     mvs_scene_->mesh.ListIncidenteFaces();
 
+    mesh_resource_->Invalidate();
+    end_edit();
     set_mesh();
     show_mesh(true);
 }
 
-void EditMeshPlugin::color_selection() {
-    viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-    Eigen::MatrixXd colors(viewer->data().F.rows(), 3);
-    for (int i = 0; i < viewer->data().F.rows(); i++) {
-        colors.row(i) = parameters_.default_color;
+void EditMeshPlugin::undo_callback() {
+    log_stream_ << std::endl;
+    if (history_generation_ != mesh_resource_->Generation()) {
+        log_stream_ << "Undo failed: mesh was changed outside of editing." << std::endl;
+        return;
     }
-    // Eigen::MatrixXd colors = Eigen::MatrixXd::Constant(viewer->data().F.rows(), 3, 1);
-    for (const auto& i : selected_faces_idx_) {
-        colors.row(i) = Eigen::RowVector3d(1, 0, 0);
+    if (!history_.Undo(&mvs_scene_->mesh)) {
+        log_stream_ << "Undo failed: nothing to undo." << std::endl;
+        return;
     }
-    viewer->data().set_colors(colors);
+    mvs_scene_->mesh.ListIncidenteFaces();
+    mesh_resource_->Invalidate();
+    history_generation_ = mesh_resource_->Generation();
+    selection_.Clear();
+    set_mesh();
+    show_mesh(true);
+    set_bounding_box();
+    set_plane();
+    log_stream_ << "Undo success: " << mvs_scene_->mesh.faces.size() << " faces." << std::endl;
 }
 
-void EditMeshPlugin::set_mesh() {
-    // Select viewer data
+void EditMeshPlugin::redo_callback() {
+    log_stream_ << std::endl;
+    if (history_generation_ != mesh_resource_->Generation()) {
+        log_stream_ << "Redo failed: mesh was changed outside of editing." << std::endl;
+        return;
+    }
+    if (!history_.Redo(&mvs_scene_->mesh)) {
+        log_stream_ << "Redo failed: nothing to redo." << std::endl;
+        return;
+    }
+    mvs_scene_->mesh.ListIncidenteFaces();
+    mesh_resource_->Invalidate();
+    history_generation_ = mesh_resource_->Generation();
+    selection_.Clear();
+    set_mesh();
+    show_mesh(true);
+    set_bounding_box();
+    set_plane();
+    log_stream_ << "Redo success: " << mvs_scene_->mesh.faces.size() << " faces." << std::endl;
+}
+
+void EditMeshPlugin::draw_lasso() {
+    if (!lasso_active_ || lasso_points_.size() < 2) {
+        return;
+    }
+
+    // Viewport to window coordinates
+    const float height = viewer->core.viewport(3);
+    ImDrawList* drawList = ImGui::GetOverlayDrawList();
+    const ImU32 color = ImGui::GetColorU32(ImVec4(1.0, 0.0, 0.0, 1.0));
+    for (size_t i = 0; i < lasso_points_.size(); i++) {
+        const Eigen::Vector2f& a = lasso_points_[i];
+        const Eigen::Vector2f& b = lasso_points_[(i + 1) % lasso_points_.size()];
+        drawList->AddLine(ImVec2(a.x(), height - a.y()), ImVec2(b.x(), height - b.y()), color, 2.0f);
+    }
+}
+
+void EditMeshPlugin::color_selection() {
     viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-    viewer->data().clear();
+    const int num_faces = viewer->data().F.rows();
+    if (selection_.Size() != num_faces) {
+        selection_.Resize(num_faces);
+    }
 
-    // Add vertices
-    int num_vertices = mvs_scene_->mesh.vertices.size();
-    Eigen::MatrixXd V(num_vertices, 3);
-    for (int i = 0; i < num_vertices; i++) {
-        MVS::Mesh::Vertex vertex = mvs_scene_->mesh.vertices[i];
-        V(i, 0) = vertex[0];
-        V(i, 1) = vertex[1];
-        V(i, 2) = vertex[2];
-    }
-    // Add faces
-    int num_faces = mvs_scene_->mesh.faces.size();
-    Eigen::MatrixXi F(num_faces, 3);
+    Eigen::MatrixXd colors(num_faces, 3);
+    const Eigen::RowVector3d selected_color(1, 0, 0);
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < num_faces; i++) {
-        MVS::Mesh::Face face = mvs_scene_->mesh.faces[i];
-        F(i, 0) = face[0];
-        F(i, 1) = face[1];
-        F(i, 2) = face[2];
+        colors.row(i) = selection_.Test(i) ? selected_color : parameters_.default_color;
     }
-    viewer->data().set_mesh(V, F);
-    viewer->data().set_colors(parameters_.default_color);
-    viewer->data().show_lines = parameters_.show_wireframe;
+    viewer->data().set_colors(colors);
+}
 
-    // Add texture if available
-    if (!mvs_scene_->mesh.faceTexcoords.IsEmpty()) {
+void EditMeshPlugin::begin_edit() {
+    // History starts over when the mesh was changed elsewhere (loading, reconstruction, texturing).
+    // Only the mesh generation is compared, building a LOD chain keeps the history.
+    if (history_generation_ != mesh_resource_->Generation()) {
+        history_.SetMemoryLimit(static_cast<size_t>(parameters_.history_memory_mb) << 20);
+        history_.Reset(mvs_scene_->mesh);
+        history_generation_ = mesh_resource_->Generation();
+    }
+}
 
-        // Set UVs
-        int num_texcoords = mvs_scene_->mesh.faceTexcoords.size();
-        Eigen::MatrixXd TC(num_texcoords, 2);
-        for (int i = 0; i < num_texcoords; i++) {
-            MVS::Mesh::TexCoord texcoord = mvs_scene_->mesh.faceTexcoords[i];
-            TC(i, 0) = texcoord[0];
-            TC(i, 1) = texcoord[1];
-        }
-        Eigen::MatrixXi FTC(num_faces, 3);
-        for (int i = 0; i < num_faces; i++) {
-            FTC(i, 0) = i*3 + 0;
-            FTC(i, 1) = i*3 + 1;
-            FTC(i, 2) = i*3 + 2;
-        }
-        viewer->data().set_uv(TC, FTC);
-
-        // Set texture
-        SEACAVE::Image8U3 img = mvs_scene_->mesh.textureDiffuse;
-        int width = img.width();
-        int height = img.height();
-
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> R(width, height);
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> G(width, height);
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> B(width, height);
-
-        for (int i = 0; i < width; i++) {
-            for (int j = 0; j < height; j++) {
-                Pixel8U pixel = img.getPixel(j, i);
-                R(i, j) = pixel.r;
-                G(i, j) = pixel.g;
-                B(i, j) = pixel.b;
-            }
-        }
+void EditMeshPlugin::end_edit() {
+    history_.Push(mvs_scene_->mesh);
+    history_generation_ = mesh_resource_->Generation();
+}
 
+void EditMeshPlugin::set_mesh() {
+    viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
+    if (mesh_resource_->SetMesh(viewer->data(), &mesh_generation_)) {
+        // Face indices of a new mesh do not match the old selection
+        selection_.Resize(viewer->data().F.rows());
+    }
+    viewer->data().show_lines = parameters_.show_wireframe;
+    if (mesh_resource_->HasTexture()) {
         viewer->data().set_colors(Eigen::RowVector3d(1, 1, 1));
-        viewer->data().set_texture(R.rowwise().reverse(), G.rowwise().reverse(), B.rowwise().reverse());
         viewer->data().show_texture = parameters_.show_texture;
+    } else {
+        viewer->data().set_colors(parameters_.default_color);
     }
 }
 
@@ -699,14 +822,42 @@ void EditMeshPlugin::show_plane(bool visible) {
 // Mouse IO
 bool EditMeshPlugin::mouse_down(int button, int modifier) {
     ImGui_ImplGlfwGL3_MouseButtonCallback(viewer->window, button, GLFW_PRESS, modifier);
-    return ImGui::GetIO().WantCaptureMouse;
+    if (ImGui::GetIO().WantCaptureMouse) {
+        return true;
+    }
+
+    // Start lasso (instead of rotating the camera)
+    if (parameters_.selection_mode == SelectionMode::LASSO && button == GLFW_MOUSE_BUTTON_LEFT) {
+        lasso_active_ = true;
+        lasso_add_ = (modifier & GLFW_MOD_SHIFT) != 0;
+        lasso_points_.clear();
+        lasso_points_.emplace_back(static_cast<float>(viewer->current_mouse_x),
+                                   viewer->core.viewport(3) - static_cast<float>(viewer->current_mouse_y));
+        return true;
+    }
+    return false;
 }
 
 bool EditMeshPlugin::mouse_up(int button, int modifier) {
+    if (lasso_active_ && button == GLFW_MOUSE_BUTTON_LEFT) {
+        lasso_active_ = false;
+        if (lasso_points_.size() >= 3) {
+            select_lasso_callback();
+        }
+        lasso_points_.clear();
+        return true;
+    }
     return ImGui::GetIO().WantCaptureMouse;
 }
 
 bool EditMeshPlugin::mouse_move(int mouse_x, int mouse_y) {
+    if (lasso_active_) {
+        Eigen::Vector2f point(static_cast<float>(mouse_x), viewer->core.viewport(3) - static_cast<float>(mouse_y));
+        if ((point - lasso_points_.back()).norm() > 2.0f) {
+            lasso_points_.push_back(point);
+        }
+        return true;
+    }
     return ImGui::GetIO().WantCaptureMouse;
 }
 
@@ -724,34 +875,14 @@ bool EditMeshPlugin::key_pressed(unsigned int key, int modifiers) {
             {
                 if (!ImGui::GetIO().WantCaptureMouse &&
                     (parameters_.selection_mode == SelectionMode::PICK)) {
-                    viewer->selected_data_index = VIEWER_DATA_MESH_EDIT;
-                    int face_id;
-                    Eigen::Vector3f barycentric;
-                    double x = viewer->current_mouse_x;
-                    double y = viewer->core.viewport(3) - viewer->current_mouse_y;
-
-                    // Cast a ray
-                    bool hit = igl::unproject_onto_mesh(
-                            Eigen::Vector2f(x, y),
-                            viewer->core.view,
-                            viewer->core.proj,
-                            viewer->core.viewport,
-                            viewer->data().V,
-                            viewer->data().F,
-                            face_id,
-                            barycentric);
-
-                    if (hit) {
-                        // Toggle face selection
-                        if (selected_faces_idx_.find(face_id) == selected_faces_idx_.end()) {
-                            selected_faces_idx_.insert(face_id);
-                        } else {
-                            selected_faces_idx_.erase(face_id);
-                        }
-                        // Set colors of selected faces
-                        color_selection();
-                        return true;
-                    }
+                    pick_face_callback();
+                }
+                return true;
+            }
+            case 'r':
+            {
+                if (!ImGui::GetIO().WantCaptureMouse) {
+                    grow_region_callback();
                 }
                 return true;
             }
@@ -763,6 +894,16 @@ bool EditMeshPlugin::key_pressed(unsigned int key, int modifiers) {
 
 bool EditMeshPlugin::key_down(int key, int modifiers) {
     ImGui_ImplGlfwGL3_KeyCallback(viewer->window, key, 0, GLFW_PRESS, modifiers);
+    if (!ImGui::GetIO().WantTextInput && (modifiers & GLFW_MOD_CONTROL)) {
+        if (key == GLFW_KEY_Z) {
+            undo_callback();
+            return true;
+        }
+        if (key == GLFW_KEY_Y) {
+            redo_callback();
+            return true;
+        }
+    }
     return ImGui::GetIO().WantCaptureKeyboard;
 }
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <ostream>
+#include <vector>
 
 #include <imgui/imgui.h>
 #include <igl/opengl/glfw/Viewer.h>
@@ -10,13 +11,18 @@
 #include <OpenMVS/MVS.h>
 
 #include "imguizmo/ImGuizmo.h"
+#include "render/MeshDecimationJob.h"
+#include "render/MeshHistory.h"
+#include "render/MeshResource.h"
+#include "util/FaceSelection.h"
 
 class EditMeshPlugin : public igl::opengl::glfw::ViewerPlugin {
 public:
     enum class SelectionMode {
         PICK,
         BOX,
-        PLANE
+        PLANE,
+        LASSO
     };
 
     struct Parameters {
@@ -32,14 +38,21 @@ public:
 
         // Selection
         SelectionMode selection_mode = SelectionMode::PICK;
+        // Maximum normal deviation from the seed face when growing a region (degrees)
+        float region_angle = 20.0f;
 
         // Modify
         int decimate_target = 10000;
+        // Levels of the LOD chain kept beside the mesh instead of replacing it (1 - replace)
+        int lod_levels = 1;
         int texture_size = 2048;
         int fill_hole_size = 100;
+
+        // History
+        int history_memory_mb = 512;
     };
 
-    explicit EditMeshPlugin(std::shared_ptr<MVS::Scene> mvs_scene);
+    EditMeshPlugin(std::shared_ptr<MVS::Scene> mvs_scene, std::shared_ptr<MeshResource> mesh_resource);
 
     void init(igl::opengl::glfw::Viewer *_viewer) override;
     bool pre_draw() override;
@@ -67,9 +80,24 @@ private:
 
     // Reconstruction
     std::shared_ptr<MVS::Scene> mvs_scene_;
+    std::shared_ptr<MeshResource> mesh_resource_;
+    uint64_t mesh_generation_ = 0;
 
     // Selection
-    std::unordered_set<int> selected_faces_idx_;
+    FaceSelection selection_;
+
+    // Lasso polygon in viewport coordinates (origin bottom left)
+    std::vector<Eigen::Vector2f> lasso_points_;
+    bool lasso_active_ = false;
+    bool lasso_add_ = false;
+
+    // Undo history and generation of the mesh (not of its LOD chain) its current state was recorded from
+    MeshHistory history_;
+    uint64_t history_generation_ = 0;
+
+    // Decimation in the background and generation of the mesh it started from
+    std::unique_ptr<MeshDecimationJob> decimation_job_;
+    uint64_t decimation_generation_ = 0;
 
     // Bounding box
     Eigen::MatrixXd bounding_box_vertices_;
@@ -87,13 +115,21 @@ private:
     void center_object_callback();
     void select_inside_callback();
     void select_faces_below_callback();
+    void select_lasso_callback();
+    void pick_face_callback();
+    void grow_region_callback();
     void invert_selection_callback();
     void remove_selection_callback();
     void fit_plane_callback();
     void decimate_callback();
+    void finish_decimation();
     void fill_holes_callback();
+    void undo_callback();
+    void redo_callback();
 
     // Helpers
+    void begin_edit();
+    void end_edit();
     void set_mesh();
     void show_mesh(bool visible);
 
@@ -105,6 +141,7 @@ private:
     void transform_plane();
     void show_plane(bool visible);
 
+    void draw_lasso();
     void color_selection();
     void gizmo_options();
 };
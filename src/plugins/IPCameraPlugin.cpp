@@ -8,14 +8,11 @@
 #include <GLFW/glfw3.h>
 #include <imgui_impl_glfw_gl3.h>
 #include <Eigen/Core>
-#include <curl/curl.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
-#include <stb/stb_image.h>
-#include <stb/stb_image_write.h>
 
 IPCameraPlugin::IPCameraPlugin(std::string images_path,
                                std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder)
@@ -23,16 +20,14 @@ IPCameraPlugin::IPCameraPlugin(std::string images_path,
           reconstruction_builder_(std::move(reconstruction_builder)),
           image_names_(std::make_shared<std::vector<std::string>>()) {
 
-    curl_ = curl_easy_init();
-    curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &curl_stream_);
-    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &IPCameraPlugin::curl_callback);
-    curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 10);
+    IPCameraCapture::Options capture_options;
+    capture_options.decode_gray = true;
+    capture_options.max_gray_size = reconstruction_builder_->GetOptions().descriptor_extractor_options.max_image_size;
+    capture_ = std::make_unique<IPCameraCapture>(capture_options);
+    capture_->SetUrl(url_buffer_);
 }
 
-IPCameraPlugin::~IPCameraPlugin() {
-    curl_easy_cleanup(curl_);
-    stbi_image_free(image_data_);
-}
+IPCameraPlugin::~IPCameraPlugin() = default;
 
 void IPCameraPlugin::init(igl::opengl::glfw::Viewer* _viewer) {
     ViewerPlugin::init(_viewer);
@@ -82,7 +77,12 @@ bool IPCameraPlugin::post_draw() {
     ImGui::Begin("Kamera", nullptr, ImGuiWindowFlags_NoSavedSettings);
 
     // Add an url text
-    ImGui::InputText("URL", url_buffer_, 128);
+    if (ImGui::InputText("URL", url_buffer_, 128)) {
+        capture_->SetUrl(url_buffer_);
+    }
+
+    // Take newest frame from capture thread
+    update_frame();
 
     // Add an image
     auto intrinsic_prior = reconstruction_builder_->GetOptions().intrinsics_prior;
@@ -96,6 +96,29 @@ bool IPCameraPlugin::post_draw() {
     if (ImGui::Button("Zajemi sliko [space]", ImVec2(-1, 0))) {
         capture_image_callback();
     }
+    if (ImGui::Checkbox("Neprekinjen zajem", &continuous_capture_)) {
+        capture_->SetContinuous(continuous_capture_);
+    }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("MJPEG tok", &stream_capture_)) {
+        // Switch between single image and stream url of the camera app
+        std::string url(url_buffer_);
+        std::string photo_suffix = "/photo.jpg";
+        std::string stream_suffix = "/video";
+        const std::string& from = stream_capture_ ? photo_suffix : stream_suffix;
+        const std::string& to = stream_capture_ ? stream_suffix : photo_suffix;
+        if (url.size() >= from.size() && url.compare(url.size() - from.size(), from.size(), from) == 0) {
+            url.replace(url.size() - from.size(), from.size(), to);
+            snprintf(url_buffer_, sizeof(url_buffer_), "%s", url.c_str());
+            capture_->SetUrl(url_buffer_);
+        }
+        capture_->SetStreaming(stream_capture_);
+    }
+    ImGui::Text("Prejete: %ld, izpuscene: %ld, napake: %ld, cas: %.0f ms",
+                static_cast<long>(capture_->NumFetched()),
+                static_cast<long>(capture_->NumDropped()),
+                static_cast<long>(capture_->NumFailed()),
+                1000.0 * capture_->LastFetchTime());
 
     // Localization
     if (ImGui::Button("Lokaliziraj sliko", ImVec2(-70, 0))) {
@@ -133,6 +156,15 @@ bool IPCameraPlugin::post_draw() {
             ImGui::SameLine();
             ImGui::Checkbox("Auto##ip_extend", &auto_extend_);
 
+            // Keyframe gate for automatic extend
+            ImGui::Checkbox("Izbira kljucnih slik", &keyframe_gate_);
+            const auto& keyframe_stats = reconstruction_builder_->GetKeyframeStats();
+            ImGui::Text("Sprejete: %d, zavrnjene: %d, odlozene: %d, prihranjeno: %.1f s",
+                        keyframe_stats.num_accepted,
+                        keyframe_stats.num_rejected,
+                        keyframe_stats.num_deferred,
+                        keyframe_stats.saved_time);
+
             if (nbv_plugin_) {
                 if (ImGui::Button("Naslednji najboljsi pogled", ImVec2(-70, 0))) {
                     nbv_callback();
@@ -154,59 +186,51 @@ std::shared_ptr<std::vector<std::string>> IPCameraPlugin::get_captured_image_nam
 
 void IPCameraPlugin::capture_image_callback() {
 
-    // Download image
-    curl_stream_.clear();
-    curl_easy_setopt(curl_, CURLOPT_URL, url_buffer_);
-    CURLcode res = curl_easy_perform(curl_);
-    if (res != CURLE_OK) {
-        log_stream_ << "IP Camera: Failed to download: " << url_buffer_ << std::endl;
+    // Current frame is already the newest one in continuous and stream mode
+    if (continuous_capture_ || stream_capture_) {
+        if (has_frame_ && auto_save_) {
+            save_image_callback();
+        }
         return;
     }
 
-    // Decode image
-    auto intrinsic_prior = reconstruction_builder_->GetOptions().intrinsics_prior;
-    int image_width = intrinsic_prior.image_width;
-    int image_height = intrinsic_prior.image_height;
-    int channels = 3;
+    // Request frame from capture thread (handled in update_frame)
+    capture_requested_ = true;
+    capture_->RequestFrame();
+}
 
-    if (image_data_ != nullptr) {
-        stbi_image_free(image_data_);
+void IPCameraPlugin::update_frame() {
+    if (!capture_->GetLatestFrame(&frame_)) {
+        return;
     }
-    image_data_ = stbi_load_from_memory(
-            curl_stream_.data(), curl_stream_.size(), &image_width, &image_height, &channels, 0);
+    has_frame_ = true;
 
     // Replace texture with new frame
     glBindTexture(GL_TEXTURE_2D, textureID_);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image_width, image_height, GL_RGB, GL_UNSIGNED_BYTE, image_data_);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame_.width, frame_.height, GL_RGB, GL_UNSIGNED_BYTE, frame_.pixels.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 
     if (auto_localize_) {
         localize_image_callback();
     }
-    if (auto_save_) {
+    if (auto_save_ && capture_requested_) {
         save_image_callback();
     }
+    capture_requested_ = false;
 }
 
 void IPCameraPlugin::localize_image_callback() {
-    log_stream_ << std::endl;
-
-    // Get image dimensions
-    auto intrinsic_prior = reconstruction_builder_->GetOptions().intrinsics_prior;
-    int image_width = intrinsic_prior.image_width;
-    int image_height = intrinsic_prior.image_height;
-    int channels = 3;
-
-    // Copy image data to float array
-    std::vector<float> image_data_float;
-    image_data_float.reserve(image_width * image_height * channels);
-
-    for (int i = 0; i < image_width * image_height * channels; i++) {
-        image_data_float[i] = static_cast<float>(image_data_[i]) / 255.0f;
+    if (!has_frame_) {
+        return;
     }
+    log_stream_ << std::endl;
 
-    // Create theia image
-    theia::FloatImage image(image_width, image_height, channels, image_data_float.data());
+    // Grayscale frame is decoded on the capture thread and passed to the extractor as is
+    GrayImage image;
+    image.width = frame_.gray_width;
+    image.height = frame_.gray_height;
+    image.data = frame_.gray.data();
+    image.scale = frame_.gray_scale;
 
     // Localize image
     bool success = false;
@@ -245,11 +269,29 @@ void IPCameraPlugin::localize_image_callback() {
         viewer->data().uniform_colors(red_color, red_color, red_color);
     }
     prev_localization_success_ = success;
+    localized_frame_index_ = frame_.index;
     show_camera(show_camera_);
 }
 
 void IPCameraPlugin::save_image_callback() {
-    if (image_data_ != nullptr) {
+    if (has_frame_) {
+
+        // Keyframe gate (frames that would not improve the reconstruction are not saved nor extended)
+        if (auto_extend_ && keyframe_gate_ && reconstruction_builder_->IsInitialized()) {
+            if (localized_frame_index_ != frame_.index) {
+                localize_image_callback();
+            }
+            auto decision = reconstruction_builder_->EvaluateKeyframe(frame_.index, prev_localization_success_,
+                                                                      prev_camera_pose_);
+            if (decision != KeyframeSelector::Decision::kAccept) {
+                const auto& result = reconstruction_builder_->GetKeyframeResult();
+                log_stream_ << "IP Camera: Frame " << (decision == KeyframeSelector::Decision::kReject ? "rejected" : "deferred")
+                            << " by keyframe gate (baseline " << result.baseline_ratio
+                            << ", overlap " << result.overlap
+                            << ", PPA gain " << result.ppa_gain << ")" << std::endl;
+                return;
+            }
+        }
 
         // Prepare filename
         std::stringstream ss;
@@ -264,7 +306,7 @@ void IPCameraPlugin::save_image_callback() {
             return;
         }
 
-        fwrite(curl_stream_.data(), sizeof(uint8_t), curl_stream_.size(), fp);
+        fwrite(frame_.encoded.data(), sizeof(uint8_t), frame_.encoded.size(), fp);
         fclose(fp);
 
         // Succsessful write
@@ -288,13 +330,6 @@ void IPCameraPlugin::save_image_callback() {
     }
 }
 
-size_t IPCameraPlugin::curl_callback(char *data, size_t size, size_t nmemb, void *userdata) {
-    auto stream = (std::vector<uint8_t>*) userdata;
-    size_t length = size * nmemb;
-    stream->insert(stream->end(), data, data + length);
-    return length;
-}
-
 void IPCameraPlugin::initialize_callback() {
     if (!reconstruction_plugin_) {
         log_stream_ << "IP Error: Reconstruction plugin not present." << std::endl;
@@ -358,9 +393,9 @@ void IPCameraPlugin::nbv_callback() {
 }
 
 void IPCameraPlugin::save_camera_stats_callback() {
-    std::string filename = images_path_ + "camera_stats.txt";
+    std::string filename = images_path_ + "camera_stats";
     camera_stats_.WriteStatsToFile(filename);
-    log_stream_ << "IP camera: camera stats saved to: \n\t" << filename << std::endl;
+    log_stream_ << "IP camera: camera stats saved to: \n\t" << filename << ".csv, .json" << std::endl;
 }
 
 void IPCameraPlugin::set_camera() {
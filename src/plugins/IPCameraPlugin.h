@@ -3,7 +3,6 @@
 
 #include <glad/glad.h>
 #include <imgui/imgui.h>
-#include <curl/curl.h>
 #include <igl/opengl/glfw/Viewer.h>
 #include <igl/opengl/glfw/ViewerPlugin.h>
 
@@ -11,6 +10,7 @@
 #include "plugins/ReconstructionPlugin.h"
 #include "plugins/NextBestViewPlugin.h"
 #include "util/IPCameraStats.h"
+#include "util/IPCameraCapture.h"
 
 class IPCameraPlugin : public igl::opengl::glfw::ViewerPlugin {
 public:
@@ -48,10 +48,11 @@ private:
     // Viewer data index
     unsigned int VIEWER_DATA_LOCALIZATION;
 
-    // Image input output
-    CURL* curl_;
-    std::vector<uint8_t> curl_stream_;
-    unsigned char* image_data_ = nullptr;
+    // Image input output (frames are fetched and decoded on the capture thread)
+    std::unique_ptr<IPCameraCapture> capture_;
+    IPCameraCapture::Frame frame_;
+    bool has_frame_ = false;
+    bool capture_requested_ = false;
 
     int next_image_idx_ = 0;
     std::string images_path_;
@@ -61,6 +62,8 @@ private:
     GLuint textureID_;
     char url_buffer_[128] = "http://192.168.43.1:8080/photo.jpg";
     bool show_camera_ = true;
+    bool continuous_capture_ = false;
+    bool stream_capture_ = false;
     bool auto_localize_ = true;
     bool auto_save_ = false;
 
@@ -68,6 +71,7 @@ private:
     bool auto_extend_ = true;
     bool auto_nbv_ = true;
     bool auto_save_camera_stats_ = true;
+    bool keyframe_gate_ = true;
 
     // Reconstruction
     std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder_;
@@ -75,6 +79,7 @@ private:
     // Localization
     bool prev_localization_success_ = false;
     theia::CalibratedAbsolutePose prev_camera_pose_;
+    int64_t localized_frame_index_ = -1;
     Eigen::MatrixXd camera_vertices_;
     Eigen::Matrix4d camera_transformation_;
 
@@ -86,7 +91,9 @@ private:
     void capture_image_callback();
     void localize_image_callback();
     void save_image_callback();
-    static size_t curl_callback(char *data, size_t size, size_t nmemb, void *userdata);
+
+    // Show newest frame from capture thread and run auto actions
+    void update_frame();
 
     // Helpers
     void set_camera();
@@ -8,14 +8,14 @@
 #include <glm/gtx/string_cast.hpp>
 #include <igl/colormap.h>
 #include <igl/jet.h>
-#include <igl/unproject_onto_mesh.h>
 
 #include "util/Helpers.h"
 #include "nbv/HelpersOptim.h"
 #include "nelder_mead/nelder_mead.h"
 
-NextBestViewPlugin::NextBestViewPlugin(std::shared_ptr<NextBestView> nbv)
-        : next_best_view_(std::move(nbv)) {}
+NextBestViewPlugin::NextBestViewPlugin(std::shared_ptr<NextBestView> nbv, std::shared_ptr<MeshResource> mesh_resource)
+        : next_best_view_(std::move(nbv)),
+          mesh_resource_(std::move(mesh_resource)) {}
 
 void NextBestViewPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
     ViewerPlugin::init(_viewer);
@@ -477,23 +477,18 @@ void NextBestViewPlugin::debug_callback() {
 }
 
 void NextBestViewPlugin::pick_face_callback() {
-    viewer->selected_data_index = VIEWER_DATA_NBV_MESH;
-
-    int face_id;
-    Eigen::Vector3f barycentric;
     double x = viewer->current_mouse_x;
     double y = viewer->core.viewport(3) - viewer->current_mouse_y;
 
     // Cast a ray
-    bool hit = igl::unproject_onto_mesh(
+    MeshBVH::Hit pick;
+    bool hit = mesh_resource_->BVH().Pick(
             Eigen::Vector2f(x, y),
             viewer->core.view,
             viewer->core.proj,
             viewer->core.viewport,
-            viewer->data().V,
-            viewer->data().F,
-            face_id,
-            barycentric);
+            &pick);
+    int face_id = pick.face;
 
     if (hit) {
         // double fa = face_area_[face_id];
@@ -608,29 +603,7 @@ void NextBestViewPlugin::show_bounding_box() {
 
 void NextBestViewPlugin::set_nbv_mesh() {
     viewer->selected_data_index = VIEWER_DATA_NBV_MESH;
-    viewer->data().clear();
-
-    // Add vertices
-    int num_vertices = next_best_view_->mvs_scene_->mesh.vertices.size();
-    Eigen::MatrixXd V(num_vertices, 3);
-    for (int i = 0; i < num_vertices; i++) {
-        MVS::Mesh::Vertex vertex = next_best_view_->mvs_scene_->mesh.vertices[i];
-        V(i, 0) = vertex[0];
-        V(i, 1) = vertex[1];
-        V(i, 2) = vertex[2];
-    }
-
-    // Add faces
-    int num_faces = next_best_view_->mvs_scene_->mesh.faces.size();
-    Eigen::MatrixXi F(num_faces, 3);
-    for (int i = 0; i < num_faces; i++) {
-        MVS::Mesh::Face face = next_best_view_->mvs_scene_->mesh.faces[i];
-        F(i, 0) = face[0];
-        F(i, 1) = face[1];
-        F(i, 2) = face[2];
-    }
-
-    viewer->data().set_mesh(V, F);
+    mesh_resource_->SetMesh(viewer->data(), &mesh_generation_, false);
     show_nbv_mesh(nbv_mesh_visible_);
 }
 
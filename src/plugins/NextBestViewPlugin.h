@@ -14,10 +14,11 @@
 
 #include "imguizmo/ImGuizmo.h"
 #include "nbv/NextBestView.h"
+#include "render/MeshResource.h"
 
 class NextBestViewPlugin : public igl::opengl::glfw::ViewerPlugin{
 public:
-    explicit NextBestViewPlugin(std::shared_ptr<NextBestView> nbv);
+    NextBestViewPlugin(std::shared_ptr<NextBestView> nbv, std::shared_ptr<MeshResource> mesh_resource);
 
     void init(igl::opengl::glfw::Viewer *_viewer) override;
     bool pre_draw() override;
@@ -75,6 +76,8 @@ private:
 
     // Next best view
     std::shared_ptr<NextBestView> next_best_view_;
+    std::shared_ptr<MeshResource> mesh_resource_;
+    uint64_t mesh_generation_ = 0;
     glm::vec3 camera_pos_ = glm::vec3(0.0, 0.0, 0.0);
     glm::vec3 camera_rot_ = glm::vec3(180.0, 0.0, 0.0);
 
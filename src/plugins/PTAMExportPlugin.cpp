@@ -3,9 +3,14 @@
 //
 #include "PTAMExportPlugin.h"
 
+#include <cstdio>
+#include <cstring>
+
 #include <imgui/imgui.h>
 #include <cereal/include/cereal/archives/binary.hpp>
 #include "util/PTAMExporter.h"
+#include "util/PTAMStream.h"
+#include "util/PointKdTree.h"
 
 void PTAMExportPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
     ViewerPlugin::init(_viewer);
@@ -216,12 +221,20 @@ bool PTAMExportPlugin::post_draw() {
         ImGui::SameLine();
         ImGui::PushItemWidth(200);
         ImGui::InputText("##model_export_path", parameters_.modelPath, 128);
+        ImGui::TextUnformatted("Format:");
+        ImGui::SameLine();
+        ImGui::RadioButton("MVS", &parameters_.modelFormat, MODEL_FORMAT_MVS);
+        ImGui::SameLine();
+        ImGui::RadioButton("PLY", &parameters_.modelFormat, MODEL_FORMAT_PLY);
+        ImGui::SameLine();
+        ImGui::RadioButton("OBJ", &parameters_.modelFormat, MODEL_FORMAT_OBJ);
         if (ImGui::Button("Izvozi 3D model", ImVec2(-1,0))) {
             export_model();
         }
         ImGui::TreePop();
     }
 
+    ImGui::Checkbox("Kompakten format (installer.ptams)", &parameters_.compactFormat);
     if (ImGui::Button("Izvozi rekonstrukcijo", ImVec2(-1,0))) {
         export_scene();
     }
@@ -361,199 +374,304 @@ void PTAMExportPlugin::show_mesh(bool visible) {
 }
 
 void PTAMExportPlugin::set_mesh() {
-    // Select viewer data
     viewer->selected_data_index = VIEWER_DATA_MESH;
-    viewer->data().clear();
-
-    // Add vertices
-    int num_vertices = mvs_scene_->mesh.vertices.size();
-    Eigen::MatrixXd V(num_vertices, 3);
-    for (int i = 0; i < num_vertices; i++) {
-        MVS::Mesh::Vertex vertex = mvs_scene_->mesh.vertices[i];
-        V(i, 0) = vertex[0];
-        V(i, 1) = vertex[1];
-        V(i, 2) = vertex[2];
-    }
-    // Add faces
-    int num_faces = mvs_scene_->mesh.faces.size();
-    Eigen::MatrixXi F(num_faces, 3);
-    for (int i = 0; i < num_faces; i++) {
-        MVS::Mesh::Face face = mvs_scene_->mesh.faces[i];
-        F(i, 0) = face[0];
-        F(i, 1) = face[1];
-        F(i, 2) = face[2];
-    }
-    viewer->data().set_mesh(V, F);
-    viewer->data().set_colors( Eigen::RowVector3d(1, 1, 1));
-    show_mesh(parameters_.show_mesh);
-
-    // Add texture if available
-    if (!mvs_scene_->mesh.faceTexcoords.IsEmpty()) {
-
-        // Set UVs
-        int num_texcoords = mvs_scene_->mesh.faceTexcoords.size();
-        Eigen::MatrixXd TC(num_texcoords, 2);
-        for (int i = 0; i < num_texcoords; i++) {
-            MVS::Mesh::TexCoord texcoord = mvs_scene_->mesh.faceTexcoords[i];
-            TC(i, 0) = texcoord[0];
-            TC(i, 1) = texcoord[1];
-        }
-        Eigen::MatrixXi FTC(num_faces, 3);
-        for (int i = 0; i < num_faces; i++) {
-            FTC(i, 0) = i*3 + 0;
-            FTC(i, 1) = i*3 + 1;
-            FTC(i, 2) = i*3 + 2;
-        }
-        viewer->data().set_uv(TC, FTC);
-
-        // Set texture
-        SEACAVE::Image8U3 img = mvs_scene_->mesh.textureDiffuse;
-        int width = img.width();
-        int height = img.height();
-
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> R(width, height);
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> G(width, height);
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> B(width, height);
-
-        for (int i = 0; i < width; i++) {
-            for (int j = 0; j < height; j++) {
-                Pixel8U pixel = img.getPixel(j, i);
-                R(i, j) = pixel.r;
-                G(i, j) = pixel.g;
-                B(i, j) = pixel.b;
-            }
-        }
-
-        viewer->data().set_colors(Eigen::RowVector3d(1, 1, 1));
-        viewer->data().set_texture(R.rowwise().reverse(), G.rowwise().reverse(), B.rowwise().reverse());
+    mesh_resource_->SetMesh(viewer->data(), &mesh_generation_);
+    if (mesh_resource_->HasTexture()) {
         viewer->data().show_texture = true;
+    } else {
+        viewer->data().set_colors(Eigen::RowVector3d(1, 1, 1));
     }
+    show_mesh(parameters_.show_mesh);
 }
 
 void PTAMExportPlugin::export_scene() {
     log_stream_ << "EXPORT started" << std::endl;
-    theia::Reconstruction reconstruction = reconstruction_builder_->GetReconstruction();
+    const theia::Reconstruction& reconstruction = reconstruction_builder_->GetReconstruction();
 
+    // Compact format is written while points are generated, legacy archive is built in memory
     PTAMExporter ptamExport;
+    std::unique_ptr<PTAMStreamWriter> ptamStream;
+    if (parameters_.compactFormat) {
+        ptamStream = std::make_unique<PTAMStreamWriter>(reconstructionFolder + "installer.ptams", kExportChunkSize);
+        if (!ptamStream->IsOpen()) {
+            log_stream_ << "EXPORT failed: cannot open " << reconstructionFolder << "installer.ptams" << std::endl;
+            return;
+        }
+    }
+
     std::vector<theia::ViewId> viewIds = reconstruction.ViewIds();
     std::sort(viewIds.begin(), viewIds.end());
 
-    ptamExport.scalePoint1 = parameters_.scalePoint1;
-    ptamExport.scalePoint2 = parameters_.scalePoint2;
-    ptamExport.scaleDistance = parameters_.scaleDistance;
-
     // Add frames
+    std::vector<theia::ViewId> estimatedViewIds;
     for (const auto& vid : viewIds) {
         if (reconstruction_builder_->IsEstimated(vid)) {
             const theia::View *v = reconstruction.View(vid);
             log_stream_ << "VIEW: " << vid << " - " << v->Name()  << std::endl;
-            ptamExport.addFrame(vid, v->Name());
+            if (ptamStream) {
+                ptamStream->AddFrame(vid, v->Name());
+            } else {
+                ptamExport.addFrame(vid, v->Name());
+            }
+            estimatedViewIds.push_back(vid);
         }
     }
-    // Add points
-    std::vector<theia::TrackId> trackPoints = reconstruction.TrackIds();
-    for (int i = 0; i < mvs_scene_->mesh.vertices.size(); i++) {
-        auto mp = mvs_scene_->mesh.vertices[i];
-        std::vector<std::pair<theia::TrackId, double>> distances;
-        for (auto& trackID : trackPoints) {
-            if (auto tp = reconstruction.Track(trackID)) {
-                Eigen::Vector3d posA(tp->Point().x(), tp->Point().y(), tp->Point().z());
-                Eigen::Vector3d posB(mp.x, mp.y, mp.z);
-                double d = (posA-posB).norm();
-                distances.emplace_back(std::pair<theia::TrackId, double>(trackID, d));
-            }
+
+    // Search structure over track positions (built once)
+    std::vector<theia::TrackId> trackIds;
+    std::vector<Eigen::Vector3d> trackPositions;
+    for (const auto& trackID : reconstruction.TrackIds()) {
+        if (auto tp = reconstruction.Track(trackID)) {
+            trackIds.push_back(trackID);
+            trackPositions.emplace_back(tp->Point().x(), tp->Point().y(), tp->Point().z());
         }
-        std::sort(distances.begin(), distances.end(), [](const std::pair<theia::TrackId, double> &x, const std::pair<theia::TrackId, double> &y) {
-            return x.second < y.second;
-        });
-
-        PTAMPoint ptamP(mp.x, mp.y, mp.z);
-        for (const auto& vid : viewIds) {
-            if (reconstruction_builder_->IsEstimated(vid)) {
-                for (int x = 0; x < distances.size() && x < 3; x++) {
-                    if (auto track = reconstruction.Track(distances[x].first)) {
-                        if (track->ViewIds().find(vid) != track->ViewIds().end()) {
-                            const theia::View *v = reconstruction.View(vid);
-                            const theia::Camera &cam = v->Camera();
-                            const Eigen::Vector4d a(mp.x, mp.y, mp.z, 1);
-                            Eigen::Vector2d b(0,0);
-                            double d = cam.ProjectPoint(a, &b);
-                            if (d > 0)
-                                ptamP.addPoint(x, vid, b.x(), b.y());
-                            break;
-                        }
+    }
+    PointKdTree trackTree(std::move(trackPositions));
+
+    // Add points (vertices are processed in parallel one block at a time, points are added in vertex order)
+    const int numVertices = mvs_scene_->mesh.vertices.size();
+    const int numThreads = reconstruction_builder_->GetOptions().num_threads;
+    std::vector<PTAMPoint> vertexPoints;
+    int numPoints = 0;
+    for (int blockBegin = 0; blockBegin < numVertices; blockBegin += kExportChunkSize) {
+        const int blockSize = std::min(kExportChunkSize, numVertices - blockBegin);
+        vertexPoints.assign(blockSize, PTAMPoint());
+
+        #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+        for (int i = 0; i < blockSize; i++) {
+            auto mp = mvs_scene_->mesh.vertices[blockBegin + i];
+            std::vector<std::pair<int, double>> nearest;
+            trackTree.KNearest(Eigen::Vector3d(mp.x, mp.y, mp.z), 3, &nearest);
+
+            PTAMPoint ptamP(mp.x, mp.y, mp.z);
+            for (const auto& vid : estimatedViewIds) {
+                for (int x = 0; x < nearest.size(); x++) {
+                    const theia::Track *track = reconstruction.Track(trackIds[nearest[x].first]);
+                    if (track->ViewIds().find(vid) != track->ViewIds().end()) {
+                        const theia::Camera &cam = reconstruction.View(vid)->Camera();
+                        const Eigen::Vector4d a(mp.x, mp.y, mp.z, 1);
+                        Eigen::Vector2d b(0,0);
+                        double d = cam.ProjectPoint(a, &b);
+                        if (d > 0)
+                            ptamP.addPoint(x, vid, b.x(), b.y());
+                        break;
                     }
                 }
             }
+            vertexPoints[i] = std::move(ptamP);
         }
 
-        if (ptamP.numberOfImagePoints() > 0)
-            ptamExport.addPoint(ptamP);
+        for (auto& ptamP : vertexPoints) {
+            if (ptamP.numberOfImagePoints() > 0) {
+                if (ptamStream) {
+                    ptamStream->AddPoint(ptamP);
+                } else {
+                    ptamExport.addPoint(ptamP);
+                }
+                numPoints++;
+            }
+        }
     }
-    std::cout << mvs_scene_->mesh.vertices.size() << std::endl;
-    std::cout << ptamExport.points.size() << std::endl;
+    log_stream_ << "EXPORT vertices: " << numVertices << ", points: " << numPoints << std::endl;
+
     // Add calibration
-    PTAMPoint cal1M(parameters_.calPoint1Model[0], parameters_.calPoint1Model[1], parameters_.calPoint1Model[2]);
-    PTAMPoint cal1W(parameters_.calPoint1Ref[0], parameters_.calPoint1Ref[1], parameters_.calPoint1Ref[2]);
-    ptamExport.addCalPoint(cal1M, cal1W);
-    PTAMPoint cal2M(parameters_.calPoint2Model[0], parameters_.calPoint2Model[1], parameters_.calPoint2Model[2]);
-    PTAMPoint cal2W(parameters_.calPoint2Ref[0], parameters_.calPoint2Ref[1], parameters_.calPoint2Ref[2]);
-    ptamExport.addCalPoint(cal2M, cal2W);
-    PTAMPoint cal3M(parameters_.calPoint3Model[0], parameters_.calPoint3Model[1], parameters_.calPoint3Model[2]);
-    PTAMPoint cal3W(parameters_.calPoint3Ref[0], parameters_.calPoint3Ref[1], parameters_.calPoint3Ref[2]);
-    ptamExport.addCalPoint(cal3M, cal3W);
-    PTAMPoint cal4M(parameters_.calPoint4Model[0], parameters_.calPoint4Model[1], parameters_.calPoint4Model[2]);
-    PTAMPoint cal4W(parameters_.calPoint4Ref[0], parameters_.calPoint4Ref[1], parameters_.calPoint4Ref[2]);
-    ptamExport.addCalPoint(cal4M, cal4W);
-
-    std::ofstream ptamFile(reconstructionFolder+"installer",  std::ios::binary);
-    {
-        cereal::BinaryOutputArchive oarchive(ptamFile);
-        oarchive(ptamExport);
+    PTAMPoint calModel[4] = {
+            PTAMPoint(parameters_.calPoint1Model[0], parameters_.calPoint1Model[1], parameters_.calPoint1Model[2]),
+            PTAMPoint(parameters_.calPoint2Model[0], parameters_.calPoint2Model[1], parameters_.calPoint2Model[2]),
+            PTAMPoint(parameters_.calPoint3Model[0], parameters_.calPoint3Model[1], parameters_.calPoint3Model[2]),
+            PTAMPoint(parameters_.calPoint4Model[0], parameters_.calPoint4Model[1], parameters_.calPoint4Model[2])};
+    PTAMPoint calWorld[4] = {
+            PTAMPoint(parameters_.calPoint1Ref[0], parameters_.calPoint1Ref[1], parameters_.calPoint1Ref[2]),
+            PTAMPoint(parameters_.calPoint2Ref[0], parameters_.calPoint2Ref[1], parameters_.calPoint2Ref[2]),
+            PTAMPoint(parameters_.calPoint3Ref[0], parameters_.calPoint3Ref[1], parameters_.calPoint3Ref[2]),
+            PTAMPoint(parameters_.calPoint4Ref[0], parameters_.calPoint4Ref[1], parameters_.calPoint4Ref[2])};
+    for (int i = 0; i < 4; i++) {
+        if (ptamStream) {
+            ptamStream->AddCalPoint(calModel[i], calWorld[i]);
+        } else {
+            ptamExport.addCalPoint(calModel[i], calWorld[i]);
+        }
+    }
+
+    if (ptamStream) {
+        if (!ptamStream->Finish(parameters_.scalePoint1, parameters_.scalePoint2, parameters_.scaleDistance)) {
+            log_stream_ << "EXPORT failed: write error" << std::endl;
+            return;
+        }
+    } else {
+        ptamExport.scalePoint1 = parameters_.scalePoint1;
+        ptamExport.scalePoint2 = parameters_.scalePoint2;
+        ptamExport.scaleDistance = parameters_.scaleDistance;
+
+        std::ofstream ptamFile(reconstructionFolder+"installer",  std::ios::binary);
+        {
+            cereal::BinaryOutputArchive oarchive(ptamFile);
+            oarchive(ptamExport);
+        }
+        ptamFile.close();
     }
-    ptamFile.close();
     log_stream_ << "EXPORT finished" << std::endl;
 }
 
 void PTAMExportPlugin::export_model() {
     log_stream_ << "EXPORT 3D model started" << std::endl;
-    Eigen::MatrixXf model;
-    model.resize(3, 4);
-    Eigen::MatrixXf ref;
-    ref.resize(3, 4);
-
-    model.col(0) = Eigen::Vector4f(parameters_.calPoint1Model[0], parameters_.calPoint1Model[1], parameters_.calPoint1Model[2], 1);
-    ref.col(0) = Eigen::Vector4f(parameters_.calPoint1Ref[0], parameters_.calPoint1Ref[1], parameters_.calPoint1Ref[2], 1);
-
-    model.col(1) = Eigen::Vector4f(parameters_.calPoint2Model[0], parameters_.calPoint2Model[1], parameters_.calPoint2Model[2], 1);
-    ref.col(1) = Eigen::Vector4f(parameters_.calPoint2Ref[0], parameters_.calPoint2Ref[1], parameters_.calPoint2Ref[2], 1);
-
-    model.col(2) = Eigen::Vector4f(parameters_.calPoint3Model[0], parameters_.calPoint3Model[1], parameters_.calPoint3Model[2], 1);
-    ref.col(2) = Eigen::Vector4f(parameters_.calPoint3Ref[0], parameters_.calPoint3Ref[1], parameters_.calPoint3Ref[2], 1);
-
-    model.col(3) = Eigen::Vector4f(parameters_.calPoint4Model[0], parameters_.calPoint4Model[1], parameters_.calPoint4Model[2], 1);
-    ref.col(3) = Eigen::Vector4f(parameters_.calPoint4Ref[0], parameters_.calPoint4Ref[1], parameters_.calPoint4Ref[2], 1);
-
-    auto transform = Eigen::umeyama(model, ref);
-    for (int i = 0; i < mvs_scene_->mesh.vertices.size(); i++) {
-        MVS::Mesh::Vertex vertex = mvs_scene_->mesh.vertices[i];
-        auto v = Eigen::Vector4f(vertex[0], vertex[1], vertex[2], 1);
-        v = transform * v;
-        mvs_scene_->mesh.vertices[i][0] = v.x();
-        mvs_scene_->mesh.vertices[i][1] = v.y();
-        mvs_scene_->mesh.vertices[i][2] = v.z();
+    Eigen::Matrix3Xf model(3, 4);
+    Eigen::Matrix3Xf ref(3, 4);
+
+    model.col(0) = Eigen::Vector3f(parameters_.calPoint1Model[0], parameters_.calPoint1Model[1], parameters_.calPoint1Model[2]);
+    ref.col(0) = Eigen::Vector3f(parameters_.calPoint1Ref[0], parameters_.calPoint1Ref[1], parameters_.calPoint1Ref[2]);
+
+    model.col(1) = Eigen::Vector3f(parameters_.calPoint2Model[0], parameters_.calPoint2Model[1], parameters_.calPoint2Model[2]);
+    ref.col(1) = Eigen::Vector3f(parameters_.calPoint2Ref[0], parameters_.calPoint2Ref[1], parameters_.calPoint2Ref[2]);
+
+    model.col(2) = Eigen::Vector3f(parameters_.calPoint3Model[0], parameters_.calPoint3Model[1], parameters_.calPoint3Model[2]);
+    ref.col(2) = Eigen::Vector3f(parameters_.calPoint3Ref[0], parameters_.calPoint3Ref[1], parameters_.calPoint3Ref[2]);
+
+    model.col(3) = Eigen::Vector3f(parameters_.calPoint4Model[0], parameters_.calPoint4Model[1], parameters_.calPoint4Model[2]);
+    ref.col(3) = Eigen::Vector3f(parameters_.calPoint4Ref[0], parameters_.calPoint4Ref[1], parameters_.calPoint4Ref[2]);
+
+    Eigen::Matrix4f transform = Eigen::umeyama(model, ref);
+
+    // Vertices are transformed on write, the live scene is never modified
+    std::string filename = reconstructionFolder + model_filename();
+    bool success = false;
+    switch (parameters_.modelFormat) {
+        case MODEL_FORMAT_PLY:
+            success = write_model_ply(filename, transform);
+            break;
+        case MODEL_FORMAT_OBJ:
+            success = write_model_obj(filename, transform);
+            break;
+        default:
+            success = write_model_mvs(filename, transform);
+            break;
+    }
+
+    if (success) {
+        log_stream_ << "EXPORT 3D model finished: " << filename << std::endl;
+    } else {
+        log_stream_ << "EXPORT 3D model failed: " << filename << std::endl;
+    }
+}
+
+std::string PTAMExportPlugin::model_filename() const {
+    static const char* extensions[] = { ".mvs", ".ply", ".obj" };
+    std::string filename(parameters_.modelPath);
+    std::string::size_type dot = filename.find_last_of('.');
+    if (dot != std::string::npos && filename.find('/', dot) == std::string::npos) {
+        filename.resize(dot);
+    }
+    return filename + extensions[parameters_.modelFormat];
+}
+
+void PTAMExportPlugin::transform_vertices(const Eigen::Matrix4f& transform, int begin, int end, float* out) const {
+    const Eigen::Matrix3f sR = transform.topLeftCorner<3, 3>();
+    const Eigen::Vector3f t = transform.topRightCorner<3, 1>();
+    const int numThreads = reconstruction_builder_->GetOptions().num_threads;
+
+    #pragma omp parallel for num_threads(numThreads)
+    for (int i = begin; i < end; i++) {
+        const MVS::Mesh::Vertex& vertex = mvs_scene_->mesh.vertices[i];
+        Eigen::Map<Eigen::Vector3f> v(out + 3 * (i - begin));
+        v = sR * Eigen::Vector3f(vertex.x, vertex.y, vertex.z) + t;
     }
+}
+
+bool PTAMExportPlugin::write_model_mvs(const std::string& filename, const Eigen::Matrix4f& transform) {
+    // Scene is saved with a transformed copy of the vertices swapped in, the original
+    // array is swapped back by the guard, also if Save throws (no round trip through the
+    // inverse transform)
+    struct VertexSwapGuard {
+        MVS::Mesh::VertexArr& a;
+        MVS::Mesh::VertexArr& b;
+        VertexSwapGuard(MVS::Mesh::VertexArr& first, MVS::Mesh::VertexArr& second) : a(first), b(second) {
+            a.Swap(b);
+        }
+        ~VertexSwapGuard() {
+            a.Swap(b);
+        }
+    };
 
-    mvs_scene_->Save(reconstructionFolder + parameters_.modelPath);
+    const int numVertices = mvs_scene_->mesh.vertices.size();
+    static_assert(sizeof(MVS::Mesh::Vertex) == 3 * sizeof(float), "Vertex must be packed xyz");
+    MVS::Mesh::VertexArr vertices;
+    vertices.Resize(numVertices);
+    transform_vertices(transform, 0, numVertices, reinterpret_cast<float*>(vertices.Begin()));
 
-    for (int i = 0; i < mvs_scene_->mesh.vertices.size(); i++) {
-        MVS::Mesh::Vertex vertex = mvs_scene_->mesh.vertices[i];
-        auto v = Eigen::Vector4f(vertex[0], vertex[1], vertex[2], 1);
-        v = transform.inverse() * v;
-        mvs_scene_->mesh.vertices[i][0] = v.x();
-        mvs_scene_->mesh.vertices[i][1] = v.y();
-        mvs_scene_->mesh.vertices[i][2] = v.z();
+    VertexSwapGuard guard(mvs_scene_->mesh.vertices, vertices);
+    return mvs_scene_->Save(filename);
+}
+
+bool PTAMExportPlugin::write_model_ply(const std::string& filename, const Eigen::Matrix4f& transform) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
     }
 
-    log_stream_ << "EXPORT 3D model finished" << std::endl;
+    const int numVertices = mvs_scene_->mesh.vertices.size();
+    const int numFaces = mvs_scene_->mesh.faces.size();
+    file << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "element vertex " << numVertices << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n"
+         << "element face " << numFaces << "\n"
+         << "property list uchar uint vertex_indices\n"
+         << "end_header\n";
+
+    // Vertices are transformed and written one block at a time
+    std::vector<float> vertexBlock;
+    for (int begin = 0; begin < numVertices; begin += kModelBlockSize) {
+        int end = std::min(begin + kModelBlockSize, numVertices);
+        vertexBlock.resize(3 * (end - begin));
+        transform_vertices(transform, begin, end, vertexBlock.data());
+        file.write(reinterpret_cast<const char*>(vertexBlock.data()), vertexBlock.size() * sizeof(float));
+    }
+
+    const int faceSize = sizeof(uint8_t) + 3 * sizeof(uint32_t);
+    std::vector<char> faceBlock;
+    for (int begin = 0; begin < numFaces; begin += kModelBlockSize) {
+        int end = std::min(begin + kModelBlockSize, numFaces);
+        faceBlock.resize(faceSize * (end - begin));
+        char* out = faceBlock.data();
+        for (int i = begin; i < end; i++) {
+            const MVS::Mesh::Face& face = mvs_scene_->mesh.faces[i];
+            uint32_t indices[3] = { face[0], face[1], face[2] };
+            *out = 3;
+            std::memcpy(out + 1, indices, sizeof(indices));
+            out += faceSize;
+        }
+        file.write(faceBlock.data(), faceBlock.size());
+    }
+    return file.good();
+}
+
+bool PTAMExportPlugin::write_model_obj(const std::string& filename, const Eigen::Matrix4f& transform) {
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    const int numVertices = mvs_scene_->mesh.vertices.size();
+    const int numFaces = mvs_scene_->mesh.faces.size();
+    std::vector<float> vertexBlock;
+    char line[128];
+    for (int begin = 0; begin < numVertices; begin += kModelBlockSize) {
+        int end = std::min(begin + kModelBlockSize, numVertices);
+        vertexBlock.resize(3 * (end - begin));
+        transform_vertices(transform, begin, end, vertexBlock.data());
+        for (int i = 0; i < end - begin; i++) {
+            int length = std::snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n",
+                                       vertexBlock[3 * i], vertexBlock[3 * i + 1], vertexBlock[3 * i + 2]);
+            file.write(line, length);
+        }
+    }
+
+    for (int i = 0; i < numFaces; i++) {
+        const MVS::Mesh::Face& face = mvs_scene_->mesh.faces[i];
+        int length = std::snprintf(line, sizeof(line), "f %u %u %u\n", face[0] + 1, face[1] + 1, face[2] + 1);
+        file.write(line, length);
+    }
+    return file.good();
 }
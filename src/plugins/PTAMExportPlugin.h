@@ -10,15 +10,23 @@
 #include <imguizmo/ImGuizmo.h>
 #include <OpenMVS/MVS.h>
 #include <reconstruction/RealtimeReconstructionBuilder.h>
+#include <render/MeshResource.h>
 
 class PTAMExportPlugin : public igl::opengl::glfw::ViewerPlugin {
 public:
 
-    PTAMExportPlugin(const std::string &reconstruction_path, std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder, std::shared_ptr<MVS::Scene> mvs_scene) :
+    PTAMExportPlugin(const std::string &reconstruction_path, std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder, std::shared_ptr<MVS::Scene> mvs_scene, std::shared_ptr<MeshResource> mesh_resource) :
     reconstruction_builder_(reconstruction_builder),
     mvs_scene_(mvs_scene),
+    mesh_resource_(mesh_resource),
     reconstructionFolder(reconstruction_path){}
 
+    enum ModelFormat {
+        MODEL_FORMAT_MVS = 0,
+        MODEL_FORMAT_PLY = 1,
+        MODEL_FORMAT_OBJ = 2
+    };
+
     struct Parameters {
         bool show_mesh = true;
 
@@ -39,6 +47,10 @@ public:
         float scaleDistance = 0;
 
         char modelPath[128] = "3d_model_in_ref.mvs";
+        int modelFormat = MODEL_FORMAT_MVS;
+
+        // Streamed chunked format instead of the cereal archive
+        bool compactFormat = false;
     };
 
     void init(igl::opengl::glfw::Viewer *_viewer) override;
@@ -55,12 +67,19 @@ private:
     unsigned int VIEWER_DATA_MESH;
     unsigned int VIEWER_DATA_CAL_POINTS;
 
+    // Vertices processed (and points buffered) per export step
+    static constexpr int kExportChunkSize = 65536;
+    // Vertices and faces transformed (and buffered) per model write step
+    static constexpr int kModelBlockSize = 65536;
+
     bool pointsSet = false;
     std::ostream& log_stream_ = std::cout;
 
     // Reconstruction
     std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder_;
     std::shared_ptr<MVS::Scene> mvs_scene_;
+    std::shared_ptr<MeshResource> mesh_resource_;
+    uint64_t mesh_generation_ = 0;
     // Calibration points
     Eigen::MatrixXd cal_points_ = Eigen::MatrixXd(4, 3);
 
@@ -72,6 +91,11 @@ private:
     void set_cal_points();
     void export_scene();
     void export_model();
+    std::string model_filename() const;
+    void transform_vertices(const Eigen::Matrix4f& transform, int begin, int end, float* out) const;
+    bool write_model_mvs(const std::string& filename, const Eigen::Matrix4f& transform);
+    bool write_model_ply(const std::string& filename, const Eigen::Matrix4f& transform);
+    bool write_model_obj(const std::string& filename, const Eigen::Matrix4f& transform);
 };
 
 #endif //REALTIME_RECONSTRUCTION_PTAMEXPORTPLUGIN_H
@@ -8,6 +8,7 @@
 #include <utility>
 #include <algorithm>
 #include <fstream>
+#include <thread>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -29,6 +30,7 @@ ReconstructionPlugin::ReconstructionPlugin(Parameters parameters,
                                            std::shared_ptr<std::vector<std::string>> image_names,
                                            std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder,
                                            std::shared_ptr<MVS::Scene> mvs_scene,
+                                           std::shared_ptr<MeshResource> mesh_resource,
                                            std::shared_ptr<QualityMeasure> quality_measure)
         : parameters_(parameters),
           images_path_(std::move(images_path)),
@@ -36,6 +38,7 @@ ReconstructionPlugin::ReconstructionPlugin(Parameters parameters,
           image_names_(std::move(image_names)),
           reconstruction_builder_(std::move(reconstruction_builder)),
           mvs_scene_(std::move(mvs_scene)),
+          mesh_resource_(std::move(mesh_resource)),
           quality_measure_(std::move(quality_measure)) {}
 
 void ReconstructionPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
@@ -58,6 +61,15 @@ void ReconstructionPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
 }
 
 bool ReconstructionPlugin::post_draw() {
+    // Chunked mesh, drawn before any menus so overlays stay on top
+    if (chunked_mesh_) {
+        chunked_mesh_->Upload();
+        if (parameters_.show_mesh) {
+            chunked_mesh_->Draw(viewer->core.view, viewer->core.proj, viewer->core.viewport,
+                                parameters_.show_texture, parameters_.show_wireframe);
+        }
+    }
+
     // Text labels
     if (parameters_.show_labels) {
         draw_labels_window();
@@ -188,6 +200,30 @@ bool ReconstructionPlugin::post_draw() {
             viewer->selected_data_index = VIEWER_DATA_MESH;
             viewer->data().show_lines = parameters_.show_wireframe;
         }
+        if (mesh_resource_->NumLevels() > 1) {
+            if (ImGui::SliderInt("Nivo modela", &parameters_.display_level, 0, mesh_resource_->NumLevels() - 1)) {
+                mesh_generation_ = 0;
+                set_mesh();
+            }
+        } else if (parameters_.display_level != 0) {
+            // Levels were dropped with a changed mesh
+            parameters_.display_level = 0;
+            mesh_generation_ = 0;
+            set_mesh();
+        }
+        if (chunked_mesh_) {
+            if (ImGui::SliderFloat("Podrobnost (px/F)", &parameters_.lod_pixels_per_face, 0.5f, 32.0f)) {
+                chunked_mesh_->SetPixelsPerFace(parameters_.lod_pixels_per_face);
+            }
+            std::ostringstream os;
+            os << "Kosi: " << chunked_mesh_->NumDrawnChunks() << "/" << chunked_mesh_->NumChunks()
+               << "\t" << chunked_mesh_->NumDrawnFaces() << " F"
+               << "\t" << chunked_mesh_->GPUMemoryUsage() / (1 << 20) << " MB";
+            ImGui::TextUnformatted(os.str().c_str());
+            if (!chunked_mesh_->Done()) {
+                ImGui::ProgressBar(chunked_mesh_->Progress(), ImVec2(-1, 0), "Nalaganje modela");
+            }
+        }
         ImGui::SliderInt("Velikost tock", &parameters_.point_size, 1, 10);
         for (auto& viewer_data : viewer->data_list) {
             if (viewer_data.point_size != parameters_.point_size) {
@@ -229,6 +265,11 @@ bool ReconstructionPlugin::post_draw() {
     return false;
 }
 
+void ReconstructionPlugin::shutdown() {
+    // GL objects are released while the context still exists
+    chunked_mesh_.reset();
+}
+
 std::shared_ptr<RealtimeReconstructionBuilder> ReconstructionPlugin::get_reconstruction_builder() {
     return reconstruction_builder_;
 }
@@ -253,6 +294,16 @@ void ReconstructionPlugin::save_scene_callback() {
         mvs_scene_->mesh.Save(reconstruction_path_ + filename_ply);
         log_stream_ << "Scene written to: \n\t" << (reconstruction_path_ + filename_ply) << std::endl;
     }
+
+    // Sparse reconstruction session (to continue extending after load)
+    if (reconstruction_builder_->IsInitialized()) {
+        std::string filename_session = std::string(parameters_.filename_buffer) + ".session";
+        if (reconstruction_builder_->SaveSession(reconstruction_path_ + filename_session)) {
+            log_stream_ << "Session written to: \n\t" << (reconstruction_path_ + filename_session) << std::endl;
+        } else {
+            log_stream_ << "Session not written: " << reconstruction_builder_->GetMessage() << std::endl;
+        }
+    }
 }
 
 void ReconstructionPlugin::load_scene_callback() {
@@ -260,12 +311,39 @@ void ReconstructionPlugin::load_scene_callback() {
 
     std::string filename_mvs = std::string(parameters_.filename_buffer) + ".mvs";
     mvs_scene_->Load(reconstruction_path_ + filename_mvs);
+    mesh_resource_->Invalidate();
     set_mesh();
     set_cameras();
     show_mesh(true);
     show_point_cloud(false);
     center_object_callback();
     log_stream_ << "Scene loaded from: \n\t" << (reconstruction_path_ + filename_mvs) << std::endl;
+
+    // Sparse reconstruction session
+    std::string filename_session = std::string(parameters_.filename_buffer) + ".session";
+    if (theia::FileExists(reconstruction_path_ + filename_session)) {
+        auto time_begin = std::chrono::steady_clock::now();
+        bool success = reconstruction_builder_->LoadSession(reconstruction_path_ + filename_session);
+        auto time_end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> time_elapsed = time_end - time_begin;
+
+        if (success) {
+            log_stream_ << "Session loaded from: \n\t" << (reconstruction_path_ + filename_session)
+                        << " (" << time_elapsed.count() << " s)" << std::endl;
+            reconstruction_builder_->PrintStatistics(log_stream_, false, true, false);
+
+            // Continue after the last image in reconstruction
+            const theia::Reconstruction& reconstruction = reconstruction_builder_->GetReconstruction();
+            for (int i = 0; i < image_names_->size(); i++) {
+                if (reconstruction.ViewIdFromName((*image_names_)[i]) != theia::kInvalidViewId) {
+                    parameters_.next_image_idx = i + 1;
+                }
+            }
+            set_point_cloud();
+        } else {
+            log_stream_ << "Session not loaded: " << reconstruction_builder_->GetMessage() << std::endl;
+        }
+    }
 }
 
 void ReconstructionPlugin::save_calibration_callback() {
@@ -477,6 +555,7 @@ void ReconstructionPlugin::reconstruct_mesh_callback() {
 
         // Recompute array of vertices incident to each vertex
         mvs_scene_->mesh.ListIncidenteFaces();
+        mesh_resource_->Invalidate();
         set_mesh();
     } else {
         log_stream_ << "Reconstruct mesh failed: Pointcloud is empty." << std::endl;
@@ -526,6 +605,7 @@ void ReconstructionPlugin::refine_mesh_callback() {
                     << mvs_scene_->mesh.vertices.GetSize() << " vertices, "
                     << mvs_scene_->mesh.faces.GetSize() << " faces." << std::endl;
 
+        mesh_resource_->Invalidate();
         set_mesh();
     } else {
         log_stream_ << "Refine mesh failed: Mesh is empty." << std::endl;
@@ -556,6 +636,7 @@ void ReconstructionPlugin::texture_mesh_callback() {
         auto time_end = std::chrono::steady_clock::now();
         std::chrono::duration<double> time_elapsed = time_end - time_begin;
         log_stream_ << "Texture mesh time: " << time_elapsed.count() << " s" << std::endl;
+        mesh_resource_->Invalidate();
         set_mesh();
     } else {
         log_stream_ << "Texture mesh failed: Mesh is empty." << std::endl;
@@ -580,7 +661,7 @@ void ReconstructionPlugin::pixels_per_area_callback() {
 
     // Set color
     if (!ppa.empty()) {
-        viewer->selected_data_index = VIEWER_DATA_MESH;
+        set_full_mesh();
         assert(viewer->data().F.rows() == ppa.size());
         auto num_faces = viewer->data().F.rows();
         Eigen::VectorXd measure(num_faces);
@@ -621,7 +702,7 @@ void ReconstructionPlugin::ground_sampling_distance_callback() {
 
     // Set color
     if (!gsd.empty()) {
-        viewer->selected_data_index = VIEWER_DATA_MESH;
+        set_full_mesh();
         assert(viewer->data().F.rows() == gsd.size());
         auto num_faces = viewer->data().F.rows();
 
@@ -663,7 +744,7 @@ void ReconstructionPlugin::mean_pixels_per_area_callback() {
 
     // Set color
     if (!mpa.empty()) {
-        viewer->selected_data_index = VIEWER_DATA_MESH;
+        set_full_mesh();
         assert(viewer->data().F.rows() == mpa.size());
 
         auto num_faces = viewer->data().F.rows();
@@ -684,6 +765,9 @@ void ReconstructionPlugin::center_object_callback() {
     if (points.rows() == 0 && viewer->data().V.rows() > 0) {
         points = viewer->data().V;
     }
+    if (points.rows() == 0 && chunked_mesh_) {
+        points = mesh_resource_->V();
+    }
     viewer->selected_data_index = VIEWER_DATA_POINT_CLOUD;
     if (points.rows() == 0 && viewer->data().points.rows() > 0) {
         points = viewer->data().points.leftCols(3);
@@ -841,74 +925,43 @@ void ReconstructionPlugin::show_point_cloud(bool visible) {
     viewer->data().show_overlay = visible;
 }
 
-void ReconstructionPlugin::set_mesh() {
+void ReconstructionPlugin::set_mesh(bool allow_chunked) {
     viewer->selected_data_index = VIEWER_DATA_MESH;
-    viewer->data().clear();
-
-    // Add vertices
-    int num_vertices = mvs_scene_->mesh.vertices.size();
-    Eigen::MatrixXd V(num_vertices, 3);
-    for (int i = 0; i < num_vertices; i++) {
-        MVS::Mesh::Vertex vertex = mvs_scene_->mesh.vertices[i];
-        V(i, 0) = vertex[0];
-        V(i, 1) = vertex[1];
-        V(i, 2) = vertex[2];
-    }
-    // Add faces
-    int num_faces = mvs_scene_->mesh.faces.size();
-    Eigen::MatrixXi F(num_faces, 3);
-    for (int i = 0; i < num_faces; i++) {
-        MVS::Mesh::Face face = mvs_scene_->mesh.faces[i];
-        F(i, 0) = face[0];
-        F(i, 1) = face[1];
-        F(i, 2) = face[2];
-    }
-    viewer->data().set_mesh(V, F);
-    viewer->data().show_lines = parameters_.show_wireframe;
 
-    // Add texture if available
-    if (!mvs_scene_->mesh.faceTexcoords.IsEmpty()) {
-
-        // Set UVs
-        int num_texcoords = mvs_scene_->mesh.faceTexcoords.size();
-        Eigen::MatrixXd TC(num_texcoords, 2);
-        for (int i = 0; i < num_texcoords; i++) {
-            MVS::Mesh::TexCoord texcoord = mvs_scene_->mesh.faceTexcoords[i];
-            TC(i, 0) = texcoord[0];
-            TC(i, 1) = texcoord[1];
-        }
-        Eigen::MatrixXi FTC(num_faces, 3);
-        for (int i = 0; i < num_faces; i++) {
-            FTC(i, 0) = i*3 + 0;
-            FTC(i, 1) = i*3 + 1;
-            FTC(i, 2) = i*3 + 2;
-        }
-        viewer->data().set_uv(TC, FTC);
-
-        // Set texture
-        SEACAVE::Image8U3 img = mvs_scene_->mesh.textureDiffuse;
-        int width = img.width();
-        int height = img.height();
-
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> R(width, height);
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> G(width, height);
-        Eigen::Matrix<unsigned char,Eigen::Dynamic,Eigen::Dynamic> B(width, height);
-
-        for (int i = 0; i < width; i++) {
-            for (int j = 0; j < height; j++) {
-                Pixel8U pixel = img.getPixel(j, i);
-                R(i, j) = pixel.r;
-                G(i, j) = pixel.g;
-                B(i, j) = pixel.b;
-            }
+    // Large meshes are drawn by the chunked renderer instead of the viewer
+    const int num_faces = static_cast<int>(mvs_scene_->mesh.faces.size());
+    if (allow_chunked && parameters_.chunked_min_faces > 0 && num_faces >= parameters_.chunked_min_faces &&
+        parameters_.display_level == 0) {
+        const uint64_t generation = mesh_resource_->Generation();
+        if (!chunked_mesh_ || chunked_generation_ != generation) {
+            ChunkedMesh::Options options;
+            options.pixels_per_face = parameters_.lod_pixels_per_face;
+            options.num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+            chunked_mesh_ = std::make_unique<ChunkedMesh>(mvs_scene_->mesh, options);
+            chunked_generation_ = generation;
+            viewer->data().clear();
+            mesh_generation_ = 0;
         }
+        return;
+    }
+    chunked_mesh_.reset();
+    chunked_generation_ = 0;
 
-        viewer->data().set_colors(Eigen::RowVector3d(1, 1, 1));
-        viewer->data().set_texture(R.rowwise().reverse(), G.rowwise().reverse(), B.rowwise().reverse());
+    mesh_resource_->SetMesh(viewer->data(), &mesh_generation_, true, parameters_.display_level);
+    viewer->data().show_lines = parameters_.show_wireframe;
+    if (mesh_resource_->HasTexture()) {
         viewer->data().show_texture = parameters_.show_texture;
     }
 }
 
+void ReconstructionPlugin::set_full_mesh() {
+    // Quality measures have one value per face of the full mesh, not of a LOD level
+    parameters_.display_level = 0;
+    mesh_generation_ = 0;
+    set_mesh(false);
+    viewer->selected_data_index = VIEWER_DATA_MESH;
+}
+
 void ReconstructionPlugin::show_mesh(bool visible) {
     parameters_.show_mesh = visible;
     viewer->selected_data_index = VIEWER_DATA_MESH;
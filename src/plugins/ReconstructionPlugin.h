@@ -13,6 +13,8 @@
 
 #include "reconstruction/RealtimeReconstructionBuilder.h"
 #include "nbv/QualityMeasure.h"
+#include "render/ChunkedMesh.h"
+#include "render/MeshResource.h"
 
 class ReconstructionPlugin : public igl::opengl::glfw::ViewerPlugin {
 public:
@@ -109,6 +111,12 @@ public:
         bool show_mesh = true;
         bool show_texture = false;
         bool show_wireframe = false;
+        // Shown level of the mesh LOD chain (0 - full mesh)
+        int display_level = 0;
+        // Meshes with at least this many faces are drawn in chunks with levels of detail (0 - disabled)
+        int chunked_min_faces = 500000;
+        // Projected pixels per face below which a coarser level of a chunk is drawn
+        float lod_pixels_per_face = 4.0f;
         char filename_buffer[64] = "filename";
         bool auto_ply = false;
         bool auto_reconstruct = true;
@@ -121,10 +129,12 @@ public:
                          std::shared_ptr<std::vector<std::string>> image_names,
                          std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder,
                          std::shared_ptr<MVS::Scene> mvs_scene,
+                         std::shared_ptr<MeshResource> mesh_resource,
                          std::shared_ptr<QualityMeasure> quality_measure);
 
     void init(igl::opengl::glfw::Viewer *_viewer) override;
     bool post_draw() override;
+    void shutdown() override;
 
     // Accessors
     std::shared_ptr<RealtimeReconstructionBuilder> get_reconstruction_builder();
@@ -190,6 +200,11 @@ private:
     // Reconstruction
     std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder_;
     std::shared_ptr<MVS::Scene> mvs_scene_;
+    std::shared_ptr<MeshResource> mesh_resource_;
+    uint64_t mesh_generation_ = 0;
+    // Renderer of large meshes, the viewer data of the mesh stays empty while it is used
+    std::unique_ptr<ChunkedMesh> chunked_mesh_;
+    uint64_t chunked_generation_ = 0;
 
     // Quality measure
     std::shared_ptr<QualityMeasure> quality_measure_;
@@ -205,7 +220,10 @@ private:
     void set_point_cloud();
     void show_point_cloud(bool visible);
 
-    void set_mesh();
+    // Per face colors need the mesh in the viewer data (allow_chunked = false)
+    void set_mesh(bool allow_chunked = true);
+    // Full resolution mesh in the viewer (for per face colors)
+    void set_full_mesh();
     void show_mesh(bool visible);
 };
 
@@ -1,5 +1,7 @@
 #include "RenderPlugin.h"
 
+#include <thread>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <imgui_impl_glfw_gl3.h>
@@ -79,6 +81,7 @@ bool RenderPlugin::post_draw() {
     // Initialization
     if (ImGui::TreeNodeEx("Moznosti prikaza", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::InputText("Ime datoteke", mesh_name_, 128, ImGuiInputTextFlags_AutoSelectAll);
+        ImGui::Checkbox("Stisnjena tekstura", &compress_texture_);
         if (ImGui::Button("Odpri (PLY, OBJ)", ImVec2(-1, 0))) {
             load_scene_callback();
         }
@@ -129,6 +132,11 @@ bool RenderPlugin::post_draw() {
                 render_pose_world_aligned_ = align_transform_ * glm::inverse(generated_poses_[selected_pose_]);
             }
         }
+        ImGui::Combo("Format", &dome_format_, "Raw\0PNG\0JPEG\0FloatImage\0");
+        ImGui::SliderInt("Medpomnilniki", &dome_num_buffers_, 1, 4);
+        if (ImGui::Button("Upodobi vse poze", ImVec2(-1, 0))) {
+            render_dome_callback();
+        }
         if (ImGui::Button("Shrani transformacijo", ImVec2(-1, 0))) {
             save_render_cameras_gizmo();
         }
@@ -231,6 +239,7 @@ bool RenderPlugin::post_draw() {
             }
             ImGui::SameLine();
             ImGui::Checkbox("Auto##savequality", &auto_save_quality_);
+            ImGui::Checkbox("Kvaliteta tudi kot besedilo", &quality_text_export_);
 
             if (ImGui::Button("Shrani podatke uporabljanja", ImVec2(-70, 0))) {
                 save_render_stats_callback();
@@ -319,7 +328,7 @@ void RenderPlugin::load_scene_callback() {
     mvs_mesh_.Load(fullpath);
 
     // Initialize render mesh
-    render_->Initialize(mvs_mesh_);
+    render_->Initialize(mvs_mesh_, compress_texture_);
     set_render_mesh(mvs_mesh_);
     show_render_mesh(true);
 
@@ -355,6 +364,25 @@ void RenderPlugin::save_render_callback() {
     log_stream_ << "Render: Image saved to: \n\t" + fullname << std::endl;
 }
 
+void RenderPlugin::render_dome_callback() {
+    if (!render_->GetMesh() || generated_poses_.empty()) {
+        log_stream_ << "Render Error: Scene or render poses not loaded." << std::endl;
+        return;
+    }
+
+    BatchRender::Options options;
+    options.format = static_cast<BatchRender::Format>(dome_format_);
+    options.num_buffers = dome_num_buffers_;
+    options.num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    options.folder = evaluation_folder_;
+    options.prefix = "dome";
+
+    BatchRender batch_render(render_, camera_intrinsics_, options);
+    BatchRender::Stats stats = batch_render.RenderPoses(generated_poses_);
+    log_stream_ << "Render: " << stats.num_frames << " poses in " << stats.total_time << " s ("
+                << stats.FramesPerSecond() << " fps, rendering " << stats.render_time << " s)" << std::endl;
+}
+
 void RenderPlugin::initialize_generated_callback() {
     if (!reconstruction_plugin_) {
         log_stream_ << "Render Error: Reconstruction plugin not present." << std::endl;
@@ -446,36 +474,29 @@ void RenderPlugin::extend_nbv_callback() {
     std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder =
             reconstruction_plugin_->get_reconstruction_builder();
 
-    bool success = false;
-    int i = 0;
-    for (i = 0; i < best_views.size(); i++) {
-        // Try to localize suggested view
-        render_pose_world_aligned_ = glm::inverse(best_views[i]);
-        render_callback();
-
-        // Convert render to theia image
-        int width = camera_intrinsics_.image_width;
-        int height = camera_intrinsics_.image_height;
-        int channels = 3;
-        theia::FloatImage image(width, height, channels);
-        for (int row = 0; row < height; row++) {
-            for (int col = 0; col < width; col++) {
-                for (int c = 0; c < channels; c++) {
-                    unsigned int val_int = render_data_[c + channels * col  + width * channels * row];
-                    float val_float = static_cast<float>(val_int) / std::numeric_limits<unsigned char>::max();
-                    image.SetRowCol(height - row - 1, col, c, val_float);
-                }
-            }
-        }
-
-        // Localization
+    // Render poses of the suggested views
+    std::vector<glm::mat4> render_poses;
+    for (const auto& best_view : best_views) {
+        render_poses.push_back(glm::inverse(glm::inverse(align_transform_) * glm::inverse(best_view)));
+    }
+
+    // Grayscale renders are localized as is while the next views render, until one localizes
+    GrayImage image;
+    image.width = camera_intrinsics_.image_width;
+    image.height = camera_intrinsics_.image_height;
+    BatchRender::Options options;
+    options.num_buffers = 2;
+    BatchRender batch_render(render_, camera_intrinsics_, options);
+    int i = batch_render.RenderGrayPosesUntil(render_poses,
+            [&](int, const std::vector<unsigned char>& gray) {
+        image.data = gray.data();
         theia::CalibratedAbsolutePose tmp_pose;
-        success = reconstruction_builder->LocalizeImage(image, tmp_pose);
-        if (success) break;
-    }
+        return reconstruction_builder->LocalizeImage(image, tmp_pose);
+    });
 
-    if (success) {
+    if (i >= 0) {
         log_stream_ << "Render: NBV pose set to view number: " << i << std::endl;
+        render_pose_world_aligned_ = glm::inverse(best_views[i]);
         extend_manual_callback(i);
     } else {
         log_stream_ << "Render: NBV Localization failed." << std::endl;
@@ -502,9 +523,9 @@ void RenderPlugin::extend_many_nbv_callback() {
         }
 
 
-        // Check if MSE too big
-        glm::mat4 transform = render_stats_.ComputeTransformation();
-        double mse = render_stats_.ComputeMSE(transform);
+        // Check if MSE too big (after alignment, updated with every added view)
+        double ate = render_stats_.ComputeATE();
+        double mse = ate * ate;
         if (mse > 0.1) {
             log_stream_ << "Render: MSE too big: " << mse << std::endl;
             break;
@@ -619,12 +640,19 @@ void RenderPlugin::save_quality_callback() {
     std::string filename;
     std::string fullname;
 
+    // Values are tagged with the hash of the faces they belong to
+    const auto& faces = reconstruction_scene->mesh.faces;
+    uint64_t faces_hash = hashBytes(faces.Begin(), faces.size() * sizeof(MVS::Mesh::Face));
+
     // Save PPA measure
     log_stream_ << "Render: Computing PPA ..." << std::endl;
     std::vector<double> ppa = quality_measure->pixelsPerArea();
     filename = ss.str() + ".ppa";
     fullname = evaluation_folder_ + filename;
-    if (writeVectorToFile(fullname, ppa)) {
+    if (writeVectorToBinaryFile(fullname + ".bin", ppa, faces_hash)) {
+        log_stream_ << "Render: PPA written to: \n\t" << fullname << ".bin" << std::endl;
+    }
+    if (quality_text_export_ && writeVectorToFile(fullname, ppa)) {
         log_stream_ << "Render: PPA written to: \n\t" << fullname << std::endl;
     }
 
@@ -633,7 +661,10 @@ void RenderPlugin::save_quality_callback() {
     std::vector<double> gsd = quality_measure->groundSamplingDistance();
     filename = ss.str() + ".gsd";
     fullname = evaluation_folder_ + filename;
-    if (writeVectorToFile(fullname, gsd)) {
+    if (writeVectorToBinaryFile(fullname + ".bin", gsd, faces_hash)) {
+        log_stream_ << "Render: GSD written to: \n\t" << fullname << ".bin" << std::endl;
+    }
+    if (quality_text_export_ && writeVectorToFile(fullname, gsd)) {
         log_stream_ << "Render: GSD written to: \n\t" << fullname << std::endl;
     }
 
@@ -648,9 +679,10 @@ void RenderPlugin::save_quality_callback() {
 }
 
 void RenderPlugin::save_render_stats_callback() {
-    std::string filename = images_folder_ + "render_stats.txt";
+    std::string filename = images_folder_ + "render_stats";
     render_stats_.WriteStatsToFile(filename);
-    log_stream_ << "Render: Render stats saved to: \n\t" << filename << std::endl;
+    log_stream_ << "Render: Render stats saved to: \n\t" << filename << ".csv, .json (ATE "
+                << render_stats_.ComputeATE() << ", RPE " << render_stats_.ComputeRPE() << ")" << std::endl;
 }
 
 void RenderPlugin::show_camera() {
@@ -14,6 +14,7 @@
 #include <glm/gtc/matrix_access.hpp>
 
 #include "imguizmo/ImGuizmo.h"
+#include "render/BatchRender.h"
 #include "render/Render.h"
 #include "render/RenderStats.h"
 #include "reconstruction/RealtimeReconstructionBuilder.h"
@@ -38,6 +39,7 @@ public:
     void load_scene_callback();
     void render_callback();
     void save_render_callback();
+    void render_dome_callback();
 
     // Plugin link callbacks
     void initialize_generated_callback();
@@ -97,12 +99,16 @@ private:
     std::string evaluation_folder_;
     bool auto_save_mesh_ = true;
     bool auto_save_quality_ = false;
+    // Quality is written as binary arrays, and as text if set
+    bool quality_text_export_ = false;
     bool auto_save_render_stats_ = true;
     int nbv_extend_count_ = 69;
     int gen_extend_count_ = 69;
 
     // Render
     MVS::Mesh mvs_mesh_;
+    // Texture is compressed by the driver when the scene is loaded (less GPU memory)
+    bool compress_texture_ = false;
     glm::mat4 align_transform_ = glm::mat4(1.0f);
     bool auto_align_ = true;
 
@@ -116,6 +122,9 @@ private:
     int camera_density_ = 20;
     std::vector<glm::mat4> generated_poses_;
     int selected_pose_ = 0;
+    // Batch rendering of the generated poses (BatchRender::Format, pixel buffers in flight)
+    int dome_format_ = 1;
+    int dome_num_buffers_ = 3;
 
     // Log
     std::ostream& log_stream_ = std::cout;
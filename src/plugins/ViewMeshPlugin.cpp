@@ -78,27 +78,63 @@ void ViewMeshPlugin::load_quality_callback() {
     // Open file
     std::string tmp(quality_name_);
     std::string fullpath = project_folder_ + tmp;
-    std::ifstream infile(fullpath);
-
-    // Read data
-    quality_data_.clear();
-    std::string line;
-    double number;
-    while (std::getline(infile, line)) {
-        std::istringstream stream(line);
-        while (stream) {
-            if (stream >> number) {
-                quality_data_.push_back(number);
+
+    // Binary arrays are mapped and used in place, other files are parsed as text
+    auto quality_file = std::make_unique<MappedArrayFile>(fullpath);
+    if (quality_file->IsValid()) {
+        if (quality_file->Size() != mvs_mesh_.faces.size()) {
+            std::cout << "Viewer Error: Quality has " << quality_file->Size() << " values, mesh has "
+                      << mvs_mesh_.faces.size() << " faces." << std::endl;
+            return;
+        }
+        uint64_t faces_hash = hashBytes(mvs_mesh_.faces.Begin(), mvs_mesh_.faces.size() * sizeof(MVS::Mesh::Face));
+        if (quality_file->Hash() != 0 && quality_file->Hash() != faces_hash) {
+            std::cout << "Viewer Warning: Quality was computed for a different mesh." << std::endl;
+        }
+
+        if (quality_file->Data<double>()) {
+            quality_data_.clear();
+            quality_ = quality_file->Data<double>();
+            quality_size_ = quality_file->Size();
+            quality_file_ = std::move(quality_file);
+        } else {
+            set_quality(quality_file->ToDoubles());
+        }
+    } else {
+        std::ifstream infile(fullpath);
+
+        // Read data
+        std::vector<double> quality_data;
+        std::string line;
+        double number;
+        while (std::getline(infile, line)) {
+            std::istringstream stream(line);
+            while (stream) {
+                if (stream >> number) {
+                    quality_data.push_back(number);
+                }
             }
         }
+        infile.close();
+        set_quality(std::move(quality_data));
     }
-    infile.close();
 
     set_mesh_color();
     std::cout << "Viewer: Quality loaded from: \n\t" << fullpath << std::endl;
 }
 
+void ViewMeshPlugin::set_quality(std::vector<double> quality_data) {
+    quality_file_.reset();
+    quality_data_ = std::move(quality_data);
+    quality_ = quality_data_.data();
+    quality_size_ = quality_data_.size();
+}
+
 void ViewMeshPlugin::smooth_quality_callback() {
+    if (quality_size_ != mvs_mesh_.faces.size()) {
+        std::cout << "Viewer Error: Quality not loaded for this mesh." << std::endl;
+        return;
+    }
 
     // Compute face areas
     std::vector<double> fa = this->face_area();
@@ -115,16 +151,16 @@ void ViewMeshPlugin::smooth_quality_callback() {
             neighbors_area_sum += fa[n];
         }
 
-        double smooth_quality = (fa[i] / neighbors_area_sum) * quality_data_[i];
+        double smooth_quality = (fa[i] / neighbors_area_sum) * quality_[i];
         for (const auto& n : neighbors) {
-            smooth_quality += (fa[n] / neighbors_area_sum) * quality_data_[n];
+            smooth_quality += (fa[n] / neighbors_area_sum) * quality_[n];
         }
 
         smooth_quality_data_.push_back(smooth_quality);
     }
 
     // Set smooth quality color
-    quality_data_ = smooth_quality_data_;
+    set_quality(std::move(smooth_quality_data_));
     set_mesh_color();
 }
 
@@ -258,12 +294,9 @@ void ViewMeshPlugin::set_mesh_color() {
 
     // Set color
     viewer->selected_data_index = VIEWER_DATA_MESH;
-    assert(viewer->data().F.rows() == quality_data_.size());
+    assert(viewer->data().F.rows() == quality_size_);
     auto num_faces = viewer->data().F.rows();
-    Eigen::VectorXd measure(num_faces);
-    for (int i = 0; i < num_faces; i++) {
-        measure(i) = quality_data_[i];
-    }
+    Eigen::VectorXd measure = Eigen::Map<const Eigen::VectorXd>(quality_, num_faces);
 
     Eigen::MatrixXd color;
     igl::jet(measure, true, color);
@@ -4,12 +4,15 @@
 #include <string>
 #include <ostream>
 #include <algorithm>
+#include <memory>
 
 #include <imgui/imgui.h>
 #include <igl/opengl/glfw/Viewer.h>
 #include <igl/opengl/glfw/ViewerPlugin.h>
 #include <OpenMVS/MVS.h>
 
+#include "util/Helpers.h"
+
 class ViewMeshPlugin : public igl::opengl::glfw::ViewerPlugin {
 public:
     explicit ViewMeshPlugin(std::string project_folder);
@@ -42,7 +45,12 @@ private:
     char quality_name_[128] = "filename.ext";
 
     MVS::Mesh mvs_mesh_;
+
+    // Per face quality, points into the mapped binary file or into quality_data_
+    std::unique_ptr<MappedArrayFile> quality_file_;
     std::vector<double> quality_data_;
+    const double* quality_ = nullptr;
+    size_t quality_size_ = 0;
 
     bool visible_mesh_ = true;
     bool visible_texture_ = false;
@@ -52,6 +60,7 @@ private:
 
     void set_mesh(const MVS::Mesh& mvs_mesh);
     void show_mesh(bool visible);
+    void set_quality(std::vector<double> quality_data);
     void set_mesh_color();
     void center_object();
 };
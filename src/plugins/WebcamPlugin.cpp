@@ -11,101 +11,343 @@
 #include <stb/stb_image_write.h>
 #include <Eigen/Core>
 
-WebcamPlugin::WebcamPlugin(std::string device, int width, int height, std::string images_path)
-        : device_string_(std::move(device)),
-          image_width_(width),
-          image_height_(height),
-          images_path_(std::move(images_path)),
-          webcam_(device_string_, image_width_, image_height_),
-          saved_frames_count_(0),
-          image_names_(std::make_shared<std::vector<std::string>>()) {}
+WebcamPlugin::WebcamPlugin(std::string device,
+                           std::string images_path,
+                           std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder)
+        : images_path_(std::move(images_path)),
+          reconstruction_builder_(std::move(reconstruction_builder)),
+          image_names_(std::make_shared<std::vector<std::string>>()) {
+
+    // Capture at the resolution of the calibration
+    auto intrinsics_prior = reconstruction_builder_->GetOptions().intrinsics_prior;
+    WebcamCapture::Options capture_options;
+    capture_options.device = std::move(device);
+    capture_options.width = intrinsics_prior.image_width;
+    capture_options.height = intrinsics_prior.image_height;
+    capture_options.max_gray_size = reconstruction_builder_->GetOptions().descriptor_extractor_options.max_image_size;
+    capture_ = std::make_unique<WebcamCapture>(capture_options);
+}
+
+WebcamPlugin::~WebcamPlugin() = default;
 
 void WebcamPlugin::init(igl::opengl::glfw::Viewer *_viewer) {
     ViewerPlugin::init(_viewer);
 
-    // Create texture for camera view (needs glfw context)
+    // Check for plugins
+    for (int i = 0; i < viewer->plugins.size(); i++) {
+        if (!reconstruction_plugin_) {
+            reconstruction_plugin_ = dynamic_cast<ReconstructionPlugin*>(viewer->plugins[i]);
+        }
+    }
+
+    // Create texture for camera view (needs glfw context), allocated with the first frame
     glGenTextures(1, &textureID_);
     glBindTexture(GL_TEXTURE_2D, textureID_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image_width_, image_height_, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Append mesh for camera
+    viewer->append_mesh();
+    VIEWER_DATA_LOCALIZATION = static_cast<unsigned int>(viewer->data_list.size() - 1);
+
+    // Initial camera pose
+    Eigen::Affine3d scale(Eigen::Scaling(1.0 / 2.0));
+    camera_transformation_ = scale * Eigen::Matrix4d::Identity();
+
+    set_camera();
+    show_camera(show_camera_);
 }
 
 bool WebcamPlugin::post_draw() {
     // Setup window
     float window_width = 480.0f;
-    float window_height = 450.0f;
-    ImGui::SetNextWindowSize(ImVec2(window_width, window_height), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(window_width, 0), ImGuiCond_FirstUseEver);
     ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - window_width, 0.0f), ImGuiCond_FirstUseEver);
 
     ImGui::Begin("Camera", nullptr, ImGuiWindowFlags_NoSavedSettings);
 
-    // Get frame from webcam
-    std::cout << "Capture frame: ";
-    auto time_begin = std::chrono::steady_clock::now();
+    // Take newest frame from capture thread
+    update_frame();
+
+    // Add an image
+    if (has_frame_) {
+        float width = ImGui::GetWindowContentRegionWidth();
+        float height = width * ((float) frame_.height / frame_.width);
+        ImGui::Image(reinterpret_cast<GLuint*>(textureID_), ImVec2(width, height));
+    } else {
+        ImGui::TextWrapped("Waiting for camera ...");
+    }
+
+    // Capture stats
+    double interval = capture_->LastFrameInterval();
+    ImGui::Text("Captured: %ld, dropped: %ld, failed: %ld",
+                static_cast<long>(capture_->NumCaptured()),
+                static_cast<long>(capture_->NumDropped()),
+                static_cast<long>(capture_->NumFailed()));
+    ImGui::Text("%.1f fps, convert: %.1f ms, localize: %.0f ms",
+                interval > 0.0 ? 1.0 / interval : 0.0,
+                1000.0 * capture_->LastConvertTime(),
+                1000.0 * localization_time_);
+
+    // Save
+    if (ImGui::Button("Capture frame [space]", ImVec2(-1, 0))) {
+        save_frame_callback();
+    }
+
+    // Localization
+    if (ImGui::Button("Localize frame", ImVec2(-70, 0))) {
+        localize_frame_callback();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Auto##localize", &auto_localize_);
+    if (ImGui::Checkbox("Show localized camera", &show_camera_)) {
+        show_camera(show_camera_);
+    }
+
+    // Keyframes
+    ImGui::Checkbox("Auto keyframes", &auto_keyframe_);
+    ImGui::SliderFloat("Min interval [s]", &min_keyframe_interval_, 0.0f, 10.0f);
+    const auto& keyframe_result = reconstruction_builder_->GetKeyframeResult();
+    if (keyframe_result.nearest_view_id != theia::kInvalidViewId) {
+        ImGui::Text("Nearest view: %d, baseline: %.2f, overlap: %.2f, PPA gain: %.2f",
+                    static_cast<int>(keyframe_result.nearest_view_id),
+                    keyframe_result.baseline_ratio,
+                    keyframe_result.overlap,
+                    keyframe_result.ppa_gain);
+    }
+    const auto& keyframe_stats = reconstruction_builder_->GetKeyframeStats();
+    ImGui::Text("Accepted: %d, rejected: %d, deferred: %d, saved: %.1f s",
+                keyframe_stats.num_accepted,
+                keyframe_stats.num_rejected,
+                keyframe_stats.num_deferred,
+                keyframe_stats.saved_time);
+    ImGui::InputInt("Next image index", &next_image_idx_);
+
+    // Camera model
+    transform_camera();
+
+    // Plugin link
+    if (reconstruction_plugin_ && ImGui::TreeNodeEx("Plugin link", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::Button("Initialize", ImVec2(-70, 0))) {
+            initialize_callback();
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Auto##webcam_initialize", &auto_initialize_);
+
+        if (ImGui::Button("Extend", ImVec2(-70, 0))) {
+            extend_callback();
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Auto##webcam_extend", &auto_extend_);
+        ImGui::TreePop();
+    }
 
-    // current_frame_ = webcam_.frame();
-    const RGBImage& frame = webcam_.frame();
+    ImGui::End();
+    return false;
+}
+
+std::shared_ptr<std::vector<std::string>> WebcamPlugin::get_captured_image_names() {
+    return image_names_;
+}
 
-    auto time_end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> time_elapsed = time_end - time_begin;
-    std::cout << time_elapsed.count() << " s";
+void WebcamPlugin::update_frame() {
+    if (capture_->IsOpen() != capture_open_) {
+        capture_open_ = capture_->IsOpen();
+        if (capture_open_) {
+            log_stream_ << "Webcam: Opened device with " << capture_->NumBuffers() << " buffers" << std::endl;
+        }
+    }
 
-    // Replace texture with new frame
-    std::cout << "\tCopy to texture: ";
-    time_begin = std::chrono::steady_clock::now();
+    if (!capture_->GetLatestFrame(&frame_)) {
+        return;
+    }
+    has_frame_ = true;
 
+    // Replace texture with new frame (reallocate if the driver changed the resolution)
     glBindTexture(GL_TEXTURE_2D, textureID_);
-    // glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image_width_, image_height_, GL_RGB, GL_UNSIGNED_BYTE, current_frame_.data);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image_width_, image_height_, GL_RGB, GL_UNSIGNED_BYTE, frame.data);
+    if (frame_.width != texture_width_ || frame_.height != texture_height_) {
+        texture_width_ = frame_.width;
+        texture_height_ = frame_.height;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_width_, texture_height_, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame_.width, frame_.height, GL_RGB, GL_UNSIGNED_BYTE, frame_.pixels.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    time_end = std::chrono::steady_clock::now();
-    time_elapsed = time_end - time_begin;
-    std::cout << time_elapsed.count() << " s" << std::endl;
+    // Localize the newest frame only, frames captured meanwhile are skipped
+    if (auto_localize_ && reconstruction_builder_->IsInitialized()) {
+        localize_frame_callback();
+        if (auto_keyframe_ && prev_localization_success_) {
+            select_keyframe();
+        }
+    }
+}
 
-    // Add an image
-    float width = ImGui::GetWindowContentRegionWidth();
-    float height = width * ((float) image_height_ / image_width_);
-    ImGui::Image(reinterpret_cast<GLuint*>(textureID_), ImVec2(width, height));
+void WebcamPlugin::localize_frame_callback() {
+    if (!has_frame_ || !reconstruction_builder_->IsInitialized()) {
+        return;
+    }
+    auto time_begin = std::chrono::steady_clock::now();
 
-    // Add a button
-    if (ImGui::Button("Capture frame [space]", ImVec2(-1, 0))) {
-        capture_frame_callback();
+    // Grayscale frame is converted on the capture thread and passed to the extractor as is
+    GrayImage image;
+    image.width = frame_.gray_width;
+    image.height = frame_.gray_height;
+    image.data = frame_.gray.data();
+    image.scale = frame_.gray_scale;
+
+    // Localize near previous pose first, globally if that fails
+    bool success = false;
+    theia::CalibratedAbsolutePose camera_pose;
+    if (prev_localization_success_) {
+        success = reconstruction_builder_->LocalizeImage(image, prev_camera_pose_, camera_pose);
+    }
+    if (!success) {
+        success = reconstruction_builder_->LocalizeImage(image, camera_pose);
     }
 
-    // Add camera message
-    ImGui::TextWrapped("%s", camera_message_.c_str());
+    std::chrono::duration<double> time_elapsed = std::chrono::steady_clock::now() - time_begin;
+    localization_time_ = time_elapsed.count();
 
-    ImGui::End();
-    return false;
+    Eigen::Vector3d color;
+    if (success) {
+        prev_camera_pose_ = camera_pose;
+
+        // Set camera transformation
+        Eigen::Affine3d scale(Eigen::Scaling(1.0 / 2.0));
+        Eigen::Affine3d rotate;
+        rotate = camera_pose.rotation.transpose();
+        Eigen::Affine3d translate(Eigen::Translation3d(camera_pose.position));
+        camera_transformation_ = (translate * rotate * scale).matrix();
+
+        color = Eigen::Vector3d(0, 255, 0) / 255.0;
+    } else {
+        color = Eigen::Vector3d(255, 0, 0) / 255.0;
+    }
+    viewer->selected_data_index = VIEWER_DATA_LOCALIZATION;
+    viewer->data().uniform_colors(color, color, color);
+
+    prev_localization_success_ = success;
+    show_camera(show_camera_);
+}
+
+void WebcamPlugin::select_keyframe() {
+    std::chrono::duration<double> since_keyframe = std::chrono::steady_clock::now() - last_keyframe_time_;
+    if (since_keyframe.count() < min_keyframe_interval_) {
+        return;
+    }
+
+    if (reconstruction_builder_->EvaluateKeyframe(frame_.index, prev_localization_success_, prev_camera_pose_) !=
+        KeyframeSelector::Decision::kAccept) {
+        return;
+    }
+
+    const auto& result = reconstruction_builder_->GetKeyframeResult();
+    log_stream_ << "Webcam: Keyframe (nearest view " << result.nearest_view_id
+                << ", baseline " << result.baseline_ratio
+                << ", overlap " << result.overlap
+                << ", PPA gain " << result.ppa_gain << ")" << std::endl;
+    save_frame_callback();
 }
 
-void WebcamPlugin::capture_frame_callback() {
-    // Get frame from webcam
-    auto frame = webcam_.frame();
+void WebcamPlugin::save_frame_callback() {
+    if (!has_frame_) {
+        return;
+    }
 
-    // Store frame on disk
+    // Prepare filename
     std::stringstream ss;
-    ss << std::setw(3) << std::setfill('0') << std::to_string(saved_frames_count_);
-    std::string filename = "frame" + ss.str() + ".png";
+    ss << std::setw(3) << std::setfill('0') << std::to_string(next_image_idx_);
+    std::string filename = "frame" + ss.str() + ".jpg";
     std::string fullname = images_path_ + filename;
 
+    // Write to file
     int channels = 3;
-    stbi_write_png(fullname.c_str(), image_width_, image_height_, channels, frame.data, image_width_ * channels);
+    if (!stbi_write_jpg(fullname.c_str(), frame_.width, frame_.height, channels, frame_.pixels.data(), 95)) {
+        log_stream_ << "Webcam: Failed to write image: " << fullname << std::endl;
+        return;
+    }
 
     image_names_->push_back(filename);
-    camera_message_ = "Image saved to: \n" + fullname;
-    saved_frames_count_++;
+    next_image_idx_++;
+    last_keyframe_time_ = std::chrono::steady_clock::now();
+    log_stream_ << "Webcam: Image saved to: \n\t" << fullname << std::endl;
+
+    // Auto actions
+    if (auto_initialize_) {
+        initialize_callback();
+    }
+    if (auto_extend_) {
+        extend_callback();
+    }
 }
 
-RGBImage* WebcamPlugin::get_current_frame() {
-    return &current_frame_;
+void WebcamPlugin::initialize_callback() {
+    if (!reconstruction_plugin_) {
+        log_stream_ << "Webcam Error: Reconstruction plugin not present." << std::endl;
+        return;
+    }
+
+    // Check if already initialized
+    if (image_names_->size() == 2 && !reconstruction_builder_->IsInitialized()) {
+        reconstruction_plugin_->initialize_callback();
+    }
 }
 
-std::shared_ptr<std::vector<std::string>> WebcamPlugin::get_captured_image_names() {
-    return image_names_;
+void WebcamPlugin::extend_callback() {
+    if (!reconstruction_plugin_) {
+        log_stream_ << "Webcam Error: Reconstruction plugin not present." << std::endl;
+        return;
+    }
+
+    // Check if already initialized
+    if (image_names_->size() > 2 && reconstruction_builder_->IsInitialized()) {
+        reconstruction_plugin_->extend_callback();
+    }
+}
+
+void WebcamPlugin::set_camera() {
+
+    // Vertices
+    Eigen::MatrixXd tmp_V(5, 3);
+    tmp_V << 0, 0, 0,
+            -0.75, -0.5, 1,
+            -0.75, 0.5, 1,
+            0.75, 0.5, 1,
+            0.75, -0.5, 1;
+    camera_vertices_ = tmp_V;
+
+    // Faces
+    Eigen::MatrixXi tmp_F(6, 3);
+    tmp_F << 0, 1, 2,
+            0, 2, 3,
+            0, 3, 4,
+            0, 4, 1,
+            1, 3, 2,
+            1, 4, 3;
+
+    // Set viewer data
+    viewer->selected_data_index = VIEWER_DATA_LOCALIZATION;
+    viewer->data().clear();
+    viewer->data().set_mesh(tmp_V, tmp_F);
+    viewer->data().set_face_based(true);
+    viewer->data().set_colors(Eigen::RowVector3d(128, 128, 128) / 255.0);
+}
+
+void WebcamPlugin::transform_camera() {
+    viewer->selected_data_index = VIEWER_DATA_LOCALIZATION;
+    if (camera_vertices_.rows() > 0) {
+        Eigen::MatrixXd V = camera_vertices_;
+        V = (V.rowwise().homogeneous() * camera_transformation_.transpose()).rowwise().hnormalized();
+        viewer->data().set_vertices(V);
+    }
+}
+
+void WebcamPlugin::show_camera(bool visible) {
+    viewer->selected_data_index = VIEWER_DATA_LOCALIZATION;
+    viewer->data().show_faces = visible;
+    viewer->data().show_lines = visible;
 }
 
 
@@ -136,8 +378,8 @@ bool WebcamPlugin::mouse_scroll(float delta_y)
 bool WebcamPlugin::key_pressed(unsigned int key, int modifiers)
 {
     ImGui_ImplGlfwGL3_CharCallback(nullptr, key);
-    if (key == ' ') {
-        capture_frame_callback();
+    if (key == ' ' && !ImGui::GetIO().WantTextInput) {
+        save_frame_callback();
         return true;
     }
     return ImGui::GetIO().WantCaptureKeyboard;
@@ -153,4 +395,4 @@ bool WebcamPlugin::key_up(int key, int modifiers)
 {
     ImGui_ImplGlfwGL3_KeyCallback(viewer->window, key, 0, GLFW_RELEASE, modifiers);
     return ImGui::GetIO().WantCaptureKeyboard;
-}
\ No newline at end of file
+}
@@ -6,17 +6,26 @@
 #include <igl/opengl/glfw/Viewer.h>
 #include <igl/opengl/glfw/ViewerPlugin.h>
 
-#include "webcam/webcam.h"
+#include "reconstruction/RealtimeReconstructionBuilder.h"
+#include "plugins/ReconstructionPlugin.h"
+#include "util/WebcamCapture.h"
 
 class WebcamPlugin : public igl::opengl::glfw::ViewerPlugin {
 public:
-    WebcamPlugin(std::string device, int width, int height, std::string images_path);
+    WebcamPlugin(std::string device,
+                 std::string images_path,
+                 std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder);
+    ~WebcamPlugin();
+
     void init(igl::opengl::glfw::Viewer *_viewer) override;
     bool post_draw() override;
 
-    RGBImage* get_current_frame();
     std::shared_ptr<std::vector<std::string>> get_captured_image_names();
 
+    // Plugin link callbacks
+    void initialize_callback();
+    void extend_callback();
+
     // Mouse IO
     bool mouse_down(int button, int modifier) override;
     bool mouse_up(int button, int modifier) override;
@@ -29,24 +38,63 @@ public:
     bool key_up(int key, int modifiers) override;
 
 private:
-    // Constructor parameters
-    std::string device_string_;
-    int image_width_;
-    int image_height_;
+    // Plugins
+    ReconstructionPlugin* reconstruction_plugin_ = nullptr;
+
+    // Viewer data index
+    unsigned int VIEWER_DATA_LOCALIZATION;
+
+    // Image input output (frames are captured on the capture thread and converted when taken)
+    std::unique_ptr<WebcamCapture> capture_;
+    bool capture_open_ = false;
+    WebcamCapture::Frame frame_;
+    bool has_frame_ = false;
+    int texture_width_ = 0;
+    int texture_height_ = 0;
+
+    int next_image_idx_ = 0;
     std::string images_path_;
+    std::shared_ptr<std::vector<std::string>> image_names_;
 
-    // Camera members
+    // Interface
     GLuint textureID_;
-    Webcam webcam_;
-    RGBImage current_frame_;
-    int saved_frames_count_;
-    std::shared_ptr<std::vector<std::string>> image_names_;
+    bool show_camera_ = true;
+    bool auto_localize_ = true;
+    bool auto_keyframe_ = true;
+    bool auto_initialize_ = true;
+    bool auto_extend_ = true;
 
-    // GUI
-    std::string camera_message_;
+    // Reconstruction
+    std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder_;
+
+    // Localization
+    bool prev_localization_success_ = false;
+    theia::CalibratedAbsolutePose prev_camera_pose_;
+    double localization_time_ = 0.0;
+    Eigen::MatrixXd camera_vertices_;
+    Eigen::Matrix4d camera_transformation_;
+
+    // Keyframe selection by the keyframe gate of the builder (minimal time between keyframes in seconds)
+    float min_keyframe_interval_ = 1.0f;
+    std::chrono::steady_clock::time_point last_keyframe_time_;
+
+    // Log
+    std::ostream& log_stream_ = std::cout;
 
     // Callback functions
-    void capture_frame_callback();
+    void localize_frame_callback();
+    void save_frame_callback();
+
+    // Show newest frame from capture thread and run auto actions
+    void update_frame();
+
+    // Add localized frame as keyframe if it passes the keyframe gate
+    void select_keyframe();
+
+    // Helpers
+    void set_camera();
+    void transform_camera();
+    void show_camera(bool visible);
 };
 
 
@@ -1,5 +1,7 @@
 #include "ImageRetrieval.h"
 
+#include <algorithm>
+
 #include <colmap/feature/utils.h>
 
 ImageRetrieval::ImageRetrieval(const Options &options)
@@ -22,7 +24,13 @@ void ImageRetrieval::AddImage(theia::ViewId view_id,
     // Add to visual index
     visual_index_.Add(options_.index_options, view_id, colmap_keypoints, colmap_descriptors);
     visual_index_.Prepare();
-    num_images_++;
+    image_ids_.insert(view_id);
+}
+
+void ImageRetrieval::RemoveImage(theia::ViewId view_id) {
+    if (image_ids_.erase(view_id) > 0) {
+        removed_image_ids_.insert(view_id);
+    }
 }
 
 std::vector<colmap::retrieval::ImageScore> ImageRetrieval::QueryImage(
@@ -41,8 +49,25 @@ std::vector<colmap::retrieval::ImageScore> ImageRetrieval::QueryImage(
     colmap::FeatureDescriptors colmap_descriptors;
     convertFromTheiaToColmap(keypoints, descriptors, &colmap_keypoints, &colmap_descriptors);
 
-    // Query
-    visual_index_.Query(options_.query_options, colmap_keypoints, colmap_descriptors, &image_scores);
+    // Query (ask for additional images to make up for removed ones)
+    colmap::retrieval::VisualIndex<>::QueryOptions query_options = options_.query_options;
+    if (query_options.max_num_images > 0) {
+        query_options.max_num_images += static_cast<int>(removed_image_ids_.size());
+    }
+    visual_index_.Query(query_options, colmap_keypoints, colmap_descriptors, &image_scores);
+
+    // Filter removed images
+    if (!removed_image_ids_.empty()) {
+        image_scores.erase(std::remove_if(image_scores.begin(), image_scores.end(),
+                                          [this](const colmap::retrieval::ImageScore& image_score) {
+                                              return removed_image_ids_.count(
+                                                      static_cast<theia::ViewId>(image_score.image_id)) > 0;
+                                          }), image_scores.end());
+        if (options_.query_options.max_num_images > 0 &&
+            image_scores.size() > options_.query_options.max_num_images) {
+            image_scores.resize(static_cast<size_t>(options_.query_options.max_num_images));
+        }
+    }
     return image_scores;
 }
 
@@ -77,5 +102,27 @@ void ImageRetrieval::convertFromTheiaToColmap(const std::vector<theia::Keypoint>
 }
 
 int ImageRetrieval::GetNumImages() {
-    return num_images_;
+    return static_cast<int>(image_ids_.size());
+}
+
+void ImageRetrieval::WriteIndex(const std::string& path) {
+    visual_index_.Write(path);
+}
+
+std::vector<theia::ViewId> ImageRetrieval::GetImageIds() {
+    std::vector<theia::ViewId> image_ids(image_ids_.begin(), image_ids_.end());
+    std::sort(image_ids.begin(), image_ids.end());
+    return image_ids;
+}
+
+std::vector<theia::ViewId> ImageRetrieval::GetRemovedImageIds() {
+    std::vector<theia::ViewId> removed_image_ids(removed_image_ids_.begin(), removed_image_ids_.end());
+    std::sort(removed_image_ids.begin(), removed_image_ids.end());
+    return removed_image_ids;
+}
+
+void ImageRetrieval::SetImageIds(const std::vector<theia::ViewId>& image_ids,
+                                 const std::vector<theia::ViewId>& removed_image_ids) {
+    image_ids_ = std::unordered_set<theia::ViewId>(image_ids.begin(), image_ids.end());
+    removed_image_ids_ = std::unordered_set<theia::ViewId>(removed_image_ids.begin(), removed_image_ids.end());
 }
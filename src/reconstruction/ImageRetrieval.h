@@ -1,6 +1,8 @@
 #ifndef REALTIME_RECONSTRUCTION_IMAGERETRIEVAL_H
 #define REALTIME_RECONSTRUCTION_IMAGERETRIEVAL_H
 
+#include <unordered_set>
+
 #include <theia/image/keypoint_detector/keypoint.h>
 #include <theia/sfm/types.h>
 
@@ -30,16 +32,29 @@ public:
                   const std::vector<theia::Keypoint>& keypoints,
                   const std::vector<Eigen::VectorXf>& descriptors);
 
+    // Removed images stay in the visual index but are excluded from query results
+    void RemoveImage(theia::ViewId view_id);
+
     std::vector<colmap::retrieval::ImageScore> QueryImage(
             const std::vector<theia::Keypoint>& keypoints,
             const std::vector<Eigen::VectorXf>& descriptors);
 
     int GetNumImages();
 
+    // Write visual index including indexed images (can be read back through vocab_tree_path)
+    void WriteIndex(const std::string& path);
+
+    // Ids of indexed and removed images (used when restoring a written index)
+    std::vector<theia::ViewId> GetImageIds();
+    std::vector<theia::ViewId> GetRemovedImageIds();
+    void SetImageIds(const std::vector<theia::ViewId>& image_ids,
+                     const std::vector<theia::ViewId>& removed_image_ids);
+
 private:
     Options options_;
     colmap::retrieval::VisualIndex<> visual_index_;
-    int num_images_ = 0;
+    std::unordered_set<theia::ViewId> image_ids_;
+    std::unordered_set<theia::ViewId> removed_image_ids_;
 
     void convertFromTheiaToColmap(const std::vector<theia::Keypoint> &keypoints_theia,
                                   const std::vector<Eigen::VectorXf> &descriptors_theia,
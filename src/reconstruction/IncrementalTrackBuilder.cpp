@@ -0,0 +1,294 @@
+#include "IncrementalTrackBuilder.h"
+
+#include <algorithm>
+
+void IncrementalTrackBuilder::AddFeatureCorrespondence(theia::ViewId view_id1, int feature_idx1,
+                                                       const theia::Feature& feature1,
+                                                       theia::ViewId view_id2, int feature_idx2,
+                                                       const theia::Feature& feature2) {
+    if (view_id1 == view_id2) {
+        return;
+    }
+
+    int node1 = FindOrInsert(view_id1, feature_idx1, feature1);
+    int node2 = FindOrInsert(view_id2, feature_idx2, feature2);
+    if (!Union(node1, node2)) {
+        num_rejected_++;
+    }
+}
+
+int IncrementalTrackBuilder::ApplyToReconstruction(theia::Reconstruction* reconstruction) {
+    int num_observations = 0;
+
+    // Sets hold each view once, so a node only needs its view to be in the reconstruction
+    auto view_exists = [reconstruction](const Node& node) {
+        return reconstruction->View(node.view_id) != nullptr;
+    };
+
+    for (const int root : dirty_roots_) {
+        auto set_it = sets_.find(root);
+        if (set_it == sets_.end() || set_it->second.members.size() < 2) {
+            continue;
+        }
+        const std::vector<int>& members = set_it->second.members;
+
+        // Existing tracks in this set (more than one if the new view bridged them)
+        std::vector<theia::TrackId> track_ids;
+        for (const int member : members) {
+            theia::TrackId track_id = nodes_[member].track_id;
+            if (track_id != theia::kInvalidTrackId &&
+                reconstruction->Track(track_id) != nullptr &&
+                std::find(track_ids.begin(), track_ids.end(), track_id) == track_ids.end()) {
+                track_ids.push_back(track_id);
+            }
+        }
+
+        if (track_ids.empty()) {
+
+            // Add new track
+            std::vector<std::pair<theia::ViewId, theia::Feature>> track;
+            std::vector<int> track_members;
+            for (const int member : members) {
+                if (view_exists(nodes_[member])) {
+                    track.emplace_back(nodes_[member].view_id, nodes_[member].feature);
+                    track_members.push_back(member);
+                }
+            }
+            if (track.size() < 2) {
+                continue;
+            }
+
+            theia::TrackId track_id = reconstruction->AddTrack(track);
+            if (track_id != theia::kInvalidTrackId) {
+                for (const int member : track_members) {
+                    nodes_[member].track_id = track_id;
+                }
+                num_observations += static_cast<int>(track.size());
+            }
+        } else {
+
+            // Keep the longest track and merge the others into it
+            theia::TrackId keep_track_id = track_ids.front();
+            for (const auto& track_id : track_ids) {
+                if (reconstruction->Track(track_id)->NumViews() >
+                    reconstruction->Track(keep_track_id)->NumViews()) {
+                    keep_track_id = track_id;
+                }
+            }
+            for (const auto& track_id : track_ids) {
+                if (track_id != keep_track_id) {
+                    reconstruction->RemoveTrack(track_id);
+                }
+            }
+
+            // Add observations to kept track
+            for (const int member : members) {
+                Node& node = nodes_[member];
+                if (node.track_id == keep_track_id) {
+                    continue;
+                }
+                if (view_exists(node) &&
+                    reconstruction->AddObservation(node.view_id, keep_track_id, node.feature)) {
+                    node.track_id = keep_track_id;
+                    num_observations++;
+                } else {
+                    node.track_id = theia::kInvalidTrackId;
+                }
+            }
+        }
+    }
+    dirty_roots_.clear();
+
+    return num_observations;
+}
+
+const theia::Track* IncrementalTrackBuilder::FindTrack(const theia::Reconstruction& reconstruction,
+                                                       theia::ViewId view_id, int feature_idx) const {
+    auto node_it = node_ids_.find(Key(view_id, feature_idx));
+    if (node_it == node_ids_.end()) {
+        return nullptr;
+    }
+    const theia::Track* track = reconstruction.Track(nodes_[node_it->second].track_id);
+
+    // Observation may have been removed by the estimator
+    if (track == nullptr || track->ViewIds().count(view_id) == 0) {
+        return nullptr;
+    }
+    return track;
+}
+
+void IncrementalTrackBuilder::RemoveView(theia::ViewId view_id) {
+    auto view_nodes_it = view_nodes_.find(view_id);
+    if (view_nodes_it == view_nodes_.end()) {
+        return;
+    }
+
+    // Removed nodes stay in the union-find structure but are no longer members
+    for (const int node : view_nodes_it->second) {
+        nodes_[node].removed = true;
+        node_ids_.erase(Key(nodes_[node].view_id, nodes_[node].feature_idx));
+
+        int root = FindRoot(node);
+        Set& set = sets_[root];
+        set.members.erase(std::remove(set.members.begin(), set.members.end(), node), set.members.end());
+        set.views.erase(view_id);
+        if (set.members.empty()) {
+            sets_.erase(root);
+            dirty_roots_.erase(root);
+        }
+    }
+    view_nodes_.erase(view_nodes_it);
+}
+
+void IncrementalTrackBuilder::Clear() {
+    nodes_.clear();
+    parents_.clear();
+    sets_.clear();
+    node_ids_.clear();
+    view_nodes_.clear();
+    dirty_roots_.clear();
+    num_rejected_ = 0;
+}
+
+int IncrementalTrackBuilder::NumRejected() const {
+    return num_rejected_;
+}
+
+namespace {
+
+// Node layout in session files
+struct NodeRecord {
+    theia::ViewId view_id;
+    int32_t feature_idx;
+    double x;
+    double y;
+    theia::TrackId track_id;
+    int32_t removed;
+};
+
+}
+
+void IncrementalTrackBuilder::Write(BinaryWriter* writer) const {
+    std::vector<NodeRecord> node_records;
+    node_records.reserve(nodes_.size());
+    for (const auto& node : nodes_) {
+        node_records.push_back({node.view_id, node.feature_idx, node.feature.x(), node.feature.y(),
+                                node.track_id, node.removed});
+    }
+    writer->WriteArray(node_records.data(), node_records.size());
+    writer->WriteArray(parents_.data(), parents_.size());
+    writer->Write(static_cast<int32_t>(num_rejected_));
+}
+
+bool IncrementalTrackBuilder::Read(MappedFileReader* reader) {
+    Clear();
+
+    uint64_t num_nodes = 0;
+    uint64_t num_parents = 0;
+    const NodeRecord* node_records = reader->ReadArray<NodeRecord>(&num_nodes);
+    if (node_records == nullptr) {
+        return false;
+    }
+    const int* parents = reader->ReadArray<int>(&num_parents);
+    int32_t num_rejected = 0;
+    if (parents == nullptr || num_parents != num_nodes || !reader->Read(&num_rejected)) {
+        return false;
+    }
+
+    nodes_.reserve(num_nodes);
+    for (uint64_t i = 0; i < num_nodes; i++) {
+        const NodeRecord& record = node_records[i];
+        nodes_.push_back({record.view_id, record.feature_idx, theia::Feature(record.x, record.y),
+                          record.track_id, record.removed != 0});
+    }
+    parents_.assign(parents, parents + num_parents);
+    num_rejected_ = num_rejected;
+
+    // Rebuild lookups and members from nodes
+    for (int i = 0; i < nodes_.size(); i++) {
+        if (parents_[i] < 0 || parents_[i] >= nodes_.size()) {
+            Clear();
+            return false;
+        }
+        if (nodes_[i].removed) {
+            continue;
+        }
+        node_ids_[Key(nodes_[i].view_id, nodes_[i].feature_idx)] = i;
+        view_nodes_[nodes_[i].view_id].push_back(i);
+    }
+    for (int i = 0; i < nodes_.size(); i++) {
+        if (!nodes_[i].removed) {
+            Set& set = sets_[FindRoot(i)];
+            set.members.push_back(i);
+            set.views.insert(nodes_[i].view_id);
+        }
+    }
+    return true;
+}
+
+uint64_t IncrementalTrackBuilder::Key(theia::ViewId view_id, int feature_idx) {
+    return (static_cast<uint64_t>(view_id) << 32) | static_cast<uint32_t>(feature_idx);
+}
+
+int IncrementalTrackBuilder::FindOrInsert(theia::ViewId view_id, int feature_idx, const theia::Feature& feature) {
+    const uint64_t key = Key(view_id, feature_idx);
+    auto node_it = node_ids_.find(key);
+    if (node_it != node_ids_.end()) {
+        return node_it->second;
+    }
+
+    auto node = static_cast<int>(nodes_.size());
+    nodes_.push_back({view_id, feature_idx, feature, theia::kInvalidTrackId, false});
+    parents_.push_back(node);
+    Set& set = sets_[node];
+    set.members.push_back(node);
+    set.views.insert(view_id);
+    node_ids_[key] = node;
+    view_nodes_[view_id].push_back(node);
+    return node;
+}
+
+int IncrementalTrackBuilder::FindRoot(int node) {
+    int root = node;
+    while (parents_[root] != root) {
+        root = parents_[root];
+    }
+
+    // Path compression
+    while (parents_[node] != root) {
+        int next = parents_[node];
+        parents_[node] = root;
+        node = next;
+    }
+    return root;
+}
+
+bool IncrementalTrackBuilder::Union(int node1, int node2) {
+    int root1 = FindRoot(node1);
+    int root2 = FindRoot(node2);
+    if (root1 == root2) {
+        return true;
+    }
+
+    // Merge smaller set into larger one
+    if (sets_[root1].members.size() < sets_[root2].members.size()) {
+        std::swap(root1, root2);
+    }
+    Set& large = sets_[root1];
+    Set& small = sets_[root2];
+
+    // Reject if merged track would observe the same view twice
+    for (const theia::ViewId view_id : small.views) {
+        if (large.views.count(view_id) > 0) {
+            return false;
+        }
+    }
+
+    parents_[root2] = root1;
+    large.members.insert(large.members.end(), small.members.begin(), small.members.end());
+    large.views.insert(small.views.begin(), small.views.end());
+    sets_.erase(root2);
+    dirty_roots_.erase(root2);
+    dirty_roots_.insert(root1);
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef REALTIME_RECONSTRUCTION_INCREMENTALTRACKBUILDER_H
+#define REALTIME_RECONSTRUCTION_INCREMENTALTRACKBUILDER_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <theia/sfm/types.h>
+#include <theia/sfm/feature.h>
+#include <theia/sfm/reconstruction.h>
+
+#include "util/BinaryIO.h"
+
+// Builds tracks incrementally with union-find over (view id, feature index) nodes.
+// Correspondences are collected first and then applied to the reconstruction in
+// one batch. Tracks connected by a new view are merged, merges that would put two
+// features of the same view into one track are rejected. Nodes are looked up by
+// feature index only, so duplicated keypoints must be mapped to one index by the caller.
+class IncrementalTrackBuilder {
+public:
+    // Add correspondence between feature indices of two views. Feature holds the
+    // pixel coordinates of the keypoint that are written to the reconstruction.
+    void AddFeatureCorrespondence(theia::ViewId view_id1, int feature_idx1, const theia::Feature& feature1,
+                                  theia::ViewId view_id2, int feature_idx2, const theia::Feature& feature2);
+
+    // Add tracks and observations for all correspondences added since the last call.
+    // Returns the number of observations added.
+    int ApplyToReconstruction(theia::Reconstruction* reconstruction);
+
+    // Track of the feature if it is still observed in the reconstruction, nullptr otherwise
+    const theia::Track* FindTrack(const theia::Reconstruction& reconstruction, theia::ViewId view_id,
+                                  int feature_idx) const;
+
+    // Forget all nodes of the view (the view must be removed from reconstruction separately)
+    void RemoveView(theia::ViewId view_id);
+
+    // Remove all nodes
+    void Clear();
+
+    // Number of correspondences rejected because of inconsistent tracks
+    int NumRejected() const;
+
+    // Write nodes and union-find parents (pending correspondences must be applied first)
+    void Write(BinaryWriter* writer) const;
+
+    // Replace state with the one written by Write
+    bool Read(MappedFileReader* reader);
+
+private:
+    struct Node {
+        theia::ViewId view_id;
+        int feature_idx;
+        theia::Feature feature;
+        theia::TrackId track_id;
+        bool removed;
+    };
+
+    // Union-find over node indices
+    std::vector<Node> nodes_;
+    std::vector<int> parents_;
+
+    // Members and their views of each set
+    struct Set {
+        std::vector<int> members;
+        std::unordered_set<theia::ViewId> views;
+    };
+
+    // Sets indexed by root node
+    std::unordered_map<int, Set> sets_;
+
+    // Lookup from (view id, feature index) to node
+    std::unordered_map<uint64_t, int> node_ids_;
+    std::unordered_map<theia::ViewId, std::vector<int>> view_nodes_;
+
+    // Roots changed since last apply
+    std::unordered_set<int> dirty_roots_;
+    int num_rejected_ = 0;
+
+    static uint64_t Key(theia::ViewId view_id, int feature_idx);
+    int FindOrInsert(theia::ViewId view_id, int feature_idx, const theia::Feature& feature);
+    int FindRoot(int node);
+    bool Union(int node1, int node2);
+};
+
+#endif //REALTIME_RECONSTRUCTION_INCREMENTALTRACKBUILDER_H
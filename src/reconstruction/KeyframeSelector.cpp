@@ -0,0 +1,100 @@
+#include "KeyframeSelector.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+KeyframeSelector::KeyframeSelector(const Options& options)
+        : options_(options) {}
+
+bool KeyframeSelector::Evaluate(const theia::Reconstruction& reconstruction,
+                                const theia::CalibratedAbsolutePose& pose,
+                                Result* result) const {
+    *result = Result();
+
+    // Nearest estimated view
+    double min_distance = std::numeric_limits<double>::max();
+    for (const auto& view_id : reconstruction.ViewIds()) {
+        const theia::View* view = reconstruction.View(view_id);
+        if (!view->IsEstimated()) {
+            continue;
+        }
+        double distance = (pose.position - view->Camera().GetPosition()).norm();
+        if (distance < min_distance) {
+            min_distance = distance;
+            result->nearest_view_id = view_id;
+        }
+    }
+    if (result->nearest_view_id == theia::kInvalidViewId) {
+        return false;
+    }
+
+    // Frame camera shares intrinsics with the nearest view
+    const theia::Camera& nearest_camera = reconstruction.View(result->nearest_view_id)->Camera();
+    theia::Camera camera = nearest_camera;
+    camera.SetPosition(pose.position);
+    camera.SetOrientationFromRotationMatrix(pose.rotation);
+
+    // Depths of the points seen by the nearest view, their visibility in the frame and
+    // pixels per area in the frame compared to the best view observing them
+    std::vector<double> depths;
+    int num_visible = 0;
+    int num_ppa_gain = 0;
+    for (const auto& track_id : reconstruction.View(result->nearest_view_id)->TrackIds()) {
+        const theia::Track* track = reconstruction.Track(track_id);
+        if (track == nullptr || !track->IsEstimated()) {
+            continue;
+        }
+        Eigen::Vector2d projection;
+        double depth = nearest_camera.ProjectPoint(track->Point(), &projection);
+        if (depth <= 0.0) {
+            continue;
+        }
+        depths.push_back(depth);
+
+        double frame_depth = camera.ProjectPoint(track->Point(), &projection);
+        if (frame_depth <= 0.0 ||
+            projection.x() < 0.0 || projection.x() >= camera.ImageWidth() ||
+            projection.y() < 0.0 || projection.y() >= camera.ImageHeight()) {
+            continue;
+        }
+        num_visible++;
+
+        // Pixels per area are proportional to (focal length / depth)^2
+        double frame_resolution = camera.FocalLength() / frame_depth;
+        double best_resolution = 0.0;
+        for (const auto& view_id : track->ViewIds()) {
+            const theia::View* view = reconstruction.View(view_id);
+            if (view == nullptr || !view->IsEstimated()) {
+                continue;
+            }
+            double view_depth = view->Camera().ProjectPoint(track->Point(), &projection);
+            if (view_depth > 0.0) {
+                best_resolution = std::max(best_resolution, view->Camera().FocalLength() / view_depth);
+            }
+        }
+        if (frame_resolution * frame_resolution >= options_.min_ppa_ratio * best_resolution * best_resolution) {
+            num_ppa_gain++;
+        }
+    }
+    if (depths.empty()) {
+        return false;
+    }
+
+    std::nth_element(depths.begin(), depths.begin() + depths.size() / 2, depths.end());
+    double median_depth = depths[depths.size() / 2];
+    result->baseline_ratio = min_distance / median_depth;
+    result->overlap = static_cast<double>(num_visible) / depths.size();
+    result->ppa_gain = (num_visible > 0) ? static_cast<double>(num_ppa_gain) / num_visible : 0.0;
+
+    if (result->overlap < options_.min_overlap) {
+        result->decision = Decision::kDefer;
+    } else if (result->baseline_ratio >= options_.min_baseline_ratio ||
+               result->overlap <= options_.max_overlap ||
+               result->ppa_gain >= options_.min_ppa_gain) {
+        result->decision = Decision::kAccept;
+    } else {
+        result->decision = Decision::kReject;
+    }
+    return true;
+}
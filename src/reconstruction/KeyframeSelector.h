@@ -0,0 +1,58 @@
+#ifndef REALTIME_RECONSTRUCTION_KEYFRAMESELECTOR_H
+#define REALTIME_RECONSTRUCTION_KEYFRAMESELECTOR_H
+
+#include <theia/sfm/types.h>
+#include <theia/sfm/reconstruction.h>
+#include <theia/sfm/estimators/estimate_calibrated_absolute_pose.h>
+
+// Decides whether a localized frame should be added to the reconstruction. The frame
+// is compared to the nearest estimated view: the baseline is measured relative to the
+// median depth of the points seen by that view and the overlap is the fraction of those
+// points that project into the frame. The PPA gain predicts how much the frame improves
+// coverage: it is the fraction of visible points that the frame would see with more
+// pixels per area than any view observing them. Frames close to an existing view that do
+// not improve coverage are redundant, frames with too little overlap cannot be matched
+// reliably and are deferred.
+class KeyframeSelector {
+public:
+    enum class Decision {
+        kAccept,
+        kReject,
+        kDefer
+    };
+
+    struct Options {
+        // Minimal baseline to the nearest view relative to its median scene depth
+        double min_baseline_ratio = 0.1;
+
+        // Frames with less overlap than max_overlap are keyframes even with a small
+        // baseline (camera rotated), frames with less than min_overlap are rejected
+        double max_overlap = 0.7;
+        double min_overlap = 0.3;
+
+        // Frames with at least min_ppa_gain of visible points seen with min_ppa_ratio
+        // times more pixels per area than before are keyframes
+        double min_ppa_ratio = 2.0;
+        double min_ppa_gain = 0.3;
+    };
+
+    struct Result {
+        theia::ViewId nearest_view_id = theia::kInvalidViewId;
+        double baseline_ratio = 0.0;
+        double overlap = 0.0;
+        double ppa_gain = 0.0;
+        Decision decision = Decision::kDefer;
+    };
+
+    explicit KeyframeSelector(const Options& options);
+
+    // Returns false (decision is kDefer) if there is no estimated view to compare with
+    bool Evaluate(const theia::Reconstruction& reconstruction,
+                  const theia::CalibratedAbsolutePose& pose,
+                  Result* result) const;
+
+private:
+    Options options_;
+};
+
+#endif //REALTIME_RECONSTRUCTION_KEYFRAMESELECTOR_H
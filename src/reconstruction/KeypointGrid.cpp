@@ -0,0 +1,142 @@
+#include "KeypointGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+KeypointGrid::KeypointGrid(const std::vector<theia::Keypoint>& keypoints, double cell_size)
+        : keypoints_(keypoints), cell_size_(cell_size) {
+    if (keypoints_.empty()) {
+        return;
+    }
+
+    // Bounding box of keypoints
+    Eigen::Vector2d min_point(std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+    Eigen::Vector2d max_point = -min_point;
+    for (const auto& keypoint : keypoints_) {
+        min_point = min_point.cwiseMin(Eigen::Vector2d(keypoint.x(), keypoint.y()));
+        max_point = max_point.cwiseMax(Eigen::Vector2d(keypoint.x(), keypoint.y()));
+    }
+    origin_ = min_point;
+    num_cols_ = static_cast<int>((max_point.x() - min_point.x()) / cell_size_) + 1;
+    num_rows_ = static_cast<int>((max_point.y() - min_point.y()) / cell_size_) + 1;
+
+    // Counting sort of keypoints by cell
+    std::vector<int> cells(keypoints_.size());
+    cell_starts_.assign(num_cols_ * num_rows_ + 1, 0);
+    for (int i = 0; i < keypoints_.size(); i++) {
+        cells[i] = CellRow(keypoints_[i].y()) * num_cols_ + CellCol(keypoints_[i].x());
+        cell_starts_[cells[i] + 1]++;
+    }
+    for (int i = 1; i < cell_starts_.size(); i++) {
+        cell_starts_[i] += cell_starts_[i - 1];
+    }
+    std::vector<int> cell_positions(cell_starts_.begin(), cell_starts_.end() - 1);
+    cell_keypoints_.resize(keypoints_.size());
+    for (int i = 0; i < keypoints_.size(); i++) {
+        cell_keypoints_[cell_positions[cells[i]]++] = i;
+    }
+}
+
+void KeypointGrid::Query(const Eigen::Vector2d& center, double radius, std::vector<int>* indices) const {
+    if (Empty()) {
+        return;
+    }
+    int col_min = CellCol(center.x() - radius);
+    int col_max = CellCol(center.x() + radius);
+    int row_min = CellRow(center.y() - radius);
+    int row_max = CellRow(center.y() + radius);
+
+    const double radius_sq = radius * radius;
+    for (int row = row_min; row <= row_max; row++) {
+        for (int col = col_min; col <= col_max; col++) {
+            int cell = row * num_cols_ + col;
+            for (int i = cell_starts_[cell]; i < cell_starts_[cell + 1]; i++) {
+                const theia::Keypoint& keypoint = keypoints_[cell_keypoints_[i]];
+                if ((Eigen::Vector2d(keypoint.x(), keypoint.y()) - center).squaredNorm() <= radius_sq) {
+                    indices->push_back(cell_keypoints_[i]);
+                }
+            }
+        }
+    }
+}
+
+void KeypointGrid::QuerySegment(const Eigen::Vector2d& point1, const Eigen::Vector2d& point2,
+                                double distance, std::vector<int>* indices) const {
+    if (Empty()) {
+        return;
+    }
+
+    // Clip segment to the grid extent (Liang-Barsky)
+    const Eigen::Vector2d box_min = origin_ - Eigen::Vector2d::Constant(distance);
+    const Eigen::Vector2d box_max = origin_ + Eigen::Vector2d(num_cols_, num_rows_) * cell_size_ +
+                                    Eigen::Vector2d::Constant(distance);
+    const Eigen::Vector2d delta = point2 - point1;
+    double t_min = 0.0;
+    double t_max = 1.0;
+    for (int axis = 0; axis < 2; axis++) {
+        if (std::abs(delta(axis)) < std::numeric_limits<double>::epsilon()) {
+            if (point1(axis) < box_min(axis) || point1(axis) > box_max(axis)) {
+                return;
+            }
+            continue;
+        }
+        double t1 = (box_min(axis) - point1(axis)) / delta(axis);
+        double t2 = (box_max(axis) - point1(axis)) / delta(axis);
+        t_min = std::max(t_min, std::min(t1, t2));
+        t_max = std::min(t_max, std::max(t1, t2));
+    }
+    if (t_min > t_max) {
+        return;
+    }
+    const Eigen::Vector2d segment_begin = point1 + t_min * delta;
+    const Eigen::Vector2d direction = (t_max - t_min) * delta;
+
+    // Cells within distance of the segment (segment is sampled every half cell)
+    const double length = direction.norm();
+    const int num_steps = static_cast<int>(std::ceil(2.0 * length / cell_size_)) + 1;
+    const double sample_distance = distance + 0.5 * length / num_steps;
+    std::vector<int> cells;
+    for (int step = 0; step <= num_steps; step++) {
+        Eigen::Vector2d point = segment_begin + direction * (static_cast<double>(step) / num_steps);
+        int col_min = CellCol(point.x() - sample_distance);
+        int col_max = CellCol(point.x() + sample_distance);
+        int row_min = CellRow(point.y() - sample_distance);
+        int row_max = CellRow(point.y() + sample_distance);
+        for (int row = row_min; row <= row_max; row++) {
+            for (int col = col_min; col <= col_max; col++) {
+                cells.push_back(row * num_cols_ + col);
+            }
+        }
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    // Distance of keypoints to segment
+    const double distance_sq = distance * distance;
+    const double length_sq = std::max(length * length, std::numeric_limits<double>::epsilon());
+    for (const auto& cell : cells) {
+        for (int i = cell_starts_[cell]; i < cell_starts_[cell + 1]; i++) {
+            const theia::Keypoint& keypoint = keypoints_[cell_keypoints_[i]];
+            Eigen::Vector2d offset = Eigen::Vector2d(keypoint.x(), keypoint.y()) - segment_begin;
+            double t = std::min(1.0, std::max(0.0, offset.dot(direction) / length_sq));
+            if ((offset - t * direction).squaredNorm() <= distance_sq) {
+                indices->push_back(cell_keypoints_[i]);
+            }
+        }
+    }
+}
+
+bool KeypointGrid::Empty() const {
+    return cell_keypoints_.empty();
+}
+
+int KeypointGrid::CellCol(double x) const {
+    int col = static_cast<int>(std::floor((x - origin_.x()) / cell_size_));
+    return std::min(num_cols_ - 1, std::max(0, col));
+}
+
+int KeypointGrid::CellRow(double y) const {
+    int row = static_cast<int>(std::floor((y - origin_.y()) / cell_size_));
+    return std::min(num_rows_ - 1, std::max(0, row));
+}
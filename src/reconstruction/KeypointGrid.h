@@ -0,0 +1,39 @@
+#ifndef REALTIME_RECONSTRUCTION_KEYPOINTGRID_H
+#define REALTIME_RECONSTRUCTION_KEYPOINTGRID_H
+
+#include <vector>
+
+#include <Eigen/Core>
+#include <theia/image/keypoint_detector/keypoint.h>
+
+// Uniform grid over keypoint positions of one image for window queries
+// (used by guided matching to find candidates near predicted locations).
+class KeypointGrid {
+public:
+    KeypointGrid(const std::vector<theia::Keypoint>& keypoints, double cell_size);
+
+    // Append indices of keypoints within radius of center
+    void Query(const Eigen::Vector2d& center, double radius, std::vector<int>* indices) const;
+
+    // Append indices of keypoints within distance of the segment between two points
+    void QuerySegment(const Eigen::Vector2d& point1, const Eigen::Vector2d& point2,
+                      double distance, std::vector<int>* indices) const;
+
+    bool Empty() const;
+
+private:
+    const std::vector<theia::Keypoint>& keypoints_;
+    double cell_size_;
+    Eigen::Vector2d origin_;
+    int num_cols_ = 0;
+    int num_rows_ = 0;
+
+    // Keypoint indices sorted by cell, cell_starts_[i] is the first entry of cell i
+    std::vector<int> cell_starts_;
+    std::vector<int> cell_keypoints_;
+
+    int CellCol(double x) const;
+    int CellRow(double y) const;
+};
+
+#endif //REALTIME_RECONSTRUCTION_KEYPOINTGRID_H
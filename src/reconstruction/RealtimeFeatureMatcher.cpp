@@ -1,9 +1,14 @@
 #include "RealtimeFeatureMatcher.h"
 #include <memory>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
 
+#include <theia/util/hash.h>
 #include <theia/util/map_util.h>
 #include <theia/matching/feature_matcher_utils.h>
+#include <theia/sfm/twoview_info.h>
 
 RealtimeFeatureMatcher::RealtimeFeatureMatcher(const RealtimeFeatureMatcher::Options &options,
                                                const theia::CameraIntrinsicsPrior &intrinsics)
@@ -21,6 +26,7 @@ void RealtimeFeatureMatcher::AddImage(const std::string &image_name,
     keypoints_and_descriptors.keypoints = keypoints;
     keypoints_and_descriptors.descriptors = descriptors;
     keypoints_and_descriptors_.insert(std::make_pair(image_name, keypoints_and_descriptors));
+    unique_keypoints_[image_name] = UniqueKeypointIndices(keypoints);
 
     // Initialize cascade hasher if necessary.
     InitializeCascadeHasher(static_cast<int>(descriptors[0].size()));
@@ -34,11 +40,26 @@ void RealtimeFeatureMatcher::AddImage(const std::string &image_name,
 void RealtimeFeatureMatcher::RemoveImage(const std::string &image_name) {
     image_names_.erase(std::remove(image_names_.begin(), image_names_.end(), image_name), image_names_.end());
     keypoints_and_descriptors_.erase(image_name);
+    unique_keypoints_.erase(image_name);
     hashed_images_.erase(image_name);
 }
 
+void RealtimeFeatureMatcher::RemoveImages(const std::vector<std::string> &image_names) {
+    std::unordered_set<std::string> names_to_remove(image_names.begin(), image_names.end());
+    image_names_.erase(std::remove_if(image_names_.begin(), image_names_.end(),
+                                      [&names_to_remove](const std::string& image_name) {
+                                          return names_to_remove.count(image_name) > 0;
+                                      }), image_names_.end());
+    for (const auto& image_name : names_to_remove) {
+        keypoints_and_descriptors_.erase(image_name);
+        unique_keypoints_.erase(image_name);
+        hashed_images_.erase(image_name);
+    }
+}
+
 void RealtimeFeatureMatcher::MatchImages(std::vector<theia::ImagePairMatch> *matches,
-                                         const std::vector<std::pair<std::string, std::string> > &pairs_to_match) {
+                                         const std::vector<std::pair<std::string, std::string> > &pairs_to_match,
+                                         std::vector<std::vector<theia::IndexedFeatureMatch>> *indexed_matches) {
     for (const auto& pair_to_match : pairs_to_match) {
         const std::string image1_name = pair_to_match.first;
         const std::string image2_name = pair_to_match.second;
@@ -62,6 +83,11 @@ void RealtimeFeatureMatcher::MatchImages(std::vector<theia::ImagePairMatch> *mat
             if (!GeometricVerification(features1, features2, putative_matches, &image_pair_match)) {
                 continue;
             }
+            if (indexed_matches != nullptr) {
+                indexed_matches->emplace_back();
+                IndexCorrespondences(features1, features2, putative_matches,
+                                     image_pair_match.correspondences, &indexed_matches->back());
+            }
         } else {
             // If no geometric verification is performed then the putative matches are output.
             image_pair_match.correspondences.reserve(putative_matches.size());
@@ -72,6 +98,9 @@ void RealtimeFeatureMatcher::MatchImages(std::vector<theia::ImagePairMatch> *mat
                         theia::Feature(keypoint1.x(), keypoint1.y()),
                         theia::Feature(keypoint2.x(), keypoint2.y()));
             }
+            if (indexed_matches != nullptr) {
+                indexed_matches->push_back(putative_matches);
+            }
         }
 
         // Add pair match to matches.
@@ -79,6 +108,68 @@ void RealtimeFeatureMatcher::MatchImages(std::vector<theia::ImagePairMatch> *mat
     }
 }
 
+void RealtimeFeatureMatcher::IndexCorrespondences(const theia::KeypointsAndDescriptors &features1,
+                                                  const theia::KeypointsAndDescriptors &features2,
+                                                  const std::vector<theia::IndexedFeatureMatch> &putative_matches,
+                                                  const std::vector<theia::FeatureCorrespondence> &correspondences,
+                                                  std::vector<theia::IndexedFeatureMatch> *indexed_correspondences) {
+
+    // Verified correspondences are a subset of putative matches with unchanged coordinates, in
+    // the same order, so they are found by walking both lists once
+    auto same_match = [&](const theia::IndexedFeatureMatch& match, const theia::FeatureCorrespondence& correspondence) {
+        const theia::Keypoint& keypoint1 = features1.keypoints[match.feature1_ind];
+        const theia::Keypoint& keypoint2 = features2.keypoints[match.feature2_ind];
+        return keypoint1.x() == correspondence.feature1.x() && keypoint1.y() == correspondence.feature1.y() &&
+               keypoint2.x() == correspondence.feature2.x() && keypoint2.y() == correspondence.feature2.y();
+    };
+
+    indexed_correspondences->reserve(correspondences.size());
+    int next = 0;
+    for (const auto& correspondence : correspondences) {
+        int i = next;
+        while (i < putative_matches.size() && !same_match(putative_matches[i], correspondence)) {
+            i++;
+        }
+        if (i == putative_matches.size()) {
+            // Out of order (should not happen), search all matches
+            i = 0;
+            while (i < putative_matches.size() && !same_match(putative_matches[i], correspondence)) {
+                i++;
+            }
+            if (i == putative_matches.size()) {
+                continue;
+            }
+        }
+        indexed_correspondences->push_back(putative_matches[i]);
+        next = i + 1;
+    }
+}
+
+std::vector<int> RealtimeFeatureMatcher::UniqueKeypointIndices(const std::vector<theia::Keypoint>& keypoints) {
+    // Sort by coordinates (then index), runs of equal coordinates map to their first keypoint
+    std::vector<int> order(keypoints.size());
+    for (int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&keypoints](int a, int b) {
+        if (keypoints[a].x() != keypoints[b].x()) {
+            return keypoints[a].x() < keypoints[b].x();
+        }
+        if (keypoints[a].y() != keypoints[b].y()) {
+            return keypoints[a].y() < keypoints[b].y();
+        }
+        return a < b;
+    });
+
+    std::vector<int> unique_indices(keypoints.size());
+    for (int i = 0; i < order.size(); i++) {
+        const bool duplicate = i > 0 && keypoints[order[i]].x() == keypoints[order[i - 1]].x() &&
+                               keypoints[order[i]].y() == keypoints[order[i - 1]].y();
+        unique_indices[order[i]] = duplicate ? unique_indices[order[i - 1]] : order[i];
+    }
+    return unique_indices;
+}
+
 bool RealtimeFeatureMatcher::MatchImagePair(const theia::KeypointsAndDescriptors &features1,
                                             const theia::KeypointsAndDescriptors &features2,
                                             std::vector<theia::IndexedFeatureMatch> *matches) {
@@ -107,6 +198,120 @@ bool RealtimeFeatureMatcher::MatchImagePair(const theia::KeypointsAndDescriptors
     return (matches->size() >= options_.min_num_feature_matches);
 }
 
+bool RealtimeFeatureMatcher::MatchImagePairGuided(const std::string &image1_name,
+                                                  const std::string &image2_name,
+                                                  const theia::Camera &camera1,
+                                                  const theia::Camera &camera2,
+                                                  const std::unordered_map<int, Eigen::Vector4d> &points1,
+                                                  double min_depth,
+                                                  double max_depth,
+                                                  const KeypointGrid &grid2,
+                                                  theia::ImagePairMatch *image_pair_match,
+                                                  std::vector<theia::IndexedFeatureMatch> *indexed_match) {
+    const theia::KeypointsAndDescriptors& features1 = keypoints_and_descriptors_[image1_name];
+    const theia::KeypointsAndDescriptors& features2 = keypoints_and_descriptors_[image2_name];
+    const float sq_lowes_ratio = options_.lowes_ratio * options_.lowes_ratio;
+    const float sq_max_distance = options_.guided_max_descriptor_distance * options_.guided_max_descriptor_distance;
+
+    // Best match of each feature in image2 (keeps matches one to one)
+    std::vector<std::pair<int, float>> best_matches2(features2.keypoints.size(),
+                                                     std::make_pair(-1, std::numeric_limits<float>::max()));
+    std::vector<int> candidates;
+    for (int i = 0; i < features1.keypoints.size(); i++) {
+        const theia::Keypoint& keypoint1 = features1.keypoints[i];
+        candidates.clear();
+
+        // Search window from the 3D point or the epipolar segment
+        auto point_it = points1.find(i);
+        if (point_it != points1.end()) {
+            Eigen::Vector2d projection;
+            if (camera2.ProjectPoint(point_it->second, &projection) <= 0.0) {
+                continue;
+            }
+            grid2.Query(projection, options_.guided_projection_radius, &candidates);
+        } else {
+            Eigen::Vector3d ray = camera1.PixelToUnitDepthRay(Eigen::Vector2d(keypoint1.x(), keypoint1.y()));
+            Eigen::Vector3d point_near = camera1.GetPosition() + min_depth * ray;
+            Eigen::Vector3d point_far = camera1.GetPosition() + max_depth * ray;
+            Eigen::Vector2d projection_near, projection_far;
+            if (camera2.ProjectPoint(point_near.homogeneous(), &projection_near) <= 0.0 ||
+                camera2.ProjectPoint(point_far.homogeneous(), &projection_far) <= 0.0) {
+                continue;
+            }
+            grid2.QuerySegment(projection_near, projection_far, options_.guided_epipolar_distance, &candidates);
+        }
+
+        // Nearest neighbor with ratio test among candidates
+        int best_idx = -1;
+        float best_distance = std::numeric_limits<float>::max();
+        float second_distance = std::numeric_limits<float>::max();
+        for (const auto& candidate : candidates) {
+            float distance = (features1.descriptors[i] - features2.descriptors[candidate]).squaredNorm();
+            if (distance < best_distance) {
+                second_distance = best_distance;
+                best_distance = distance;
+                best_idx = candidate;
+            } else if (distance < second_distance) {
+                second_distance = distance;
+            }
+        }
+        if (candidates.size() < 2 || best_distance > sq_max_distance ||
+            (options_.use_lowes_ratio && best_distance > sq_lowes_ratio * second_distance)) {
+            continue;
+        }
+        if (best_distance < best_matches2[best_idx].second) {
+            best_matches2[best_idx] = std::make_pair(i, best_distance);
+        }
+    }
+
+    // Epipolar plane of camera1 ray and baseline, for pure rotation the rays must coincide
+    const Eigen::Vector3d baseline = camera2.GetPosition() - camera1.GetPosition();
+    const bool has_baseline = baseline.norm() > 1e-9;
+    const double max_sin_angle = options_.guided_epipolar_distance / camera2.FocalLength();
+
+    // Collect matches consistent with the relative pose of the cameras
+    indexed_match->clear();
+    image_pair_match->correspondences.clear();
+    for (int j = 0; j < best_matches2.size(); j++) {
+        if (best_matches2[j].first < 0) {
+            continue;
+        }
+        const theia::Keypoint& keypoint1 = features1.keypoints[best_matches2[j].first];
+        const theia::Keypoint& keypoint2 = features2.keypoints[j];
+
+        Eigen::Vector3d ray1 = camera1.PixelToUnitDepthRay(Eigen::Vector2d(keypoint1.x(), keypoint1.y())).normalized();
+        Eigen::Vector3d ray2 = camera2.PixelToUnitDepthRay(Eigen::Vector2d(keypoint2.x(), keypoint2.y())).normalized();
+        double sin_angle;
+        if (has_baseline) {
+            Eigen::Vector3d normal = ray1.cross(baseline);
+            if (normal.norm() < 1e-12) {
+                continue;
+            }
+            sin_angle = std::abs(normal.normalized().dot(ray2));
+        } else {
+            sin_angle = ray1.cross(ray2).norm();
+        }
+        if (sin_angle > max_sin_angle) {
+            continue;
+        }
+
+        indexed_match->emplace_back(best_matches2[j].first, j, best_matches2[j].second);
+        image_pair_match->correspondences.emplace_back(
+                theia::Feature(keypoint1.x(), keypoint1.y()),
+                theia::Feature(keypoint2.x(), keypoint2.y()));
+    }
+    if (indexed_match->size() < options_.min_num_feature_matches) {
+        return false;
+    }
+
+    // Relative pose from cameras
+    image_pair_match->image1 = image1_name;
+    image_pair_match->image2 = image2_name;
+    theia::TwoViewInfoFromTwoCameras(camera1, camera2, &image_pair_match->twoview_info);
+    image_pair_match->twoview_info.num_verified_matches = static_cast<int>(indexed_match->size());
+    return true;
+}
+
 bool RealtimeFeatureMatcher::GeometricVerification(const theia::KeypointsAndDescriptors &features1,
                                                    const theia::KeypointsAndDescriptors &features2,
                                                    const std::vector<theia::IndexedFeatureMatch> &putative_matches,
@@ -126,6 +331,132 @@ bool RealtimeFeatureMatcher::GeometricVerification(const theia::KeypointsAndDesc
     return success;
 }
 
+namespace {
+
+// Keypoint layout in session files (coordinates at the precision of track nodes and reconstruction)
+struct KeypointRecord {
+    double x;
+    double y;
+    float scale;
+    float orientation;
+};
+
+// Same scaling as colmap::FeatureDescriptorsToUnsignedByte
+const float kDescriptorQuantization = 512.0f;
+
+}
+
+void RealtimeFeatureMatcher::WriteFeatures(BinaryWriter* writer) {
+    writer->Write(static_cast<uint64_t>(image_names_.size()));
+
+    std::vector<KeypointRecord> keypoint_records;
+    std::vector<uint8_t> descriptors_uint8;
+    for (const auto& image_name : image_names_) {
+        const theia::KeypointsAndDescriptors& features = keypoints_and_descriptors_[image_name];
+        writer->WriteString(image_name);
+
+        // Keypoints
+        keypoint_records.clear();
+        keypoint_records.reserve(features.keypoints.size());
+        for (const auto& keypoint : features.keypoints) {
+            keypoint_records.push_back({keypoint.x(),
+                                        keypoint.y(),
+                                        static_cast<float>(keypoint.scale()),
+                                        static_cast<float>(keypoint.orientation())});
+        }
+        writer->WriteArray(keypoint_records.data(), keypoint_records.size());
+
+        // Descriptors
+        auto descriptor_dimension = static_cast<uint32_t>(
+                features.descriptors.empty() ? 0 : features.descriptors.front().size());
+        writer->Write(descriptor_dimension);
+
+        descriptors_uint8.resize(features.descriptors.size() * descriptor_dimension);
+        for (int i = 0; i < features.descriptors.size(); i++) {
+            for (int j = 0; j < descriptor_dimension; j++) {
+                float value = std::round(kDescriptorQuantization * features.descriptors[i](j));
+                descriptors_uint8[i * descriptor_dimension + j] =
+                        static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, value)));
+            }
+        }
+        writer->WriteArray(descriptors_uint8.data(), descriptors_uint8.size());
+    }
+}
+
+bool RealtimeFeatureMatcher::ReadFeatures(MappedFileReader* reader) {
+    image_names_.clear();
+    keypoints_and_descriptors_.clear();
+    unique_keypoints_.clear();
+    hashed_images_.clear();
+
+    uint64_t num_images = 0;
+    if (!reader->Read(&num_images)) {
+        return false;
+    }
+
+    std::vector<theia::KeypointsAndDescriptors*> images_to_hash;
+    images_to_hash.reserve(num_images);
+    for (uint64_t i = 0; i < num_images; i++) {
+        std::string image_name;
+        if (!reader->ReadString(&image_name)) {
+            return false;
+        }
+        theia::KeypointsAndDescriptors& features = keypoints_and_descriptors_[image_name];
+        features.image_name = image_name;
+
+        // Keypoints
+        uint64_t num_keypoints = 0;
+        const KeypointRecord* keypoint_records = reader->ReadArray<KeypointRecord>(&num_keypoints);
+        if (keypoint_records == nullptr) {
+            return false;
+        }
+        features.keypoints.reserve(num_keypoints);
+        for (uint64_t j = 0; j < num_keypoints; j++) {
+            theia::Keypoint keypoint(keypoint_records[j].x, keypoint_records[j].y,
+                                     theia::Keypoint::KeypointType::SIFT);
+            keypoint.set_scale(keypoint_records[j].scale);
+            keypoint.set_orientation(keypoint_records[j].orientation);
+            features.keypoints.push_back(keypoint);
+        }
+
+        // Descriptors
+        uint32_t descriptor_dimension = 0;
+        uint64_t num_values = 0;
+        if (!reader->Read(&descriptor_dimension)) {
+            return false;
+        }
+        const uint8_t* descriptors_uint8 = reader->ReadArray<uint8_t>(&num_values);
+        if (descriptors_uint8 == nullptr || num_values != num_keypoints * descriptor_dimension) {
+            return false;
+        }
+        features.descriptors.resize(num_keypoints, Eigen::VectorXf(descriptor_dimension));
+        for (uint64_t j = 0; j < num_keypoints; j++) {
+            const uint8_t* descriptor = descriptors_uint8 + j * descriptor_dimension;
+            for (int k = 0; k < descriptor_dimension; k++) {
+                features.descriptors[j](k) = descriptor[k] / kDescriptorQuantization;
+            }
+        }
+
+        image_names_.push_back(image_name);
+        unique_keypoints_[image_name] = UniqueKeypointIndices(features.keypoints);
+        if (!features.descriptors.empty()) {
+            InitializeCascadeHasher(static_cast<int>(descriptor_dimension));
+            images_to_hash.push_back(&features);
+        }
+    }
+
+    // Recompute hashes in parallel
+    std::vector<theia::HashedImage> hashed_images(images_to_hash.size());
+    #pragma omp parallel for num_threads(options_.num_threads)
+    for (int i = 0; i < images_to_hash.size(); i++) {
+        hashed_images[i] = cascade_hasher_->CreateHashedSiftDescriptors(images_to_hash[i]->descriptors);
+    }
+    for (int i = 0; i < images_to_hash.size(); i++) {
+        hashed_images_[images_to_hash[i]->image_name] = std::move(hashed_images[i]);
+    }
+    return true;
+}
+
 void RealtimeFeatureMatcher::InitializeCascadeHasher(int descriptor_dimension) {
     if (cascade_hasher_ == nullptr && descriptor_dimension > 0) {
         cascade_hasher_ = std::make_unique<theia::CascadeHasher>(options_.rng);
@@ -4,6 +4,10 @@
 #include <theia/matching/image_pair_match.h>
 #include <theia/matching/cascade_hasher.h>
 #include <theia/sfm/two_view_match_geometric_verification.h>
+#include <theia/sfm/camera/camera.h>
+
+#include "KeypointGrid.h"
+#include "util/BinaryIO.h"
 
 class RealtimeFeatureMatcher {
 public:
@@ -32,6 +36,15 @@ public:
 
         // Only images that contain more feature matches than this number will be returned.
         int min_num_feature_matches = 200;
+
+        // Guided matching: search radius around projected 3D points and maximum distance
+        // to the epipolar segment for features without 3D point (in pixels).
+        double guided_projection_radius = 16.0;
+        double guided_epipolar_distance = 4.0;
+
+        // Guided matching: maximum descriptor distance of a match (descriptors are unit length).
+        // Windows with a single candidate are rejected, the ratio test is undefined for them.
+        float guided_max_descriptor_distance = 0.7f;
     };
 
     RealtimeFeatureMatcher(const Options& matcher_options, const theia::CameraIntrinsicsPrior& intrinsics);
@@ -43,10 +56,15 @@ public:
 
     void RemoveImage(const std::string & image_name);
 
+    // Removes several images with a single pass over image names.
+    void RemoveImages(const std::vector<std::string>& image_names);
+
     // Matches features between image pairs. Only the matches which pass the have greater than
-    // min_num_feature_matches are returned.
+    // min_num_feature_matches are returned. If indexed_matches is set, keypoint indices of
+    // the verified correspondences are returned as well (one entry per returned match).
     void MatchImages(std::vector<theia::ImagePairMatch>* matches,
-                     const std::vector<std::pair<std::string, std::string>>& pairs_to_match);
+                     const std::vector<std::pair<std::string, std::string>>& pairs_to_match,
+                     std::vector<std::vector<theia::IndexedFeatureMatch>>* indexed_matches = nullptr);
 
     // Performs geometric verification.
     bool GeometricVerification(const theia::KeypointsAndDescriptors& features1,
@@ -54,6 +72,33 @@ public:
                                const std::vector<theia::IndexedFeatureMatch>& putative_matches,
                                theia::ImagePairMatch* image_pair_match);
 
+    // Recovers keypoint indices of verified correspondences from putative matches (in order).
+    void IndexCorrespondences(const theia::KeypointsAndDescriptors& features1,
+                              const theia::KeypointsAndDescriptors& features2,
+                              const std::vector<theia::IndexedFeatureMatch>& putative_matches,
+                              const std::vector<theia::FeatureCorrespondence>& correspondences,
+                              std::vector<theia::IndexedFeatureMatch>* indexed_correspondences);
+
+    // Matches features of image1 to image2 using known cameras of both images. Features with a
+    // 3D point (points1, indexed by keypoint) are searched around their projection, the others along
+    // the epipolar segment between min_depth and max_depth. Instead of RANSAC, matches are verified
+    // with the epipolar geometry of the cameras (only inliers are returned) and the two view info is
+    // computed from the cameras. Returns true if at least min_num_feature_matches are verified.
+    bool MatchImagePairGuided(const std::string& image1_name,
+                              const std::string& image2_name,
+                              const theia::Camera& camera1,
+                              const theia::Camera& camera2,
+                              const std::unordered_map<int, Eigen::Vector4d>& points1,
+                              double min_depth,
+                              double max_depth,
+                              const KeypointGrid& grid2,
+                              theia::ImagePairMatch* image_pair_match,
+                              std::vector<theia::IndexedFeatureMatch>* indexed_match);
+
+    // For each keypoint the index of the first keypoint with the same coordinates (SiftGPU
+    // returns one keypoint per orientation), so that a pixel belongs to one track only.
+    static std::vector<int> UniqueKeypointIndices(const std::vector<theia::Keypoint>& keypoints);
+
     // Returns true if the image pair is a valid match.
     bool MatchImagePair(const theia::KeypointsAndDescriptors& features1,
                         const theia::KeypointsAndDescriptors& features2,
@@ -61,6 +106,13 @@ public:
 
 
 
+    // Writes keypoints and descriptors of all images (descriptors are quantized to uint8).
+    void WriteFeatures(BinaryWriter* writer);
+
+    // Replaces all images with the ones written by WriteFeatures. Cascade hashes are
+    // recomputed because the hashing projections of Theia's hasher are not exposed.
+    bool ReadFeatures(MappedFileReader* reader);
+
     // Initializes the cascade hasher (only if needed).
     void InitializeCascadeHasher(int descriptor_dimension);
 
@@ -68,6 +120,7 @@ public:
     theia::CameraIntrinsicsPrior intrinsics_;
     std::vector<std::string> image_names_;
     std::unordered_map<std::string, theia::KeypointsAndDescriptors> keypoints_and_descriptors_;
+    std::unordered_map<std::string, std::vector<int>> unique_keypoints_;
 
     std::unordered_map<std::string, theia::HashedImage> hashed_images_;
     std::unique_ptr<theia::CascadeHasher> cascade_hasher_;
@@ -1,5 +1,11 @@
 #include "RealtimeReconstructionBuilder.h"
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include <cereal/archives/portable_binary.hpp>
 
 #include <theia/util/filesystem.h>
 #include <theia/image/image.h>
@@ -13,6 +19,30 @@
 #include <theia/io/write_ply_file.h>
 #include <colmap/retrieval/utils.h>
 
+#include "util/BinaryIO.h"
+
+namespace {
+
+// Session file header
+const char kSessionMagic[8] = {'R', 'T', 'R', 'S', 'E', 'S', 'S', '\0'};
+const uint32_t kSessionVersion = 2;
+
+// View graph edge layout in session files
+struct EdgeRecord {
+    theia::ViewId view_id1;
+    theia::ViewId view_id2;
+    double focal_length_1;
+    double focal_length_2;
+    double position_2[3];
+    double rotation_2[3];
+    int32_t num_verified_matches;
+    int32_t num_homography_inliers;
+    int32_t visibility_score;
+    int32_t padding;
+};
+
+}
+
 RealtimeReconstructionBuilder::RealtimeReconstructionBuilder(const Options& options)
         : options_(options) {
 
@@ -30,6 +60,10 @@ RealtimeReconstructionBuilder::RealtimeReconstructionBuilder(const Options& opti
     view_graph_ = std::make_unique<theia::ViewGraph>();
     reconstruction_ = std::make_unique<theia::Reconstruction>();
     reconstruction_estimator_.reset(theia::ReconstructionEstimator::Create(options_.reconstruction_estimator_options));
+    track_builder_ = std::make_unique<IncrementalTrackBuilder>();
+
+    // Initialize keyframe gate
+    keyframe_selector_ = std::make_unique<KeyframeSelector>(options_.keyframe_options);
 }
 
 bool RealtimeReconstructionBuilder::InitializeReconstruction(
@@ -86,27 +120,19 @@ bool RealtimeReconstructionBuilder::InitializeReconstruction(
     image_retrieval_->AddImage(view2_id, image2_keypoints, image2_descriptors);
 
     std::vector<theia::ImagePairMatch> matches;
+    std::vector<std::vector<theia::IndexedFeatureMatch>> indexed_matches;
     std::vector<std::pair<std::string, std::string>> pairs_to_match;
     pairs_to_match.emplace_back(std::make_pair(image1_filename, image2_filename));
-    feature_matcher_->MatchImages(&matches, pairs_to_match);
+    feature_matcher_->MatchImages(&matches, pairs_to_match, &indexed_matches);
 
     // Add matches to view graph
     if (!matches.empty()) {
-        theia::ImagePairMatch match = matches.front();
+        const theia::ImagePairMatch& match = matches.front();
         view_graph_->AddEdge(view1_id, view2_id, match.twoview_info);
 
         // Add tracks to reconstruction
-        for (const auto& correspondence : match.correspondences) {
-            const auto image1_feature = std::make_pair(view1_id, correspondence.feature1);
-            const auto image2_feature = std::make_pair(view2_id, correspondence.feature2);
-
-            // Build track
-            std::vector<std::pair<theia::ViewId, theia::Feature>> track;
-            track.emplace_back(image1_feature);
-            track.emplace_back(image2_feature);
-
-            theia::TrackId track_id = reconstruction_->AddTrack(track);
-        }
+        AddMatchToTrackBuilder(match, indexed_matches.front());
+        track_builder_->ApplyToReconstruction(reconstruction_.get());
     } else {
         reconstruction_message_ = "Initialize error: No matches found.";
         ResetReconstruction();
@@ -143,31 +169,62 @@ bool RealtimeReconstructionBuilder::ExtendReconstruction(const std::string& imag
     theia::GetFilenameFromFilepath(image_fullpath, true, &image_filename);
     theia::FloatImage image(image_fullpath);
 
+    extend_summary_ = ExtendSummary();
+    auto time_begin = std::chrono::steady_clock::now();
+    auto time_step = time_begin;
+    auto elapsed = [&time_step]() {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> time_elapsed = now - time_step;
+        time_step = now;
+        return time_elapsed.count();
+    };
+
     // Add new view to reconstruction and set intrinsics prior
     theia::ViewId view_id = reconstruction_->AddView(image_filename, 0);
     theia::View* view = reconstruction_->MutableView(view_id);
     *(view->MutableCameraIntrinsicsPrior()) = options_.intrinsics_prior;
+    extend_summary_.view_id = view_id;
 
     // Feature extraction
     std::vector<theia::Keypoint> image_keypoints;
     std::vector<Eigen::VectorXf> image_descriptors;
     descriptor_extractor_->DetectAndExtractDescriptors(image, &image_keypoints, &image_descriptors);
+    extend_summary_.num_features = static_cast<int>(image_keypoints.size());
+    extend_summary_.extraction_time = elapsed();
 
     // Image retrieval (set pairs to match)
-    std::vector<colmap::retrieval::ImageScore> image_scores =
-            image_retrieval_->QueryImage(image_keypoints, image_descriptors);
+    if (options_.exhaustive_matching) {
+        for (const auto& other_view_id : reconstruction_->ViewIds()) {
+            if (other_view_id != view_id) {
+                extend_summary_.retrieved_views.push_back(other_view_id);
+            }
+        }
+    } else {
+        std::vector<colmap::retrieval::ImageScore> image_scores =
+                image_retrieval_->QueryImage(image_keypoints, image_descriptors);
+        for (const auto& image_score : image_scores) {
+            extend_summary_.retrieved_views.push_back(static_cast<theia::ViewId>(image_score.image_id));
+        }
+    }
 
     std::vector<std::pair<std::string, std::string>> pairs_to_match;
-    for (const auto& image_score : image_scores) {
-        auto other_view_id = static_cast<theia::ViewId>(image_score.image_id);
+    for (const auto& other_view_id : extend_summary_.retrieved_views) {
         std::string other_filename = reconstruction_->View(other_view_id)->Name();
         pairs_to_match.emplace_back(std::make_pair(other_filename, image_filename));
     }
+    extend_summary_.retrieval_time = elapsed();
 
-    // Feature matching
+    // Feature matching (guided by predicted pose first, remaining pairs with full verification)
     feature_matcher_->AddImage(image_filename, image_keypoints, image_descriptors);
     std::vector<theia::ImagePairMatch> matches;
-    feature_matcher_->MatchImages(&matches, pairs_to_match);
+    std::vector<std::vector<theia::IndexedFeatureMatch>> indexed_matches;
+    if (options_.guided_matching && !options_.exhaustive_matching) {
+        std::vector<std::pair<std::string, std::string>> unmatched_pairs;
+        MatchImagesGuided(image_keypoints, image_descriptors, pairs_to_match,
+                          &matches, &indexed_matches, &unmatched_pairs);
+        pairs_to_match.swap(unmatched_pairs);
+    }
+    feature_matcher_->MatchImages(&matches, pairs_to_match, &indexed_matches);
 
     // Add to image retrieval
     image_retrieval_->AddImage(view_id, image_keypoints, image_descriptors);
@@ -175,46 +232,39 @@ bool RealtimeReconstructionBuilder::ExtendReconstruction(const std::string& imag
     // Add matches to view graph
     if (!matches.empty()) {
 
-        for (const auto& match : matches) {
+        for (int i = 0; i < matches.size(); i++) {
+            const theia::ImagePairMatch& match = matches[i];
             theia::ViewId view1_id = reconstruction_->ViewIdFromName(match.image1);
             theia::ViewId view2_id = reconstruction_->ViewIdFromName(match.image2);
             assert(view1_id < view2_id);
             assert(view_id == view2_id);
             view_graph_->AddEdge(view1_id, view2_id, match.twoview_info);
+            extend_summary_.matched_views.push_back(view1_id);
 
-            // Add tracks and observations to reconstruction
-            for (const auto& correspondence : match.correspondences) {
-
-                // Check if correspondence is already reconstructed
-                const theia::View* view1 = reconstruction_->View(view1_id);
-                const theia::TrackId* track_id_ptr = view1->GetTrackId(correspondence.feature1);
-                if (track_id_ptr == nullptr) {
-
-                    // Add new track to reconstruction
-                    std::vector<std::pair<theia::ViewId, theia::Feature>> new_track;
-                    new_track.emplace_back(std::make_pair(view1_id, correspondence.feature1));
-                    new_track.emplace_back(std::make_pair(view2_id, correspondence.feature2));
-                    reconstruction_->AddTrack(new_track);
-                } else {
-
-                    // Observation of the track may be already added from the previous match
-                    theia::TrackId existing_track_id = *track_id_ptr;
-                    const theia::View* view2 = reconstruction_->View(view2_id);
-                    if (view2->GetFeature(existing_track_id) == nullptr) {
-
-                        // Add observation of existing track
-                        reconstruction_->AddObservation(view2_id, existing_track_id, correspondence.feature2);
-                    }
-                }
-            }
+            // Collect correspondences (tracks bridged by the new view are merged)
+            AddMatchToTrackBuilder(match, indexed_matches[i]);
         }
+
+        // Add tracks and observations to reconstruction
+        track_builder_->ApplyToReconstruction(reconstruction_.get());
     } else {
+        extend_summary_.matching_time = elapsed();
+        extend_summary_.total_time = extend_summary_.extraction_time +
+                                     extend_summary_.retrieval_time +
+                                     extend_summary_.matching_time;
         reconstruction_message_ = "Extend error: No matches found.";
         return false;
     }
+    extend_summary_.matching_time = elapsed();
 
     // Build reconstruction
     auto summary = reconstruction_estimator_->Estimate(view_graph_.get(), reconstruction_.get());
+    extend_summary_.estimation_time = elapsed();
+
+    std::chrono::duration<double> total_elapsed = std::chrono::steady_clock::now() - time_begin;
+    extend_summary_.total_time = total_elapsed.count();
+    keyframe_stats_.num_extended++;
+    keyframe_stats_.extend_time += extend_summary_.total_time;
 
     // Check if view was added successfully
     if (reconstruction_->NumViews() != NumEstimatedViews(*reconstruction_)) {
@@ -226,52 +276,105 @@ bool RealtimeReconstructionBuilder::ExtendReconstruction(const std::string& imag
 }
 
 bool RealtimeReconstructionBuilder::RemoveView(theia::ViewId view_id) {
-    const theia::View* view = reconstruction_->View(view_id);
-    if (view != nullptr) {
-        bool success;
+    return RemoveViews({view_id});
+}
+
+bool RealtimeReconstructionBuilder::RemoveViews(const std::vector<theia::ViewId>& view_ids, bool reestimate) {
+    bool success = true;
 
-        // Remove from matcher
-        feature_matcher_->RemoveImage(reconstruction_->View(view_id)->Name());
+    // Remove from all state objects
+    std::vector<std::string> image_names;
+    for (const auto& view_id : view_ids) {
+        const theia::View* view = reconstruction_->View(view_id);
+        if (view == nullptr) {
+            reconstruction_message_ = "Remove view error: View id " + std::to_string(view_id) + " does not exist.";
+            success = false;
+            continue;
+        }
+        image_names.push_back(view->Name());
 
-        // Remove view from view_graph
-        success = view_graph_->RemoveView(view_id);
-        if (!success) return false;
+        image_retrieval_->RemoveImage(view_id);
+        track_builder_->RemoveView(view_id);
 
-        // Remove from reconstruction
-        success = reconstruction_->RemoveView(view_id);
-        if (!success) return false;
+        // View without edges is not in view graph
+        if (view_graph_->HasView(view_id)) {
+            view_graph_->RemoveView(view_id);
+        }
+        success = reconstruction_->RemoveView(view_id) && success;
+    }
+    feature_matcher_->RemoveImages(image_names);
 
-        // Reestimate tracks
+    // Reestimate once
+    if (reestimate && !image_names.empty() && reconstruction_->NumViews() > 0) {
         reconstruction_estimator_->Estimate(view_graph_.get(), reconstruction_.get());
-        return true;
-    } else {
-        reconstruction_message_ = "Remove view error: View id " + std::to_string(view_id) + " does not exist.";
-        return false;
     }
+    return success;
 }
 
 bool RealtimeReconstructionBuilder::RemoveUnestimatedViews() {
-    bool success = true;
+    std::vector<theia::ViewId> unestimated_views;
     for (const auto& view_id : reconstruction_->ViewIds()) {
-        const class theia::View* view = reconstruction_->View(view_id);
-        if (!view->IsEstimated()) {
-            bool result = RemoveView(view_id);
-            success = success & result;
+        if (!reconstruction_->View(view_id)->IsEstimated()) {
+            unestimated_views.push_back(view_id);
         }
     }
-    return success;
+    if (unestimated_views.empty()) {
+        return true;
+    }
+    return RemoveViews(unestimated_views);
 }
 
 bool RealtimeReconstructionBuilder::ResetReconstruction() {
-    bool success = true;
-    for (const auto& view_id : reconstruction_->ViewIds()) {
-        bool result = RemoveView(view_id);
-        success = success & result;
+    image_retrieval_ = std::make_unique<ImageRetrieval>(options_.image_retrieval_options);
+    feature_matcher_ = std::make_unique<RealtimeFeatureMatcher>(options_.matching_options,
+                                                                options_.intrinsics_prior);
+    view_graph_ = std::make_unique<theia::ViewGraph>();
+    reconstruction_ = std::make_unique<theia::Reconstruction>();
+    track_builder_->Clear();
+    extend_summary_ = ExtendSummary();
+    ResetKeyframeGate();
+    return true;
+}
+
+void RealtimeReconstructionBuilder::ResetKeyframeGate() {
+    keyframe_result_ = KeyframeSelector::Result();
+    keyframe_stats_ = KeyframeStats();
+    keyframe_frame_index_ = -1;
+    deferring_ = false;
+}
+
+bool RealtimeReconstructionBuilder::LocalizeImage(const theia::FloatImage& image,
+                                                  theia::CalibratedAbsolutePose& pose) {
+
+    if (image_retrieval_->GetNumImages() < 1) {
+        return false;
     }
-    return success;
+
+    // Feature extraction
+    std::vector<theia::Keypoint> image_keypoints;
+    std::vector<Eigen::VectorXf> image_descriptors;
+    descriptor_extractor_->DetectAndExtractDescriptors(image, &image_keypoints, &image_descriptors);
+
+    return LocalizeFeatures(image_keypoints, image_descriptors, pose);
 }
 
 bool RealtimeReconstructionBuilder::LocalizeImage(const theia::FloatImage& image,
+                                                  const theia::CalibratedAbsolutePose& prev_pose,
+                                                  theia::CalibratedAbsolutePose& pose) {
+
+    if (NumEstimated() < 1) {
+        return false;
+    }
+
+    // Feature extraction
+    std::vector<theia::Keypoint> image_keypoints;
+    std::vector<Eigen::VectorXf> image_descriptors;
+    descriptor_extractor_->DetectAndExtractDescriptors(image, &image_keypoints, &image_descriptors);
+
+    return LocalizeFeatures(image_keypoints, image_descriptors, prev_pose, pose);
+}
+
+bool RealtimeReconstructionBuilder::LocalizeImage(const GrayImage& image,
                                                   theia::CalibratedAbsolutePose& pose) {
 
     if (image_retrieval_->GetNumImages() < 1) {
@@ -283,6 +386,29 @@ bool RealtimeReconstructionBuilder::LocalizeImage(const theia::FloatImage& image
     std::vector<Eigen::VectorXf> image_descriptors;
     descriptor_extractor_->DetectAndExtractDescriptors(image, &image_keypoints, &image_descriptors);
 
+    return LocalizeFeatures(image_keypoints, image_descriptors, pose);
+}
+
+bool RealtimeReconstructionBuilder::LocalizeImage(const GrayImage& image,
+                                                  const theia::CalibratedAbsolutePose& prev_pose,
+                                                  theia::CalibratedAbsolutePose& pose) {
+
+    if (NumEstimated() < 1) {
+        return false;
+    }
+
+    // Feature extraction
+    std::vector<theia::Keypoint> image_keypoints;
+    std::vector<Eigen::VectorXf> image_descriptors;
+    descriptor_extractor_->DetectAndExtractDescriptors(image, &image_keypoints, &image_descriptors);
+
+    return LocalizeFeatures(image_keypoints, image_descriptors, prev_pose, pose);
+}
+
+bool RealtimeReconstructionBuilder::LocalizeFeatures(const std::vector<theia::Keypoint>& image_keypoints,
+                                                     const std::vector<Eigen::VectorXf>& image_descriptors,
+                                                     theia::CalibratedAbsolutePose& pose) {
+
     // Image retrieval
     std::vector<colmap::retrieval::ImageScore> image_scores =
             image_retrieval_->QueryImage(image_keypoints, image_descriptors);
@@ -300,9 +426,10 @@ bool RealtimeReconstructionBuilder::LocalizeImage(const theia::FloatImage& image
     return success;
 }
 
-bool RealtimeReconstructionBuilder::LocalizeImage(const theia::FloatImage& image,
-                                                  const theia::CalibratedAbsolutePose& prev_pose,
-                                                  theia::CalibratedAbsolutePose& pose) {
+bool RealtimeReconstructionBuilder::LocalizeFeatures(const std::vector<theia::Keypoint>& image_keypoints,
+                                                     const std::vector<Eigen::VectorXf>& image_descriptors,
+                                                     const theia::CalibratedAbsolutePose& prev_pose,
+                                                     theia::CalibratedAbsolutePose& pose) {
 
     // Compute distances to estimated views
     std::vector<std::pair<theia::ViewId, double>> distances;
@@ -329,10 +456,6 @@ bool RealtimeReconstructionBuilder::LocalizeImage(const theia::FloatImage& image
     }
 
     // Call localization
-    std::vector<theia::Keypoint> image_keypoints;
-    std::vector<Eigen::VectorXf> image_descriptors;
-    descriptor_extractor_->DetectAndExtractDescriptors(image, &image_keypoints, &image_descriptors);
-
     std::vector<theia::ViewId> views_to_match = {min_distance.first};
     bool success = LocalizeImage(image_keypoints, image_descriptors, views_to_match, pose);
     return success;
@@ -361,6 +484,7 @@ bool RealtimeReconstructionBuilder::LocalizeImage(const std::vector<theia::Keypo
         // Get features of matching view
         std::string match_view_name = reconstruction_->View(match_view_id)->Name();
         const theia::KeypointsAndDescriptors& features_match = feature_matcher_->keypoints_and_descriptors_[match_view_name];
+        const std::vector<int>& unique_match = feature_matcher_->unique_keypoints_[match_view_name];
         theia::HashedImage& hashed_match = feature_matcher_->hashed_images_[features_match.image_name];
 
         // Compute matches
@@ -373,23 +497,16 @@ bool RealtimeReconstructionBuilder::LocalizeImage(const std::vector<theia::Keypo
         // Get normalized 2D 3D matches
         for (const auto& match_correspondence : putative_matches) {
             const theia::Keypoint& keypoint_camera = features_camera.keypoints[match_correspondence.feature1_ind];
-            const theia::Keypoint& keypoint_match = features_match.keypoints[match_correspondence.feature2_ind];
-
             theia::Feature feature_camera(keypoint_camera.x(), keypoint_camera.y());
-            theia::Feature feature_match(keypoint_match.x(), keypoint_match.y());
-
-            const theia::View* match_view = reconstruction_->View(match_view_id);
-            const theia::TrackId* track_id_ptr = match_view->GetTrackId(feature_match);
 
-            if (track_id_ptr != nullptr) {
-                const theia::Track* track = reconstruction_->Track(*track_id_ptr);
+            const theia::Track* track = track_builder_->FindTrack(
+                    *reconstruction_, match_view_id, unique_match[match_correspondence.feature2_ind]);
 
-                if (track->IsEstimated()) {
-                    theia::FeatureCorrespondence2D3D pose_correspondence;
-                    pose_correspondence.feature = camera.PixelToNormalizedCoordinates(feature_camera).hnormalized();
-                    pose_correspondence.world_point = track->Point().hnormalized();
-                    pose_match_map[feature_camera] = pose_correspondence;
-                }
+            if (track != nullptr && track->IsEstimated()) {
+                theia::FeatureCorrespondence2D3D pose_correspondence;
+                pose_correspondence.feature = camera.PixelToNormalizedCoordinates(feature_camera).hnormalized();
+                pose_correspondence.world_point = track->Point().hnormalized();
+                pose_match_map[feature_camera] = pose_correspondence;
             }
         }
     }
@@ -423,6 +540,338 @@ bool RealtimeReconstructionBuilder::LocalizeImage(const std::vector<theia::Keypo
     return (ransac_summary.inliers.size() >= options_.reconstruction_estimator_options.min_num_absolute_pose_inliers);
 }
 
+void RealtimeReconstructionBuilder::MatchImagesGuided(
+        const std::vector<theia::Keypoint>& image_keypoints,
+        const std::vector<Eigen::VectorXf>& image_descriptors,
+        const std::vector<std::pair<std::string, std::string>>& pairs_to_match,
+        std::vector<theia::ImagePairMatch>* matches,
+        std::vector<std::vector<theia::IndexedFeatureMatch>>* indexed_matches,
+        std::vector<std::pair<std::string, std::string>>* unmatched_pairs) {
+
+    *unmatched_pairs = pairs_to_match;
+    if (pairs_to_match.empty()) {
+        return;
+    }
+
+    // Predict pose from the best retrieved view
+    theia::ViewId top_view_id = reconstruction_->ViewIdFromName(pairs_to_match[0].first);
+    const theia::View* top_view = reconstruction_->View(top_view_id);
+    theia::CalibratedAbsolutePose pose;
+    if (!top_view->IsEstimated() ||
+        !LocalizeImage(image_keypoints, image_descriptors, {top_view_id}, pose)) {
+        return;
+    }
+    theia::Camera camera = top_view->Camera();
+    camera.SetPosition(pose.position);
+    camera.SetOrientationFromRotationMatrix(pose.rotation);
+
+    KeypointGrid grid(image_keypoints, options_.matching_options.guided_projection_radius);
+    unmatched_pairs->clear();
+    for (const auto& pair_to_match : pairs_to_match) {
+        theia::ViewId other_view_id = reconstruction_->ViewIdFromName(pair_to_match.first);
+        const theia::View* other_view = reconstruction_->View(other_view_id);
+        if (!other_view->IsEstimated()) {
+            unmatched_pairs->push_back(pair_to_match);
+            continue;
+        }
+
+        // Estimated 3D points and depth range of the other view
+        const std::vector<int>& other_unique = feature_matcher_->unique_keypoints_[pair_to_match.first];
+        std::unordered_map<int, Eigen::Vector4d> other_points;
+        double min_depth = std::numeric_limits<double>::max();
+        double max_depth = 0.0;
+        for (int i = 0; i < other_unique.size(); i++) {
+            const theia::Track* track = track_builder_->FindTrack(*reconstruction_, other_view_id, other_unique[i]);
+            if (track == nullptr || !track->IsEstimated()) {
+                continue;
+            }
+            const Eigen::Vector4d& point = track->Point();
+            Eigen::Vector2d projection;
+            double depth = other_view->Camera().ProjectPoint(point, &projection);
+            if (depth > 0.0) {
+                other_points[i] = point;
+                min_depth = std::min(min_depth, depth);
+                max_depth = std::max(max_depth, depth);
+            }
+        }
+        if (other_points.empty()) {
+            unmatched_pairs->push_back(pair_to_match);
+            continue;
+        }
+
+        theia::ImagePairMatch match;
+        std::vector<theia::IndexedFeatureMatch> indexed_match;
+        if (feature_matcher_->MatchImagePairGuided(pair_to_match.first, pair_to_match.second,
+                                                   other_view->Camera(), camera, other_points,
+                                                   0.5 * min_depth, 2.0 * max_depth, grid,
+                                                   &match, &indexed_match)) {
+            matches->push_back(match);
+            indexed_matches->push_back(indexed_match);
+            extend_summary_.guided_views.push_back(other_view_id);
+        } else {
+            unmatched_pairs->push_back(pair_to_match);
+        }
+    }
+}
+
+void RealtimeReconstructionBuilder::AddMatchToTrackBuilder(const theia::ImagePairMatch& match,
+                                                           const std::vector<theia::IndexedFeatureMatch>& indexed_match) {
+    theia::ViewId view1_id = reconstruction_->ViewIdFromName(match.image1);
+    theia::ViewId view2_id = reconstruction_->ViewIdFromName(match.image2);
+    const std::vector<theia::Keypoint>& keypoints1 = feature_matcher_->keypoints_and_descriptors_[match.image1].keypoints;
+    const std::vector<theia::Keypoint>& keypoints2 = feature_matcher_->keypoints_and_descriptors_[match.image2].keypoints;
+    const std::vector<int>& unique1 = feature_matcher_->unique_keypoints_[match.image1];
+    const std::vector<int>& unique2 = feature_matcher_->unique_keypoints_[match.image2];
+
+    // Duplicated keypoints are added as the same feature
+    for (const auto& feature_match : indexed_match) {
+        const int feature1_idx = unique1[feature_match.feature1_ind];
+        const int feature2_idx = unique2[feature_match.feature2_ind];
+        const theia::Keypoint& keypoint1 = keypoints1[feature1_idx];
+        const theia::Keypoint& keypoint2 = keypoints2[feature2_idx];
+        track_builder_->AddFeatureCorrespondence(
+                view1_id, feature1_idx, theia::Feature(keypoint1.x(), keypoint1.y()),
+                view2_id, feature2_idx, theia::Feature(keypoint2.x(), keypoint2.y()));
+    }
+}
+
+KeyframeSelector::Decision RealtimeReconstructionBuilder::EvaluateKeyframe(int64_t frame_index, bool localized,
+                                                                         const theia::CalibratedAbsolutePose& pose) {
+    // Same frame again (e.g. save requested twice), it was not extended either time
+    if (frame_index >= 0 && frame_index == keyframe_frame_index_) {
+        return keyframe_result_.decision;
+    }
+    keyframe_frame_index_ = frame_index;
+
+    keyframe_result_ = KeyframeSelector::Result();
+    if (!IsInitialized()) {
+        keyframe_result_.decision = KeyframeSelector::Decision::kAccept;
+        return keyframe_result_.decision;
+    }
+
+    // Frames that are not localized cannot be compared and are deferred
+    if (localized) {
+        keyframe_selector_->Evaluate(*reconstruction_, pose, &keyframe_result_);
+    }
+
+    // Do not defer forever (e.g. camera moved to a part of the scene that is not reconstructed yet)
+    auto now = std::chrono::steady_clock::now();
+    if (keyframe_result_.decision == KeyframeSelector::Decision::kDefer) {
+        if (!deferring_) {
+            deferring_ = true;
+            deferred_since_ = now;
+        }
+        std::chrono::duration<double> deferred_time = now - deferred_since_;
+        if (deferred_time.count() >= options_.max_deferred_time) {
+            keyframe_result_.decision = KeyframeSelector::Decision::kAccept;
+        }
+    }
+
+    // Each new frame refused by the gate is an extend that is skipped
+    double mean_extend_time = (keyframe_stats_.num_extended > 0) ?
+                              keyframe_stats_.extend_time / keyframe_stats_.num_extended : 0.0;
+    switch (keyframe_result_.decision) {
+        case KeyframeSelector::Decision::kAccept:
+            keyframe_stats_.num_accepted++;
+            deferring_ = false;
+            break;
+        case KeyframeSelector::Decision::kReject:
+            keyframe_stats_.num_rejected++;
+            keyframe_stats_.saved_time += mean_extend_time;
+            deferring_ = false;
+            break;
+        case KeyframeSelector::Decision::kDefer:
+            keyframe_stats_.num_deferred++;
+            keyframe_stats_.saved_time += mean_extend_time;
+            break;
+    }
+    return keyframe_result_.decision;
+}
+
+std::vector<theia::ViewId> RealtimeReconstructionBuilder::MatchAllViews(theia::ViewId view_id) {
+    std::vector<theia::ViewId> matched_views;
+    const theia::View* view = reconstruction_->View(view_id);
+    if (view == nullptr) {
+        return matched_views;
+    }
+
+    // Pairs are ordered so that the view with lower id comes first
+    std::vector<std::pair<std::string, std::string>> pairs_to_match;
+    for (const auto& other_view_id : reconstruction_->ViewIds()) {
+        if (other_view_id == view_id) {
+            continue;
+        }
+        const std::string& other_name = reconstruction_->View(other_view_id)->Name();
+        if (other_view_id < view_id) {
+            pairs_to_match.emplace_back(std::make_pair(other_name, view->Name()));
+        } else {
+            pairs_to_match.emplace_back(std::make_pair(view->Name(), other_name));
+        }
+    }
+
+    std::vector<theia::ImagePairMatch> matches;
+    feature_matcher_->MatchImages(&matches, pairs_to_match);
+
+    for (const auto& match : matches) {
+        theia::ViewId view1_id = reconstruction_->ViewIdFromName(match.image1);
+        theia::ViewId view2_id = reconstruction_->ViewIdFromName(match.image2);
+        matched_views.push_back((view1_id == view_id) ? view2_id : view1_id);
+    }
+    std::sort(matched_views.begin(), matched_views.end());
+    return matched_views;
+}
+
+bool RealtimeReconstructionBuilder::SaveSession(const std::string& session_fullpath) {
+    BinaryWriter writer(session_fullpath);
+    if (!writer.IsOpen()) {
+        reconstruction_message_ = "Save session error: Cannot open " + session_fullpath + " for writing.";
+        return false;
+    }
+
+    // Header
+    writer.Write(kSessionMagic);
+    writer.Write(kSessionVersion);
+
+    // Reconstruction
+    std::ostringstream reconstruction_stream;
+    {
+        cereal::PortableBinaryOutputArchive archive(reconstruction_stream);
+        archive(*reconstruction_);
+    }
+    writer.WriteString(reconstruction_stream.str());
+
+    // View graph
+    std::vector<EdgeRecord> edges;
+    edges.reserve(view_graph_->NumEdges());
+    for (const auto& edge : view_graph_->GetAllEdges()) {
+        const theia::TwoViewInfo& info = edge.second;
+        EdgeRecord record{};
+        record.view_id1 = edge.first.first;
+        record.view_id2 = edge.first.second;
+        record.focal_length_1 = info.focal_length_1;
+        record.focal_length_2 = info.focal_length_2;
+        for (int i = 0; i < 3; i++) {
+            record.position_2[i] = info.position_2(i);
+            record.rotation_2[i] = info.rotation_2(i);
+        }
+        record.num_verified_matches = info.num_verified_matches;
+        record.num_homography_inliers = info.num_homography_inliers;
+        record.visibility_score = info.visibility_score;
+        edges.push_back(record);
+    }
+    writer.WriteArray(edges.data(), edges.size());
+
+    // Features and tracks
+    feature_matcher_->WriteFeatures(&writer);
+    track_builder_->Write(&writer);
+
+    // Image retrieval
+    std::vector<theia::ViewId> image_ids = image_retrieval_->GetImageIds();
+    std::vector<theia::ViewId> removed_image_ids = image_retrieval_->GetRemovedImageIds();
+    writer.WriteArray(image_ids.data(), image_ids.size());
+    writer.WriteArray(removed_image_ids.data(), removed_image_ids.size());
+    image_retrieval_->WriteIndex(session_fullpath + ".index");
+
+    if (!writer.Good()) {
+        reconstruction_message_ = "Save session error: Writing " + session_fullpath + " failed.";
+        return false;
+    }
+    return true;
+}
+
+bool RealtimeReconstructionBuilder::LoadSession(const std::string& session_fullpath) {
+    const std::string index_fullpath = session_fullpath + ".index";
+    MappedFileReader reader(session_fullpath);
+    if (!reader.IsOpen() || !theia::FileExists(index_fullpath)) {
+        reconstruction_message_ = "Load session error: Cannot open " + session_fullpath + ".";
+        return false;
+    }
+
+    // Header
+    char magic[8];
+    uint32_t version = 0;
+    if (!reader.Read(&magic) || std::memcmp(magic, kSessionMagic, sizeof(magic)) != 0 ||
+        !reader.Read(&version) || version != kSessionVersion) {
+        reconstruction_message_ = "Load session error: Unsupported session file " + session_fullpath + ".";
+        return false;
+    }
+
+    // Reconstruction
+    auto reconstruction = std::make_unique<theia::Reconstruction>();
+    uint64_t reconstruction_size = 0;
+    const char* reconstruction_data = reader.ReadArray<char>(&reconstruction_size);
+    if (reconstruction_data == nullptr) {
+        reconstruction_message_ = "Load session error: Reconstruction is corrupted.";
+        return false;
+    }
+    try {
+        MemoryStreamBuffer buffer(reconstruction_data, reconstruction_size);
+        std::istream reconstruction_stream(&buffer);
+        cereal::PortableBinaryInputArchive archive(reconstruction_stream);
+        archive(*reconstruction);
+    } catch (const std::exception& e) {
+        reconstruction_message_ = std::string("Load session error: ") + e.what();
+        return false;
+    }
+
+    // View graph
+    auto view_graph = std::make_unique<theia::ViewGraph>();
+    uint64_t num_edges = 0;
+    const EdgeRecord* edges = reader.ReadArray<EdgeRecord>(&num_edges);
+    if (edges == nullptr) {
+        reconstruction_message_ = "Load session error: View graph is corrupted.";
+        return false;
+    }
+    for (uint64_t i = 0; i < num_edges; i++) {
+        theia::TwoViewInfo info;
+        info.focal_length_1 = edges[i].focal_length_1;
+        info.focal_length_2 = edges[i].focal_length_2;
+        info.position_2 = Eigen::Map<const Eigen::Vector3d>(edges[i].position_2);
+        info.rotation_2 = Eigen::Map<const Eigen::Vector3d>(edges[i].rotation_2);
+        info.num_verified_matches = edges[i].num_verified_matches;
+        info.num_homography_inliers = edges[i].num_homography_inliers;
+        info.visibility_score = edges[i].visibility_score;
+        view_graph->AddEdge(edges[i].view_id1, edges[i].view_id2, info);
+    }
+
+    // Features and tracks
+    auto feature_matcher = std::make_unique<RealtimeFeatureMatcher>(options_.matching_options,
+                                                                    options_.intrinsics_prior);
+    auto track_builder = std::make_unique<IncrementalTrackBuilder>();
+    if (!feature_matcher->ReadFeatures(&reader) || !track_builder->Read(&reader)) {
+        reconstruction_message_ = "Load session error: Features or tracks are corrupted.";
+        return false;
+    }
+
+    // Image retrieval
+    uint64_t num_image_ids = 0;
+    uint64_t num_removed_image_ids = 0;
+    const theia::ViewId* image_ids = reader.ReadArray<theia::ViewId>(&num_image_ids);
+    const theia::ViewId* removed_image_ids = (image_ids != nullptr) ?
+            reader.ReadArray<theia::ViewId>(&num_removed_image_ids) : nullptr;
+    if (removed_image_ids == nullptr) {
+        reconstruction_message_ = "Load session error: Image retrieval is corrupted.";
+        return false;
+    }
+    ImageRetrieval::Options image_retrieval_options = options_.image_retrieval_options;
+    image_retrieval_options.vocab_tree_path = index_fullpath;
+    auto image_retrieval = std::make_unique<ImageRetrieval>(image_retrieval_options);
+    image_retrieval->SetImageIds(std::vector<theia::ViewId>(image_ids, image_ids + num_image_ids),
+                                 std::vector<theia::ViewId>(removed_image_ids,
+                                                            removed_image_ids + num_removed_image_ids));
+
+    // Replace state only after everything was read
+    reconstruction_ = std::move(reconstruction);
+    view_graph_ = std::move(view_graph);
+    feature_matcher_ = std::move(feature_matcher);
+    track_builder_ = std::move(track_builder);
+    image_retrieval_ = std::move(image_retrieval);
+    reconstruction_estimator_.reset(theia::ReconstructionEstimator::Create(options_.reconstruction_estimator_options));
+    extend_summary_ = ExtendSummary();
+    ResetKeyframeGate();
+    return true;
+}
+
 bool RealtimeReconstructionBuilder::IsInitialized() {
     std::unordered_set<theia::ViewId> estimated_views;
     GetEstimatedViewsFromReconstruction(*reconstruction_, &estimated_views);
@@ -503,3 +952,15 @@ RealtimeReconstructionBuilder::Options RealtimeReconstructionBuilder::GetOptions
 std::string RealtimeReconstructionBuilder::GetMessage() {
     return reconstruction_message_;
 }
+
+const RealtimeReconstructionBuilder::ExtendSummary& RealtimeReconstructionBuilder::GetExtendSummary() {
+    return extend_summary_;
+}
+
+const KeyframeSelector::Result& RealtimeReconstructionBuilder::GetKeyframeResult() {
+    return keyframe_result_;
+}
+
+const RealtimeReconstructionBuilder::KeyframeStats& RealtimeReconstructionBuilder::GetKeyframeStats() {
+    return keyframe_stats_;
+}
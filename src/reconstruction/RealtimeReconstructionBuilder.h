@@ -1,6 +1,8 @@
 #ifndef REALTIME_RECONSTRUCTION_REALTIMERECONSTRUCTIONBUILDER_H
 #define REALTIME_RECONSTRUCTION_REALTIMERECONSTRUCTIONBUILDER_H
 
+#include <chrono>
+#include <cstdint>
 #include <ostream>
 
 #include <theia/image/descriptor/descriptor_extractor.h>
@@ -19,6 +21,8 @@
 #include "SiftGpuDescriptorExtractor.h"
 #include "ImageRetrieval.h"
 #include "RealtimeFeatureMatcher.h"
+#include "IncrementalTrackBuilder.h"
+#include "KeyframeSelector.h"
 
 class RealtimeReconstructionBuilder {
 public:
@@ -45,6 +49,55 @@ public:
 
         // Options for estimating the reconstruction.
         theia::ReconstructionEstimatorOptions reconstruction_estimator_options;
+
+        // Match new image against all views in reconstruction instead of the
+        // views returned by image retrieval (slow, used for evaluation).
+        bool exhaustive_matching = false;
+
+        // Localize new image against the best retrieved view and match retrieved views
+        // in windows predicted by the pose. Pairs with enough matches consistent with the
+        // pose skip geometric verification, the others are matched as usual.
+        bool guided_matching = true;
+
+        // Keyframe gate (see EvaluateKeyframe). Frames are accepted once frames were deferred
+        // for max_deferred_time seconds in a row so that extending does not stall.
+        KeyframeSelector::Options keyframe_options;
+        double max_deferred_time = 2.0;
+    };
+
+    // Timings and matched views of the last call to ExtendReconstruction.
+    struct ExtendSummary {
+        theia::ViewId view_id = theia::kInvalidViewId;
+        int num_features = 0;
+
+        // Views selected for matching (by retrieval or exhaustively)
+        std::vector<theia::ViewId> retrieved_views;
+        // Views that passed matching and geometric verification
+        std::vector<theia::ViewId> matched_views;
+        // Views matched by guided matching (subset of matched views)
+        std::vector<theia::ViewId> guided_views;
+
+        // Timings in seconds
+        double extraction_time = 0.0;
+        double retrieval_time = 0.0;
+        double matching_time = 0.0;
+        double estimation_time = 0.0;
+        double total_time = 0.0;
+    };
+
+    // Decisions of the keyframe gate and extend time they saved.
+    struct KeyframeStats {
+        int num_accepted = 0;
+        int num_rejected = 0;
+        int num_deferred = 0;
+
+        // Extends performed and their total time in seconds
+        int num_extended = 0;
+        double extend_time = 0.0;
+
+        // Extend time saved by rejected and deferred frames (estimated with the mean extend time,
+        // counted once per frame)
+        double saved_time = 0.0;
     };
 
     explicit RealtimeReconstructionBuilder(const Options& options);
@@ -58,10 +111,14 @@ public:
     // Remove view from reconstruction by id
     bool RemoveView(theia::ViewId view_id);
 
+    // Remove views from reconstruction, view graph, tracks, matcher and image retrieval.
+    // Reconstruction is re-estimated once after all views are removed.
+    bool RemoveViews(const std::vector<theia::ViewId>& view_ids, bool reestimate = true);
+
     // Remove all unestimated views from reconstruction
     bool RemoveUnestimatedViews();
 
-    // Reset reconstruction by removing all views
+    // Reset reconstruction by reinitializing all state objects
     bool ResetReconstruction();
 
     // Global localization
@@ -73,12 +130,40 @@ public:
                        const theia::CalibratedAbsolutePose& prev_pose,
                        theia::CalibratedAbsolutePose& pose);
 
+    // Same as above for grayscale frames that are passed to the extractor without conversion
+    bool LocalizeImage(const GrayImage& image,
+                       theia::CalibratedAbsolutePose& pose);
+    bool LocalizeImage(const GrayImage& image,
+                       const theia::CalibratedAbsolutePose& prev_pose,
+                       theia::CalibratedAbsolutePose& pose);
+
     // Helper function for localization
     bool LocalizeImage(const std::vector<theia::Keypoint>& image_keypoints,
                        const std::vector<Eigen::VectorXf>& image_descriptors,
                        const std::vector<theia::ViewId>& views_to_match,
                        theia::CalibratedAbsolutePose& pose);
 
+    // Keyframe gate: decide from the localization result of a frame whether extending with it
+    // is worthwhile, before any extraction or matching is done for it. Frames that add baseline,
+    // view new parts of the scene or improve pixels per area are accepted, near duplicates of
+    // the nearest view are rejected and frames that are not localized or overlap too little
+    // are deferred. Always accepts while the reconstruction is not initialized. Evaluating the
+    // same frame_index again returns the previous decision without counting it again.
+    KeyframeSelector::Decision EvaluateKeyframe(int64_t frame_index, bool localized,
+                                                const theia::CalibratedAbsolutePose& pose);
+
+    // Match view against all other views without changing the reconstruction.
+    // Returns ids of views that pass matching and geometric verification.
+    std::vector<theia::ViewId> MatchAllViews(theia::ViewId view_id);
+
+    // Save complete builder state (reconstruction, view graph, tracks, features and
+    // image retrieval) so that extending can continue after LoadSession. The visual
+    // index is written next to the session file with ".index" suffix.
+    bool SaveSession(const std::string& session_fullpath);
+
+    // Restore builder state written by SaveSession
+    bool LoadSession(const std::string& session_fullpath);
+
     // Check if reconstruction is initialized
     bool IsInitialized();
 
@@ -104,10 +189,14 @@ public:
     const theia::Reconstruction& GetReconstruction();
     Options GetOptions();
     std::string GetMessage();
+    const ExtendSummary& GetExtendSummary();
+    const KeyframeSelector::Result& GetKeyframeResult();
+    const KeyframeStats& GetKeyframeStats();
 
 private:
     Options options_;
     std::string reconstruction_message_;
+    ExtendSummary extend_summary_;
 
     // Feature extraction and matching
     std::unique_ptr<SiftGpuDescriptorExtractor> descriptor_extractor_;
@@ -118,6 +207,41 @@ private:
     std::unique_ptr<theia::ViewGraph> view_graph_;
     std::unique_ptr<theia::Reconstruction> reconstruction_;
     std::unique_ptr<theia::ReconstructionEstimator> reconstruction_estimator_;
+    std::unique_ptr<IncrementalTrackBuilder> track_builder_;
+
+    // Keyframe gate
+    std::unique_ptr<KeyframeSelector> keyframe_selector_;
+    KeyframeSelector::Result keyframe_result_;
+    KeyframeStats keyframe_stats_;
+    int64_t keyframe_frame_index_ = -1;
+    // Time of the first frame of the current run of deferred frames
+    bool deferring_ = false;
+    std::chrono::steady_clock::time_point deferred_since_;
+
+    // Clear cached decisions and statistics of the keyframe gate (new or loaded reconstruction)
+    void ResetKeyframeGate();
+
+    // Localization with extracted features (global or near previous pose)
+    bool LocalizeFeatures(const std::vector<theia::Keypoint>& image_keypoints,
+                          const std::vector<Eigen::VectorXf>& image_descriptors,
+                          theia::CalibratedAbsolutePose& pose);
+    bool LocalizeFeatures(const std::vector<theia::Keypoint>& image_keypoints,
+                          const std::vector<Eigen::VectorXf>& image_descriptors,
+                          const theia::CalibratedAbsolutePose& prev_pose,
+                          theia::CalibratedAbsolutePose& pose);
+
+    // Match pairs guided by the pose of the new image localized against the first retrieved view.
+    // Pairs that are not matched are returned in unmatched_pairs.
+    void MatchImagesGuided(const std::vector<theia::Keypoint>& image_keypoints,
+                           const std::vector<Eigen::VectorXf>& image_descriptors,
+                           const std::vector<std::pair<std::string, std::string>>& pairs_to_match,
+                           std::vector<theia::ImagePairMatch>* matches,
+                           std::vector<std::vector<theia::IndexedFeatureMatch>>* indexed_matches,
+                           std::vector<std::pair<std::string, std::string>>* unmatched_pairs);
+
+    // Add verified correspondences of image pair to track builder
+    void AddMatchToTrackBuilder(const theia::ImagePairMatch& match,
+                                const std::vector<theia::IndexedFeatureMatch>& indexed_match);
 };
 
 #endif //REALTIME_RECONSTRUCTION_REALTIMERECONSTRUCTIONBUILDER_H
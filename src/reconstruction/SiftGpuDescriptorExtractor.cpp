@@ -23,9 +23,25 @@ bool SiftGpuDescriptorExtractor::DetectAndExtractDescriptors(
     theia::FloatImage gray_img = img.AsGrayscaleImage();
     gray_img.ScalePixels(255.0f);
 
+    return RunSift(gray_img.Width(), gray_img.Height(), gray_img.Data(), GL_FLOAT, 1.0f,
+                   keypoints, descriptors);
+}
+
+bool SiftGpuDescriptorExtractor::DetectAndExtractDescriptors(
+        const GrayImage &image,
+        std::vector<theia::Keypoint> *keypoints,
+        std::vector<Eigen::VectorXf> *descriptors) {
+
+    return RunSift(image.width, image.height, image.data, GL_UNSIGNED_BYTE, image.scale,
+                   keypoints, descriptors);
+}
+
+bool SiftGpuDescriptorExtractor::RunSift(int width, int height, const void* data, unsigned int data_type, float scale,
+                                         std::vector<theia::Keypoint> *keypoints,
+                                         std::vector<Eigen::VectorXf> *descriptors) {
+
     // Extract features
-    const int result = sift_gpu_.RunSIFT(gray_img.Width(), gray_img.Height(),
-                                         gray_img.Data(), GL_LUMINANCE, GL_FLOAT);
+    const int result = sift_gpu_.RunSIFT(width, height, data, GL_LUMINANCE, data_type);
 
     // Download the extracted keypoints and descriptors
     const auto num_features = static_cast<size_t>(sift_gpu_.GetFeatureNum());
@@ -43,12 +59,13 @@ bool SiftGpuDescriptorExtractor::DetectAndExtractDescriptors(
         descriptors_siftgpu = colmap::L1RootNormalizeFeatureDescriptors(descriptors_siftgpu);
     }
 
-    // Convert to Theia format
+    // Convert to Theia format (a downsampled pixel is centered between the pixels it averages)
+    const float offset = 0.5f * (scale - 1.0f);
     for (int i = 0; i < num_features; i++) {
-        theia::Keypoint keypoint(keypoints_siftgpu[i].x,
-                                 keypoints_siftgpu[i].y,
+        theia::Keypoint keypoint(scale * keypoints_siftgpu[i].x + offset,
+                                 scale * keypoints_siftgpu[i].y + offset,
                                  theia::Keypoint::KeypointType::SIFT);
-        keypoint.set_scale(keypoints_siftgpu[i].s);
+        keypoint.set_scale(scale * keypoints_siftgpu[i].s);
         keypoint.set_orientation(keypoints_siftgpu[i].o);
 
         keypoints->push_back(keypoint);
@@ -1,6 +1,7 @@
 #ifndef REALTIME_RECONSTRUCTION_COLMAPDESCRIPTOREXTRACTOR_H
 #define REALTIME_RECONSTRUCTION_COLMAPDESCRIPTOREXTRACTOR_H
 
+#include <cstdint>
 #include <vector>
 
 #include <theia/image/image.h>
@@ -8,6 +9,17 @@
 
 #include <SiftGPU/SiftGPU.h>
 
+// Single channel 8-bit image (row major, no padding), data is not owned.
+// Keypoints are multiplied by scale, so images decoded at reduced size
+// give keypoints in full resolution coordinates.
+struct GrayImage {
+    int width = 0;
+    int height = 0;
+    const uint8_t* data = nullptr;
+    // Integer box downsampling factor, keypoints are mapped back to full resolution
+    float scale = 1.0f;
+};
+
 class SiftGpuDescriptorExtractor {
 public:
     struct Options {
@@ -88,10 +100,21 @@ public:
             std::vector<theia::Keypoint> *keypoints,
             std::vector<Eigen::VectorXf> *descriptors);
 
+    // Same as above without conversion (image is passed to SiftGPU as is).
+    bool DetectAndExtractDescriptors(
+            const GrayImage &image,
+            std::vector<theia::Keypoint> *keypoints,
+            std::vector<Eigen::VectorXf> *descriptors);
+
 private:
     Options options_;
     SiftGPU sift_gpu_;
 
+    // Run SiftGPU on luminance data of given GL type and download features
+    bool RunSift(int width, int height, const void* data, unsigned int data_type, float scale,
+                 std::vector<theia::Keypoint> *keypoints,
+                 std::vector<Eigen::VectorXf> *descriptors);
+
     bool CreateSiftGPUExtractor(const Options& options, SiftGPU* sift_gpu);
 };
 
@@ -0,0 +1,232 @@
+#include "BatchRender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#include <glad/glad.h>
+#include <theia/util/threadpool.h>
+
+#include "stb/stb_image_write.h"
+
+double BatchRender::Stats::FramesPerSecond() const {
+    return total_time > 0.0 ? num_frames / total_time : 0.0;
+}
+
+BatchRender::BatchRender(std::shared_ptr<Render> render, const Render::CameraIntrinsic& intrinsic,
+                         const Options& options)
+        : render_(std::move(render)),
+          intrinsic_(intrinsic),
+          options_(options) {}
+
+const std::vector<std::string>& BatchRender::Filenames() const {
+    return filenames_;
+}
+
+std::vector<std::vector<unsigned char>>& BatchRender::RawImages() {
+    return raw_images_;
+}
+
+std::vector<std::shared_ptr<theia::FloatImage>>& BatchRender::FloatImages() {
+    return float_images_;
+}
+
+BatchRender::Stats BatchRender::RenderPoses(const std::vector<glm::mat4>& view_matrices) {
+    auto time_begin = std::chrono::steady_clock::now();
+
+    const int image_width = intrinsic_.image_width;
+    const int image_height = intrinsic_.image_height;
+    const size_t image_size = static_cast<size_t>(image_width) * image_height * 3;
+    const int num_frames = static_cast<int>(view_matrices.size());
+    const int num_buffers = std::max(1, options_.num_buffers);
+    const int num_threads = std::max(1, options_.num_threads);
+
+    filenames_.assign(num_frames, std::string());
+    raw_images_.assign(options_.format == Format::RAW ? num_frames : 0, std::vector<unsigned char>());
+    float_images_.assign(options_.format == Format::FLOAT_IMAGE ? num_frames : 0, nullptr);
+
+    // Framebuffer and pixel buffers are reused for every pose
+    Render::Framebuffer framebuffer = render_->CreateFramebuffer(intrinsic_);
+    std::vector<unsigned int> pixel_buffers(num_buffers);
+    std::vector<GLsync> fences(num_buffers, nullptr);
+    glGenBuffers(num_buffers, pixel_buffers.data());
+    for (unsigned int pixel_buffer : pixel_buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, image_size, nullptr, GL_STREAM_READ);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    stbi_flip_vertically_on_write(true);
+
+    theia::ThreadPool pool(num_threads);
+    std::deque<std::future<void>> encoding;
+
+    // Copies a finished readback out of its buffer and hands it to the pool
+    auto collect = [&](int frame) {
+        const int slot = frame % num_buffers;
+        while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+        auto data = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image_size,
+                                                                       GL_MAP_READ_BIT));
+        auto pixels = std::make_shared<std::vector<unsigned char>>(data, data + image_size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+        if (options_.format == Format::RAW) {
+            raw_images_[frame] = std::move(*pixels);
+            return;
+        }
+
+        // Frames waiting for encoding are bounded
+        while (encoding.size() >= static_cast<size_t>(2 * num_threads)) {
+            encoding.front().get();
+            encoding.pop_front();
+        }
+        encoding.push_back(pool.Add([this, frame, pixels]() { Encode(frame, *pixels); }));
+    };
+
+    // Frame i is collected while the GPU works on frames i+1 .. i+num_buffers-1
+    for (int frame = 0; frame < num_frames; frame++) {
+        const int slot = frame % num_buffers;
+        render_->Draw(view_matrices[frame], intrinsic_);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+        glReadPixels(0, 0, image_width, image_height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        if (frame - (num_buffers - 1) >= 0) {
+            collect(frame - (num_buffers - 1));
+        }
+    }
+    for (int frame = std::max(0, num_frames - (num_buffers - 1)); frame < num_frames; frame++) {
+        collect(frame);
+    }
+
+    // Cleanup
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glDeleteBuffers(num_buffers, pixel_buffers.data());
+    render_->DeleteFramebuffer(framebuffer);
+
+    Stats stats;
+    stats.num_frames = num_frames;
+    stats.render_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_begin).count();
+    for (auto& future : encoding) {
+        future.get();
+    }
+    stats.total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_begin).count();
+    return stats;
+}
+
+int BatchRender::RenderGrayPosesUntil(const std::vector<glm::mat4>& view_matrices,
+                                      const std::function<bool(int, const std::vector<unsigned char>&)>& consume) {
+    const int image_width = intrinsic_.image_width;
+    const int image_height = intrinsic_.image_height;
+    const size_t image_size = static_cast<size_t>(image_width) * image_height;
+    const int num_frames = static_cast<int>(view_matrices.size());
+    const int num_buffers = std::max(1, options_.num_buffers);
+
+    Render::Framebuffer framebuffer = render_->CreateFramebuffer(intrinsic_, true);
+    std::vector<unsigned int> pixel_buffers(num_buffers);
+    std::vector<GLsync> fences(num_buffers, nullptr);
+    glGenBuffers(num_buffers, pixel_buffers.data());
+    for (unsigned int pixel_buffer : pixel_buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, image_size, nullptr, GL_STREAM_READ);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    auto submit = [&](int frame) {
+        const int slot = frame % num_buffers;
+        render_->DrawGray(view_matrices[frame], intrinsic_);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+        glReadPixels(0, 0, image_width, image_height, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    };
+
+    // Frame i is consumed while the GPU works on frames i+1 .. i+num_buffers-1
+    int accepted = -1;
+    std::vector<unsigned char> pixels(image_size);
+    for (int frame = 0; frame < std::min(num_buffers - 1, num_frames); frame++) {
+        submit(frame);
+    }
+    for (int frame = 0; frame < num_frames && accepted < 0; frame++) {
+        if (frame + num_buffers - 1 < num_frames) {
+            submit(frame + num_buffers - 1);
+        }
+
+        const int slot = frame % num_buffers;
+        while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+        auto data = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image_size,
+                                                                       GL_MAP_READ_BIT));
+        std::copy(data, data + image_size, pixels.begin());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (consume(frame, pixels)) {
+            accepted = frame;
+        }
+    }
+
+    // Frames still in flight after an accepted one are dropped
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    // Cleanup
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glDeleteBuffers(num_buffers, pixel_buffers.data());
+    render_->DeleteFramebuffer(framebuffer);
+    return accepted;
+}
+
+void BatchRender::Encode(int frame, const std::vector<unsigned char>& pixels) {
+    const int image_width = intrinsic_.image_width;
+    const int image_height = intrinsic_.image_height;
+
+    if (options_.format == Format::FLOAT_IMAGE) {
+        // Flipped to the top row first
+        auto image = std::make_shared<theia::FloatImage>(image_width, image_height, 3);
+        float* data = image->Data();
+        const size_t row_size = static_cast<size_t>(image_width) * 3;
+        for (int y = 0; y < image_height; y++) {
+            const unsigned char* src = pixels.data() + (image_height - 1 - y) * row_size;
+            float* dst = data + y * row_size;
+            for (size_t i = 0; i < row_size; i++) {
+                dst[i] = src[i] / 255.0f;
+            }
+        }
+        float_images_[frame] = image;
+        return;
+    }
+
+    std::stringstream ss;
+    ss << std::setw(3) << std::setfill('0') << std::to_string(frame);
+    std::string filename = options_.folder + options_.prefix + ss.str() +
+                           (options_.format == Format::PNG ? ".png" : ".jpg");
+
+    int written;
+    if (options_.format == Format::PNG) {
+        written = stbi_write_png(filename.c_str(), image_width, image_height, 3, pixels.data(), image_width * 3);
+    } else {
+        written = stbi_write_jpg(filename.c_str(), image_width, image_height, 3, pixels.data(),
+                                 options_.jpeg_quality);
+    }
+    if (!written) {
+        std::cout << "Render Error: could not write " << filename << std::endl;
+        return;
+    }
+    filenames_[frame] = filename;
+}
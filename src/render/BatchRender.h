@@ -0,0 +1,78 @@
+#ifndef REALTIME_RECONSTRUCTION_BATCHRENDER_H
+#define REALTIME_RECONSTRUCTION_BATCHRENDER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <theia/image/image.h>
+
+#include "Render.h"
+
+// Renders many poses into one framebuffer. Readbacks go through a ring of pixel buffer
+// objects, so the GPU renders the next poses while the CPU copies an earlier one, and the
+// images are encoded on a thread pool.
+class BatchRender {
+public:
+    enum class Format {
+        // Bytes as returned by Render::RenderFromCamera (RGB, bottom row first)
+        RAW,
+        PNG,
+        JPEG,
+        // In memory, RGB in [0, 1], top row first (as read from an image file)
+        FLOAT_IMAGE
+    };
+
+    struct Options {
+        Format format = Format::PNG;
+        // Readbacks in flight (1 - blocking, 2 - double, 3 - triple buffering)
+        int num_buffers = 3;
+        // Threads encoding the images
+        int num_threads = 4;
+        int jpeg_quality = 95;
+        // Files are named folder + prefix + index (3 digits) + extension
+        std::string folder;
+        std::string prefix = "render";
+    };
+
+    struct Stats {
+        int num_frames = 0;
+        // Until the last readback, and until the last image is encoded
+        double render_time = 0.0;
+        double total_time = 0.0;
+
+        double FramesPerSecond() const;
+    };
+
+    BatchRender(std::shared_ptr<Render> render, const Render::CameraIntrinsic& intrinsic, const Options& options);
+
+    // Renders the view matrices (GL thread), returns when every image is encoded
+    Stats RenderPoses(const std::vector<glm::mat4>& view_matrices);
+
+    // Renders grayscale images (one byte per pixel, top row first) and passes them to consume in
+    // the order of the poses while the next ones render. Stops at the first image consume accepts
+    // and returns its index, -1 if none is accepted (GL thread).
+    int RenderGrayPosesUntil(const std::vector<glm::mat4>& view_matrices,
+                             const std::function<bool(int, const std::vector<unsigned char>&)>& consume);
+
+    // Results of the last RenderPoses in the order of the poses
+    const std::vector<std::string>& Filenames() const;
+    std::vector<std::vector<unsigned char>>& RawImages();
+    std::vector<std::shared_ptr<theia::FloatImage>>& FloatImages();
+
+private:
+    std::shared_ptr<Render> render_;
+    Render::CameraIntrinsic intrinsic_;
+    Options options_;
+
+    std::vector<std::string> filenames_;
+    std::vector<std::vector<unsigned char>> raw_images_;
+    std::vector<std::shared_ptr<theia::FloatImage>> float_images_;
+
+    // Encodes one frame (pool thread), pixels as read back
+    void Encode(int frame, const std::vector<unsigned char>& pixels);
+};
+
+#endif //REALTIME_RECONSTRUCTION_BATCHRENDER_H
@@ -0,0 +1,478 @@
+#include "ChunkedMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <glad/glad.h>
+
+#include "MeshDecimationJob.h"
+
+namespace {
+
+const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+Eigen::Vector3f Position(const MVS::Mesh::Vertex& vertex) {
+    return Eigen::Vector3f(vertex.x, vertex.y, vertex.z);
+}
+
+}
+
+ChunkedMesh::ChunkedMesh(const MVS::Mesh& mesh, const Options& options)
+        : options_(options),
+          vertices_(mesh.vertices),
+          faces_(mesh.faces),
+          texcoords_(mesh.faceTexcoords) {
+
+    // Texture is uploaded by the first Upload
+    if (!texcoords_.IsEmpty() && mesh.textureDiffuse.data != nullptr) {
+        texture_width_ = mesh.textureDiffuse.width();
+        texture_height_ = mesh.textureDiffuse.height();
+        const uint8_t* data = mesh.textureDiffuse.data;
+        texture_data_.assign(data, data + static_cast<size_t>(texture_width_) * texture_height_ * 3);
+    }
+
+    worker_ = std::thread(&ChunkedMesh::Run, this);
+}
+
+ChunkedMesh::~ChunkedMesh() {
+    cancel_ = true;
+    worker_.join();
+
+    for (Chunk& chunk : chunks_) {
+        for (Level& level : chunk.levels) {
+            if (level.VAO != 0) {
+                glDeleteVertexArrays(1, &level.VAO);
+                glDeleteBuffers(1, &level.VBO);
+                glDeleteBuffers(1, &level.EBO);
+            }
+        }
+    }
+    if (texture_id_ != 0) {
+        glDeleteTextures(1, &texture_id_);
+    }
+    if (shader_) {
+        glDeleteProgram(shader_->ID);
+    }
+}
+
+bool ChunkedMesh::Done() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return built_all_ && built_.empty();
+}
+
+float ChunkedMesh::Progress() const {
+    const int num_expected_levels = num_expected_levels_;
+    if (num_expected_levels == 0) {
+        return 0.0f;
+    }
+    return std::min(1.0f, static_cast<float>(num_uploaded_levels_) / num_expected_levels);
+}
+
+bool ChunkedMesh::HasTexture() const {
+    return texture_width_ > 0 && texture_height_ > 0;
+}
+
+int ChunkedMesh::NumChunks() const {
+    return static_cast<int>(chunks_.size());
+}
+
+int ChunkedMesh::NumDrawnFaces() const {
+    return num_drawn_faces_;
+}
+
+int ChunkedMesh::NumDrawnChunks() const {
+    return num_drawn_chunks_;
+}
+
+size_t ChunkedMesh::GPUMemoryUsage() const {
+    return gpu_memory_usage_;
+}
+
+void ChunkedMesh::SetPixelsPerFace(float pixels_per_face) {
+    options_.pixels_per_face = pixels_per_face;
+}
+
+void ChunkedMesh::Run() {
+    std::vector<uint32_t> order;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    Split(&order, &ranges);
+    const int num_chunks = static_cast<int>(ranges.size());
+    const int num_levels = std::max(1, options_.num_levels);
+    num_expected_levels_ = num_chunks * num_levels;
+
+    // Chunk meshes with their own vertices, shared vertices are duplicated along the borders
+    std::vector<std::shared_ptr<MVS::Mesh>> chunk_meshes(num_chunks);
+    std::vector<Eigen::AlignedBox3f> boxes(num_chunks);
+    std::vector<uint32_t> local_index(vertices_.size(), kInvalidIndex);
+    for (int c = 0; c < num_chunks; c++) {
+        chunk_meshes[c] = ExtractChunk(order.data() + ranges[c].first, ranges[c].second - ranges[c].first,
+                                       &local_index);
+        for (size_t v = 0; v < chunk_meshes[c]->vertices.size(); v++) {
+            boxes[c].extend(Position(chunk_meshes[c]->vertices[v]));
+        }
+        if (cancel_) {
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        boxes_ = std::move(boxes);
+    }
+    vertices_.Release();
+    faces_.Release();
+    texcoords_.Release();
+
+    // Full resolution first, so the whole mesh shows up before the levels are done
+    for (int c = 0; c < num_chunks && !cancel_; c++) {
+        BuiltLevel built;
+        built.chunk = c;
+        built.level = 0;
+        Pack(*chunk_meshes[c], &built);
+        Publish(std::move(built));
+    }
+
+    // Coarser levels. Chunk borders are mesh borders here, which the decimation never moves.
+    #pragma omp parallel for schedule(dynamic) num_threads(options_.num_threads)
+    for (int c = 0; c < num_chunks; c++) {
+        if (cancel_ || num_levels == 1) {
+            continue;
+        }
+        MeshDecimationJob::Options decimation_options;
+        decimation_options.num_levels = num_levels;
+        decimation_options.target_faces = std::max(1, static_cast<int>(chunk_meshes[c]->faces.size()) >> (num_levels - 1));
+        std::vector<std::shared_ptr<MVS::Mesh>> levels = MeshDecimationJob::Decimate(*chunk_meshes[c], decimation_options);
+        chunk_meshes[c].reset();
+
+        for (int l = 1; l < static_cast<int>(levels.size()); l++) {
+            if (levels[l] == levels[l - 1]) {
+                // Nothing left to collapse, Draw falls back to the finer level
+                num_expected_levels_--;
+                continue;
+            }
+            BuiltLevel built;
+            built.chunk = c;
+            built.level = l;
+            Pack(*levels[l], &built);
+            Publish(std::move(built));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    built_all_ = true;
+}
+
+void ChunkedMesh::Split(std::vector<uint32_t>* order, std::vector<std::pair<uint32_t, uint32_t>>* ranges) const {
+    const uint32_t num_faces = faces_.size();
+    std::vector<Eigen::Vector3f> centroids(num_faces);
+    for (uint32_t f = 0; f < num_faces; f++) {
+        const MVS::Mesh::Face& face = faces_[f];
+        centroids[f] = (Position(vertices_[face[0]]) + Position(vertices_[face[1]]) +
+                        Position(vertices_[face[2]])) / 3.0f;
+    }
+    order->resize(num_faces);
+    for (uint32_t f = 0; f < num_faces; f++) {
+        (*order)[f] = f;
+    }
+
+    // Median splits along the longest axis of the centroids
+    const uint32_t chunk_faces = static_cast<uint32_t>(std::max(1, options_.chunk_faces));
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    if (num_faces > 0) {
+        stack.emplace_back(0, num_faces);
+    }
+    while (!stack.empty()) {
+        std::pair<uint32_t, uint32_t> range = stack.back();
+        stack.pop_back();
+        if (range.second - range.first <= chunk_faces) {
+            ranges->push_back(range);
+            continue;
+        }
+        Eigen::AlignedBox3f box;
+        for (uint32_t i = range.first; i < range.second; i++) {
+            box.extend(centroids[(*order)[i]]);
+        }
+        int axis;
+        box.diagonal().maxCoeff(&axis);
+        const uint32_t middle = range.first + (range.second - range.first) / 2;
+        std::nth_element(order->begin() + range.first, order->begin() + middle, order->begin() + range.second,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        stack.emplace_back(middle, range.second);
+        stack.emplace_back(range.first, middle);
+    }
+}
+
+std::shared_ptr<MVS::Mesh> ChunkedMesh::ExtractChunk(const uint32_t* faces, uint32_t num_faces,
+                                                     std::vector<uint32_t>* local_index) const {
+    auto chunk = std::make_shared<MVS::Mesh>();
+    const bool with_texcoords = !texcoords_.IsEmpty();
+    chunk->faces.Resize(num_faces);
+    if (with_texcoords) {
+        chunk->faceTexcoords.Resize(num_faces * 3);
+    }
+    for (uint32_t i = 0; i < num_faces; i++) {
+        const MVS::Mesh::Face& face = faces_[faces[i]];
+        for (int j = 0; j < 3; j++) {
+            uint32_t& index = (*local_index)[face[j]];
+            if (index == kInvalidIndex) {
+                index = chunk->vertices.size();
+                chunk->vertices.Insert(vertices_[face[j]]);
+            }
+            chunk->faces[i][j] = index;
+            if (with_texcoords) {
+                chunk->faceTexcoords[i * 3 + j] = texcoords_[faces[i] * 3 + j];
+            }
+        }
+    }
+
+    // Reset for the next chunk
+    for (uint32_t i = 0; i < num_faces; i++) {
+        const MVS::Mesh::Face& face = faces_[faces[i]];
+        for (int j = 0; j < 3; j++) {
+            (*local_index)[face[j]] = kInvalidIndex;
+        }
+    }
+    return chunk;
+}
+
+void ChunkedMesh::Pack(const MVS::Mesh& mesh, BuiltLevel* built) const {
+    const uint32_t num_vertices = mesh.vertices.size();
+    const uint32_t num_faces = mesh.faces.size();
+
+    // Area weighted vertex normals
+    std::vector<Eigen::Vector3f> normals(num_vertices, Eigen::Vector3f::Zero());
+    for (uint32_t f = 0; f < num_faces; f++) {
+        const MVS::Mesh::Face& face = mesh.faces[f];
+        Eigen::Vector3f p0 = Position(mesh.vertices[face[0]]);
+        Eigen::Vector3f normal = (Position(mesh.vertices[face[1]]) - p0).cross(Position(mesh.vertices[face[2]]) - p0);
+        for (int j = 0; j < 3; j++) {
+            normals[face[j]] += normal;
+        }
+    }
+
+    // Vertices are split where their faces have different texture coordinates
+    const bool with_texcoords = !mesh.faceTexcoords.IsEmpty();
+    std::vector<uint32_t> first(num_vertices, kInvalidIndex);
+    std::vector<uint32_t> next;
+    built->vertices.clear();
+    built->vertices.reserve(num_vertices);
+    next.reserve(num_vertices);
+    built->indices.resize(num_faces * 3);
+    for (uint32_t f = 0; f < num_faces; f++) {
+        const MVS::Mesh::Face& face = mesh.faces[f];
+        for (int j = 0; j < 3; j++) {
+            const uint32_t vertex = face[j];
+            float u = 0.0f, v = 0.0f;
+            if (with_texcoords) {
+                const MVS::Mesh::TexCoord& texcoord = mesh.faceTexcoords[f * 3 + j];
+                u = texcoord.x;
+                v = 1.0f - texcoord.y;
+            }
+            uint32_t index = first[vertex];
+            while (index != kInvalidIndex &&
+                   (built->vertices[index].texcoord[0] != u || built->vertices[index].texcoord[1] != v)) {
+                index = next[index];
+            }
+            if (index == kInvalidIndex) {
+                index = static_cast<uint32_t>(built->vertices.size());
+                const MVS::Mesh::Vertex& position = mesh.vertices[vertex];
+                Eigen::Vector3f normal = normals[vertex].normalized();
+                built->vertices.push_back({{position.x, position.y, position.z},
+                                           {normal.x(), normal.y(), normal.z()},
+                                           {u, v}});
+                next.push_back(first[vertex]);
+                first[vertex] = index;
+            }
+            built->indices[f * 3 + j] = index;
+        }
+    }
+}
+
+void ChunkedMesh::Publish(BuiltLevel built) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    built_.push_back(std::move(built));
+}
+
+void ChunkedMesh::Upload() {
+    if (!texture_data_.empty()) {
+        glGenTextures(1, &texture_id_);
+        glBindTexture(GL_TEXTURE_2D, texture_id_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_width_, texture_height_, 0, GL_BGR, GL_UNSIGNED_BYTE,
+                     texture_data_.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        gpu_memory_usage_ += texture_data_.size() * 4 / 3;
+        std::vector<uint8_t>().swap(texture_data_);
+    }
+
+    // Take built levels up to the budget
+    std::vector<BuiltLevel> levels;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (chunks_.empty() && !boxes_.empty()) {
+            chunks_.resize(boxes_.size());
+            for (size_t c = 0; c < chunks_.size(); c++) {
+                chunks_[c].box = boxes_[c];
+                chunks_[c].levels.resize(std::max(1, options_.num_levels));
+            }
+        }
+        size_t bytes = 0;
+        while (!built_.empty() && (levels.empty() || bytes < options_.upload_budget)) {
+            bytes += built_.front().vertices.size() * sizeof(ChunkVertex) +
+                     built_.front().indices.size() * sizeof(uint32_t);
+            levels.push_back(std::move(built_.front()));
+            built_.pop_front();
+        }
+    }
+
+    for (const BuiltLevel& built : levels) {
+        UploadLevel(built);
+    }
+}
+
+void ChunkedMesh::UploadLevel(const BuiltLevel& built) {
+    Level& level = chunks_[built.chunk].levels[built.level];
+    glGenVertexArrays(1, &level.VAO);
+    glGenBuffers(1, &level.VBO);
+    glGenBuffers(1, &level.EBO);
+
+    glBindVertexArray(level.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, level.VBO);
+    glBufferData(GL_ARRAY_BUFFER, built.vertices.size() * sizeof(ChunkVertex), built.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, level.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, built.indices.size() * sizeof(uint32_t), built.indices.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ChunkVertex), (void*) offsetof(ChunkVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ChunkVertex), (void*) offsetof(ChunkVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ChunkVertex), (void*) offsetof(ChunkVertex, texcoord));
+    glBindVertexArray(0);
+
+    level.num_faces = static_cast<int>(built.indices.size() / 3);
+    gpu_memory_usage_ += built.vertices.size() * sizeof(ChunkVertex) + built.indices.size() * sizeof(uint32_t);
+    num_uploaded_levels_++;
+}
+
+int ChunkedMesh::SelectLevel(const Chunk& chunk, const Eigen::Vector3f& eye, const Eigen::Matrix4f& proj,
+                             const Eigen::Vector4f& viewport) const {
+    const int num_faces = chunk.levels[0].num_faces;
+    const Eigen::Vector3f center = chunk.box.center();
+    const float radius = 0.5f * chunk.box.diagonal().norm();
+
+    // Projected radius in pixels, orthographic projections have no perspective division
+    float pixels = radius * proj(1, 1) * 0.5f * viewport(3);
+    if (proj(3, 3) == 0.0f) {
+        const float distance = (center - eye).norm();
+        if (distance <= radius) {
+            return 0;
+        }
+        pixels /= distance;
+    }
+    const float max_faces = static_cast<float>(M_PI) * pixels * pixels / std::max(options_.pixels_per_face, 1e-3f);
+    if (max_faces >= num_faces || num_faces == 0) {
+        return 0;
+    }
+
+    // Every level has half the faces of the previous one
+    const int level = static_cast<int>(std::ceil(std::log2(num_faces / std::max(max_faces, 1.0f))));
+    return std::min(level, static_cast<int>(chunk.levels.size()) - 1);
+}
+
+void ChunkedMesh::Draw(const Eigen::Matrix4f& view, const Eigen::Matrix4f& proj, const Eigen::Vector4f& viewport,
+                       bool with_texture, bool wireframe) {
+    num_drawn_faces_ = 0;
+    num_drawn_chunks_ = 0;
+    if (chunks_.empty()) {
+        return;
+    }
+    if (!shader_) {
+        shader_ = std::make_unique<SourceShader>(vert_source, frag_source);
+    }
+
+    // Frustum planes, points inside have a non-negative distance to all of them
+    const Eigen::Matrix4f view_proj = proj * view;
+    Eigen::Vector4f planes[6];
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = view_proj.row(3) + view_proj.row(i);
+        planes[2 * i + 1] = view_proj.row(3) - view_proj.row(i);
+    }
+    const Eigen::Vector3f eye = view.inverse().block<3, 1>(0, 3);
+
+    // Visible chunks and their levels (missing levels fall back to a finer one, then a coarser one)
+    std::vector<const Level*> visible;
+    for (const Chunk& chunk : chunks_) {
+        bool inside = true;
+        for (const Eigen::Vector4f& plane : planes) {
+            Eigen::Vector3f corner;
+            for (int k = 0; k < 3; k++) {
+                corner[k] = plane[k] >= 0.0f ? chunk.box.max()[k] : chunk.box.min()[k];
+            }
+            if (plane.head<3>().dot(corner) + plane[3] < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+        if (!inside) {
+            continue;
+        }
+
+        const int selected = SelectLevel(chunk, eye, proj, viewport);
+        const Level* level = nullptr;
+        for (int l = selected; l >= 0 && !level; l--) {
+            level = chunk.levels[l].VAO != 0 ? &chunk.levels[l] : nullptr;
+        }
+        for (int l = selected + 1; l < static_cast<int>(chunk.levels.size()) && !level; l++) {
+            level = chunk.levels[l].VAO != 0 ? &chunk.levels[l] : nullptr;
+        }
+        if (level) {
+            visible.push_back(level);
+            num_drawn_faces_ += level->num_faces;
+        }
+    }
+    num_drawn_chunks_ = static_cast<int>(visible.size());
+
+    shader_->use();
+    glUniformMatrix4fv(glGetUniformLocation(shader_->ID, "view"), 1, GL_FALSE, view.data());
+    glUniformMatrix4fv(glGetUniformLocation(shader_->ID, "projection"), 1, GL_FALSE, proj.data());
+    glUniform3f(glGetUniformLocation(shader_->ID, "color"), 1.0f, 228.0f / 255.0f, 58.0f / 255.0f);
+    const bool use_texture = with_texture && texture_id_ != 0;
+    glUniform1i(glGetUniformLocation(shader_->ID, "use_texture"), use_texture ? 1 : 0);
+    glUniform1i(glGetUniformLocation(shader_->ID, "wireframe"), 0);
+    if (use_texture) {
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(glGetUniformLocation(shader_->ID, "texture_diffuse"), 0);
+        glBindTexture(GL_TEXTURE_2D, texture_id_);
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.0f, 1.0f);
+    for (const Level* level : visible) {
+        glBindVertexArray(level->VAO);
+        glDrawElements(GL_TRIANGLES, 3 * level->num_faces, GL_UNSIGNED_INT, nullptr);
+    }
+    glDisable(GL_POLYGON_OFFSET_FILL);
+
+    if (wireframe) {
+        glUniform1i(glGetUniformLocation(shader_->ID, "wireframe"), 1);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        for (const Level* level : visible) {
+            glBindVertexArray(level->VAO);
+            glDrawElements(GL_TRIANGLES, 3 * level->num_faces, GL_UNSIGNED_INT, nullptr);
+        }
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
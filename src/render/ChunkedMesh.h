@@ -0,0 +1,179 @@
+#ifndef REALTIME_RECONSTRUCTION_CHUNKEDMESH_H
+#define REALTIME_RECONSTRUCTION_CHUNKEDMESH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <OpenMVS/MVS.h>
+
+#include "nbv/SourceShader.h"
+
+// Renderer for large meshes. The mesh is split into spatially compact chunks, every chunk
+// gets a LOD chain (quadric decimation that keeps the chunk borders, so neighboring chunks
+// at different levels stay watertight). Chunks are built on a worker thread and uploaded as
+// float32 vertex and uint32 index buffers within a per frame budget, full resolution first.
+// Drawing culls chunks outside the view frustum and picks a level by projected size.
+class ChunkedMesh {
+public:
+    struct Options {
+        // Maximum number of faces of a chunk at full resolution
+        int chunk_faces = 65536;
+        // Number of levels of a chunk, each has half the faces of the previous one
+        int num_levels = 5;
+        // Projected pixels per face below which a coarser level is drawn
+        float pixels_per_face = 4.0f;
+        // Bytes uploaded to the GPU per frame (at least one level is uploaded)
+        size_t upload_budget = 32 << 20;
+        // Threads decimating the chunks
+        int num_threads = 1;
+    };
+
+    // Copies vertices, faces, texture coordinates and texture of mesh and starts building
+    ChunkedMesh(const MVS::Mesh& mesh, const Options& options);
+    // Must be destroyed while the GL context is current
+    ~ChunkedMesh();
+
+    ChunkedMesh(const ChunkedMesh&) = delete;
+    ChunkedMesh& operator=(const ChunkedMesh&) = delete;
+
+    // True when every level of every chunk is built and uploaded
+    bool Done() const;
+    // Fraction of levels uploaded
+    float Progress() const;
+
+    bool HasTexture() const;
+    int NumChunks() const;
+    // Faces and chunks drawn by the last Draw
+    int NumDrawnFaces() const;
+    int NumDrawnChunks() const;
+    size_t GPUMemoryUsage() const;
+
+    void SetPixelsPerFace(float pixels_per_face);
+
+    // Uploads built levels within the budget (GL thread)
+    void Upload();
+
+    // Draws with the viewer matrices (GL thread)
+    void Draw(const Eigen::Matrix4f& view, const Eigen::Matrix4f& proj, const Eigen::Vector4f& viewport,
+              bool with_texture, bool wireframe);
+
+private:
+    struct ChunkVertex {
+        float position[3];
+        float normal[3];
+        float texcoord[2];
+    };
+
+    // Level built by the worker, waiting for upload
+    struct BuiltLevel {
+        int chunk;
+        int level;
+        std::vector<ChunkVertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    struct Level {
+        unsigned int VAO = 0;
+        unsigned int VBO = 0;
+        unsigned int EBO = 0;
+        int num_faces = 0;
+    };
+
+    struct Chunk {
+        Eigen::AlignedBox3f box;
+        std::vector<Level> levels;
+    };
+
+    Options options_;
+
+    // Owned by the worker until built
+    MVS::Mesh::VertexArr vertices_;
+    MVS::Mesh::FaceArr faces_;
+    MVS::Mesh::TexCoordArr texcoords_;
+
+    // Texture copy (BGR rows), released after upload
+    std::vector<uint8_t> texture_data_;
+    int texture_width_ = 0;
+    int texture_height_ = 0;
+    unsigned int texture_id_ = 0;
+
+    std::thread worker_;
+    std::atomic<bool> cancel_{false};
+    std::atomic<int> num_expected_levels_{0};
+
+    // Shared between the worker and the GL thread
+    mutable std::mutex mutex_;
+    std::vector<Eigen::AlignedBox3f> boxes_;
+    std::deque<BuiltLevel> built_;
+    bool built_all_ = false;
+
+    // GL thread
+    std::vector<Chunk> chunks_;
+    std::unique_ptr<SourceShader> shader_;
+    int num_uploaded_levels_ = 0;
+    int num_drawn_faces_ = 0;
+    int num_drawn_chunks_ = 0;
+    size_t gpu_memory_usage_ = 0;
+
+    void Run();
+    void Split(std::vector<uint32_t>* order, std::vector<std::pair<uint32_t, uint32_t>>* ranges) const;
+    std::shared_ptr<MVS::Mesh> ExtractChunk(const uint32_t* faces, uint32_t num_faces,
+                                            std::vector<uint32_t>* local_index) const;
+    void Pack(const MVS::Mesh& mesh, BuiltLevel* built) const;
+    void Publish(BuiltLevel built);
+    void UploadLevel(const BuiltLevel& built);
+    int SelectLevel(const Chunk& chunk, const Eigen::Vector3f& eye, const Eigen::Matrix4f& proj,
+                    const Eigen::Vector4f& viewport) const;
+
+    // Shaders
+    const std::string vert_source =
+            "#version 330 core\n"
+            "layout (location = 0) in vec3 aPos;\n"
+            "layout (location = 1) in vec3 aNormal;\n"
+            "layout (location = 2) in vec2 aTexCoords;\n"
+            "out vec3 Position;\n"
+            "out vec3 Normal;\n"
+            "out vec2 TexCoords;\n"
+            "uniform mat4 view;\n"
+            "uniform mat4 projection;\n"
+            "void main()\n"
+            "{\n"
+            "    vec4 position = view * vec4(aPos, 1.0);\n"
+            "    Position = position.xyz;\n"
+            "    Normal = mat3(view) * aNormal;\n"
+            "    TexCoords = aTexCoords;\n"
+            "    gl_Position = projection * position;\n"
+            "}\n";
+
+    const std::string frag_source =
+            "#version 330 core\n"
+            "out vec4 FragColor;\n"
+            "in vec3 Position;\n"
+            "in vec3 Normal;\n"
+            "in vec2 TexCoords;\n"
+            "uniform sampler2D texture_diffuse;\n"
+            "uniform bool use_texture;\n"
+            "uniform bool wireframe;\n"
+            "uniform vec3 color;\n"
+            "void main()\n"
+            "{\n"
+            "    if (wireframe) {\n"
+            "        FragColor = vec4(0.0, 0.0, 0.0, 1.0);\n"
+            "        return;\n"
+            "    }\n"
+            "    vec3 base = use_texture ? texture(texture_diffuse, TexCoords).rgb : color;\n"
+            "    float diffuse = abs(dot(normalize(Normal), normalize(-Position)));\n"
+            "    FragColor = vec4(base * (0.3 + 0.7 * diffuse), 1.0);\n"
+            "}\n";
+};
+
+#endif //REALTIME_RECONSTRUCTION_CHUNKEDMESH_H
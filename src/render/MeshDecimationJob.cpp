@@ -0,0 +1,448 @@
+#include "MeshDecimationJob.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace {
+
+const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+const double kEdgeLengthWeight = 1e-3;
+
+Eigen::Vector3d Position(const MVS::Mesh::Vertex& vertex) {
+    return Eigen::Vector3d(vertex.x, vertex.y, vertex.z);
+}
+
+bool SameTexCoord(const MVS::Mesh::TexCoord& a, const MVS::Mesh::TexCoord& b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+int Corner(const MVS::Mesh::Face& face, uint32_t vertex) {
+    for (int j = 0; j < 3; j++) {
+        if (face[j] == vertex) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+}
+
+MeshDecimationJob::MeshDecimationJob(const MVS::Mesh& mesh, const Options& options)
+        : MeshDecimationJob(mesh, options, true) {}
+
+MeshDecimationJob::MeshDecimationJob(const MVS::Mesh& mesh, const Options& options, bool background)
+        : options_(options),
+          vertices_(mesh.vertices),
+          faces_(mesh.faces),
+          texcoords_(mesh.faceTexcoords) {
+
+    if (background) {
+        worker_ = std::thread(&MeshDecimationJob::Run, this);
+    } else {
+        Run();
+    }
+}
+
+MeshDecimationJob::~MeshDecimationJob() {
+    cancel_ = true;
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+std::vector<std::shared_ptr<MVS::Mesh>> MeshDecimationJob::Decimate(const MVS::Mesh& mesh, const Options& options) {
+    MeshDecimationJob job(mesh, options, false);
+    return job.TakeLevels();
+}
+
+void MeshDecimationJob::Cancel() {
+    cancel_ = true;
+}
+
+bool MeshDecimationJob::Done() const {
+    return done_;
+}
+
+bool MeshDecimationJob::Cancelled() const {
+    return cancelled_;
+}
+
+float MeshDecimationJob::Progress() const {
+    return progress_;
+}
+
+double MeshDecimationJob::Time() const {
+    return time_;
+}
+
+std::vector<std::shared_ptr<MVS::Mesh>> MeshDecimationJob::TakeLevels() {
+    if (!done_) {
+        return {};
+    }
+    return std::move(levels_);
+}
+
+void MeshDecimationJob::Quadric::AddPlane(double a, double b, double c, double d, double weight) {
+    q[0] += weight * a * a; q[1] += weight * a * b; q[2] += weight * a * c; q[3] += weight * a * d;
+    q[4] += weight * b * b; q[5] += weight * b * c; q[6] += weight * b * d;
+    q[7] += weight * c * c; q[8] += weight * c * d;
+    q[9] += weight * d * d;
+}
+
+MeshDecimationJob::Quadric& MeshDecimationJob::Quadric::operator+=(const Quadric& other) {
+    for (int i = 0; i < 10; i++) {
+        q[i] += other.q[i];
+    }
+    return *this;
+}
+
+double MeshDecimationJob::Quadric::Evaluate(double x, double y, double z) const {
+    return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x +
+           q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y +
+           q[7] * z * z + 2.0 * q[8] * z +
+           q[9];
+}
+
+void MeshDecimationJob::Run() {
+    auto time_begin = std::chrono::steady_clock::now();
+    Initialize();
+
+    // Face targets of the levels, finest first
+    std::vector<int> targets;
+    for (int level = 0; level < std::max(1, options_.num_levels); level++) {
+        targets.push_back(options_.target_faces << (std::max(1, options_.num_levels) - 1 - level));
+    }
+    const int num_initial_faces = num_faces_;
+    const int num_collapsed_faces = std::max(1, num_initial_faces - options_.target_faces);
+
+    size_t next_level = 0;
+    auto take_levels = [&]() {
+        std::shared_ptr<MVS::Mesh> snapshot;
+        while (next_level < targets.size() && num_faces_ <= targets[next_level]) {
+            if (!snapshot) {
+                snapshot = Snapshot();
+            }
+            levels_.push_back(snapshot);
+            next_level++;
+        }
+    };
+    take_levels();
+
+    int iteration = 0;
+    while (next_level < targets.size() && !queue_.empty()) {
+        if ((++iteration & 1023) == 0) {
+            if (cancel_) {
+                break;
+            }
+            progress_ = static_cast<float>(num_initial_faces - num_faces_) / num_collapsed_faces;
+        }
+
+        Collapse collapse = queue_.top();
+        queue_.pop();
+        if (removed_vertices_[collapse.from] || removed_vertices_[collapse.to] ||
+            collapse.stamp != stamps_[collapse.from]) {
+            continue;
+        }
+        if (!IsValid(collapse.from, collapse.to)) {
+            PushCollapse(collapse.from, true);
+            continue;
+        }
+        ApplyCollapse(collapse.from, collapse.to);
+        take_levels();
+    }
+
+    if (cancel_) {
+        levels_.clear();
+        cancelled_ = true;
+    } else if (next_level < targets.size()) {
+        // Nothing left to collapse, remaining levels are the same
+        std::shared_ptr<MVS::Mesh> snapshot = Snapshot();
+        levels_.resize(targets.size(), snapshot);
+    }
+
+    // Release working data before handing over
+    quadrics_.clear();
+    vertex_faces_.clear();
+    queue_ = decltype(queue_)();
+
+    progress_ = 1.0f;
+    time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_begin).count();
+    done_ = true;
+}
+
+void MeshDecimationJob::Initialize() {
+    const uint32_t num_vertices = vertices_.size();
+    const uint32_t num_faces = faces_.size();
+    num_faces_ = static_cast<int>(num_faces);
+
+    // Area weighted plane quadrics of the faces around each vertex
+    quadrics_.assign(num_vertices, Quadric());
+    vertex_faces_.assign(num_vertices, {});
+    for (uint32_t f = 0; f < num_faces; f++) {
+        const MVS::Mesh::Face& face = faces_[f];
+        Eigen::Vector3d p0 = Position(vertices_[face[0]]);
+        Eigen::Vector3d normal = (Position(vertices_[face[1]]) - p0).cross(Position(vertices_[face[2]]) - p0);
+        double norm = normal.norm();
+        Quadric quadric;
+        if (norm > 0.0) {
+            normal /= norm;
+            quadric.AddPlane(normal.x(), normal.y(), normal.z(), -normal.dot(p0), 0.5 * norm);
+        }
+        for (int j = 0; j < 3; j++) {
+            quadrics_[face[j]] += quadric;
+            vertex_faces_[face[j]].push_back(f);
+        }
+    }
+
+    LockBorders();
+    removed_vertices_.assign(num_vertices, 0);
+    removed_faces_.assign(num_faces, 0);
+    stamps_.assign(num_vertices, 0);
+    for (uint32_t v = 0; v < num_vertices; v++) {
+        PushCollapse(v, false);
+        if ((v & 4095) == 0 && cancel_) {
+            return;
+        }
+    }
+}
+
+void MeshDecimationJob::LockBorders() {
+    const uint32_t num_faces = faces_.size();
+    const bool has_texcoords = texcoords_.size() == 3 * num_faces && num_faces > 0;
+    locked_.assign(vertices_.size(), 0);
+
+    // Edges as (sorted vertex pair, face), sorted so that faces sharing an edge are adjacent
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+    edges.reserve(3 * static_cast<size_t>(num_faces));
+    for (uint32_t f = 0; f < num_faces; f++) {
+        for (int j = 0; j < 3; j++) {
+            uint64_t a = faces_[f][j];
+            uint64_t b = faces_[f][(j + 1) % 3];
+            edges.emplace_back(std::min(a, b) << 32 | std::max(a, b), f);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t begin = 0; begin < edges.size();) {
+        size_t end = begin + 1;
+        while (end < edges.size() && edges[end].first == edges[begin].first) {
+            end++;
+        }
+        auto a = static_cast<uint32_t>(edges[begin].first >> 32);
+        auto b = static_cast<uint32_t>(edges[begin].first & 0xFFFFFFFF);
+
+        // Boundary and non-manifold edges
+        bool lock = (end - begin != 2);
+        if (!lock) {
+            uint32_t f0 = edges[begin].second;
+            uint32_t f1 = edges[begin + 1].second;
+            int a0 = Corner(faces_[f0], a), b0 = Corner(faces_[f0], b);
+            int a1 = Corner(faces_[f1], a), b1 = Corner(faces_[f1], b);
+
+            // Inconsistently oriented neighbors (same edge direction in both faces)
+            lock = ((a0 + 1) % 3 == b0) == ((a1 + 1) % 3 == b1);
+
+            // UV seams
+            if (!lock && has_texcoords) {
+                lock = !SameTexCoord(texcoords_[3 * f0 + a0], texcoords_[3 * f1 + a1]) ||
+                       !SameTexCoord(texcoords_[3 * f0 + b0], texcoords_[3 * f1 + b1]);
+            }
+        }
+        if (lock) {
+            locked_[a] = 1;
+            locked_[b] = 1;
+        }
+        begin = end;
+    }
+}
+
+void MeshDecimationJob::Neighbors(uint32_t vertex, std::vector<uint32_t>* neighbors) const {
+    neighbors->clear();
+    for (uint32_t f : vertex_faces_[vertex]) {
+        for (int j = 0; j < 3; j++) {
+            if (faces_[f][j] != vertex) {
+                neighbors->push_back(faces_[f][j]);
+            }
+        }
+    }
+    std::sort(neighbors->begin(), neighbors->end());
+    neighbors->erase(std::unique(neighbors->begin(), neighbors->end()), neighbors->end());
+}
+
+bool MeshDecimationJob::IsValid(uint32_t from, uint32_t to) const {
+    // Link condition: the edge endpoints share exactly the two vertices opposite to the edge
+    std::vector<uint32_t>& neighbors_from = neighbors_;
+    std::vector<uint32_t>& neighbors_to = other_neighbors_;
+    Neighbors(from, &neighbors_from);
+    Neighbors(to, &neighbors_to);
+    int num_common = 0;
+    for (size_t i = 0, j = 0; i < neighbors_from.size() && j < neighbors_to.size();) {
+        if (neighbors_from[i] < neighbors_to[j]) {
+            i++;
+        } else if (neighbors_from[i] > neighbors_to[j]) {
+            j++;
+        } else {
+            num_common++;
+            i++;
+            j++;
+        }
+    }
+    if (num_common != 2) {
+        return false;
+    }
+
+    // Remaining faces around from must not flip or degenerate
+    const Eigen::Vector3d target = Position(vertices_[to]);
+    for (uint32_t f : vertex_faces_[from]) {
+        const MVS::Mesh::Face& face = faces_[f];
+        if (Corner(face, to) >= 0) {
+            continue;
+        }
+        Eigen::Vector3d p[3];
+        for (int j = 0; j < 3; j++) {
+            p[j] = Position(vertices_[face[j]]);
+        }
+        Eigen::Vector3d normal_before = (p[1] - p[0]).cross(p[2] - p[0]);
+        p[Corner(face, from)] = target;
+        Eigen::Vector3d normal_after = (p[1] - p[0]).cross(p[2] - p[0]);
+        double norm_after = normal_after.norm();
+        if (norm_after <= 0.0 ||
+            normal_before.dot(normal_after) < options_.min_normal_cos * normal_before.norm() * norm_after) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshDecimationJob::PushCollapse(uint32_t vertex, bool validate) {
+    // Invalidates the queued collapse of vertex
+    stamps_[vertex]++;
+    if (locked_[vertex] || removed_vertices_[vertex]) {
+        return;
+    }
+
+    Neighbors(vertex, &neighbors_);
+    candidates_.clear();
+    for (uint32_t neighbor : neighbors_) {
+        Quadric quadric = quadrics_[vertex];
+        quadric += quadrics_[neighbor];
+        const MVS::Mesh::Vertex& position = vertices_[neighbor];
+        double cost = quadric.Evaluate(position.x, position.y, position.z);
+
+        // Prefer short edges on flat regions, collapses with equal error would otherwise
+        // pile up on few vertices of very high valence
+        double area = quadric.q[0] + quadric.q[4] + quadric.q[7];
+        cost += kEdgeLengthWeight * area * (Position(position) - Position(vertices_[vertex])).squaredNorm();
+        candidates_.push_back({cost, vertex, neighbor, stamps_[vertex]});
+    }
+    if (candidates_.empty()) {
+        return;
+    }
+
+    // Cheapest collapse is validated when popped, after it failed the cheapest valid one is queued
+    if (!validate) {
+        queue_.push(*std::min_element(candidates_.begin(), candidates_.end(),
+                                      [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; }));
+        return;
+    }
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+    for (const Collapse& candidate : candidates_) {
+        if (IsValid(candidate.from, candidate.to)) {
+            queue_.push(candidate);
+            return;
+        }
+    }
+}
+
+void MeshDecimationJob::ApplyCollapse(uint32_t from, uint32_t to) {
+    const bool has_texcoords = texcoords_.size() == 3 * faces_.size() && !faces_.IsEmpty();
+
+    // Texture coordinate of to in the chart around from (from is not on a seam)
+    MVS::Mesh::TexCoord texcoord;
+    if (has_texcoords) {
+        for (uint32_t f : vertex_faces_[from]) {
+            int corner = Corner(faces_[f], to);
+            if (corner >= 0) {
+                texcoord = texcoords_[3 * f + corner];
+                break;
+            }
+        }
+    }
+
+    for (uint32_t f : vertex_faces_[from]) {
+        MVS::Mesh::Face& face = faces_[f];
+        if (Corner(face, to) >= 0) {
+            // Faces on the collapsed edge disappear
+            removed_faces_[f] = 1;
+            num_faces_--;
+            for (int j = 0; j < 3; j++) {
+                if (face[j] != from) {
+                    std::vector<uint32_t>& faces = vertex_faces_[face[j]];
+                    faces.erase(std::find(faces.begin(), faces.end(), f));
+                }
+            }
+        } else {
+            int corner = Corner(face, from);
+            face[corner] = to;
+            if (has_texcoords) {
+                texcoords_[3 * f + corner] = texcoord;
+            }
+            vertex_faces_[to].push_back(f);
+        }
+    }
+    std::vector<uint32_t>().swap(vertex_faces_[from]);
+    quadrics_[to] += quadrics_[from];
+    removed_vertices_[from] = 1;
+
+    // Costs around to changed
+    std::vector<uint32_t> neighbors;
+    Neighbors(to, &neighbors);
+    PushCollapse(to, false);
+    for (uint32_t neighbor : neighbors) {
+        PushCollapse(neighbor, false);
+    }
+}
+
+std::shared_ptr<MVS::Mesh> MeshDecimationJob::Snapshot() const {
+    const uint32_t num_faces = faces_.size();
+    const bool has_texcoords = texcoords_.size() == 3 * num_faces && num_faces > 0;
+    auto mesh = std::make_shared<MVS::Mesh>();
+
+    // Remaining faces with vertices renumbered in order of first use
+    std::vector<uint32_t> remap(vertices_.size(), kInvalidIndex);
+    uint32_t num_vertices = 0;
+    mesh->faces.Resize(num_faces_);
+    if (has_texcoords) {
+        mesh->faceTexcoords.Resize(3 * num_faces_);
+    }
+    uint32_t k = 0;
+    for (uint32_t f = 0; f < num_faces; f++) {
+        if (removed_faces_[f]) {
+            continue;
+        }
+        for (int j = 0; j < 3; j++) {
+            uint32_t vertex = faces_[f][j];
+            if (remap[vertex] == kInvalidIndex) {
+                remap[vertex] = num_vertices++;
+            }
+            mesh->faces[k][j] = remap[vertex];
+            if (has_texcoords) {
+                mesh->faceTexcoords[3 * k + j] = texcoords_[3 * f + j];
+            }
+        }
+        k++;
+    }
+
+    mesh->vertices.Resize(num_vertices);
+    for (uint32_t v = 0; v < remap.size(); v++) {
+        if (remap[v] != kInvalidIndex) {
+            mesh->vertices[remap[v]] = vertices_[v];
+        }
+    }
+    return mesh;
+}
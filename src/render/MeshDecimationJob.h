@@ -0,0 +1,111 @@
+#ifndef REALTIME_RECONSTRUCTION_MESHDECIMATIONJOB_H
+#define REALTIME_RECONSTRUCTION_MESHDECIMATIONJOB_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <OpenMVS/MVS.h>
+
+// Quadric error decimation of a snapshot of an MVS mesh on a worker thread. Collapses are
+// half-edge collapses (a vertex moves onto a neighbor), so positions and texture
+// coordinates are never interpolated. Vertices on boundaries, non-manifold edges and UV
+// seams are never moved, which keeps seams and texture charts intact. Levels of a LOD
+// chain are snapshots taken while collapsing towards the coarsest level.
+class MeshDecimationJob {
+public:
+    struct Options {
+        // Faces of the coarsest level
+        int target_faces = 10000;
+        // Number of levels, each has half the faces of the previous one (1 - only target_faces)
+        int num_levels = 1;
+        // Minimum cosine between a face normal before and after a collapse
+        float min_normal_cos = 0.2f;
+    };
+
+    // Copies vertices, faces and texture coordinates of mesh and starts decimating
+    MeshDecimationJob(const MVS::Mesh& mesh, const Options& options);
+    ~MeshDecimationJob();
+
+    // Decimates on the calling thread, levels are the same as the ones of a job
+    static std::vector<std::shared_ptr<MVS::Mesh>> Decimate(const MVS::Mesh& mesh, const Options& options);
+
+    MeshDecimationJob(const MeshDecimationJob&) = delete;
+    MeshDecimationJob& operator=(const MeshDecimationJob&) = delete;
+
+    // Stops the worker as soon as possible, Done becomes true without levels (Cancelled)
+    void Cancel();
+
+    bool Done() const;
+    bool Cancelled() const;
+
+    // Fraction of collapses done towards the coarsest level
+    float Progress() const;
+    double Time() const;
+
+    // Decimated meshes (vertices, faces, texture coordinates), finest first. Valid once Done.
+    std::vector<std::shared_ptr<MVS::Mesh>> TakeLevels();
+
+private:
+    // Symmetric 4x4 quadric (upper triangle)
+    struct Quadric {
+        double q[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        void AddPlane(double a, double b, double c, double d, double weight);
+        Quadric& operator+=(const Quadric& other);
+        double Evaluate(double x, double y, double z) const;
+    };
+
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t stamp;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    MeshDecimationJob(const MVS::Mesh& mesh, const Options& options, bool background);
+
+    Options options_;
+
+    std::thread worker_;
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> done_{false};
+    std::atomic<bool> cancelled_{false};
+    std::atomic<float> progress_{0.0f};
+    std::atomic<double> time_{0.0};
+
+    // Owned by the worker until done
+    MVS::Mesh::VertexArr vertices_;
+    MVS::Mesh::FaceArr faces_;
+    MVS::Mesh::TexCoordArr texcoords_;
+    std::vector<Quadric> quadrics_;
+    std::vector<std::vector<uint32_t>> vertex_faces_;
+    std::vector<uint8_t> locked_;
+    std::vector<uint8_t> removed_vertices_;
+    std::vector<uint8_t> removed_faces_;
+    std::vector<uint32_t> stamps_;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue_;
+    int num_faces_ = 0;
+    std::vector<std::shared_ptr<MVS::Mesh>> levels_;
+    // Scratch space for neighbor lists
+    mutable std::vector<uint32_t> neighbors_;
+    mutable std::vector<uint32_t> other_neighbors_;
+    std::vector<Collapse> candidates_;
+
+    void Run();
+    void Initialize();
+    void LockBorders();
+    void Neighbors(uint32_t vertex, std::vector<uint32_t>* neighbors) const;
+    bool IsValid(uint32_t from, uint32_t to) const;
+    void PushCollapse(uint32_t vertex, bool validate);
+    void ApplyCollapse(uint32_t from, uint32_t to);
+    std::shared_ptr<MVS::Mesh> Snapshot() const;
+};
+
+#endif //REALTIME_RECONSTRUCTION_MESHDECIMATIONJOB_H
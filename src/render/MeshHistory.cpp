@@ -0,0 +1,111 @@
+#include "MeshHistory.h"
+
+MeshHistory::MeshHistory(size_t memory_limit, size_t chunk_size)
+        : memory_limit_(memory_limit),
+          chunk_size_(chunk_size) {}
+
+void MeshHistory::Reset(const MVS::Mesh& mesh) {
+    states_.clear();
+    states_.push_back(Capture(mesh, nullptr));
+    current_ = 0;
+    memory_usage_ = states_.back().bytes;
+}
+
+void MeshHistory::Push(const MVS::Mesh& mesh) {
+    if (states_.empty()) {
+        Reset(mesh);
+        return;
+    }
+
+    // Redo states
+    while (states_.size() > current_ + 1) {
+        memory_usage_ -= states_.back().bytes;
+        states_.pop_back();
+    }
+
+    states_.push_back(Capture(mesh, &states_[current_]));
+    current_++;
+    memory_usage_ += states_.back().bytes;
+    Trim();
+}
+
+bool MeshHistory::CanUndo() const {
+    return current_ > 0;
+}
+
+bool MeshHistory::CanRedo() const {
+    return current_ + 1 < states_.size();
+}
+
+int MeshHistory::NumUndo() const {
+    return static_cast<int>(current_);
+}
+
+int MeshHistory::NumRedo() const {
+    return states_.empty() ? 0 : static_cast<int>(states_.size() - current_ - 1);
+}
+
+bool MeshHistory::Undo(MVS::Mesh* mesh) {
+    if (!CanUndo()) {
+        return false;
+    }
+    Restore(states_[current_ - 1], states_[current_], mesh);
+    current_--;
+    return true;
+}
+
+bool MeshHistory::Redo(MVS::Mesh* mesh) {
+    if (!CanRedo()) {
+        return false;
+    }
+    Restore(states_[current_ + 1], states_[current_], mesh);
+    current_++;
+    return true;
+}
+
+size_t MeshHistory::MemoryUsage() const {
+    return memory_usage_;
+}
+
+void MeshHistory::SetMemoryLimit(size_t memory_limit) {
+    memory_limit_ = memory_limit;
+    Trim();
+}
+
+MeshHistory::State MeshHistory::Capture(const MVS::Mesh& mesh, const State* previous) const {
+    State state;
+    state.vertices = CaptureArray(mesh.vertices, previous ? &previous->vertices : nullptr, &state.bytes);
+    state.faces = CaptureArray(mesh.faces, previous ? &previous->faces : nullptr, &state.bytes);
+    state.texcoords = CaptureArray(mesh.faceTexcoords, previous ? &previous->texcoords : nullptr, &state.bytes);
+    return state;
+}
+
+void MeshHistory::Restore(const State& target, const State& current, MVS::Mesh* mesh) const {
+    RestoreArray(target.vertices, current.vertices, &mesh->vertices);
+    RestoreArray(target.faces, current.faces, &mesh->faces);
+    RestoreArray(target.texcoords, current.texcoords, &mesh->faceTexcoords);
+}
+
+void MeshHistory::Trim() {
+    // Oldest states first, the current state is always kept
+    while (memory_usage_ > memory_limit_ && current_ > 0) {
+        memory_usage_ -= states_.front().bytes;
+        states_.pop_front();
+        current_--;
+
+        // Chunks of the new oldest state are no longer shared with a dropped state
+        State& oldest = states_.front();
+        memory_usage_ -= oldest.bytes;
+        oldest.bytes = 0;
+        for (const auto& chunk : oldest.vertices.chunks) {
+            oldest.bytes += chunk->size() * sizeof(MVS::Mesh::Vertex);
+        }
+        for (const auto& chunk : oldest.faces.chunks) {
+            oldest.bytes += chunk->size() * sizeof(MVS::Mesh::Face);
+        }
+        for (const auto& chunk : oldest.texcoords.chunks) {
+            oldest.bytes += chunk->size() * sizeof(MVS::Mesh::TexCoord);
+        }
+        memory_usage_ += oldest.bytes;
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef REALTIME_RECONSTRUCTION_MESHHISTORY_H
+#define REALTIME_RECONSTRUCTION_MESHHISTORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <OpenMVS/MVS.h>
+
+// Undo history of the vertices, faces and texture coordinates of an MVS mesh. Every state
+// stores its arrays as chunks shared with the previous state, so a state only owns the
+// chunks an edit touched. Undo and redo copy only the chunks that differ between the current
+// and the restored state. The oldest states are dropped when the history exceeds its memory limit.
+class MeshHistory {
+public:
+    explicit MeshHistory(size_t memory_limit = 512 << 20, size_t chunk_size = 4096);
+
+    // Clears the history, mesh becomes the only state
+    void Reset(const MVS::Mesh& mesh);
+
+    // Records mesh after an edit (drops the states that could be redone)
+    void Push(const MVS::Mesh& mesh);
+
+    bool CanUndo() const;
+    bool CanRedo() const;
+    int NumUndo() const;
+    int NumRedo() const;
+
+    // Restores the previous (next) state into mesh, which must hold the current state
+    bool Undo(MVS::Mesh* mesh);
+    bool Redo(MVS::Mesh* mesh);
+
+    // Bytes owned by the states
+    size_t MemoryUsage() const;
+    void SetMemoryLimit(size_t memory_limit);
+
+private:
+    template <typename T>
+    struct ChunkedArray {
+        size_t size = 0;
+        std::vector<std::shared_ptr<const std::vector<T>>> chunks;
+    };
+
+    struct State {
+        ChunkedArray<MVS::Mesh::Vertex> vertices;
+        ChunkedArray<MVS::Mesh::Face> faces;
+        ChunkedArray<MVS::Mesh::TexCoord> texcoords;
+        // Bytes of chunks not shared with the previous state
+        size_t bytes = 0;
+    };
+
+    size_t memory_limit_;
+    size_t chunk_size_;
+    std::deque<State> states_;
+    size_t current_ = 0;
+    size_t memory_usage_ = 0;
+
+    State Capture(const MVS::Mesh& mesh, const State* previous) const;
+    void Restore(const State& target, const State& current, MVS::Mesh* mesh) const;
+    void Trim();
+
+    // Chunks equal to the ones of previous are shared instead of copied
+    template <typename T, typename Array>
+    ChunkedArray<T> CaptureArray(const Array& array, const ChunkedArray<T>* previous, size_t* bytes) const {
+        ChunkedArray<T> chunked;
+        chunked.size = array.size();
+        const T* data = array.Begin();
+        for (size_t begin = 0; begin < chunked.size; begin += chunk_size_) {
+            const size_t count = std::min(chunk_size_, chunked.size - begin);
+            const size_t index = begin / chunk_size_;
+            if (previous && index < previous->chunks.size() && previous->chunks[index]->size() == count &&
+                std::memcmp(previous->chunks[index]->data(), data + begin, count * sizeof(T)) == 0) {
+                chunked.chunks.push_back(previous->chunks[index]);
+            } else {
+                chunked.chunks.push_back(std::make_shared<const std::vector<T>>(data + begin, data + begin + count));
+                *bytes += count * sizeof(T);
+            }
+        }
+        return chunked;
+    }
+
+    // Copies the chunks of target that are not shared with current (array holds current)
+    template <typename T, typename Array>
+    void RestoreArray(const ChunkedArray<T>& target, const ChunkedArray<T>& current, Array* array) const {
+        array->Resize(target.size);
+        T* data = array->Begin();
+        for (size_t index = 0; index < target.chunks.size(); index++) {
+            if (index >= current.chunks.size() || target.chunks[index] != current.chunks[index]) {
+                const std::vector<T>& chunk = *target.chunks[index];
+                std::memcpy(data + index * chunk_size_, chunk.data(), chunk.size() * sizeof(T));
+            }
+        }
+    }
+};
+
+#endif //REALTIME_RECONSTRUCTION_MESHHISTORY_H
@@ -0,0 +1,221 @@
+#include "MeshResource.h"
+
+MeshResource::MeshResource(std::shared_ptr<MVS::Scene> mvs_scene, int num_threads)
+        : mvs_scene_(std::move(mvs_scene)),
+          num_threads_(num_threads) {}
+
+void MeshResource::Invalidate() {
+    NewGeneration();
+}
+
+uint64_t MeshResource::Generation() {
+    Fingerprint fingerprint = ComputeFingerprint();
+    if (!(fingerprint == fingerprint_)) {
+        fingerprint_ = fingerprint;
+        NewGeneration();
+    }
+    return generation_;
+}
+
+uint64_t MeshResource::LevelsGeneration() {
+    Generation();
+    return levels_generation_;
+}
+
+void MeshResource::SetLevels(std::vector<std::shared_ptr<MVS::Mesh>> levels) {
+    Generation();
+    levels_ = std::move(levels);
+
+    // Plugins showing a level set their data again, the mesh generation stays
+    levels_generation_ = ++last_generation_;
+}
+
+int MeshResource::NumLevels() {
+    Generation();
+    return 1 + static_cast<int>(levels_.size());
+}
+
+const Eigen::MatrixXd& MeshResource::V() {
+    Update();
+    return V_;
+}
+
+const Eigen::MatrixXi& MeshResource::F() {
+    Update();
+    return F_;
+}
+
+const Eigen::MatrixXd& MeshResource::TC() {
+    Update();
+    return TC_;
+}
+
+const Eigen::MatrixXi& MeshResource::FTC() {
+    Update();
+    return FTC_;
+}
+
+bool MeshResource::HasTexture() {
+    Update();
+    return TC_.rows() > 0 && R_.size() > 0;
+}
+
+const MeshBVH& MeshResource::BVH() {
+    Update();
+    if (bvh_generation_ != converted_generation_) {
+        if (faces_changed_ || bvh_.NumFaces() != F_.rows()) {
+            bvh_.Build(V_, F_);
+            faces_changed_ = false;
+        } else {
+            bvh_.Refit(V_, F_);
+        }
+        bvh_generation_ = converted_generation_;
+    }
+    return bvh_;
+}
+
+bool MeshResource::SetMesh(igl::opengl::ViewerData& data, uint64_t* data_generation, bool with_texture, int level) {
+    Update();
+    const bool use_level = level > 0 && level <= static_cast<int>(levels_.size());
+    const uint64_t generation = use_level ? levels_generation_ : converted_generation_;
+    if (*data_generation == generation) {
+        return false;
+    }
+
+    data.clear();
+    if (use_level) {
+        Eigen::MatrixXd V, TC;
+        Eigen::MatrixXi F, FTC;
+        ConvertGeometry(*levels_[level - 1], &V, &F, &TC, &FTC);
+        data.set_mesh(V, F);
+        if (with_texture && TC.rows() > 0 && R_.size() > 0) {
+            data.set_uv(TC, FTC);
+            data.set_colors(Eigen::RowVector3d(1, 1, 1));
+            data.set_texture(R_, G_, B_);
+        }
+    } else {
+        data.set_mesh(V_, F_);
+        if (with_texture && HasTexture()) {
+            data.set_uv(TC_, FTC_);
+            data.set_colors(Eigen::RowVector3d(1, 1, 1));
+            data.set_texture(R_, G_, B_);
+        }
+    }
+    *data_generation = generation;
+    return true;
+}
+
+bool MeshResource::Fingerprint::operator==(const Fingerprint& other) const {
+    return vertices == other.vertices && faces == other.faces &&
+           texcoords == other.texcoords && texture == other.texture &&
+           num_vertices == other.num_vertices && num_faces == other.num_faces &&
+           num_texcoords == other.num_texcoords &&
+           texture_width == other.texture_width && texture_height == other.texture_height;
+}
+
+MeshResource::Fingerprint MeshResource::ComputeFingerprint() const {
+    const MVS::Mesh& mesh = mvs_scene_->mesh;
+    Fingerprint fingerprint;
+    fingerprint.vertices = mesh.vertices.Begin();
+    fingerprint.faces = mesh.faces.Begin();
+    fingerprint.texcoords = mesh.faceTexcoords.Begin();
+    fingerprint.texture = mesh.textureDiffuse.data;
+    fingerprint.num_vertices = mesh.vertices.size();
+    fingerprint.num_faces = mesh.faces.size();
+    fingerprint.num_texcoords = mesh.faceTexcoords.size();
+    fingerprint.texture_width = mesh.textureDiffuse.width();
+    fingerprint.texture_height = mesh.textureDiffuse.height();
+    return fingerprint;
+}
+
+void MeshResource::NewGeneration() {
+    generation_ = ++last_generation_;
+    if (!levels_.empty()) {
+        levels_.clear();
+        levels_generation_ = ++last_generation_;
+    }
+}
+
+void MeshResource::Update() {
+    if (Generation() == converted_generation_) {
+        return;
+    }
+    const MVS::Mesh& mesh = mvs_scene_->mesh;
+
+    // Faces are compared to decide between refitting and rebuilding the picking hierarchy
+    Eigen::MatrixXi F;
+    ConvertGeometry(mesh, &V_, &F, &TC_, &FTC_);
+    if (F.rows() != F_.rows() || F != F_) {
+        faces_changed_ = true;
+    }
+    F_.swap(F);
+
+    // Texture
+    if (!mesh.faceTexcoords.IsEmpty()) {
+        // Channels are transposed and flipped vertically for the viewer
+        const SEACAVE::Image8U3& img = mesh.textureDiffuse;
+        const int width = img.width();
+        const int height = img.height();
+        R_.resize(width, height);
+        G_.resize(width, height);
+        B_.resize(width, height);
+        #pragma omp parallel for num_threads(num_threads_)
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++) {
+                const Pixel8U& pixel = img(j, i);
+                R_(i, height - 1 - j) = pixel.r;
+                G_(i, height - 1 - j) = pixel.g;
+                B_(i, height - 1 - j) = pixel.b;
+            }
+        }
+    } else {
+        R_.resize(0, 0);
+        G_.resize(0, 0);
+        B_.resize(0, 0);
+    }
+
+    converted_generation_ = generation_;
+}
+
+void MeshResource::ConvertGeometry(const MVS::Mesh& mesh, Eigen::MatrixXd* V, Eigen::MatrixXi* F,
+                                   Eigen::MatrixXd* TC, Eigen::MatrixXi* FTC) const {
+    // Vertices and faces
+    const int num_vertices = mesh.vertices.size();
+    V->resize(num_vertices, 3);
+    #pragma omp parallel for num_threads(num_threads_)
+    for (int i = 0; i < num_vertices; i++) {
+        const MVS::Mesh::Vertex& vertex = mesh.vertices[i];
+        (*V)(i, 0) = vertex[0];
+        (*V)(i, 1) = vertex[1];
+        (*V)(i, 2) = vertex[2];
+    }
+    const int num_faces = mesh.faces.size();
+    F->resize(num_faces, 3);
+    #pragma omp parallel for num_threads(num_threads_)
+    for (int i = 0; i < num_faces; i++) {
+        const MVS::Mesh::Face& face = mesh.faces[i];
+        (*F)(i, 0) = face[0];
+        (*F)(i, 1) = face[1];
+        (*F)(i, 2) = face[2];
+    }
+
+    // UVs (three per face)
+    if (!mesh.faceTexcoords.IsEmpty()) {
+        const int num_texcoords = mesh.faceTexcoords.size();
+        TC->resize(num_texcoords, 2);
+        for (int i = 0; i < num_texcoords; i++) {
+            const MVS::Mesh::TexCoord& texcoord = mesh.faceTexcoords[i];
+            (*TC)(i, 0) = texcoord[0];
+            (*TC)(i, 1) = texcoord[1];
+        }
+        FTC->resize(num_faces, 3);
+        for (int i = 0; i < num_faces; i++) {
+            (*FTC)(i, 0) = i*3 + 0;
+            (*FTC)(i, 1) = i*3 + 1;
+            (*FTC)(i, 2) = i*3 + 2;
+        }
+    } else {
+        TC->resize(0, 2);
+        FTC->resize(0, 3);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef REALTIME_RECONSTRUCTION_MESHRESOURCE_H
+#define REALTIME_RECONSTRUCTION_MESHRESOURCE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+#include <igl/opengl/ViewerData.h>
+#include <OpenMVS/MVS.h>
+
+#include "util/MeshBVH.h"
+
+// Single converted copy of the scene mesh (vertices, faces, UVs and texture) shared by the
+// plugins that display it. Every change of the mesh starts a new generation, plugins keep
+// the generation last set into their viewer data and only set (and upload) it again when
+// the generation changes. The LOD chain has its own generation, so building it does not
+// look like a change of the mesh itself.
+class MeshResource {
+public:
+    explicit MeshResource(std::shared_ptr<MVS::Scene> mvs_scene, int num_threads = 1);
+
+    // Must be called after the scene mesh is modified in place
+    void Invalidate();
+
+    // Generation of the scene mesh. Reallocated or resized mesh arrays are detected without
+    // Invalidate.
+    uint64_t Generation();
+    // Generation of the LOD chain, changes with SetLevels and when the levels are dropped
+    uint64_t LevelsGeneration();
+
+    // Converted data of the current generation
+    const Eigen::MatrixXd& V();
+    const Eigen::MatrixXi& F();
+    const Eigen::MatrixXd& TC();
+    const Eigen::MatrixXi& FTC();
+    bool HasTexture();
+
+    // Picking hierarchy of the current generation, built on first use. Refitted when only
+    // the vertices moved, rebuilt when the faces changed.
+    const MeshBVH& BVH();
+
+    // Coarser versions of the scene mesh (LOD chain, finest first) using the scene texture.
+    // They are dropped when the scene mesh changes.
+    void SetLevels(std::vector<std::shared_ptr<MVS::Mesh>> levels);
+    // Number of levels including the scene mesh (level 0)
+    int NumLevels();
+
+    // Sets the mesh (or a coarser level) into data if its generation (of the LOD chain for
+    // levels above 0) is older. Returns true if data was set. Callers switching to another
+    // level reset data_generation.
+    bool SetMesh(igl::opengl::ViewerData& data, uint64_t* data_generation, bool with_texture = true,
+                 int level = 0);
+
+private:
+    using Channel = Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>;
+
+    // Identity of the mesh arrays, changes when they are reallocated or resized
+    struct Fingerprint {
+        const void* vertices = nullptr;
+        const void* faces = nullptr;
+        const void* texcoords = nullptr;
+        const void* texture = nullptr;
+        size_t num_vertices = 0;
+        size_t num_faces = 0;
+        size_t num_texcoords = 0;
+        int texture_width = 0;
+        int texture_height = 0;
+
+        bool operator==(const Fingerprint& other) const;
+    };
+
+    std::shared_ptr<MVS::Scene> mvs_scene_;
+    int num_threads_;
+
+    // Both generations are taken from one counter, so a data generation of the mesh never
+    // equals one of the LOD chain
+    uint64_t last_generation_ = 1;
+    uint64_t generation_ = 1;
+    uint64_t levels_generation_ = 0;
+    uint64_t converted_generation_ = 0;
+    Fingerprint fingerprint_;
+
+    Eigen::MatrixXd V_;
+    Eigen::MatrixXi F_;
+    Eigen::MatrixXd TC_;
+    Eigen::MatrixXi FTC_;
+    Channel R_, G_, B_;
+
+    std::vector<std::shared_ptr<MVS::Mesh>> levels_;
+
+    MeshBVH bvh_;
+    uint64_t bvh_generation_ = 0;
+    // Faces changed since the hierarchy was last built
+    bool faces_changed_ = true;
+
+    Fingerprint ComputeFingerprint() const;
+    void NewGeneration();
+    void Update();
+    void ConvertGeometry(const MVS::Mesh& mesh, Eigen::MatrixXd* V, Eigen::MatrixXi* F,
+                         Eigen::MatrixXd* TC, Eigen::MatrixXi* FTC) const;
+};
+
+#endif //REALTIME_RECONSTRUCTION_MESHRESOURCE_H
@@ -1,36 +1,49 @@
 #include "Render.h"
 
+#include <limits>
+
 #include "glm/gtx/string_cast.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "stb/stb_image_write.h"
 
-void Render::Initialize(MVS::Mesh& mvs_mesh) {
-
-    // Load mesh file
-    mvs_mesh.ListIncidenteVertices();
-    mvs_mesh.ListIncidenteFaces();
-    mvs_mesh.ComputeNormalVertices();
+void Render::Initialize(const MVS::Mesh& mvs_mesh, bool compress_texture) {
 
-    // Fill vertices
+    // Fill vertices, welded and split only where faces have different texture coordinates (UV seams)
+    const unsigned int no_vertex = std::numeric_limits<unsigned int>::max();
+    const bool has_tex_coords = !mvs_mesh.faceTexcoords.IsEmpty();
+    std::vector<unsigned int> first_vertex(mvs_mesh.vertices.size(), no_vertex);
+    std::vector<unsigned int> next_vertex;
     std::vector<Vertex> vertices;
-    vertices.reserve(mvs_mesh.faces.size() * 3);
+    vertices.reserve(mvs_mesh.vertices.size());
+    next_vertex.reserve(mvs_mesh.vertices.size());
+    std::vector<unsigned int> indices(mvs_mesh.faces.size() * 3);
     for (int face_i = 0; face_i < mvs_mesh.faces.size(); face_i++) {
         const auto& mvs_face = mvs_mesh.faces[face_i];
 
         for (int vert_i = 0; vert_i < 3; vert_i++) {
-            const auto& mvs_vert = mvs_mesh.vertices[mvs_face[vert_i]];
-            const auto& mvs_normal = mvs_mesh.vertexNormals[mvs_face[vert_i]];
-            const auto& mvs_tex_coord = mvs_mesh.faceTexcoords[face_i * 3 + vert_i];
-
-            Vertex vertex;
-            vertex.Position = glm::vec3(mvs_vert.x, mvs_vert.y, mvs_vert.z);
-            vertex.Normal = glm::vec3(mvs_normal.x, mvs_normal.y, mvs_normal.z);
-            vertex.TexCoords = glm::vec2(mvs_tex_coord.x, 1.0 - mvs_tex_coord.y);
-            vertices.push_back(vertex);
+            const unsigned int mvs_vert_i = mvs_face[vert_i];
+            glm::vec2 tex_coords(0.0f, 0.0f);
+            if (has_tex_coords) {
+                const auto& mvs_tex_coord = mvs_mesh.faceTexcoords[face_i * 3 + vert_i];
+                tex_coords = glm::vec2(mvs_tex_coord.x, 1.0 - mvs_tex_coord.y);
+            }
+
+            unsigned int index = first_vertex[mvs_vert_i];
+            while (index != no_vertex && vertices[index].TexCoords != tex_coords) {
+                index = next_vertex[index];
+            }
+            if (index == no_vertex) {
+                const auto& mvs_vert = mvs_mesh.vertices[mvs_vert_i];
+                index = static_cast<unsigned int>(vertices.size());
+                vertices.push_back({glm::vec3(mvs_vert.x, mvs_vert.y, mvs_vert.z), tex_coords});
+                next_vertex.push_back(first_vertex[mvs_vert_i]);
+                first_vertex[mvs_vert_i] = index;
+            }
+            indices[face_i * 3 + vert_i] = index;
         }
     }
 
-    // Fill texture
+    // Fill texture, sampled with NEAREST so a single level is uploaded
     int width = mvs_mesh.textureDiffuse.width();
     int height = mvs_mesh.textureDiffuse.height();
 
@@ -38,16 +51,37 @@ void Render::Initialize(MVS::Mesh& mvs_mesh) {
     glGenTextures(1, &textureID);
 
     glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, mvs_mesh.textureDiffuse.data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (compress_texture) {
+        // Compressed by the driver on upload
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE,
+                     mvs_mesh.textureDiffuse.data);
+    } else {
+#ifdef GL_VERSION_4_2
+        if (GLAD_GL_VERSION_4_2) {
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB8, width, height);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE,
+                            mvs_mesh.textureDiffuse.data);
+        } else
+#endif
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE,
+                         mvs_mesh.textureDiffuse.data);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
 
-    mesh_ = std::make_unique<TexturedMesh>(vertices, textureID);
-    shader_ = std::make_unique<SourceShader>(vert_source, frag_source);
+    mesh_ = std::make_shared<TexturedMesh>(std::move(vertices), std::move(indices), textureID);
+    if (!shader_) {
+        shader_ = std::make_shared<SourceShader>(vert_source, frag_source);
+        gray_shader_ = std::make_shared<SourceShader>(vert_source, gray_frag_source);
+    }
 }
 
 
@@ -110,38 +144,62 @@ Render::RenderPosesDome(const glm::mat4& transform, int camera_density) const {
     return render_poses;
 }
 
-std::vector<unsigned char>
-Render::RenderFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic) {
+Render::Framebuffer Render::CreateFramebuffer(const CameraIntrinsic& intrinsic, bool gray) const {
 
     int image_width = intrinsic.image_width;
     int image_height = intrinsic.image_height;
-    double focal_y = intrinsic.focal_y;
 
     // Framebuffer configuration
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    Framebuffer framebuffer;
+    glGenFramebuffers(1, &framebuffer.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.framebuffer);
 
     // Color attachment
-    unsigned int framebufferTexture;
-    glGenTextures(1, &framebufferTexture);
-    glBindTexture(GL_TEXTURE_2D, framebufferTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image_width, image_height, 0,  GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glGenTextures(1, &framebuffer.color);
+    glBindTexture(GL_TEXTURE_2D, framebuffer.color);
+    if (gray) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, image_width, image_height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image_width, image_height, 0,  GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, framebufferTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, framebuffer.color, 0);
 
     // Depth and stencil attachment
-    unsigned int framebufferDepthStencil;
-    glGenRenderbuffers(1, &framebufferDepthStencil);
-    glBindRenderbuffer(GL_RENDERBUFFER, framebufferDepthStencil);
+    glGenRenderbuffers(1, &framebuffer.depth_stencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, framebuffer.depth_stencil);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, image_width, image_height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, framebufferDepthStencil);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, framebuffer.depth_stencil);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
     }
 
+    return framebuffer;
+}
+
+void Render::DeleteFramebuffer(const Framebuffer& framebuffer) const {
+    glDeleteFramebuffers(1, &framebuffer.framebuffer);
+    glDeleteTextures(1, &framebuffer.color);
+    glDeleteRenderbuffers(1, &framebuffer.depth_stencil);
+}
+
+void Render::Draw(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic) {
+    DrawMesh(*shader_, view_matrix, intrinsic, false);
+}
+
+void Render::DrawGray(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic) {
+    DrawMesh(*gray_shader_, view_matrix, intrinsic, true);
+}
+
+void Render::DrawMesh(SourceShader& shader, const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic,
+                      bool flip) {
+
+    int image_width = intrinsic.image_width;
+    int image_height = intrinsic.image_height;
+    double focal_y = intrinsic.focal_y;
+
     // Render configuration
     glViewport(0, 0, image_width, image_height);
     glEnable(GL_DEPTH_TEST);
@@ -154,7 +212,7 @@ Render::RenderFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& in
     glClearBufferfv(GL_DEPTH, 0, &depth_clear_val);
 
     // Render configuration
-    shader_->use();
+    shader.use();
 
     // Projection matrix
     double fov_y = (2 * std::atan(static_cast<double>(image_height) / (2*focal_y)));
@@ -163,31 +221,66 @@ Render::RenderFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& in
             static_cast<float>(fov_y),
             static_cast<float>(image_width) / static_cast<float>(image_height),
             0.1f, 100.0f);
-    shader_->setMat4("projection", projection);
+    if (flip) {
+        // Flipping y reverses the winding, front faces stay front faces with CW
+        projection = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f)) * projection;
+        glFrontFace(GL_CW);
+    }
+    shader.setMat4("projection", projection);
 
     // View matrix
-    shader_->setMat4("view", view_matrix);
+    shader.setMat4("view", view_matrix);
 
     // Model matrix
     glm::mat4 model = glm::mat4(1.0f);
-    shader_->setMat4("model", model);
+    shader.setMat4("model", model);
 
     // Render the mesh
-    mesh_->Draw(*shader_);
+    mesh_->Draw(shader);
+    glFrontFace(GL_CCW);
+}
+
+std::vector<unsigned char>
+Render::RenderFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic) {
 
-    // Read frambuffer texture
+    int image_width = intrinsic.image_width;
+    int image_height = intrinsic.image_height;
+
+    Framebuffer framebuffer = CreateFramebuffer(intrinsic);
+    Draw(view_matrix, intrinsic);
+
+    // Read frambuffer texture (rows are tightly packed)
     std::vector<unsigned char> render_data(image_width * image_height * 3, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
     glReadPixels(0, 0, image_width, image_height, GL_RGB, GL_UNSIGNED_BYTE, render_data.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
 
     // Cleanup
-    glDeleteFramebuffers(1, &framebuffer);
-    glDeleteTextures(1, &framebufferTexture);
-    glDeleteRenderbuffers(1, &framebufferDepthStencil);
+    DeleteFramebuffer(framebuffer);
     // glDisable(GL_CULL_FACE);
 
     return render_data;
 }
 
+std::vector<unsigned char>
+Render::RenderGrayFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic) {
+
+    int image_width = intrinsic.image_width;
+    int image_height = intrinsic.image_height;
+
+    Framebuffer framebuffer = CreateFramebuffer(intrinsic, true);
+    DrawGray(view_matrix, intrinsic);
+
+    std::vector<unsigned char> render_data(image_width * image_height, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, image_width, image_height, GL_RED, GL_UNSIGNED_BYTE, render_data.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    DeleteFramebuffer(framebuffer);
+
+    return render_data;
+}
+
 void Render::SaveRender(const std::string& filename,
         const CameraIntrinsic& intrinsic,
         const std::vector<unsigned char>& render_data) const {
@@ -16,12 +16,30 @@ public:
         double focal_y;
     };
 
-    void Initialize(MVS::Mesh& mvs_mesh);
+    struct Framebuffer {
+        unsigned int framebuffer = 0;
+        unsigned int color = 0;
+        unsigned int depth_stencil = 0;
+    };
+
+    // Uploads the mesh (welded, indexed) and its texture, compressed by the driver if compress_texture
+    void Initialize(const MVS::Mesh& mvs_mesh, bool compress_texture = false);
     std::shared_ptr<TexturedMesh> GetMesh() const;
     std::shared_ptr<SourceShader> GetShader() const;
 
     std::vector<glm::mat4> RenderPosesDome(const glm::mat4& transform, int camera_density) const;
     std::vector<unsigned char> RenderFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic);
+
+    // Grayscale render (one byte per pixel, top row first), as SIFT takes it
+    std::vector<unsigned char> RenderGrayFromCamera(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic);
+
+    // Offscreen framebuffer of the image size (stays bound), single channel if gray
+    Framebuffer CreateFramebuffer(const CameraIntrinsic& intrinsic, bool gray = false) const;
+    void DeleteFramebuffer(const Framebuffer& framebuffer) const;
+    // Draws the mesh seen from view_matrix into the bound framebuffer
+    void Draw(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic);
+    // Same as above with luminance and flipped vertically, so rows are read back top row first
+    void DrawGray(const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic);
     void SaveRender(const std::string& filename,
             const CameraIntrinsic& intrinsic,
             const std::vector<unsigned char>& render_data) const;
@@ -29,12 +47,14 @@ public:
 private:
     std::shared_ptr<TexturedMesh> mesh_;
     std::shared_ptr<SourceShader> shader_;
+    std::shared_ptr<SourceShader> gray_shader_;
+
+    void DrawMesh(SourceShader& shader, const glm::mat4& view_matrix, const CameraIntrinsic& intrinsic, bool flip);
 
     // Shaders
     const std::string vert_source =
             "#version 330 core\n"
             "layout (location = 0) in vec3 aPos;\n"
-            "layout (location = 1) in vec3 aNormal;\n"
             "layout (location = 2) in vec2 aTexCoords;\n"
             "out vec2 TexCoords;\n"
             "uniform mat4 model;\n"
@@ -56,6 +76,18 @@ private:
             "    if (gl_FrontFacing) FragColor = texture(texture_diffuse, TexCoords);\n"
             "    else FragColor = vec4(1.0, 1.0, 1.0, 1.0);\n"
             "}\n";
+
+    const std::string gray_frag_source =
+            "#version 330 core\n"
+            "out vec4 FragColor;\n"
+            "in vec2 TexCoords;\n"
+            "uniform sampler2D texture_diffuse;\n"
+            "void main()\n"
+            "{\n"
+            "    float gray = 1.0;\n"
+            "    if (gl_FrontFacing) gray = dot(texture(texture_diffuse, TexCoords).rgb, vec3(0.299, 0.587, 0.114));\n"
+            "    FragColor = vec4(gray, gray, gray, 1.0);\n"
+            "}\n";
 };
 
 #endif //RENDER_H
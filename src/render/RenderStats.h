@@ -6,6 +6,8 @@
 
 #include <glm/glm.hpp>
 
+#include "util/TrajectoryEvaluation.h"
+
 class RenderStats {
 public:
     // Utility functions
@@ -16,14 +18,22 @@ public:
     // Add new pose pair
     void AddPose(int pose_id, const glm::mat4& render_pose, const glm::mat4& estimated_pose, int best_view_pick);
 
-    // Compute transformation from render to estimated poses in world coordinates
+    // Compute transformation from render to estimated poses in world coordinates (cached)
     glm::mat4 ComputeTransformation();
 
     // Compute mean squared error
     double ComputeMSE(glm::mat4 transform);
 
-    // Write to file
-    void WriteStatsToFile(std::string filename);
+    // Absolute trajectory error and relative pose error (RMSE) after alignment, the RPE
+    // split into translation and rotation (degrees)
+    double ComputeATE();
+    double ComputeRPE();
+    double ComputeRotationRPE();
+
+    const TrajectoryEvaluation& GetEvaluation() const;
+
+    // Write per view rows to basename.csv and the summary to basename.json
+    void WriteStatsToFile(const std::string& basename);
 
 private:
     // Poses are in view coordinates
@@ -31,6 +41,9 @@ private:
     std::vector<glm::mat4> render_poses;
     std::vector<glm::mat4> estimated_poses;
     std::vector<int> best_view_picks;
+
+    // Camera centers and alignment sums
+    TrajectoryEvaluation evaluation_;
 };
 
 
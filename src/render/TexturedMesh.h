@@ -5,6 +5,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include <glad/glad.h>
@@ -17,8 +18,6 @@
 struct Vertex {
     // position
     glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
     // texCoords
     glm::vec2 TexCoords;
 };
@@ -27,13 +26,15 @@ class TexturedMesh {
 public:
     // Members
     std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
     unsigned int texture_id;
-    unsigned int VAO, VBO;
+    unsigned int VAO, VBO, EBO;
 
     // Functions
-    TexturedMesh(std::vector<Vertex> vertices, unsigned int texture_id) {
-        this->vertices = vertices;
-        this->texture_id = texture_id;
+    TexturedMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, unsigned int texture_id)
+            : vertices(std::move(vertices)),
+              indices(std::move(indices)),
+              texture_id(texture_id) {
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         SetupMesh();
@@ -42,9 +43,13 @@ public:
     ~TexturedMesh() {
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
         glDeleteTextures(1, &texture_id);
     }
 
+    TexturedMesh(const TexturedMesh&) = delete;
+    TexturedMesh& operator=(const TexturedMesh&) = delete;
+
     // render the mesh
     void Draw(const SourceShader& shader) {
         // bind texture
@@ -56,8 +61,7 @@ public:
 
         // draw mesh
         glBindVertexArray(VAO);
-        // glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -66,24 +70,35 @@ public:
 
 private:
 
+    // immutable storage where available (GL 4.4), the buffers are never modified
+    static void BufferData(GLenum target, GLsizeiptr size, const void* data) {
+#ifdef GL_VERSION_4_4
+        if (GLAD_GL_VERSION_4_4) {
+            glBufferStorage(target, size, data, 0);
+            return;
+        }
+#endif
+        glBufferData(target, size, data, GL_STATIC_DRAW);
+    }
+
     // initializes all the buffer objects/arrays
     void SetupMesh() {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
 
         glBindVertexArray(VAO);
-        // load data into vertex buffer
+        // load data into vertex and index buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data());
 
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) 0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, Normal));
         // vertex texture coords
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, TexCoords));
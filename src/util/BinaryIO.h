@@ -0,0 +1,177 @@
+#ifndef REALTIME_RECONSTRUCTION_BINARYIO_H
+#define REALTIME_RECONSTRUCTION_BINARYIO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary file helpers for snapshots and mapped data files. Values are written in host
+// byte order (little-endian on supported platforms). Arrays are prefixed by their element
+// count and aligned to 8 bytes, so they can be used directly from a mapped file.
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(const std::string& filename)
+            : stream_(filename, std::ios::binary | std::ios::trunc) {}
+
+    bool IsOpen() const {
+        return stream_.is_open();
+    }
+
+    bool Good() const {
+        return stream_.good();
+    }
+
+    template<typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        WriteBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const T* data, uint64_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        Write(count);
+        Align();
+        WriteBytes(data, sizeof(T) * count);
+        Align();
+    }
+
+    void WriteString(const std::string& text) {
+        WriteArray(text.data(), text.size());
+    }
+
+private:
+    std::ofstream stream_;
+    uint64_t position_ = 0;
+
+    void WriteBytes(const void* data, uint64_t size) {
+        stream_.write(reinterpret_cast<const char*>(data), size);
+        position_ += size;
+    }
+
+    void Align() {
+        static const char padding[8] = {0};
+        uint64_t remainder = position_ % 8;
+        if (remainder != 0) {
+            WriteBytes(padding, 8 - remainder);
+        }
+    }
+};
+
+class MappedFileReader {
+public:
+    explicit MappedFileReader(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+            size_ = static_cast<uint64_t>(file_stat.st_size);
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<const char*>(data);
+                madvise(data, size_, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFileReader() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    MappedFileReader(const MappedFileReader&) = delete;
+    MappedFileReader& operator=(const MappedFileReader&) = delete;
+
+    bool IsOpen() const {
+        return data_ != nullptr;
+    }
+
+    bool Good() const {
+        return IsOpen() && !failed_;
+    }
+
+    template<typename T>
+    bool Read(T* value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        if (!Available(sizeof(T))) {
+            return false;
+        }
+        std::memcpy(value, data_ + position_, sizeof(T));
+        position_ += sizeof(T);
+        return true;
+    }
+
+    // Returns pointer into the mapped file (valid while the reader exists)
+    template<typename T>
+    const T* ReadArray(uint64_t* count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        if (!Read(count)) {
+            return nullptr;
+        }
+        Align();
+        if (*count > size_ / sizeof(T) || !Available(sizeof(T) * (*count))) {
+            failed_ = true;
+            return nullptr;
+        }
+        const auto* data = reinterpret_cast<const T*>(data_ + position_);
+        position_ += sizeof(T) * (*count);
+        Align();
+        return data;
+    }
+
+    bool ReadString(std::string* text) {
+        uint64_t length = 0;
+        const char* data = ReadArray<char>(&length);
+        if (data == nullptr) {
+            return false;
+        }
+        text->assign(data, length);
+        return Good();
+    }
+
+private:
+    const char* data_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t position_ = 0;
+    bool failed_ = false;
+
+    bool Available(uint64_t size) {
+        if (failed_ || position_ + size > size_) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    void Align() {
+        uint64_t remainder = position_ % 8;
+        if (remainder != 0) {
+            position_ = std::min(size_, position_ + 8 - remainder);
+        }
+    }
+};
+
+// Read only stream buffer over memory (used to deserialize blobs from a mapped file)
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    MemoryStreamBuffer(const char* data, uint64_t size) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+#endif //REALTIME_RECONSTRUCTION_BINARYIO_H
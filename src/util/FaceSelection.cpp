@@ -0,0 +1,135 @@
+#include "FaceSelection.h"
+
+#include <algorithm>
+
+namespace {
+
+// Vertices per parallel block, inner loops are vectorized
+const int kVertexBlockSize = 4096;
+
+}
+
+void FaceSelection::Resize(int num_faces) {
+    size_ = std::max(0, num_faces);
+    words_.assign((size_ + 63) / 64, 0);
+}
+
+int FaceSelection::Size() const {
+    return size_;
+}
+
+bool FaceSelection::Test(int face) const {
+    return (words_[face >> 6] >> (face & 63)) & 1;
+}
+
+void FaceSelection::Set(int face) {
+    words_[face >> 6] |= uint64_t(1) << (face & 63);
+}
+
+void FaceSelection::Toggle(int face) {
+    words_[face >> 6] ^= uint64_t(1) << (face & 63);
+}
+
+void FaceSelection::Clear() {
+    std::fill(words_.begin(), words_.end(), 0);
+}
+
+void FaceSelection::Invert() {
+    for (auto& word : words_) {
+        word = ~word;
+    }
+    ClearTail();
+}
+
+bool FaceSelection::Empty() const {
+    return std::all_of(words_.begin(), words_.end(), [](uint64_t word) { return word == 0; });
+}
+
+int FaceSelection::Count() const {
+    int count = 0;
+    for (const auto& word : words_) {
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+void FaceSelection::SelectFromVertices(const Eigen::MatrixXi& F, const std::vector<uint8_t>& vertex_mask) {
+    Resize(static_cast<int>(F.rows()));
+    const int* f0 = F.col(0).data();
+    const int* f1 = F.col(1).data();
+    const int* f2 = F.col(2).data();
+    const uint8_t* mask = vertex_mask.data();
+    const int num_words = static_cast<int>(words_.size());
+
+    #pragma omp parallel for schedule(static)
+    for (int w = 0; w < num_words; w++) {
+        const int begin = w * 64;
+        const int end = std::min(begin + 64, size_);
+        uint64_t word = 0;
+        for (int i = begin; i < end; i++) {
+            uint64_t selected = mask[f0[i]] | mask[f1[i]] | mask[f2[i]];
+            word |= selected << (i - begin);
+        }
+        words_[w] = word;
+    }
+}
+
+void FaceSelection::ClearTail() {
+    if (size_ % 64 != 0) {
+        words_.back() &= (uint64_t(1) << (size_ % 64)) - 1;
+    }
+}
+
+void VerticesInsideBox(const Eigen::MatrixXd& V, const Eigen::Matrix3d& axes,
+                       const Eigen::Vector3d& lower, const Eigen::Vector3d& upper,
+                       std::vector<uint8_t>* mask) {
+    const int num_vertices = static_cast<int>(V.rows());
+    mask->resize(num_vertices);
+    const double* x = V.col(0).data();
+    const double* y = V.col(1).data();
+    const double* z = V.col(2).data();
+    uint8_t* out = mask->data();
+
+    // Plain scalars so the inner loop vectorizes
+    const double ux = axes(0, 0), uy = axes(0, 1), uz = axes(0, 2);
+    const double vx = axes(1, 0), vy = axes(1, 1), vz = axes(1, 2);
+    const double wx = axes(2, 0), wy = axes(2, 1), wz = axes(2, 2);
+    const double u_min = lower(0), u_max = upper(0);
+    const double v_min = lower(1), v_max = upper(1);
+    const double w_min = lower(2), w_max = upper(2);
+
+    #pragma omp parallel for schedule(static)
+    for (int begin = 0; begin < num_vertices; begin += kVertexBlockSize) {
+        const int end = std::min(begin + kVertexBlockSize, num_vertices);
+        #pragma omp simd
+        for (int i = begin; i < end; i++) {
+            double a = ux * x[i] + uy * y[i] + uz * z[i];
+            double b = vx * x[i] + vy * y[i] + vz * z[i];
+            double c = wx * x[i] + wy * y[i] + wz * z[i];
+            out[i] = (a > u_min) & (a < u_max) &
+                     (b > v_min) & (b < v_max) &
+                     (c > w_min) & (c < w_max);
+        }
+    }
+}
+
+void VerticesBelowPlane(const Eigen::MatrixXd& V, const Eigen::Vector3d& normal, const Eigen::Vector3d& center,
+                        std::vector<uint8_t>* mask) {
+    const int num_vertices = static_cast<int>(V.rows());
+    mask->resize(num_vertices);
+    const double* x = V.col(0).data();
+    const double* y = V.col(1).data();
+    const double* z = V.col(2).data();
+    uint8_t* out = mask->data();
+    const double nx = normal(0), ny = normal(1), nz = normal(2);
+    const double offset = normal.dot(center);
+
+    #pragma omp parallel for schedule(static)
+    for (int begin = 0; begin < num_vertices; begin += kVertexBlockSize) {
+        const int end = std::min(begin + kVertexBlockSize, num_vertices);
+        #pragma omp simd
+        for (int i = begin; i < end; i++) {
+            out[i] = (nx * x[i] + ny * y[i] + nz * z[i]) < offset;
+        }
+    }
+}
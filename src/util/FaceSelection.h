@@ -0,0 +1,60 @@
+#ifndef REALTIME_RECONSTRUCTION_FACESELECTION_H
+#define REALTIME_RECONSTRUCTION_FACESELECTION_H
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+// Dense bitset over mesh faces (one bit per face, 64 faces per word). Faces are classified
+// one word at a time, so the parallel loops never write to the same word.
+class FaceSelection {
+public:
+    // Clears the selection
+    void Resize(int num_faces);
+    int Size() const;
+
+    bool Test(int face) const;
+    void Set(int face);
+    void Toggle(int face);
+
+    void Clear();
+    void Invert();
+    bool Empty() const;
+    int Count() const;
+
+    // Calls function(face) for every selected face in ascending order
+    template<typename Function>
+    void ForEach(Function function) const {
+        for (int w = 0; w < static_cast<int>(words_.size()); w++) {
+            uint64_t word = words_[w];
+            while (word != 0) {
+                function(w * 64 + __builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // Replaces the selection with faces that have at least one vertex in vertex_mask
+    void SelectFromVertices(const Eigen::MatrixXi& F, const std::vector<uint8_t>& vertex_mask);
+
+private:
+    std::vector<uint64_t> words_;
+    int size_ = 0;
+
+    void ClearTail();
+};
+
+// Vertex tests over the columns of V (column major, so x, y and z are contiguous arrays).
+// Mask entries are 1 for vertices that pass the test, 0 otherwise.
+
+// Strictly inside the oriented box lower(k) < axes.row(k) * x < upper(k)
+void VerticesInsideBox(const Eigen::MatrixXd& V, const Eigen::Matrix3d& axes,
+                       const Eigen::Vector3d& lower, const Eigen::Vector3d& upper,
+                       std::vector<uint8_t>* mask);
+
+// Below the plane, normal * (x - center) < 0
+void VerticesBelowPlane(const Eigen::MatrixXd& V, const Eigen::Vector3d& normal, const Eigen::Vector3d& center,
+                        std::vector<uint8_t>* mask);
+
+#endif //REALTIME_RECONSTRUCTION_FACESELECTION_H
@@ -4,9 +4,14 @@
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "util/BinaryIO.h"
+
 template <typename T>
 bool writeBufferToFile(const std::string& filename, int width, int height, const std::vector<T>& data) {
     assert((width * height) == data.size());
@@ -44,4 +49,129 @@ bool writeVectorToFile(const std::string& filename, const std::vector<T>& data)
     return true;
 }
 
+// 64-bit FNV-1a over 8 byte words, identifies the data a binary array was computed for
+// (e.g. the faces of a mesh)
+inline uint64_t hashBytes(const void* data, size_t size) {
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = 14695981039346656037ULL;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+    return hash;
+}
+
+// Binary array file: header, then the values as an aligned BinaryWriter array, so a
+// mapped file is used in place
+enum class ArrayType : uint32_t {
+    FLOAT32 = 1,
+    FLOAT64 = 2,
+    INT32 = 3,
+    UINT32 = 4
+};
+
+template <typename T> struct ArrayTypeOf;
+template <> struct ArrayTypeOf<float> { static constexpr ArrayType value = ArrayType::FLOAT32; };
+template <> struct ArrayTypeOf<double> { static constexpr ArrayType value = ArrayType::FLOAT64; };
+template <> struct ArrayTypeOf<int32_t> { static constexpr ArrayType value = ArrayType::INT32; };
+template <> struct ArrayTypeOf<uint32_t> { static constexpr ArrayType value = ArrayType::UINT32; };
+
+struct ArrayFileHeader {
+    static constexpr uint32_t MAGIC = 0x31525241; // "ARR1"
+
+    uint32_t magic = MAGIC;
+    ArrayType type = ArrayType::FLOAT64;
+    uint64_t count = 0;
+    // Hash of the data the values belong to, 0 if unknown
+    uint64_t hash = 0;
+};
+
+template <typename T>
+bool writeVectorToBinaryFile(const std::string& filename, const std::vector<T>& data, uint64_t hash = 0) {
+    BinaryWriter writer(filename);
+    if (!writer.IsOpen()) {
+        std::cerr << "Could not open file: " << filename << std::endl;
+        return false;
+    }
+
+    ArrayFileHeader header;
+    header.type = ArrayTypeOf<T>::value;
+    header.count = data.size();
+    header.hash = hash;
+    writer.Write(header);
+    writer.WriteArray(data.data(), data.size());
+    return writer.Good();
+}
+
+// Binary array file mapped to memory, values are read in place
+class MappedArrayFile {
+public:
+    explicit MappedArrayFile(const std::string& filename)
+            : reader_(new MappedFileReader(filename)) {
+        if (!reader_->Read(&header_) || header_.magic != ArrayFileHeader::MAGIC) {
+            return;
+        }
+        uint64_t count = 0;
+        switch (header_.type) {
+            case ArrayType::FLOAT32: data_ = reader_->ReadArray<float>(&count); break;
+            case ArrayType::FLOAT64: data_ = reader_->ReadArray<double>(&count); break;
+            case ArrayType::INT32: data_ = reader_->ReadArray<int32_t>(&count); break;
+            case ArrayType::UINT32: data_ = reader_->ReadArray<uint32_t>(&count); break;
+        }
+        if (data_ == nullptr || count != header_.count) {
+            data_ = nullptr;
+        }
+    }
+
+    // False if the file is missing, not a binary array (e.g. text) or truncated
+    bool IsValid() const {
+        return data_ != nullptr;
+    }
+
+    ArrayType Type() const {
+        return header_.type;
+    }
+
+    uint64_t Size() const {
+        return header_.count;
+    }
+
+    uint64_t Hash() const {
+        return header_.hash;
+    }
+
+    // Values in the mapping (valid while this exists), nullptr if the type differs
+    template <typename T>
+    const T* Data() const {
+        return IsValid() && header_.type == ArrayTypeOf<T>::value ? static_cast<const T*>(data_) : nullptr;
+    }
+
+    // Copy of the values as double
+    std::vector<double> ToDoubles() const {
+        switch (header_.type) {
+            case ArrayType::FLOAT32: return ToDoubles(Data<float>());
+            case ArrayType::FLOAT64: return ToDoubles(Data<double>());
+            case ArrayType::INT32: return ToDoubles(Data<int32_t>());
+            case ArrayType::UINT32: return ToDoubles(Data<uint32_t>());
+        }
+        return std::vector<double>();
+    }
+
+private:
+    std::unique_ptr<MappedFileReader> reader_;
+    ArrayFileHeader header_;
+    const void* data_ = nullptr;
+
+    template <typename T>
+    std::vector<double> ToDoubles(const T* data) const {
+        return data ? std::vector<double>(data, data + header_.count) : std::vector<double>();
+    }
+};
+
 #endif //SANDBOX_NBV_HELPERS_H
@@ -0,0 +1,297 @@
+#include "IPCameraCapture.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <stb/stb_image.h>
+
+#include "util/ImageDownsample.h"
+
+IPCameraCapture::IPCameraCapture(const Options& options)
+        : options_(options),
+          encoded_frames_(static_cast<size_t>(std::max(1, options.buffer_size))),
+          decoded_frames_(static_cast<size_t>(std::max(1, options.buffer_size))),
+          stream_parser_([this](std::vector<uint8_t>& jpeg) {
+              fetch_frame_.encoded.swap(jpeg);
+              PushEncoded();
+          }) {
+
+    curl_ = curl_easy_init();
+    curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+
+    // Abort transfers when stopping or when the stream is reopened
+    curl_easy_setopt(curl_, CURLOPT_XFERINFODATA, this);
+    curl_easy_setopt(curl_, CURLOPT_XFERINFOFUNCTION, &IPCameraCapture::ProgressCallback);
+    curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 0L);
+
+    fetch_thread_ = std::thread(&IPCameraCapture::RunFetch, this);
+    decode_thread_ = std::thread(&IPCameraCapture::RunDecode, this);
+}
+
+IPCameraCapture::~IPCameraCapture() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(decode_mutex_);
+    }
+    condition_.notify_one();
+    decode_condition_.notify_one();
+    fetch_thread_.join();
+    decode_thread_.join();
+    curl_easy_cleanup(curl_);
+}
+
+void IPCameraCapture::SetUrl(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (url_ != url) {
+        url_ = url;
+        restart_stream_ = true;
+    }
+}
+
+void IPCameraCapture::SetContinuous(bool continuous) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        continuous_ = continuous;
+    }
+    condition_.notify_one();
+}
+
+bool IPCameraCapture::IsContinuous() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return continuous_;
+}
+
+void IPCameraCapture::SetStreaming(bool streaming) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        streaming_ = streaming;
+        restart_stream_ = true;
+    }
+    condition_.notify_one();
+}
+
+bool IPCameraCapture::IsStreaming() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return streaming_;
+}
+
+void IPCameraCapture::RequestFrame() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requested_ = true;
+    }
+    condition_.notify_one();
+}
+
+bool IPCameraCapture::GetLatestFrame(Frame* frame) {
+    size_t skipped = 0;
+    bool success = decoded_frames_.PopLatest(*frame, &skipped);
+    num_dropped_ += skipped;
+    return success;
+}
+
+int64_t IPCameraCapture::NumFetched() const {
+    return num_fetched_;
+}
+
+int64_t IPCameraCapture::NumDropped() const {
+    return num_dropped_;
+}
+
+int64_t IPCameraCapture::NumFailed() const {
+    return num_failed_;
+}
+
+double IPCameraCapture::LastFetchTime() const {
+    return last_fetch_time_;
+}
+
+void IPCameraCapture::RunFetch() {
+    while (true) {
+        std::string url;
+        bool streaming;
+        {
+            // Wait for request, continuous mode or streaming
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stop_ || continuous_ || requested_ || streaming_; });
+            if (stop_) {
+                break;
+            }
+            requested_ = false;
+            restart_stream_ = false;
+            url = url_;
+            streaming = streaming_;
+        }
+
+        bool success = streaming ? FetchStream(url) : FetchFrame(url);
+        if (!success && !restart_stream_) {
+            num_failed_++;
+
+            // Do not retry immediately
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait_for(lock, std::chrono::milliseconds(500), [this]() { return stop_.load(); });
+        }
+    }
+}
+
+bool IPCameraCapture::FetchFrame(const std::string& url) {
+
+    // Download image
+    auto time_begin = std::chrono::steady_clock::now();
+    fetch_frame_.encoded.clear();
+    curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &fetch_frame_.encoded);
+    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &IPCameraCapture::WriteCallback);
+    curl_easy_setopt(curl_, CURLOPT_TIMEOUT, options_.timeout);
+    CURLcode res = curl_easy_perform(curl_);
+    if (res != CURLE_OK) {
+        if (!stop_) {
+            std::cerr << "IP Camera: Failed to download: " << url << " (" << curl_easy_strerror(res) << ")" << std::endl;
+        }
+        return false;
+    }
+    std::chrono::duration<double> time_elapsed = std::chrono::steady_clock::now() - time_begin;
+    last_fetch_time_ = time_elapsed.count();
+
+    PushEncoded();
+    return true;
+}
+
+bool IPCameraCapture::FetchStream(const std::string& url) {
+
+    // One connection for all frames, runs until stopped or reopened
+    stream_parser_.Reset();
+    last_frame_time_ = std::chrono::steady_clock::now();
+    in_stream_ = true;
+    curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl_, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &IPCameraCapture::StreamCallback);
+    curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 0L);
+    CURLcode res = curl_easy_perform(curl_);
+    in_stream_ = false;
+
+    if (stop_ || restart_stream_) {
+        return true;
+    }
+
+    // Stream ended or failed on its own
+    std::cerr << "IP Camera: Stream interrupted: " << url << " (" << curl_easy_strerror(res) << ")" << std::endl;
+    return false;
+}
+
+void IPCameraCapture::PushEncoded() {
+    auto now = std::chrono::steady_clock::now();
+    if (in_stream_) {
+        std::chrono::duration<double> interval = now - last_frame_time_;
+        last_fetch_time_ = interval.count();
+        last_frame_time_ = now;
+    }
+    fetch_frame_.index = num_fetched_++;
+    fetch_frame_.timestamp = now;
+
+    // Hand over to decode thread (slot buffers are swapped into fetch_frame_ for reuse),
+    // the lock orders the push before a concurrent wait of the decode thread
+    if (!encoded_frames_.Push(fetch_frame_)) {
+        num_dropped_++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(decode_mutex_);
+    }
+    decode_condition_.notify_one();
+}
+
+void IPCameraCapture::RunDecode() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(decode_mutex_);
+            decode_condition_.wait(lock, [this]() {
+                return stop_ || !encoded_frames_.Empty();
+            });
+            if (stop_) {
+                return;
+            }
+        }
+
+        // Frames that arrived while decoding are skipped
+        size_t skipped = 0;
+        if (!encoded_frames_.PopLatest(decode_frame_, &skipped)) {
+            continue;
+        }
+        num_dropped_ += skipped;
+
+        if (!Decode(&decode_frame_)) {
+            num_failed_++;
+            continue;
+        }
+        if (!decoded_frames_.Push(decode_frame_)) {
+            num_dropped_++;
+        }
+    }
+}
+
+bool IPCameraCapture::Decode(Frame* frame) {
+    int width, height, channels;
+    unsigned char* data = stbi_load_from_memory(frame->encoded.data(), static_cast<int>(frame->encoded.size()),
+                                                &width, &height, &channels, 3);
+    if (data == nullptr) {
+        std::cerr << "IP Camera: Failed to decode frame " << frame->index << std::endl;
+        return false;
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->channels = 3;
+    frame->pixels.assign(data, data + width * height * 3);
+    stbi_image_free(data);
+
+    if (options_.decode_gray) {
+        ComputeGray(frame);
+    }
+    return true;
+}
+
+void IPCameraCapture::ComputeGray(Frame* frame) {
+    const int width = frame->width;
+    const int height = frame->height;
+    const uint8_t* rgb = frame->pixels.data();
+
+    // Luminance with the weights stb uses for one channel requests
+    int factor = DownsampleFactor(width, height, options_.max_gray_size);
+    frame->gray_scale = static_cast<float>(factor);
+    std::vector<uint8_t>& gray = (factor == 1) ? frame->gray : gray_full_;
+    gray.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < gray.size(); i++) {
+        gray[i] = static_cast<uint8_t>((rgb[3 * i] * 77 + rgb[3 * i + 1] * 150 + rgb[3 * i + 2] * 29) >> 8);
+    }
+
+    // Box filter downsampling by integer factor
+    if (factor == 1) {
+        frame->gray_width = width;
+        frame->gray_height = height;
+    } else {
+        BoxDownsample(gray_full_.data(), width, height, 1, width, factor,
+                      &frame->gray_width, &frame->gray_height, &frame->gray);
+    }
+}
+
+size_t IPCameraCapture::WriteCallback(char *data, size_t size, size_t nmemb, void *userdata) {
+    auto stream = (std::vector<uint8_t>*) userdata;
+    size_t length = size * nmemb;
+    stream->insert(stream->end(), data, data + length);
+    return length;
+}
+
+size_t IPCameraCapture::StreamCallback(char *data, size_t size, size_t nmemb, void *userdata) {
+    auto capture = (IPCameraCapture*) userdata;
+    size_t length = size * nmemb;
+    capture->stream_parser_.Parse(reinterpret_cast<const uint8_t*>(data), length);
+    return length;
+}
+
+int IPCameraCapture::ProgressCallback(void *userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    auto capture = (IPCameraCapture*) userdata;
+    bool abort = capture->stop_ || (capture->in_stream_ && capture->restart_stream_);
+    return abort ? 1 : 0;
+}
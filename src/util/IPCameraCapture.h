@@ -0,0 +1,146 @@
+#ifndef REALTIME_RECONSTRUCTION_IPCAMERACAPTURE_H
+#define REALTIME_RECONSTRUCTION_IPCAMERACAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "util/RingBuffer.h"
+#include "util/MJPEGStreamParser.h"
+
+// Fetches JPEG frames from an IP camera on a dedicated thread, either as single
+// images (HTTP GET per frame) or from a continuous MJPEG stream over one persistent
+// connection. Encoded frames are decoded on a worker thread and handed over through
+// single-producer/single-consumer rings. When a consumer falls behind and a ring
+// is full, the oldest frame is overwritten, consumers skip to the newest frame with GetLatestFrame.
+class IPCameraCapture {
+public:
+    struct Options {
+        // Number of frames buffered between threads
+        int buffer_size = 4;
+
+        // Request timeout in seconds (single images only)
+        long timeout = 10;
+
+        // Compute grayscale image for feature extraction from the decoded RGB image (each
+        // frame is decoded once) and downsample it by integer factor so that it is
+        // not larger than max_gray_size (0 keeps full resolution).
+        bool decode_gray = true;
+        int max_gray_size = 0;
+    };
+
+    struct Frame {
+        // Increasing index of received frames and time when frame was received
+        int64_t index = -1;
+        std::chrono::steady_clock::time_point timestamp;
+
+        // Encoded image as received from the camera
+        std::vector<uint8_t> encoded;
+
+        // Decoded RGB8 image
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        std::vector<uint8_t> pixels;
+
+        // Decoded grayscale image, gray_scale converts its coordinates to full resolution
+        int gray_width = 0;
+        int gray_height = 0;
+        float gray_scale = 1.0f;
+        std::vector<uint8_t> gray;
+    };
+
+    explicit IPCameraCapture(const Options& options);
+    ~IPCameraCapture();
+
+    IPCameraCapture(const IPCameraCapture&) = delete;
+    IPCameraCapture& operator=(const IPCameraCapture&) = delete;
+
+    // Url of single image or of MJPEG stream (reconnects if streaming)
+    void SetUrl(const std::string& url);
+
+    // Fetch single images continuously or only on request
+    void SetContinuous(bool continuous);
+    bool IsContinuous() const;
+
+    // Receive frames from MJPEG stream (url must point to the stream)
+    void SetStreaming(bool streaming);
+    bool IsStreaming() const;
+
+    // Fetch one single image (ignored while a requested frame is pending)
+    void RequestFrame();
+
+    // Consumer: newest decoded frame, older frames in the ring are dropped.
+    // Returns false if no new frame is available.
+    bool GetLatestFrame(Frame* frame);
+
+    // Counters
+    int64_t NumFetched() const;
+    int64_t NumDropped() const;
+    int64_t NumFailed() const;
+
+    // Time to receive the last frame in seconds (request duration or interval between stream frames)
+    double LastFetchTime() const;
+
+private:
+    Options options_;
+
+    // Encoded frames (fetch thread -> decode thread) and decoded frames (decode thread -> consumer)
+    RingBuffer<Frame> encoded_frames_;
+    RingBuffer<Frame> decoded_frames_;
+
+    // Fetch thread
+    std::thread fetch_thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::string url_;
+    bool continuous_ = false;
+    bool streaming_ = false;
+    bool requested_ = false;
+    std::atomic<bool> stop_{false};
+
+    // Set when a running stream has to be reopened (url or mode changed)
+    std::atomic<bool> restart_stream_{false};
+
+    // Decode thread
+    std::thread decode_thread_;
+    std::mutex decode_mutex_;
+    std::condition_variable decode_condition_;
+
+    // Owned by fetch thread
+    CURL* curl_;
+    Frame fetch_frame_;
+    MJPEGStreamParser stream_parser_;
+    std::chrono::steady_clock::time_point last_frame_time_;
+    bool in_stream_ = false;
+
+    // Owned by decode thread
+    Frame decode_frame_;
+    std::vector<uint8_t> gray_full_;
+
+    std::atomic<int64_t> num_fetched_{0};
+    std::atomic<int64_t> num_dropped_{0};
+    std::atomic<int64_t> num_failed_{0};
+    std::atomic<double> last_fetch_time_{0.0};
+
+    void RunFetch();
+    void RunDecode();
+    bool FetchFrame(const std::string& url);
+    bool FetchStream(const std::string& url);
+    void PushEncoded();
+    bool Decode(Frame* frame);
+    void ComputeGray(Frame* frame);
+
+    static size_t WriteCallback(char *data, size_t size, size_t nmemb, void *userdata);
+    static size_t StreamCallback(char *data, size_t size, size_t nmemb, void *userdata);
+    static int ProgressCallback(void *userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
+};
+
+#endif //REALTIME_RECONSTRUCTION_IPCAMERACAPTURE_H
@@ -1,12 +1,12 @@
 #include "IPCameraStats.h"
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_access.hpp>
-#include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/vector_angle.hpp>
 #include <imguizmo/ImGuizmo.h>
 
@@ -53,6 +53,7 @@ void IPCameraStats::AddPose(int pose_id, const glm::vec3& camera_pos, const glm:
     glm::vec3 diff = camera_pos - nbv_pos;
     double pos_error = glm::length(diff);
     pos_errors.push_back(pos_error);
+    pos_error_sum_ += pos_error;
 
     // Compute rotation error
     glm::vec3 scale = glm::vec3(1.0, 1.0, 1.0);
@@ -75,32 +76,19 @@ void IPCameraStats::AddPose(int pose_id, const glm::vec3& camera_pos, const glm:
     glm::vec3 nbv_front = -glm::column(nbv_world, 2);
     double rot_error = glm::angle(camera_front, nbv_front);
     rot_errors.push_back(rot_error);
+    rot_error_sum_ += rot_error;
 }
 
 double IPCameraStats::ComputeMeanError() {
-    auto num_poses = this->Size();
-    double error_sum = 0.0;
-    for (int i = 0; i < num_poses; i++) {
-        glm::vec3 diff = camera_positions[i] - nbv_positions[i];
-        error_sum += glm::length(diff);
-    }
-    return error_sum / num_poses;
+    return ComputeMeanPosError();
 }
 
 double IPCameraStats::ComputeMeanPosError() {
-    double error_sum = 0.0;
-    for (const auto& tmp : pos_errors) {
-        error_sum += tmp;
-    }
-    return (error_sum / pos_errors.size());
+    return (pos_error_sum_ / pos_errors.size());
 }
 
 double IPCameraStats::ComputeMeanRotError() {
-    double error_sum = 0.0;
-    for (const auto& tmp : rot_errors) {
-        error_sum += tmp;
-    }
-    return (error_sum / rot_errors.size());
+    return (rot_error_sum_ / rot_errors.size());
 }
 
 double IPCameraStats::ComputeMeanCameraDistance() {
@@ -132,32 +120,37 @@ double IPCameraStats::ComputeMaxCameraDistance() {
     return max_distance;
 }
 
-void IPCameraStats::WriteStatsToFile(std::string filename) {
+void IPCameraStats::WriteStatsToFile(const std::string& basename) {
+    std::string filename = basename + ".csv";
     std::ofstream outfile(filename);
-
     if (!outfile) {
         std::cout << "IPCamera stats: cannot open file " << filename << " for writing." << std::endl;
         return;
     }
 
     auto num_poses = this->Size();
+    outfile << std::setprecision(9);
+    outfile << "view_id,best_view_pick,camera_x,camera_y,camera_z,camera_rot_x,camera_rot_y,camera_rot_z,"
+               "nbv_x,nbv_y,nbv_z,nbv_rot_x,nbv_rot_y,nbv_rot_z,pos_error,rot_error\n";
     for (int i = 0; i < num_poses; i++) {
-        outfile << "View id: " << pose_ids[i] << "\n";
-        outfile << "Camera pos: " << glm::to_string(camera_positions[i]) << "\n";
-        outfile << "Camera rot: " << glm::to_string(camera_rotations[i]) << "\n";
-        outfile << "NBV pos: " << glm::to_string(nbv_positions[i]) << "\n";
-        outfile << "NBV rot: " << glm::to_string(nbv_rotations[i]) << "\n";
-        outfile << "Best view pick: " << best_view_picks[i] << "\n";
-        outfile << "Pos error: " << pos_errors[i] << "\n";
-        outfile << "Rot error: " << rot_errors[i] << "\n\n";
+        outfile << pose_ids[i] << "," << best_view_picks[i] << ","
+                << camera_positions[i].x << "," << camera_positions[i].y << "," << camera_positions[i].z << ","
+                << camera_rotations[i].x << "," << camera_rotations[i].y << "," << camera_rotations[i].z << ","
+                << nbv_positions[i].x << "," << nbv_positions[i].y << "," << nbv_positions[i].z << ","
+                << nbv_rotations[i].x << "," << nbv_rotations[i].y << "," << nbv_rotations[i].z << ","
+                << pos_errors[i] << "," << rot_errors[i] << "\n";
     }
 
-    double mean_pos_error = ComputeMeanPosError();
-    outfile << "Mean position error: " << mean_pos_error << "\n";
-
-    double mean_rot_error = ComputeMeanRotError();
-    outfile << "Mean rotation error: " << mean_rot_error << "\n";
-
-    // double max_camera_distance = ComputeMaxCameraDistance();
-    // outfile << "Max camera distance: " << max_camera_distance << "\n";
+    filename = basename + ".json";
+    std::ofstream summary(filename);
+    if (!summary) {
+        std::cout << "IPCamera stats: cannot open file " << filename << " for writing." << std::endl;
+        return;
+    }
+    summary << std::setprecision(9);
+    summary << "{\n";
+    summary << "  \"num_views\": " << num_poses << ",\n";
+    summary << "  \"mean_pos_error\": " << (num_poses > 0 ? ComputeMeanPosError() : 0.0) << ",\n";
+    summary << "  \"mean_rot_error\": " << (num_poses > 0 ? ComputeMeanRotError() : 0.0) << "\n";
+    summary << "}\n";
 }
@@ -36,8 +36,8 @@ public:
     // Compute max camera distance
     double ComputeMaxCameraDistance();
 
-    // Write to file
-    void WriteStatsToFile(std::string filename);
+    // Write per view rows to basename.csv and the summary to basename.json
+    void WriteStatsToFile(const std::string& basename);
 
 private:
     // Poses are in view coordinates
@@ -51,6 +51,10 @@ private:
     std::vector<int> best_view_picks;
     std::vector<double> pos_errors;
     std::vector<double> rot_errors;
+
+    // Running sums of the errors
+    double pos_error_sum_ = 0.0;
+    double rot_error_sum_ = 0.0;
 };
 
 #endif //REALTIME_RECONSTRUCTION_IPCAMERASTATS_H
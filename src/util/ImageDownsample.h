@@ -0,0 +1,40 @@
+#ifndef REALTIME_RECONSTRUCTION_IMAGEDOWNSAMPLE_H
+#define REALTIME_RECONSTRUCTION_IMAGEDOWNSAMPLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Integer factor that makes the larger image side at most max_size (0 keeps full resolution)
+inline int DownsampleFactor(int width, int height, int max_size) {
+    if (max_size <= 0) {
+        return 1;
+    }
+    return std::max(1, (std::max(width, height) + max_size - 1) / max_size);
+}
+
+// Box filter downsampling of one 8-bit channel by integer factor. Pixels of the source
+// are pixel_step bytes apart and rows are stride bytes apart, so the luminance of packed
+// formats (e.g. YUYV with pixel_step 2) is downsampled without extracting it first.
+inline void BoxDownsample(const uint8_t* src, int width, int height, int pixel_step, int stride,
+                          int factor, int* dst_width, int* dst_height, std::vector<uint8_t>* dst) {
+    *dst_width = width / factor;
+    *dst_height = height / factor;
+    dst->resize(static_cast<size_t>(*dst_width) * *dst_height);
+
+    const int area = factor * factor;
+    for (int y = 0; y < *dst_height; y++) {
+        for (int x = 0; x < *dst_width; x++) {
+            int sum = 0;
+            for (int dy = 0; dy < factor; dy++) {
+                const uint8_t* row = src + (y * factor + dy) * stride + x * factor * pixel_step;
+                for (int dx = 0; dx < factor; dx++) {
+                    sum += row[dx * pixel_step];
+                }
+            }
+            (*dst)[y * *dst_width + x] = static_cast<uint8_t>((sum + area / 2) / area);
+        }
+    }
+}
+
+#endif //REALTIME_RECONSTRUCTION_IMAGEDOWNSAMPLE_H
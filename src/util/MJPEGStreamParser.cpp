@@ -0,0 +1,168 @@
+#include "MJPEGStreamParser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+// Longest accepted header line (protects against streams without line breaks)
+const size_t kMaxHeaderLineLength = 4096;
+
+bool StartsWithNoCase(const std::string& text, const std::string& prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != std::tolower(static_cast<unsigned char>(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+MJPEGStreamParser::MJPEGStreamParser(FrameCallback callback)
+        : callback_(std::move(callback)) {}
+
+void MJPEGStreamParser::Parse(const uint8_t* data, size_t size) {
+    size_t position = 0;
+    while (position < size) {
+        switch (state_) {
+            case State::kHeaders:
+                position += ParseHeaders(data + position, size - position);
+                break;
+            case State::kBody:
+                position += ParseBody(data + position, size - position);
+                break;
+            case State::kScan:
+                position += ScanBody(data + position, size - position);
+                break;
+        }
+    }
+}
+
+void MJPEGStreamParser::Reset() {
+    state_ = State::kHeaders;
+    header_line_.clear();
+    has_headers_ = false;
+    content_length_ = 0;
+    image_.clear();
+    remaining_ = 0;
+    marker_depth_ = 0;
+    previous_ff_ = false;
+}
+
+size_t MJPEGStreamParser::ParseHeaders(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != '\n') {
+            header_line_.push_back(static_cast<char>(data[i]));
+            if (header_line_.size() > kMaxHeaderLineLength) {
+                Reset();
+            }
+            continue;
+        }
+
+        // Complete line
+        if (!header_line_.empty() && header_line_.back() == '\r') {
+            header_line_.pop_back();
+        }
+        if (!header_line_.empty()) {
+            ParseHeaderLine();
+            header_line_.clear();
+            continue;
+        }
+
+        // Empty line ends the headers of a part (empty lines before a boundary are skipped)
+        if (has_headers_) {
+            image_.clear();
+            if (content_length_ > 0) {
+                remaining_ = content_length_;
+                image_.reserve(content_length_);
+                state_ = State::kBody;
+            } else {
+                marker_depth_ = 0;
+                previous_ff_ = false;
+                state_ = State::kScan;
+            }
+            has_headers_ = false;
+            content_length_ = 0;
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+void MJPEGStreamParser::ParseHeaderLine() {
+    // Boundary line starts a new part
+    if (header_line_.compare(0, 2, "--") == 0) {
+        has_headers_ = false;
+        content_length_ = 0;
+        return;
+    }
+
+    has_headers_ = true;
+    const std::string content_length = "Content-Length:";
+    if (StartsWithNoCase(header_line_, content_length)) {
+        try {
+            content_length_ = std::stoul(header_line_.substr(content_length.size()));
+        } catch (const std::exception&) {
+            content_length_ = 0;
+        }
+    }
+}
+
+size_t MJPEGStreamParser::ParseBody(const uint8_t* data, size_t size) {
+    size_t length = std::min(size, remaining_);
+    image_.insert(image_.end(), data, data + length);
+    remaining_ -= length;
+    if (remaining_ == 0) {
+        EmitImage();
+        state_ = State::kHeaders;
+    }
+    return length;
+}
+
+size_t MJPEGStreamParser::ScanBody(const uint8_t* data, size_t size) {
+    // Start and end of image markers (FFD8, FFD9) are never present in entropy coded
+    // data, nested markers come from embedded thumbnails.
+    size_t begin = (marker_depth_ > 0) ? 0 : size;
+    for (size_t i = 0; i < size; i++) {
+        bool is_ff = (data[i] == 0xFF);
+        if (previous_ff_ && data[i] == 0xD8) {
+            if (marker_depth_ == 0) {
+                // Marker started in previous chunk
+                image_.clear();
+                if (i == 0) {
+                    image_.push_back(0xFF);
+                    begin = 0;
+                } else {
+                    begin = i - 1;
+                }
+            }
+            marker_depth_++;
+        } else if (previous_ff_ && data[i] == 0xD9 && marker_depth_ > 0) {
+            marker_depth_--;
+            if (marker_depth_ == 0) {
+                image_.insert(image_.end(), data + begin, data + i + 1);
+                previous_ff_ = false;
+                EmitImage();
+                state_ = State::kHeaders;
+                return i + 1;
+            }
+        }
+        previous_ff_ = is_ff;
+    }
+    if (marker_depth_ > 0) {
+        image_.insert(image_.end(), data + begin, data + size);
+    }
+    return size;
+}
+
+void MJPEGStreamParser::EmitImage() {
+    if (!image_.empty()) {
+        callback_(image_);
+    }
+    image_.clear();
+}
@@ -0,0 +1,54 @@
+#ifndef REALTIME_RECONSTRUCTION_MJPEGSTREAMPARSER_H
+#define REALTIME_RECONSTRUCTION_MJPEGSTREAMPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Incremental parser for multipart/x-mixed-replace MJPEG streams. Chunks are
+// parsed as they arrive from the network, image bytes are copied straight from
+// the chunk into the image buffer. The end of an image is found from the part's
+// Content-Length, or by scanning JPEG start/end markers when the length is missing.
+class MJPEGStreamParser {
+public:
+    // Called with each complete JPEG (the buffer may be swapped out by the callback)
+    using FrameCallback = std::function<void(std::vector<uint8_t>& jpeg)>;
+
+    explicit MJPEGStreamParser(FrameCallback callback);
+
+    void Parse(const uint8_t* data, size_t size);
+
+    // Discard partially parsed data
+    void Reset();
+
+private:
+    enum class State {
+        kHeaders,
+        kBody,
+        kScan
+    };
+
+    FrameCallback callback_;
+    State state_ = State::kHeaders;
+
+    // Part headers
+    std::string header_line_;
+    bool has_headers_ = false;
+    size_t content_length_ = 0;
+
+    // Image of the current part
+    std::vector<uint8_t> image_;
+    size_t remaining_ = 0;
+    int marker_depth_ = 0;
+    bool previous_ff_ = false;
+
+    size_t ParseHeaders(const uint8_t* data, size_t size);
+    size_t ParseBody(const uint8_t* data, size_t size);
+    size_t ScanBody(const uint8_t* data, size_t size);
+    void ParseHeaderLine();
+    void EmitImage();
+};
+
+#endif //REALTIME_RECONSTRUCTION_MJPEGSTREAMPARSER_H
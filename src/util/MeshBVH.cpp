@@ -0,0 +1,376 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include <Eigen/Dense>
+
+void MeshBVH::Build(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F) {
+    const int num_faces = static_cast<int>(F.rows());
+    ComputeFaceData(V, F);
+
+    nodes_.clear();
+    order_.resize(num_faces);
+    if (num_faces > 0) {
+        std::vector<BuildItem> items(num_faces);
+        for (int i = 0; i < num_faces; i++) {
+            items[i].centroid = centroids_[i];
+            items[i].face = i;
+        }
+        nodes_.reserve(2 * (num_faces / kLeafSize + 1));
+        BuildNode(&items, 0, num_faces);
+        for (int i = 0; i < num_faces; i++) {
+            order_[i] = items[i].face;
+        }
+    }
+    Refit(V, F);
+    BuildAdjacency(F);
+}
+
+void MeshBVH::Refit(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F) {
+    ComputeFaceData(V, F);
+
+    // Triangles in leaf order
+    const int num_faces = static_cast<int>(order_.size());
+    v0_.resize(num_faces);
+    e1_.resize(num_faces);
+    e2_.resize(num_faces);
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < num_faces; k++) {
+        Eigen::Vector3i face = F.row(order_[k]);
+        Eigen::Vector3f a = V.row(face(0)).transpose().cast<float>();
+        Eigen::Vector3f b = V.row(face(1)).transpose().cast<float>();
+        Eigen::Vector3f c = V.row(face(2)).transpose().cast<float>();
+        v0_[k] = a;
+        e1_[k] = b - a;
+        e2_[k] = c - a;
+    }
+
+    // Children are stored after their parent, so boxes are computed bottom up
+    for (int i = static_cast<int>(nodes_.size()) - 1; i >= 0; i--) {
+        ComputeBounds(&nodes_[i]);
+        if (nodes_[i].count == 0) {
+            const Node& left = nodes_[i + 1];
+            const Node& right = nodes_[nodes_[i].index];
+            nodes_[i].min = left.min.cwiseMin(right.min);
+            nodes_[i].max = left.max.cwiseMax(right.max);
+        }
+    }
+}
+
+bool MeshBVH::Empty() const {
+    return nodes_.empty();
+}
+
+int MeshBVH::NumFaces() const {
+    return static_cast<int>(order_.size());
+}
+
+bool MeshBVH::Intersect(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, Hit* hit) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+    // Zero components would give 0 * inf = NaN in the slab test for boxes touching the ray
+    Eigen::Vector3f inv_direction;
+    for (int i = 0; i < 3; i++) {
+        float d = std::abs(direction(i)) < 1e-20f ? std::copysign(1e-20f, direction(i)) : direction(i);
+        inv_direction(i) = 1.0f / d;
+    }
+    const float epsilon = 1e-12f;
+    float best_t = std::numeric_limits<float>::max();
+    int best_k = -1;
+    float best_u = 0.0f, best_v = 0.0f;
+
+    // Entry distance of the ray into the node box (infinity if missed or farther than best)
+    auto enter = [&](const Node& node) {
+        Eigen::Vector3f t1 = (node.min - origin).cwiseProduct(inv_direction);
+        Eigen::Vector3f t2 = (node.max - origin).cwiseProduct(inv_direction);
+        float t_near = std::max(t1.cwiseMin(t2).maxCoeff(), 0.0f);
+        float t_far = t1.cwiseMax(t2).minCoeff();
+        return (t_near <= t_far && t_near < best_t) ? t_near : std::numeric_limits<float>::infinity();
+    };
+
+    int stack[64];
+    int stack_size = 0;
+    if (enter(nodes_[0]) == std::numeric_limits<float>::infinity()) {
+        return false;
+    }
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const Node& node = nodes_[stack[--stack_size]];
+        if (node.count > 0) {
+            // Moller-Trumbore
+            for (int k = node.index; k < node.index + node.count; k++) {
+                Eigen::Vector3f p = direction.cross(e2_[k]);
+                float det = e1_[k].dot(p);
+                if (std::abs(det) < epsilon) {
+                    continue;
+                }
+                float inv_det = 1.0f / det;
+                Eigen::Vector3f s = origin - v0_[k];
+                float u = s.dot(p) * inv_det;
+                if (u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+                Eigen::Vector3f q = s.cross(e1_[k]);
+                float v = direction.dot(q) * inv_det;
+                if (v < 0.0f || u + v > 1.0f) {
+                    continue;
+                }
+                float t = e2_[k].dot(q) * inv_det;
+                if (t > 0.0f && t < best_t) {
+                    best_t = t;
+                    best_k = k;
+                    best_u = u;
+                    best_v = v;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first
+        int left = static_cast<int>(&node - nodes_.data()) + 1;
+        int right = node.index;
+        float t_left = enter(nodes_[left]);
+        float t_right = enter(nodes_[right]);
+        if (t_left > t_right) {
+            std::swap(left, right);
+            std::swap(t_left, t_right);
+        }
+        if (t_right != std::numeric_limits<float>::infinity()) {
+            stack[stack_size++] = right;
+        }
+        if (t_left != std::numeric_limits<float>::infinity()) {
+            stack[stack_size++] = left;
+        }
+    }
+
+    if (best_k < 0) {
+        return false;
+    }
+    hit->face = order_[best_k];
+    hit->t = best_t;
+    hit->barycentric = Eigen::Vector3f(1.0f - best_u - best_v, best_u, best_v);
+    return true;
+}
+
+bool MeshBVH::Pick(const Eigen::Vector2f& position, const Eigen::Matrix4f& view, const Eigen::Matrix4f& proj,
+                   const Eigen::Vector4f& viewport, Hit* hit) const {
+    // Unproject the pixel on the near and far plane
+    Eigen::Matrix4d inverse = (proj.cast<double>() * view.cast<double>()).inverse();
+    double x = 2.0 * (position.x() - viewport(0)) / viewport(2) - 1.0;
+    double y = 2.0 * (position.y() - viewport(1)) / viewport(3) - 1.0;
+    Eigen::Vector3d near_point = (inverse * Eigen::Vector4d(x, y, -1.0, 1.0)).hnormalized();
+    Eigen::Vector3d far_point = (inverse * Eigen::Vector4d(x, y, 1.0, 1.0)).hnormalized();
+    return Intersect(near_point.cast<float>(), (far_point - near_point).cast<float>(), hit);
+}
+
+void MeshBVH::FacesInFrustum(const std::vector<Eigen::Vector4f>& planes, std::vector<int>* faces) const {
+    faces->clear();
+    if (nodes_.empty()) {
+        return;
+    }
+
+    auto centroid_inside = [&](const Eigen::Vector3f& point) {
+        for (const auto& plane : planes) {
+            if (plane.head<3>().dot(point) + plane(3) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    int stack[64];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const int index = stack[--stack_size];
+        const Node& node = nodes_[index];
+
+        // Classify box against planes (corner farthest along and against each normal)
+        bool outside = false;
+        bool inside = true;
+        for (const auto& plane : planes) {
+            Eigen::Vector3f normal = plane.head<3>();
+            Eigen::Vector3f positive = (normal.array() >= 0.0f).select(node.max, node.min);
+            Eigen::Vector3f negative = (normal.array() >= 0.0f).select(node.min, node.max);
+            if (normal.dot(positive) + plane(3) < 0.0f) {
+                outside = true;
+                break;
+            }
+            if (normal.dot(negative) + plane(3) < 0.0f) {
+                inside = false;
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        if (inside) {
+            // Subtree triangles are contiguous, from its leftmost to its rightmost leaf
+            int first = index;
+            while (nodes_[first].count == 0) {
+                first = first + 1;
+            }
+            int last = index;
+            while (nodes_[last].count == 0) {
+                last = nodes_[last].index;
+            }
+            for (int k = nodes_[first].index; k < nodes_[last].index + nodes_[last].count; k++) {
+                faces->push_back(order_[k]);
+            }
+        } else if (node.count > 0) {
+            for (int k = node.index; k < node.index + node.count; k++) {
+                if (centroid_inside(centroids_[order_[k]])) {
+                    faces->push_back(order_[k]);
+                }
+            }
+        } else {
+            stack[stack_size++] = node.index;
+            stack[stack_size++] = index + 1;
+        }
+    }
+}
+
+void MeshBVH::GrowRegion(int seed, float max_angle, std::vector<int>* faces) const {
+    faces->clear();
+    if (seed < 0 || seed >= NumFaces()) {
+        return;
+    }
+    const Eigen::Vector3f seed_normal = normals_[seed];
+    const float min_cos = std::cos(max_angle);
+
+    std::vector<uint8_t> visited(normals_.size(), 0);
+    visited[seed] = 1;
+    faces->push_back(seed);
+    for (size_t i = 0; i < faces->size(); i++) {
+        int face = (*faces)[i];
+        for (int a = adjacency_offsets_[face]; a < adjacency_offsets_[face + 1]; a++) {
+            int neighbor = adjacency_[a];
+            if (!visited[neighbor] && normals_[neighbor].dot(seed_normal) >= min_cos) {
+                visited[neighbor] = 1;
+                faces->push_back(neighbor);
+            }
+        }
+    }
+}
+
+const Eigen::Vector3f& MeshBVH::Centroid(int face) const {
+    return centroids_[face];
+}
+
+void MeshBVH::ComputeFaceData(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F) {
+    const int num_faces = static_cast<int>(F.rows());
+    centroids_.resize(num_faces);
+    normals_.resize(num_faces);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_faces; i++) {
+        Eigen::Vector3d a = V.row(F(i, 0));
+        Eigen::Vector3d b = V.row(F(i, 1));
+        Eigen::Vector3d c = V.row(F(i, 2));
+        centroids_[i] = ((a + b + c) / 3.0).cast<float>();
+        Eigen::Vector3d normal = (b - a).cross(c - a);
+        double norm = normal.norm();
+        normals_[i] = (norm > 0.0 ? Eigen::Vector3d(normal / norm) : Eigen::Vector3d::Zero()).cast<float>();
+    }
+}
+
+int MeshBVH::BuildNode(std::vector<BuildItem>* items, int begin, int end) {
+    const int index = static_cast<int>(nodes_.size());
+    nodes_.emplace_back();
+    if (end - begin <= kLeafSize) {
+        nodes_[index].index = begin;
+        nodes_[index].count = end - begin;
+        return index;
+    }
+
+    // Median split along the largest extent of the centroids
+    Eigen::Vector3f min = (*items)[begin].centroid;
+    Eigen::Vector3f max = min;
+    for (int k = begin + 1; k < end; k++) {
+        min = min.cwiseMin((*items)[k].centroid);
+        max = max.cwiseMax((*items)[k].centroid);
+    }
+    int axis;
+    (max - min).maxCoeff(&axis);
+    const int middle = begin + (end - begin) / 2;
+    std::nth_element(items->begin() + begin, items->begin() + middle, items->begin() + end,
+                     [axis](const BuildItem& a, const BuildItem& b) { return a.centroid(axis) < b.centroid(axis); });
+
+    BuildNode(items, begin, middle);
+    int right = BuildNode(items, middle, end);
+    nodes_[index].index = right;
+    nodes_[index].count = 0;
+    return index;
+}
+
+void MeshBVH::ComputeBounds(Node* node) const {
+    if (node->count == 0) {
+        return;
+    }
+    node->min = v0_[node->index];
+    node->max = v0_[node->index];
+    for (int k = node->index; k < node->index + node->count; k++) {
+        Eigen::Vector3f b = v0_[k] + e1_[k];
+        Eigen::Vector3f c = v0_[k] + e2_[k];
+        node->min = node->min.cwiseMin(v0_[k]).cwiseMin(b).cwiseMin(c);
+        node->max = node->max.cwiseMax(v0_[k]).cwiseMax(b).cwiseMax(c);
+    }
+}
+
+void MeshBVH::BuildAdjacency(const Eigen::MatrixXi& F) {
+    const int num_faces = static_cast<int>(F.rows());
+    const int num_vertices = num_faces > 0 ? F.maxCoeff() + 1 : 0;
+
+    // Faces around each vertex
+    std::vector<int> vertex_offsets(num_vertices + 1, 0);
+    for (int i = 0; i < num_faces; i++) {
+        for (int j = 0; j < 3; j++) {
+            vertex_offsets[F(i, j) + 1]++;
+        }
+    }
+    for (int i = 0; i < num_vertices; i++) {
+        vertex_offsets[i + 1] += vertex_offsets[i];
+    }
+    std::vector<int> vertex_faces(vertex_offsets[num_vertices]);
+    std::vector<int> fill(vertex_offsets.begin(), vertex_offsets.end() - 1);
+    for (int i = 0; i < num_faces; i++) {
+        for (int j = 0; j < 3; j++) {
+            vertex_faces[fill[F(i, j)]++] = i;
+        }
+    }
+
+    // Faces sharing an edge are the other faces around its first vertex that contain its second vertex
+    auto for_each_neighbor = [&](int face, auto fn) {
+        for (int j = 0; j < 3; j++) {
+            int a = F(face, j);
+            int b = F(face, (j + 1) % 3);
+            for (int k = vertex_offsets[a]; k < vertex_offsets[a + 1]; k++) {
+                int other = vertex_faces[k];
+                if (other != face && (F(other, 0) == b || F(other, 1) == b || F(other, 2) == b)) {
+                    fn(other);
+                }
+            }
+        }
+    };
+
+    adjacency_offsets_.assign(num_faces + 1, 0);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_faces; i++) {
+        int count = 0;
+        for_each_neighbor(i, [&count](int) { count++; });
+        adjacency_offsets_[i + 1] = count;
+    }
+    for (int i = 0; i < num_faces; i++) {
+        adjacency_offsets_[i + 1] += adjacency_offsets_[i];
+    }
+    adjacency_.resize(adjacency_offsets_[num_faces]);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_faces; i++) {
+        int next = adjacency_offsets_[i];
+        for_each_neighbor(i, [this, &next](int other) { adjacency_[next++] = other; });
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef REALTIME_RECONSTRUCTION_MESHBVH_H
+#define REALTIME_RECONSTRUCTION_MESHBVH_H
+
+#include <vector>
+
+#include <Eigen/Core>
+
+// Bounding volume hierarchy over mesh triangles for picking and selection. Nodes are stored
+// depth first (left child follows its parent), leaves hold up to kLeafSize triangles whose
+// data is stored in leaf order. Edge adjacency is built with the tree for region growing.
+class MeshBVH {
+public:
+    struct Hit {
+        int face = -1;
+        float t = 0.0f;
+        // Same convention as igl::unproject_onto_mesh (1 - u - v, u, v)
+        Eigen::Vector3f barycentric = Eigen::Vector3f::Zero();
+    };
+
+    void Build(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F);
+
+    // Update triangles and boxes for moved vertices (faces must be unchanged)
+    void Refit(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F);
+
+    bool Empty() const;
+    int NumFaces() const;
+
+    // Closest triangle hit by the ray origin + t * direction, t > 0
+    bool Intersect(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, Hit* hit) const;
+
+    // Ray through the pixel (x right, y up from the bottom of the viewport) and closest hit
+    bool Pick(const Eigen::Vector2f& position, const Eigen::Matrix4f& view, const Eigen::Matrix4f& proj,
+              const Eigen::Vector4f& viewport, Hit* hit) const;
+
+    // Faces with centroid on the positive side of all planes (a * x + b * y + c * z + d >= 0)
+    void FacesInFrustum(const std::vector<Eigen::Vector4f>& planes, std::vector<int>* faces) const;
+
+    // Edge connected faces reachable from seed whose normals are within max_angle (radians) of the seed normal
+    void GrowRegion(int seed, float max_angle, std::vector<int>* faces) const;
+
+    const Eigen::Vector3f& Centroid(int face) const;
+
+private:
+    static const int kLeafSize = 4;
+
+    struct Node {
+        Eigen::Vector3f min;
+        Eigen::Vector3f max;
+        // Leaf: first triangle in leaf order and count, inner node: right child and count 0
+        int index;
+        int count;
+    };
+
+    // Face centroid moved around while splitting
+    struct BuildItem {
+        Eigen::Vector3f centroid;
+        int face;
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<int> order_;
+
+    // Triangles in leaf order (vertex and two edges)
+    std::vector<Eigen::Vector3f> v0_;
+    std::vector<Eigen::Vector3f> e1_;
+    std::vector<Eigen::Vector3f> e2_;
+
+    // Per face in mesh order
+    std::vector<Eigen::Vector3f> centroids_;
+    std::vector<Eigen::Vector3f> normals_;
+
+    // Edge adjacent faces of face i are adjacency_[offsets_[i]] .. adjacency_[offsets_[i + 1] - 1]
+    std::vector<int> adjacency_offsets_;
+    std::vector<int> adjacency_;
+
+    void ComputeFaceData(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F);
+    int BuildNode(std::vector<BuildItem>* items, int begin, int end);
+    void ComputeBounds(Node* node) const;
+    void BuildAdjacency(const Eigen::MatrixXi& F);
+};
+
+#endif //REALTIME_RECONSTRUCTION_MESHBVH_H
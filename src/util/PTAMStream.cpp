@@ -0,0 +1,278 @@
+#include "PTAMStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ptam_stream;
+
+// BinaryWriter and MappedFileReader use host byte order, the format is little-endian
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "PTAM stream requires a little-endian host");
+
+PTAMStreamWriter::PTAMStreamWriter(const std::string& filename, int chunk_size)
+        : writer_(filename),
+          chunk_size_(std::max(1, chunk_size)) {
+
+    writer_.Write(kMagic);
+    writer_.Write(kVersion);
+    uint32_t flags = 0;
+    writer_.Write(flags);
+
+    offsets_.push_back(0);
+}
+
+PTAMStreamWriter::~PTAMStreamWriter() = default;
+
+bool PTAMStreamWriter::IsOpen() const {
+    return writer_.IsOpen();
+}
+
+void PTAMStreamWriter::AddFrame(uint32_t view_id, const std::string& name) {
+    frame_ids_.push_back(view_id);
+    frame_names_.push_back(name);
+}
+
+void PTAMStreamWriter::AddPoint(const PTAMPoint& point) {
+    if (!frames_written_) {
+        WriteFrames();
+    }
+
+    x_.push_back(point.x);
+    y_.push_back(point.y);
+    z_.push_back(point.z);
+    for (const auto& image_point : point.imagePoints) {
+        levels_.push_back(static_cast<uint8_t>(image_point.level));
+        frames_.push_back(static_cast<uint32_t>(image_point.frame));
+        image_x_.push_back(static_cast<float>(image_point.x));
+        image_y_.push_back(static_cast<float>(image_point.y));
+    }
+    offsets_.push_back(static_cast<uint32_t>(levels_.size()));
+
+    if (x_.size() >= static_cast<size_t>(chunk_size_)) {
+        WriteChunk();
+    }
+}
+
+void PTAMStreamWriter::AddCalPoint(const PTAMPoint& model, const PTAMPoint& world) {
+    cal_model_.insert(cal_model_.end(), {model.x, model.y, model.z});
+    cal_world_.insert(cal_world_.end(), {world.x, world.y, world.z});
+}
+
+bool PTAMStreamWriter::Finish(int scale_point1, int scale_point2, float scale_distance) {
+    if (finished_) {
+        return writer_.Good();
+    }
+    if (!frames_written_) {
+        WriteFrames();
+    }
+    WriteChunk();
+
+    writer_.Write(static_cast<uint32_t>(kChunkEnd));
+    writer_.WriteArray(cal_model_.data(), cal_model_.size());
+    writer_.WriteArray(cal_world_.data(), cal_world_.size());
+    writer_.Write(static_cast<int32_t>(scale_point1));
+    writer_.Write(static_cast<int32_t>(scale_point2));
+    writer_.Write(scale_distance);
+    writer_.Write(num_points_);
+    writer_.Write(num_observations_);
+    writer_.Write(num_chunks_);
+
+    finished_ = true;
+    return writer_.Good();
+}
+
+uint64_t PTAMStreamWriter::NumPoints() const {
+    return num_points_ + x_.size();
+}
+
+uint64_t PTAMStreamWriter::NumObservations() const {
+    return num_observations_ + levels_.size();
+}
+
+void PTAMStreamWriter::WriteFrames() {
+    writer_.Write(static_cast<uint32_t>(kChunkFrames));
+    writer_.WriteArray(frame_ids_.data(), frame_ids_.size());
+    for (const auto& name : frame_names_) {
+        writer_.WriteString(name);
+    }
+    frames_written_ = true;
+}
+
+void PTAMStreamWriter::WriteChunk() {
+    if (x_.empty()) {
+        return;
+    }
+
+    writer_.Write(static_cast<uint32_t>(kChunkPoints));
+    writer_.WriteArray(x_.data(), x_.size());
+    writer_.WriteArray(y_.data(), y_.size());
+    writer_.WriteArray(z_.data(), z_.size());
+    writer_.WriteArray(offsets_.data(), offsets_.size());
+    writer_.WriteArray(levels_.data(), levels_.size());
+    writer_.WriteArray(frames_.data(), frames_.size());
+    writer_.WriteArray(image_x_.data(), image_x_.size());
+    writer_.WriteArray(image_y_.data(), image_y_.size());
+
+    num_points_ += x_.size();
+    num_observations_ += levels_.size();
+    num_chunks_++;
+
+    // Buffers keep their capacity for the next chunk
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    offsets_.assign(1, 0);
+    levels_.clear();
+    frames_.clear();
+    image_x_.clear();
+    image_y_.clear();
+}
+
+PTAMStreamReader::PTAMStreamReader(const std::string& filename)
+        : reader_(filename) {
+
+    char magic[8];
+    uint32_t version, flags;
+    if (!reader_.Read(&magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !reader_.Read(&version) || version != kVersion ||
+        !reader_.Read(&flags) || flags != 0) {
+        return;
+    }
+
+    uint32_t type;
+    while (reader_.Read(&type)) {
+        bool success = false;
+        switch (type) {
+            case kChunkFrames:
+                success = ReadFrames();
+                break;
+            case kChunkPoints:
+                success = ReadPoints();
+                break;
+            case kChunkEnd:
+                ok_ = ReadEnd();
+                return;
+            default:
+                break;
+        }
+        if (!success) {
+            return;
+        }
+    }
+}
+
+bool PTAMStreamReader::IsOpen() const {
+    return ok_;
+}
+
+const std::vector<uint32_t>& PTAMStreamReader::FrameIds() const {
+    return frame_ids_;
+}
+
+const std::vector<std::string>& PTAMStreamReader::FrameNames() const {
+    return frame_names_;
+}
+
+const std::vector<PointChunk>& PTAMStreamReader::Chunks() const {
+    return chunks_;
+}
+
+const std::vector<float>& PTAMStreamReader::CalModelPoints() const {
+    return cal_model_;
+}
+
+const std::vector<float>& PTAMStreamReader::CalWorldPoints() const {
+    return cal_world_;
+}
+
+int PTAMStreamReader::ScalePoint1() const {
+    return scale_point1_;
+}
+
+int PTAMStreamReader::ScalePoint2() const {
+    return scale_point2_;
+}
+
+float PTAMStreamReader::ScaleDistance() const {
+    return scale_distance_;
+}
+
+uint64_t PTAMStreamReader::NumPoints() const {
+    return num_points_;
+}
+
+uint64_t PTAMStreamReader::NumObservations() const {
+    return num_observations_;
+}
+
+bool PTAMStreamReader::ReadFrames() {
+    uint64_t num_frames = 0;
+    const uint32_t* ids = reader_.ReadArray<uint32_t>(&num_frames);
+    if (ids == nullptr && num_frames > 0) {
+        return false;
+    }
+    frame_ids_.assign(ids, ids + num_frames);
+    frame_names_.resize(num_frames);
+    for (auto& name : frame_names_) {
+        if (!reader_.ReadString(&name)) {
+            return false;
+        }
+    }
+    return reader_.Good();
+}
+
+bool PTAMStreamReader::ReadPoints() {
+    PointChunk chunk;
+    uint64_t count_y = 0, count_z = 0, count_offsets = 0;
+    chunk.x = reader_.ReadArray<float>(&chunk.num_points);
+    chunk.y = reader_.ReadArray<float>(&count_y);
+    chunk.z = reader_.ReadArray<float>(&count_z);
+    chunk.offsets = reader_.ReadArray<uint32_t>(&count_offsets);
+    if (!reader_.Good() || chunk.num_points == 0 || count_y != chunk.num_points ||
+        count_z != chunk.num_points || count_offsets != chunk.num_points + 1) {
+        return false;
+    }
+
+    uint64_t count_frames = 0, count_image_x = 0, count_image_y = 0;
+    chunk.levels = reader_.ReadArray<uint8_t>(&chunk.num_observations);
+    chunk.frames = reader_.ReadArray<uint32_t>(&count_frames);
+    chunk.image_x = reader_.ReadArray<float>(&count_image_x);
+    chunk.image_y = reader_.ReadArray<float>(&count_image_y);
+    if (!reader_.Good() || count_frames != chunk.num_observations ||
+        count_image_x != chunk.num_observations || count_image_y != chunk.num_observations ||
+        chunk.offsets[0] != 0 || chunk.offsets[chunk.num_points] != chunk.num_observations) {
+        return false;
+    }
+
+    // Offsets index the mapped observation arrays, so they must not go backwards
+    for (uint64_t i = 0; i < chunk.num_points; i++) {
+        if (chunk.offsets[i] > chunk.offsets[i + 1]) {
+            return false;
+        }
+    }
+
+    num_points_ += chunk.num_points;
+    num_observations_ += chunk.num_observations;
+    chunks_.push_back(chunk);
+    return true;
+}
+
+bool PTAMStreamReader::ReadEnd() {
+    uint64_t count = 0;
+    const float* model = reader_.ReadArray<float>(&count);
+    cal_model_.assign(model, model + (model != nullptr ? count : 0));
+    const float* world = reader_.ReadArray<float>(&count);
+    cal_world_.assign(world, world + (world != nullptr ? count : 0));
+
+    int32_t scale_point1, scale_point2;
+    uint64_t num_points, num_observations, num_chunks;
+    if (!reader_.Read(&scale_point1) || !reader_.Read(&scale_point2) || !reader_.Read(&scale_distance_) ||
+        !reader_.Read(&num_points) || !reader_.Read(&num_observations) || !reader_.Read(&num_chunks)) {
+        return false;
+    }
+    scale_point1_ = scale_point1;
+    scale_point2_ = scale_point2;
+
+    // Totals guard against truncated or partially written files
+    return reader_.Good() && num_points == num_points_ && num_observations == num_observations_ &&
+           num_chunks == chunks_.size();
+}
@@ -0,0 +1,139 @@
+#ifndef REALTIME_RECONSTRUCTION_PTAMSTREAM_H
+#define REALTIME_RECONSTRUCTION_PTAMSTREAM_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/BinaryIO.h"
+#include "util/PTAMExporter.h"
+
+// Compact streaming alternative to the cereal PTAMExporter archive. The file is a
+// header followed by chunks, all values little-endian and arrays 8-byte aligned:
+//
+//   header:  magic "PTAMSTR", version, flags (compression, 0 = none)
+//   frames:  view ids, names
+//   points:  (repeated) number of points, x, y, z (float32 arrays), observation offsets
+//            (num_points + 1), observation levels, frames, image x, image y (float32)
+//   end:     calibration points, scale points and distance, totals
+//
+// Points are written in chunks while they are generated, so memory is bounded by the
+// chunk size. The reader maps the file and returns pointers into it without copying.
+namespace ptam_stream {
+
+const char kMagic[8] = {'P', 'T', 'A', 'M', 'S', 'T', 'R', '\0'};
+const uint32_t kVersion = 1;
+
+enum ChunkType : uint32_t {
+    kChunkFrames = 1,
+    kChunkPoints = 2,
+    kChunkEnd = 3
+};
+
+// Observation table of one chunk, observations of point i are [offsets[i], offsets[i + 1])
+struct PointChunk {
+    uint64_t num_points = 0;
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* z = nullptr;
+    const uint32_t* offsets = nullptr;
+
+    uint64_t num_observations = 0;
+    const uint8_t* levels = nullptr;
+    const uint32_t* frames = nullptr;
+    const float* image_x = nullptr;
+    const float* image_y = nullptr;
+};
+
+}
+
+class PTAMStreamWriter {
+public:
+    explicit PTAMStreamWriter(const std::string& filename, int chunk_size = 65536);
+    ~PTAMStreamWriter();
+
+    bool IsOpen() const;
+
+    // Frames must be added before the first point
+    void AddFrame(uint32_t view_id, const std::string& name);
+
+    // Buffered, written when the chunk is full
+    void AddPoint(const PTAMPoint& point);
+
+    void AddCalPoint(const PTAMPoint& model, const PTAMPoint& world);
+
+    // Write remaining points, calibration and totals. Returns false on write error.
+    bool Finish(int scale_point1, int scale_point2, float scale_distance);
+
+    uint64_t NumPoints() const;
+    uint64_t NumObservations() const;
+
+private:
+    BinaryWriter writer_;
+    int chunk_size_;
+    bool frames_written_ = false;
+    bool finished_ = false;
+
+    std::vector<uint32_t> frame_ids_;
+    std::vector<std::string> frame_names_;
+    std::vector<float> cal_model_;
+    std::vector<float> cal_world_;
+
+    // Current chunk
+    std::vector<float> x_, y_, z_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint8_t> levels_;
+    std::vector<uint32_t> frames_;
+    std::vector<float> image_x_, image_y_;
+
+    uint64_t num_points_ = 0;
+    uint64_t num_observations_ = 0;
+    uint64_t num_chunks_ = 0;
+
+    void WriteFrames();
+    void WriteChunk();
+};
+
+class PTAMStreamReader {
+public:
+    // Maps the file and reads all chunk tables (data stays in the mapped file)
+    explicit PTAMStreamReader(const std::string& filename);
+
+    bool IsOpen() const;
+
+    const std::vector<uint32_t>& FrameIds() const;
+    const std::vector<std::string>& FrameNames() const;
+    const std::vector<ptam_stream::PointChunk>& Chunks() const;
+
+    // Calibration points as x, y, z triplets
+    const std::vector<float>& CalModelPoints() const;
+    const std::vector<float>& CalWorldPoints() const;
+    int ScalePoint1() const;
+    int ScalePoint2() const;
+    float ScaleDistance() const;
+
+    uint64_t NumPoints() const;
+    uint64_t NumObservations() const;
+
+private:
+    MappedFileReader reader_;
+    bool ok_ = false;
+
+    std::vector<uint32_t> frame_ids_;
+    std::vector<std::string> frame_names_;
+    std::vector<ptam_stream::PointChunk> chunks_;
+    std::vector<float> cal_model_;
+    std::vector<float> cal_world_;
+    int scale_point1_ = -1;
+    int scale_point2_ = -1;
+    float scale_distance_ = 0.0f;
+    uint64_t num_points_ = 0;
+    uint64_t num_observations_ = 0;
+
+    bool ReadFrames();
+    bool ReadPoints();
+    bool ReadEnd();
+};
+
+#endif //REALTIME_RECONSTRUCTION_PTAMSTREAM_H
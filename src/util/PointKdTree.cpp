@@ -0,0 +1,101 @@
+#include "PointKdTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+PointKdTree::PointKdTree(std::vector<Eigen::Vector3d> points)
+        : points_(std::move(points)),
+          indices_(points_.size()),
+          split_dims_(points_.size(), 0) {
+    for (int i = 0; i < indices_.size(); i++) {
+        indices_[i] = i;
+    }
+    Build(0, static_cast<int>(indices_.size()));
+}
+
+int PointKdTree::Size() const {
+    return static_cast<int>(points_.size());
+}
+
+void PointKdTree::Build(int begin, int end) {
+    if (end - begin <= 1) {
+        return;
+    }
+
+    // Split along the dimension with the largest extent
+    Eigen::Vector3d min_point = points_[indices_[begin]];
+    Eigen::Vector3d max_point = min_point;
+    for (int i = begin + 1; i < end; i++) {
+        min_point = min_point.cwiseMin(points_[indices_[i]]);
+        max_point = max_point.cwiseMax(points_[indices_[i]]);
+    }
+    int dim;
+    (max_point - min_point).maxCoeff(&dim);
+
+    int mid = begin + (end - begin) / 2;
+    std::nth_element(indices_.begin() + begin, indices_.begin() + mid, indices_.begin() + end,
+                     [this, dim](int a, int b) { return points_[a][dim] < points_[b][dim]; });
+    split_dims_[mid] = static_cast<unsigned char>(dim);
+
+    Build(begin, mid);
+    Build(mid + 1, end);
+}
+
+void PointKdTree::KNearest(const Eigen::Vector3d& query, int k,
+                           std::vector<std::pair<int, double>>* neighbors) const {
+    neighbors->clear();
+    if (k <= 0 || points_.empty()) {
+        return;
+    }
+
+    // Max heap of (squared distance, index) of the best k points so far
+    std::vector<std::pair<double, int>> heap;
+    heap.reserve(k + 1);
+    Search(0, static_cast<int>(indices_.size()), query, k, &heap);
+
+    std::sort(heap.begin(), heap.end());
+    neighbors->reserve(heap.size());
+    for (const auto& entry : heap) {
+        neighbors->emplace_back(entry.second, std::sqrt(entry.first));
+    }
+}
+
+void PointKdTree::Search(int begin, int end, const Eigen::Vector3d& query, int k,
+                         std::vector<std::pair<double, int>>* heap) const {
+    if (begin >= end) {
+        return;
+    }
+    int mid = begin + (end - begin) / 2;
+    int index = indices_[mid];
+
+    // Visit node
+    std::pair<double, int> entry((points_[index] - query).squaredNorm(), index);
+    if (heap->size() < k) {
+        heap->push_back(entry);
+        std::push_heap(heap->begin(), heap->end());
+    } else if (entry < heap->front()) {
+        std::pop_heap(heap->begin(), heap->end());
+        heap->back() = entry;
+        std::push_heap(heap->begin(), heap->end());
+    }
+    if (end - begin == 1) {
+        return;
+    }
+
+    // Near side first, far side only if the splitting plane is within the current k-th distance
+    int dim = split_dims_[mid];
+    double diff = query[dim] - points_[index][dim];
+    bool left_first = diff < 0.0;
+    if (left_first) {
+        Search(begin, mid, query, k, heap);
+    } else {
+        Search(mid + 1, end, query, k, heap);
+    }
+    if (heap->size() < k || diff * diff <= heap->front().first) {
+        if (left_first) {
+            Search(mid + 1, end, query, k, heap);
+        } else {
+            Search(begin, mid, query, k, heap);
+        }
+    }
+}
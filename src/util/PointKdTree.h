@@ -0,0 +1,34 @@
+#ifndef REALTIME_RECONSTRUCTION_POINTKDTREE_H
+#define REALTIME_RECONSTRUCTION_POINTKDTREE_H
+
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+// Static k-d tree over 3D points for k nearest neighbor queries. The tree is stored
+// implicitly in a permutation of point indices (median of each range is the node),
+// queries are const and can run in parallel.
+class PointKdTree {
+public:
+    explicit PointKdTree(std::vector<Eigen::Vector3d> points);
+
+    // Indices of up to k nearest points and their distances, sorted by increasing
+    // distance (ties are ordered by index)
+    void KNearest(const Eigen::Vector3d& query, int k, std::vector<std::pair<int, double>>* neighbors) const;
+
+    int Size() const;
+
+private:
+    std::vector<Eigen::Vector3d> points_;
+    std::vector<int> indices_;
+
+    // Split dimension of the node at each position of indices_
+    std::vector<unsigned char> split_dims_;
+
+    void Build(int begin, int end);
+    void Search(int begin, int end, const Eigen::Vector3d& query, int k,
+                std::vector<std::pair<double, int>>* heap) const;
+};
+
+#endif //REALTIME_RECONSTRUCTION_POINTKDTREE_H
@@ -0,0 +1,292 @@
+#include "ReplayBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+#include <sys/resource.h>
+
+#include <theia/sfm/reconstruction_estimator_utils.h>
+
+namespace {
+
+std::string EscapeJSON(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+}
+
+ReplayBenchmark::ReplayBenchmark(const Options& options,
+                                 std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder)
+        : options_(options),
+          reconstruction_builder_(std::move(reconstruction_builder)) {}
+
+bool ReplayBenchmark::Run(std::ostream& log_stream) {
+    records_.clear();
+    if (options_.image_names.size() < 2) {
+        log_stream << "Replay: At least two images are needed." << std::endl;
+        return false;
+    }
+
+    // Initialize reconstruction
+    log_stream << "Replay: Initializing with " << options_.image_names[0]
+               << " and " << options_.image_names[1] << std::endl;
+    auto time_begin = std::chrono::steady_clock::now();
+    initialize_success_ = reconstruction_builder_->InitializeReconstruction(
+            options_.images_path + options_.image_names[0],
+            options_.images_path + options_.image_names[1]);
+    std::chrono::duration<double> time_elapsed = std::chrono::steady_clock::now() - time_begin;
+    initialize_time_ = time_elapsed.count();
+
+    if (!initialize_success_) {
+        log_stream << "Replay: Initialization failed: " << reconstruction_builder_->GetMessage() << std::endl;
+        return false;
+    }
+
+    // Extend with remaining images
+    for (int i = 2; i < options_.image_names.size(); i++) {
+        ViewRecord record;
+        record.image_idx = i;
+        record.image_name = options_.image_names[i];
+        record.success = reconstruction_builder_->ExtendReconstruction(options_.images_path + record.image_name);
+
+        const auto& summary = reconstruction_builder_->GetExtendSummary();
+        record.view_id = summary.view_id;
+        record.num_features = summary.num_features;
+        record.extraction_time = summary.extraction_time;
+        record.retrieval_time = summary.retrieval_time;
+        record.matching_time = summary.matching_time;
+        record.estimation_time = summary.estimation_time;
+        record.total_time = summary.total_time;
+        record.num_retrieved = static_cast<int>(summary.retrieved_views.size());
+        record.num_matched = static_cast<int>(summary.matched_views.size());
+        record.num_guided = static_cast<int>(summary.guided_views.size());
+
+        // Failed extends have no relevant views, they are left out of the retrieval means
+        if (options_.evaluate_retrieval && record.success && record.view_id != theia::kInvalidViewId) {
+            EvaluateRetrieval(record);
+        }
+        RecordReconstruction(record);
+
+        log_stream << "Replay: [" << (i + 1) << "/" << options_.image_names.size() << "] "
+                   << record.image_name << " extend " << (record.success ? "ok" : "failed")
+                   << " in " << record.total_time << " s" << std::endl;
+        records_.push_back(record);
+    }
+    return true;
+}
+
+bool ReplayBenchmark::RunSaveSession(const std::string& session_fullpath, std::ostream& log_stream) {
+    auto time_begin = std::chrono::steady_clock::now();
+    bool success = reconstruction_builder_->SaveSession(session_fullpath);
+    std::chrono::duration<double> time_elapsed = std::chrono::steady_clock::now() - time_begin;
+
+    if (!success) {
+        log_stream << "Replay: Saving session failed: " << reconstruction_builder_->GetMessage() << std::endl;
+        return false;
+    }
+    save_time_ = time_elapsed.count();
+    std::ifstream session_file(session_fullpath, std::ios::binary | std::ios::ate);
+    session_bytes_ = static_cast<long>(session_file.tellg());
+    log_stream << "Replay: Session (" << session_bytes_ << " bytes) saved in " << save_time_ << " s" << std::endl;
+    return true;
+}
+
+bool ReplayBenchmark::RunLoadSession(const std::string& session_fullpath, int num_repetitions,
+                                     std::ostream& log_stream) {
+    load_times_.clear();
+    for (int i = 0; i < num_repetitions; i++) {
+        auto time_begin = std::chrono::steady_clock::now();
+        bool success = reconstruction_builder_->LoadSession(session_fullpath);
+        std::chrono::duration<double> time_elapsed = std::chrono::steady_clock::now() - time_begin;
+
+        if (!success) {
+            log_stream << "Replay: Loading session failed: " << reconstruction_builder_->GetMessage() << std::endl;
+            return false;
+        }
+        load_times_.push_back(time_elapsed.count());
+        log_stream << "Replay: Session loaded in " << time_elapsed.count() << " s" << std::endl;
+    }
+
+    const theia::Reconstruction& reconstruction = reconstruction_builder_->GetReconstruction();
+    load_num_views_ = reconstruction.NumViews();
+    load_num_tracks_ = reconstruction.NumTracks();
+    log_stream << "Replay: Session has " << load_num_views_ << " views and "
+               << load_num_tracks_ << " tracks" << std::endl;
+    return true;
+}
+
+const std::vector<ReplayBenchmark::ViewRecord>& ReplayBenchmark::GetRecords() const {
+    return records_;
+}
+
+void ReplayBenchmark::EvaluateRetrieval(ViewRecord& record) {
+    std::vector<theia::ViewId> relevant = reconstruction_builder_->MatchAllViews(record.view_id);
+    std::vector<theia::ViewId> retrieved = reconstruction_builder_->GetExtendSummary().retrieved_views;
+    std::sort(retrieved.begin(), retrieved.end());
+
+    std::vector<theia::ViewId> intersection;
+    std::set_intersection(retrieved.begin(), retrieved.end(),
+                          relevant.begin(), relevant.end(),
+                          std::back_inserter(intersection));
+
+    // Without relevant views neither measure says anything about retrieval (-1, not evaluated)
+    record.num_relevant = static_cast<int>(relevant.size());
+    if (relevant.empty()) {
+        return;
+    }
+    if (!retrieved.empty()) {
+        record.precision = static_cast<double>(intersection.size()) / retrieved.size();
+    }
+    record.recall = static_cast<double>(intersection.size()) / relevant.size();
+}
+
+void ReplayBenchmark::RecordReconstruction(ViewRecord& record) {
+    const theia::Reconstruction& reconstruction = reconstruction_builder_->GetReconstruction();
+    record.num_views = reconstruction.NumViews();
+    record.num_estimated_views = theia::NumEstimatedViews(reconstruction);
+    record.num_tracks = reconstruction.NumTracks();
+    record.peak_rss_kb = PeakRSS();
+}
+
+bool ReplayBenchmark::WriteCSV(const std::string& filename) const {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "Replay: cannot open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    outfile << "label,image_idx,image_name,view_id,success,"
+            << "extraction_time,retrieval_time,matching_time,estimation_time,total_time,"
+            << "num_features,num_retrieved,num_matched,num_guided,num_relevant,precision,recall,"
+            << "num_views,num_estimated_views,num_tracks,peak_rss_kb\n";
+
+    outfile << std::setprecision(6) << std::fixed;
+    for (const auto& record : records_) {
+        outfile << options_.label << ","
+                << record.image_idx << ","
+                << record.image_name << ","
+                << record.view_id << ","
+                << record.success << ","
+                << record.extraction_time << ","
+                << record.retrieval_time << ","
+                << record.matching_time << ","
+                << record.estimation_time << ","
+                << record.total_time << ","
+                << record.num_features << ","
+                << record.num_retrieved << ","
+                << record.num_matched << ","
+                << record.num_guided << ","
+                << record.num_relevant << ","
+                << record.precision << ","
+                << record.recall << ","
+                << record.num_views << ","
+                << record.num_estimated_views << ","
+                << record.num_tracks << ","
+                << record.peak_rss_kb << "\n";
+    }
+    return true;
+}
+
+bool ReplayBenchmark::WriteJSON(const std::string& filename) const {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cerr << "Replay: cannot open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    // Totals
+    double total_extend_time = 0.0;
+    double precision_sum = 0.0;
+    double recall_sum = 0.0;
+    int num_precision = 0;
+    int num_recall = 0;
+    int num_success = 0;
+    for (const auto& record : records_) {
+        total_extend_time += record.total_time;
+        num_success += record.success;
+        if (record.precision >= 0.0) {
+            precision_sum += record.precision;
+            num_precision++;
+        }
+        if (record.recall >= 0.0) {
+            recall_sum += record.recall;
+            num_recall++;
+        }
+    }
+
+    outfile << std::setprecision(6) << std::fixed;
+    outfile << "{\n";
+    outfile << "  \"label\": \"" << EscapeJSON(options_.label) << "\",\n";
+    outfile << "  \"num_images\": " << options_.image_names.size() << ",\n";
+    outfile << "  \"initialize_success\": " << (initialize_success_ ? "true" : "false") << ",\n";
+    outfile << "  \"initialize_time\": " << initialize_time_ << ",\n";
+    outfile << "  \"num_extend_success\": " << num_success << ",\n";
+    outfile << "  \"total_extend_time\": " << total_extend_time << ",\n";
+    outfile << "  \"mean_extend_time\": " << (records_.empty() ? 0.0 : total_extend_time / records_.size()) << ",\n";
+    outfile << "  \"mean_precision\": " << (num_precision > 0 ? precision_sum / num_precision : -1.0) << ",\n";
+    outfile << "  \"mean_recall\": " << (num_recall > 0 ? recall_sum / num_recall : -1.0) << ",\n";
+    outfile << "  \"peak_rss_kb\": " << PeakRSS() << ",\n";
+
+    if (save_time_ >= 0.0) {
+        outfile << "  \"session_save_time\": " << save_time_ << ",\n";
+        outfile << "  \"session_bytes\": " << session_bytes_ << ",\n";
+    }
+    if (!load_times_.empty()) {
+        outfile << "  \"session_num_views\": " << load_num_views_ << ",\n";
+        outfile << "  \"session_num_tracks\": " << load_num_tracks_ << ",\n";
+        outfile << "  \"session_load_times\": [";
+        for (int i = 0; i < load_times_.size(); i++) {
+            outfile << (i == 0 ? "" : ", ") << load_times_[i];
+        }
+        outfile << "],\n";
+    }
+    outfile << "  \"views\": [";
+
+    for (int i = 0; i < records_.size(); i++) {
+        const auto& record = records_[i];
+        outfile << (i == 0 ? "\n" : ",\n");
+        outfile << "    {\"image_idx\": " << record.image_idx
+                << ", \"image_name\": \"" << EscapeJSON(record.image_name) << "\""
+                << ", \"view_id\": " << record.view_id
+                << ", \"success\": " << (record.success ? "true" : "false")
+                << ", \"extraction_time\": " << record.extraction_time
+                << ", \"retrieval_time\": " << record.retrieval_time
+                << ", \"matching_time\": " << record.matching_time
+                << ", \"estimation_time\": " << record.estimation_time
+                << ", \"total_time\": " << record.total_time
+                << ", \"num_features\": " << record.num_features
+                << ", \"num_retrieved\": " << record.num_retrieved
+                << ", \"num_matched\": " << record.num_matched
+                << ", \"num_guided\": " << record.num_guided
+                << ", \"num_relevant\": " << record.num_relevant
+                << ", \"precision\": " << record.precision
+                << ", \"recall\": " << record.recall
+                << ", \"num_views\": " << record.num_views
+                << ", \"num_estimated_views\": " << record.num_estimated_views
+                << ", \"num_tracks\": " << record.num_tracks
+                << ", \"peak_rss_kb\": " << record.peak_rss_kb << "}";
+    }
+    outfile << "\n  ]\n}\n";
+    return true;
+}
+
+long ReplayBenchmark::PeakRSS() {
+    // On Linux ru_maxrss is reported in kilobytes
+    struct rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
@@ -0,0 +1,100 @@
+#ifndef REALTIME_RECONSTRUCTION_REPLAYBENCHMARK_H
+#define REALTIME_RECONSTRUCTION_REPLAYBENCHMARK_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "reconstruction/RealtimeReconstructionBuilder.h"
+
+// Replays a recorded image sequence through RealtimeReconstructionBuilder and
+// records per view timings, retrieval quality and memory usage.
+class ReplayBenchmark {
+public:
+    struct Options {
+        // Label written to the output (e.g. "sod_vocabtree")
+        std::string label = "replay";
+
+        // Folder and ordered names of the images to replay
+        std::string images_path;
+        std::vector<std::string> image_names;
+
+        // Compare retrieved views against exhaustive matching of all pairs
+        bool evaluate_retrieval = true;
+    };
+
+    struct ViewRecord {
+        int image_idx = 0;
+        std::string image_name;
+        theia::ViewId view_id = theia::kInvalidViewId;
+        bool success = false;
+
+        // Timings in seconds
+        double extraction_time = 0.0;
+        double retrieval_time = 0.0;
+        double matching_time = 0.0;
+        double estimation_time = 0.0;
+        double total_time = 0.0;
+
+        // Retrieval quality against all pairs (-1 when not evaluated)
+        int num_features = 0;
+        int num_retrieved = 0;
+        int num_matched = 0;
+        int num_guided = 0;
+        int num_relevant = -1;
+        double precision = -1.0;
+        double recall = -1.0;
+
+        // Reconstruction state after the extend
+        int num_views = 0;
+        int num_estimated_views = 0;
+        int num_tracks = 0;
+
+        // Peak resident set size in kilobytes
+        long peak_rss_kb = 0;
+    };
+
+    ReplayBenchmark(const Options& options,
+                    std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder);
+
+    // Initialize with the first two images and extend with the rest
+    bool Run(std::ostream& log_stream);
+
+    // Time saving of the session after a replay
+    bool RunSaveSession(const std::string& session_fullpath, std::ostream& log_stream);
+
+    // Time loading of a saved session (e.g. written after a 500 view replay)
+    bool RunLoadSession(const std::string& session_fullpath, int num_repetitions, std::ostream& log_stream);
+
+    const std::vector<ViewRecord>& GetRecords() const;
+
+    // Write one row per view
+    bool WriteCSV(const std::string& filename) const;
+
+    // Write options, records and totals
+    bool WriteJSON(const std::string& filename) const;
+
+    // Peak resident set size of the process in kilobytes
+    static long PeakRSS();
+
+private:
+    Options options_;
+    std::shared_ptr<RealtimeReconstructionBuilder> reconstruction_builder_;
+
+    std::vector<ViewRecord> records_;
+    double initialize_time_ = 0.0;
+    bool initialize_success_ = false;
+
+    // Session save and load timings in seconds
+    double save_time_ = -1.0;
+    long session_bytes_ = 0;
+    std::vector<double> load_times_;
+    int load_num_views_ = 0;
+    int load_num_tracks_ = 0;
+
+    void EvaluateRetrieval(ViewRecord& record);
+    void RecordReconstruction(ViewRecord& record);
+};
+
+#endif //REALTIME_RECONSTRUCTION_REPLAYBENCHMARK_H
@@ -0,0 +1,85 @@
+#ifndef REALTIME_RECONSTRUCTION_RINGBUFFER_H
+#define REALTIME_RECONSTRUCTION_RINGBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Ring buffer between one producer and one consumer thread. Items are swapped in and
+// out of preallocated slots, so buffers inside items are reused (the lock is only held
+// for the swaps). When the ring is full the oldest item is overwritten, so consumers
+// never get a stale item while newer ones were pushed.
+template<typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity)
+            : slots_(std::max<size_t>(1, capacity)) {}
+
+    // Producer: swap item into the buffer (item gets a recycled slot back). Returns false
+    // if the ring was full and its oldest item was dropped.
+    bool Push(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool full = size_ == slots_.size();
+        if (full) {
+            tail_ = Next(tail_);
+            size_--;
+        }
+        std::swap(slots_[head_], item);
+        head_ = Next(head_);
+        size_++;
+        return !full;
+    }
+
+    // Consumer: swap oldest item out of the buffer. Returns false if empty.
+    bool Pop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size_ == 0) {
+            return false;
+        }
+        std::swap(item, slots_[tail_]);
+        tail_ = Next(tail_);
+        size_--;
+        return true;
+    }
+
+    // Consumer: swap newest item out of the buffer, older items are dropped (their
+    // number is added to skipped). Returns false if empty.
+    bool PopLatest(T& item, size_t* skipped = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size_ == 0) {
+            return false;
+        }
+        size_t newest = (head_ + slots_.size() - 1) % slots_.size();
+        std::swap(item, slots_[newest]);
+        if (skipped) {
+            *skipped += size_ - 1;
+        }
+        tail_ = head_;
+        size_ = 0;
+        return true;
+    }
+
+    size_t Capacity() const {
+        return slots_.size();
+    }
+
+    bool Empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_ == 0;
+    }
+
+private:
+    std::vector<T> slots_;
+    mutable std::mutex mutex_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    size_t size_ = 0;
+
+    size_t Next(size_t index) const {
+        return (index + 1 == slots_.size()) ? 0 : index + 1;
+    }
+};
+
+#endif //REALTIME_RECONSTRUCTION_RINGBUFFER_H
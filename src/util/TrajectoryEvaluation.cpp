@@ -0,0 +1,291 @@
+#include "TrajectoryEvaluation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+#include <Eigen/SVD>
+
+Eigen::Matrix4d TrajectoryEvaluation::Similarity::Matrix() const {
+    Eigen::Matrix4d matrix = Eigen::Matrix4d::Identity();
+    matrix.topLeftCorner<3, 3>() = scale * rotation;
+    matrix.topRightCorner<3, 1>() = translation;
+    return matrix;
+}
+
+void TrajectoryEvaluation::Clear() {
+    *this = TrajectoryEvaluation();
+}
+
+void TrajectoryEvaluation::AddView(int view_id, const Eigen::Vector3d& reference_center,
+                                   const Eigen::Vector3d& estimated_center) {
+    if (view_ids_.empty()) {
+        ref_origin_ = reference_center;
+        est_origin_ = estimated_center;
+    } else {
+        const int last = Size() - 1;
+        Eigen::Vector3d dref = reference_center - ReferenceCenter(last);
+        Eigen::Vector3d dest = estimated_center - EstimatedCenter(last);
+        dref_dest_sum_.noalias() += dref * dest.transpose();
+        dref_dref_sum_ += dref.squaredNorm();
+        dest_dest_sum_ += dest.squaredNorm();
+    }
+
+    view_ids_.push_back(view_id);
+    rotation_residuals_.push_back(0.0);
+    has_last_rotation_ = false;
+    ref_x_.push_back(reference_center.x());
+    ref_y_.push_back(reference_center.y());
+    ref_z_.push_back(reference_center.z());
+    est_x_.push_back(estimated_center.x());
+    est_y_.push_back(estimated_center.y());
+    est_z_.push_back(estimated_center.z());
+
+    Eigen::Vector3d r = reference_center - ref_origin_;
+    Eigen::Vector3d e = estimated_center - est_origin_;
+    ref_sum_ += r;
+    est_sum_ += e;
+    ref_ref_sum_.noalias() += r * r.transpose();
+    ref_est_sum_.noalias() += r * e.transpose();
+    est_est_sum_ += e.squaredNorm();
+
+    alignment_valid_ = false;
+}
+
+void TrajectoryEvaluation::AddView(int view_id, const Eigen::Vector3d& reference_center,
+                                   const Eigen::Matrix3d& reference_rotation,
+                                   const Eigen::Vector3d& estimated_center,
+                                   const Eigen::Matrix3d& estimated_rotation) {
+    // Relative rotations from the last view, dR = R_i * R_(i-1)^T
+    double angle = -1.0;
+    if (has_last_rotation_) {
+        Eigen::Matrix3d dref = reference_rotation * last_ref_rotation_.transpose();
+        Eigen::Matrix3d dest = estimated_rotation * last_est_rotation_.transpose();
+        angle = Eigen::AngleAxisd(dest * dref.transpose()).angle();
+    }
+
+    AddView(view_id, reference_center, estimated_center);
+    if (angle >= 0.0) {
+        rotation_angle_sum_ += angle * angle;
+        num_rotation_deltas_++;
+        rotation_residuals_.back() = angle * 180.0 / M_PI;
+    }
+    last_ref_rotation_ = reference_rotation;
+    last_est_rotation_ = estimated_rotation;
+    has_last_rotation_ = true;
+}
+
+void TrajectoryEvaluation::AddView(int view_id, const glm::mat4& reference_view, const glm::mat4& estimated_view) {
+    AddView(view_id, CameraCenter(reference_view), CameraRotation(reference_view),
+            CameraCenter(estimated_view), CameraRotation(estimated_view));
+}
+
+Eigen::Vector3d TrajectoryEvaluation::CameraCenter(const glm::mat4& view_matrix) {
+    // Solves L * c + t = 0 for the 3x3 part (glm is column major, L(j, k) = view_matrix[k][j])
+    Eigen::Matrix3d linear;
+    Eigen::Vector3d translation;
+    for (int k = 0; k < 3; k++) {
+        for (int j = 0; j < 3; j++) {
+            linear(j, k) = view_matrix[k][j];
+        }
+        translation[k] = view_matrix[3][k];
+    }
+    return -(linear.inverse() * translation);
+}
+
+Eigen::Matrix3d TrajectoryEvaluation::CameraRotation(const glm::mat4& view_matrix) {
+    Eigen::Matrix3d linear;
+    for (int k = 0; k < 3; k++) {
+        for (int j = 0; j < 3; j++) {
+            linear(j, k) = view_matrix[k][j];
+        }
+    }
+
+    // U * V^T of the SVD, with the last column flipped for reflections
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(linear, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Vector3d e(1, 1, 1);
+    if ((svd.matrixU() * svd.matrixV().transpose()).determinant() < 0) {
+        e[2] = -1;
+    }
+    return svd.matrixU() * e.asDiagonal() * svd.matrixV().transpose();
+}
+
+int TrajectoryEvaluation::Size() const {
+    return static_cast<int>(view_ids_.size());
+}
+
+int TrajectoryEvaluation::ViewId(int index) const {
+    return view_ids_[index];
+}
+
+Eigen::Vector3d TrajectoryEvaluation::ReferenceCenter(int index) const {
+    return Eigen::Vector3d(ref_x_[index], ref_y_[index], ref_z_[index]);
+}
+
+Eigen::Vector3d TrajectoryEvaluation::EstimatedCenter(int index) const {
+    return Eigen::Vector3d(est_x_[index], est_y_[index], est_z_[index]);
+}
+
+const TrajectoryEvaluation::Similarity& TrajectoryEvaluation::Alignment() const {
+    if (alignment_valid_) {
+        return alignment_;
+    }
+    alignment_ = Similarity();
+    alignment_valid_ = true;
+
+    const int num_views = Size();
+    if (num_views < 3) {
+        return alignment_;
+    }
+
+    // Centered covariance and variance from the sums
+    Eigen::Vector3d ref_center = ref_sum_ / num_views;
+    Eigen::Vector3d est_center = est_sum_ / num_views;
+    Eigen::Matrix3d cov = ref_est_sum_ - num_views * ref_center * est_center.transpose();
+    double ref_sd = ref_ref_sum_.trace() - num_views * ref_center.squaredNorm();
+    if (ref_sd <= 0.0) {
+        return alignment_;
+    }
+
+    // Rotation, with the sign of the smallest singular value flipped for reflections
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(cov, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Vector3d e(1, 1, 1);
+    if ((svd.matrixV() * svd.matrixU().transpose()).determinant() < 0) {
+        e[2] = -1;
+    }
+    alignment_.rotation = svd.matrixV() * e.asDiagonal() * svd.matrixU().transpose();
+    alignment_.scale = svd.singularValues().dot(e) / ref_sd;
+
+    // Translation back from the first view origin
+    Eigen::Matrix3d linear = alignment_.scale * alignment_.rotation;
+    alignment_.translation = est_center + est_origin_ - linear * (ref_center + ref_origin_);
+    return alignment_;
+}
+
+double TrajectoryEvaluation::MeanSquaredError(const Eigen::Matrix4d& transform) const {
+    const int num_views = Size();
+    if (num_views == 0) {
+        return 0.0;
+    }
+
+    // sum |A r + t - e|^2 expanded over the sums, with r and e relative to the first view
+    Eigen::Matrix3d A = transform.topLeftCorner<3, 3>();
+    Eigen::Vector3d u = transform.topRightCorner<3, 1>() + A * ref_origin_ - est_origin_;
+    double sum = (A * ref_ref_sum_ * A.transpose()).trace() + num_views * u.squaredNorm() + est_est_sum_ +
+                 2.0 * u.dot(A * ref_sum_) - 2.0 * (A * ref_est_sum_).trace() - 2.0 * u.dot(est_sum_);
+    return std::max(0.0, sum) / num_views;
+}
+
+double TrajectoryEvaluation::AbsoluteTrajectoryError() const {
+    return std::sqrt(MeanSquaredError(Alignment().Matrix()));
+}
+
+double TrajectoryEvaluation::RelativeTranslationError() const {
+    const int num_deltas = Size() - 1;
+    if (num_deltas <= 0) {
+        return 0.0;
+    }
+
+    // sum |s R dr - de|^2 expanded over the sums
+    const Similarity& alignment = Alignment();
+    double sum = alignment.scale * alignment.scale * dref_dref_sum_ -
+                 2.0 * alignment.scale * (alignment.rotation * dref_dest_sum_).trace() + dest_dest_sum_;
+    return std::sqrt(std::max(0.0, sum) / num_deltas);
+}
+
+double TrajectoryEvaluation::RelativeRotationError() const {
+    if (num_rotation_deltas_ == 0) {
+        return 0.0;
+    }
+    return std::sqrt(rotation_angle_sum_ / num_rotation_deltas_) * 180.0 / M_PI;
+}
+
+std::vector<double> TrajectoryEvaluation::Residuals() const {
+    const int num_views = Size();
+    const Eigen::Matrix4d m = Alignment().Matrix();
+    std::vector<double> residuals(num_views);
+    for (int i = 0; i < num_views; i++) {
+        double dx = m(0, 0) * ref_x_[i] + m(0, 1) * ref_y_[i] + m(0, 2) * ref_z_[i] + m(0, 3) - est_x_[i];
+        double dy = m(1, 0) * ref_x_[i] + m(1, 1) * ref_y_[i] + m(1, 2) * ref_z_[i] + m(1, 3) - est_y_[i];
+        double dz = m(2, 0) * ref_x_[i] + m(2, 1) * ref_y_[i] + m(2, 2) * ref_z_[i] + m(2, 3) - est_z_[i];
+        residuals[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+    return residuals;
+}
+
+std::vector<double> TrajectoryEvaluation::RelativeResiduals() const {
+    const int num_views = Size();
+    const Eigen::Matrix4d m = Alignment().Matrix();
+    std::vector<double> residuals(num_views, 0.0);
+    for (int i = 1; i < num_views; i++) {
+        double rx = ref_x_[i] - ref_x_[i - 1], ry = ref_y_[i] - ref_y_[i - 1], rz = ref_z_[i] - ref_z_[i - 1];
+        double dx = m(0, 0) * rx + m(0, 1) * ry + m(0, 2) * rz - (est_x_[i] - est_x_[i - 1]);
+        double dy = m(1, 0) * rx + m(1, 1) * ry + m(1, 2) * rz - (est_y_[i] - est_y_[i - 1]);
+        double dz = m(2, 0) * rx + m(2, 1) * ry + m(2, 2) * rz - (est_z_[i] - est_z_[i - 1]);
+        residuals[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+    return residuals;
+}
+
+const std::vector<double>& TrajectoryEvaluation::RotationResiduals() const {
+    return rotation_residuals_;
+}
+
+bool TrajectoryEvaluation::WriteCSV(const std::string& filename, const std::string& extra_name,
+                                    const std::vector<int>& extra) const {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cout << "TrajectoryEvaluation: cannot open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    const bool has_extra = !extra_name.empty() && static_cast<int>(extra.size()) == Size();
+    std::vector<double> residuals = Residuals();
+    std::vector<double> relative_residuals = RelativeResiduals();
+
+    outfile << std::setprecision(9);
+    outfile << "view_id," << (has_extra ? extra_name + "," : "")
+            << "ref_x,ref_y,ref_z,est_x,est_y,est_z,residual,relative_residual,relative_rotation_deg\n";
+    for (int i = 0; i < Size(); i++) {
+        outfile << view_ids_[i] << ",";
+        if (has_extra) {
+            outfile << extra[i] << ",";
+        }
+        outfile << ref_x_[i] << "," << ref_y_[i] << "," << ref_z_[i] << ","
+                << est_x_[i] << "," << est_y_[i] << "," << est_z_[i] << ","
+                << residuals[i] << "," << relative_residuals[i] << "," << rotation_residuals_[i] << "\n";
+    }
+    return true;
+}
+
+bool TrajectoryEvaluation::WriteJSON(const std::string& filename) const {
+    std::ofstream outfile(filename);
+    if (!outfile) {
+        std::cout << "TrajectoryEvaluation: cannot open file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    const Similarity& alignment = Alignment();
+    const Eigen::Matrix4d transform = alignment.Matrix();
+
+    outfile << std::setprecision(9);
+    outfile << "{\n";
+    outfile << "  \"num_views\": " << Size() << ",\n";
+    outfile << "  \"scale\": " << alignment.scale << ",\n";
+    outfile << "  \"transform\": [";
+    for (int row = 0; row < 4; row++) {
+        outfile << (row ? ", [" : "[") << transform(row, 0) << ", " << transform(row, 1) << ", "
+                << transform(row, 2) << ", " << transform(row, 3) << "]";
+    }
+    outfile << "],\n";
+    outfile << "  \"mse\": " << MeanSquaredError(transform) << ",\n";
+    outfile << "  \"ate_rmse\": " << AbsoluteTrajectoryError() << ",\n";
+    outfile << "  \"rpe_translation_rmse\": " << RelativeTranslationError() << ",\n";
+    outfile << "  \"rpe_rotation_rmse_deg\": " << RelativeRotationError() << "\n";
+    outfile << "}\n";
+    return true;
+}
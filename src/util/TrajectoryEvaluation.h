@@ -0,0 +1,101 @@
+#ifndef REALTIME_RECONSTRUCTION_TRAJECTORYEVALUATION_H
+#define REALTIME_RECONSTRUCTION_TRAJECTORYEVALUATION_H
+
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glm/glm.hpp>
+
+// Evaluation of an estimated camera trajectory against a reference trajectory. Camera centers
+// are stored as one array per coordinate. The sums of the Umeyama alignment and of the error
+// terms are updated with every added view, so the alignment, absolute trajectory error (ATE)
+// and relative pose error (RPE, translation and rotation part) cost O(1) per added view (one
+// 3x3 SVD). Sums are taken relative to the first view to keep large coordinates from cancelling.
+// Rotations are optional, the rotation RPE only covers consecutive views that both have one.
+class TrajectoryEvaluation {
+public:
+    // Maps reference centers to estimated centers: scale * rotation * x + translation
+    struct Similarity {
+        double scale = 1.0;
+        Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+        Eigen::Vector3d translation = Eigen::Vector3d::Zero();
+
+        Eigen::Matrix4d Matrix() const;
+    };
+
+    void Clear();
+
+    void AddView(int view_id, const Eigen::Vector3d& reference_center, const Eigen::Vector3d& estimated_center);
+    // Same as above with world to view rotations
+    void AddView(int view_id, const Eigen::Vector3d& reference_center, const Eigen::Matrix3d& reference_rotation,
+                 const Eigen::Vector3d& estimated_center, const Eigen::Matrix3d& estimated_rotation);
+    // Same as above with world to view matrices
+    void AddView(int view_id, const glm::mat4& reference_view, const glm::mat4& estimated_view);
+
+    // Center of a world to view matrix (inverse of the 3x3 part only, the matrix may be scaled)
+    static Eigen::Vector3d CameraCenter(const glm::mat4& view_matrix);
+    // Closest rotation to the 3x3 part of a world to view matrix (removes the scale)
+    static Eigen::Matrix3d CameraRotation(const glm::mat4& view_matrix);
+
+    int Size() const;
+    int ViewId(int index) const;
+    Eigen::Vector3d ReferenceCenter(int index) const;
+    Eigen::Vector3d EstimatedCenter(int index) const;
+
+    // Least squares similarity (identity with fewer than 3 views), cached until the next view
+    const Similarity& Alignment() const;
+
+    // Mean squared distance of transformed reference and estimated centers
+    double MeanSquaredError(const Eigen::Matrix4d& transform) const;
+    // Root mean squared distance of aligned reference and estimated centers
+    double AbsoluteTrajectoryError() const;
+    // Translation part of the RPE: root mean squared error of the aligned displacements
+    // between consecutive views
+    double RelativeTranslationError() const;
+    // Rotation part of the RPE: root mean squared angle of dR_est * dR_ref^T between
+    // consecutive views, in degrees (independent of the alignment)
+    double RelativeRotationError() const;
+
+    // Per view distance of the aligned centers, and of the displacement from the previous view (0 for the first)
+    std::vector<double> Residuals() const;
+    std::vector<double> RelativeResiduals() const;
+    // Per view relative rotation angle in degrees (0 for the first view and views without rotations)
+    const std::vector<double>& RotationResiduals() const;
+
+    // One row per view (view id, extra column, centers, residuals)
+    bool WriteCSV(const std::string& filename, const std::string& extra_name = "",
+                  const std::vector<int>& extra = std::vector<int>()) const;
+    // Alignment and errors
+    bool WriteJSON(const std::string& filename) const;
+
+private:
+    std::vector<int> view_ids_;
+    std::vector<double> ref_x_, ref_y_, ref_z_;
+    std::vector<double> est_x_, est_y_, est_z_;
+
+    // Sums of centers relative to the first view (r, e) and of displacements (dr, de)
+    Eigen::Vector3d ref_origin_ = Eigen::Vector3d::Zero();
+    Eigen::Vector3d est_origin_ = Eigen::Vector3d::Zero();
+    Eigen::Vector3d ref_sum_ = Eigen::Vector3d::Zero();
+    Eigen::Vector3d est_sum_ = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d ref_ref_sum_ = Eigen::Matrix3d::Zero();
+    Eigen::Matrix3d ref_est_sum_ = Eigen::Matrix3d::Zero();
+    double est_est_sum_ = 0.0;
+    Eigen::Matrix3d dref_dest_sum_ = Eigen::Matrix3d::Zero();
+    double dref_dref_sum_ = 0.0;
+    double dest_dest_sum_ = 0.0;
+
+    // Rotations of the last view and sum of squared relative rotation angles (radians)
+    std::vector<double> rotation_residuals_;
+    Eigen::Matrix3d last_ref_rotation_ = Eigen::Matrix3d::Identity();
+    Eigen::Matrix3d last_est_rotation_ = Eigen::Matrix3d::Identity();
+    bool has_last_rotation_ = false;
+    double rotation_angle_sum_ = 0.0;
+    int num_rotation_deltas_ = 0;
+
+    mutable Similarity alignment_;
+    mutable bool alignment_valid_ = false;
+};
+
+#endif //REALTIME_RECONSTRUCTION_TRAJECTORYEVALUATION_H
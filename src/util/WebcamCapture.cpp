@@ -0,0 +1,190 @@
+#include "WebcamCapture.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "util/ImageDownsample.h"
+
+WebcamCapture::WebcamCapture(const Options& options)
+        : options_(options) {
+
+    // One buffer for the driver besides the pending and the converted one
+    options_.num_buffers = std::max(3, options_.num_buffers);
+    capture_thread_ = std::thread(&WebcamCapture::RunCapture, this);
+}
+
+WebcamCapture::~WebcamCapture() {
+    stop_ = true;
+    capture_thread_.join();
+}
+
+bool WebcamCapture::GetLatestFrame(Frame* frame) {
+    YUYVFrame lent;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!has_pending_) {
+            return false;
+        }
+        lent = pending_;
+        frame->index = pending_index_;
+        frame->timestamp = pending_timestamp_;
+        has_pending_ = false;
+        num_converting_++;
+    }
+
+    // Buffer stays mapped until it is returned, the capture thread does not close the device before
+    auto time_begin = std::chrono::steady_clock::now();
+    Convert(lent, frame);
+    std::chrono::duration<double> convert_time = std::chrono::steady_clock::now() - time_begin;
+    last_convert_time_ = convert_time.count();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        returned_.push_back(lent);
+        num_converting_--;
+    }
+    returned_condition_.notify_all();
+    return true;
+}
+
+bool WebcamCapture::IsOpen() const {
+    return open_;
+}
+
+int WebcamCapture::NumBuffers() const {
+    return num_buffers_;
+}
+
+int64_t WebcamCapture::NumCaptured() const {
+    return num_captured_;
+}
+
+int64_t WebcamCapture::NumDropped() const {
+    return num_dropped_;
+}
+
+int64_t WebcamCapture::NumFailed() const {
+    return num_failed_;
+}
+
+double WebcamCapture::LastFrameInterval() const {
+    return last_frame_interval_;
+}
+
+double WebcamCapture::LastConvertTime() const {
+    return last_convert_time_;
+}
+
+void WebcamCapture::RunCapture() {
+    bool report_error = true;
+    while (!stop_) {
+        if (!webcam_ && !Open()) {
+            // Device not available (yet), do not retry immediately
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+
+        try {
+            // Buffers converted meanwhile go back to the driver before waiting for the next one
+            ReleaseReturned();
+
+            // Short timeout so that stopping is not delayed
+            YUYVFrame lent = webcam_->acquire_frame(1);
+            auto now = std::chrono::steady_clock::now();
+            std::chrono::duration<double> interval = now - last_frame_time_;
+            last_frame_interval_ = interval.count();
+            last_frame_time_ = now;
+
+            // Lend the newest buffer, the one it replaces was skipped
+            YUYVFrame skipped;
+            bool has_skipped;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                has_skipped = has_pending_;
+                skipped = pending_;
+                pending_ = lent;
+                pending_index_ = num_captured_++;
+                pending_timestamp_ = now;
+                has_pending_ = true;
+            }
+            if (has_skipped) {
+                num_dropped_++;
+                webcam_->release_frame(skipped);
+            }
+            report_error = true;
+        } catch (const std::runtime_error& e) {
+            // Timeout or device lost, reopen
+            num_failed_++;
+            if (report_error) {
+                std::cerr << "Webcam: " << e.what() << std::endl;
+                report_error = false;
+            }
+            Close();
+        }
+    }
+    Close();
+}
+
+bool WebcamCapture::Open() {
+    try {
+        webcam_ = std::make_unique<Webcam>(options_.device, options_.width, options_.height, options_.num_buffers);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    num_buffers_ = static_cast<int>(webcam_->num_buffers());
+    open_ = true;
+    last_frame_time_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void WebcamCapture::ReleaseReturned() {
+    std::vector<YUYVFrame> to_release;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        to_release.swap(returned_);
+    }
+    for (const auto& lent : to_release) {
+        webcam_->release_frame(lent);
+    }
+}
+
+void WebcamCapture::Close() {
+    if (!webcam_) {
+        return;
+    }
+
+    // Lent buffers are unmapped with the device
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        returned_condition_.wait(lock, [this] { return num_converting_ == 0; });
+        has_pending_ = false;
+        returned_.clear();
+    }
+    open_ = false;
+    webcam_.reset();
+}
+
+void WebcamCapture::Convert(const YUYVFrame& lent, Frame* frame) {
+    const int width = static_cast<int>(lent.width);
+    const int height = static_cast<int>(lent.height);
+    const int stride = static_cast<int>(lent.stride);
+
+    frame->width = width;
+    frame->height = height;
+    frame->pixels.resize(static_cast<size_t>(width) * height * 3);
+    yuyv_to_rgb24(lent.data, frame->pixels.data(), width, height, stride);
+
+    // Luminance is read directly from the YUYV buffer
+    int factor = DownsampleFactor(width, height, options_.max_gray_size);
+    frame->gray_scale = static_cast<float>(factor);
+    if (factor == 1) {
+        frame->gray_width = width;
+        frame->gray_height = height;
+        frame->gray.resize(static_cast<size_t>(width) * height);
+        yuyv_to_gray(lent.data, frame->gray.data(), width, height, stride);
+    } else {
+        BoxDownsample(lent.data, width, height, 2, stride, factor,
+                      &frame->gray_width, &frame->gray_height, &frame->gray);
+    }
+}
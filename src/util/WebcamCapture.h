@@ -0,0 +1,118 @@
+#ifndef REALTIME_RECONSTRUCTION_WEBCAMCAPTURE_H
+#define REALTIME_RECONSTRUCTION_WEBCAMCAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "webcam/webcam.h"
+
+// Captures frames from a V4L2 device (e.g. a webcam or a v4l2loopback device) on a
+// dedicated thread. Driver buffers are dequeued without copying and the newest one is
+// lent to the consumer, which converts it to RGB for display and to grayscale for feature
+// extraction in GetLatestFrame. A newer buffer replaces one that was not taken yet, so
+// skipped frames are re-queued without being converted. Returned buffers are re-queued
+// by the capture thread, which owns the device. The device is (re)opened on the capture
+// thread, so capture starts as soon as the device appears and recovers when it disappears.
+class WebcamCapture {
+public:
+    struct Options {
+        std::string device = "/dev/video0";
+
+        // Requested resolution (the driver may choose a different one)
+        int width = 640;
+        int height = 480;
+
+        // Number of V4L2 buffers, two of them can be lent (newest and converted frame)
+        // while the driver fills the others (at least 3)
+        int num_buffers = 4;
+
+        // Downsample grayscale image by integer factor so that it is not larger than
+        // max_gray_size (0 keeps full resolution)
+        int max_gray_size = 0;
+    };
+
+    struct Frame {
+        // Increasing index of captured frames and time when frame was dequeued
+        int64_t index = -1;
+        std::chrono::steady_clock::time_point timestamp;
+
+        // RGB8 image
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> pixels;
+
+        // Grayscale image, gray_scale converts its coordinates to full resolution
+        int gray_width = 0;
+        int gray_height = 0;
+        float gray_scale = 1.0f;
+        std::vector<uint8_t> gray;
+    };
+
+    explicit WebcamCapture(const Options& options);
+    ~WebcamCapture();
+
+    WebcamCapture(const WebcamCapture&) = delete;
+    WebcamCapture& operator=(const WebcamCapture&) = delete;
+
+    // Consumer: converts the newest frame into frame. Returns false if no new frame is available.
+    bool GetLatestFrame(Frame* frame);
+
+    // True while the device is open and streaming, with the number of V4L2 buffers
+    bool IsOpen() const;
+    int NumBuffers() const;
+
+    // Counters
+    int64_t NumCaptured() const;
+    int64_t NumDropped() const;
+    int64_t NumFailed() const;
+
+    // Interval between the last two captured frames and time to convert the last frame in seconds
+    double LastFrameInterval() const;
+    double LastConvertTime() const;
+
+private:
+    Options options_;
+
+    std::thread capture_thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> open_{false};
+    std::atomic<int> num_buffers_{0};
+
+    // Owned by capture thread
+    std::unique_ptr<Webcam> webcam_;
+    std::chrono::steady_clock::time_point last_frame_time_;
+
+    // Newest buffer not taken by the consumer yet, number of buffers the consumer is
+    // converting and buffers it returned that are not re-queued yet
+    std::mutex mutex_;
+    std::condition_variable returned_condition_;
+    bool has_pending_ = false;
+    YUYVFrame pending_;
+    int64_t pending_index_ = -1;
+    std::chrono::steady_clock::time_point pending_timestamp_;
+    int num_converting_ = 0;
+    std::vector<YUYVFrame> returned_;
+
+    std::atomic<int64_t> num_captured_{0};
+    std::atomic<int64_t> num_dropped_{0};
+    std::atomic<int64_t> num_failed_{0};
+    std::atomic<double> last_frame_interval_{0.0};
+    std::atomic<double> last_convert_time_{0.0};
+
+    void RunCapture();
+    bool Open();
+    // Re-queues the buffers returned by the consumer
+    void ReleaseReturned();
+    // Waits until the consumer returned all buffers and closes the device
+    void Close();
+    void Convert(const YUYVFrame& lent, Frame* frame);
+};
+
+#endif //REALTIME_RECONSTRUCTION_WEBCAMCAPTURE_H
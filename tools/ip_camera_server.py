@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Local stand-in for an IP camera app.
+
+Serves JPEG images from a folder in a loop, one image per request at /photo.jpg
+and as a multipart/x-mixed-replace MJPEG stream at /video.
+
+    python3 tools/ip_camera_server.py dataset/statues/images --port 8080 --delay 0.3 --fps 10
+
+Then use http://127.0.0.1:8080/photo.jpg or http://127.0.0.1:8080/video as camera URL.
+"""
+
+import argparse
+import glob
+import http.server
+import itertools
+import os
+import threading
+import time
+
+BOUNDARY = "frameboundary"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Serve JPEG images like an IP camera")
+    parser.add_argument("images", help="folder with .jpg images (served in sorted order)")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--delay", type=float, default=0.0,
+                        help="seconds to wait before answering (simulates still capture latency)")
+    parser.add_argument("--fps", type=float, default=10.0, help="frame rate of the stream")
+    args = parser.parse_args()
+
+    filenames = sorted(glob.glob(os.path.join(args.images, "*.jpg")))
+    if not filenames:
+        raise SystemExit("No .jpg images in " + args.images)
+    images = [open(filename, "rb").read() for filename in filenames]
+    frames = itertools.cycle(range(len(images)))
+    lock = threading.Lock()
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            path = self.path.split("?")[0]
+            if path == "/video":
+                self.stream()
+                return
+            if path != "/photo.jpg":
+                self.send_error(404)
+                return
+            with lock:
+                index = next(frames)
+            time.sleep(args.delay)
+
+            data = images[index]
+            self.send_response(200)
+            self.send_header("Content-Type", "image/jpeg")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def stream(self):
+            # Recorded sequence in a loop until the client disconnects
+            self.send_response(200)
+            self.send_header("Content-Type", "multipart/x-mixed-replace; boundary=" + BOUNDARY)
+            self.end_headers()
+            period = 1.0 / args.fps
+            next_time = time.time()
+            try:
+                for index in itertools.cycle(range(len(images))):
+                    data = images[index]
+                    header = "--{}\r\nContent-Type: image/jpeg\r\nContent-Length: {}\r\n\r\n".format(
+                        BOUNDARY, len(data))
+                    self.wfile.write(header.encode("ascii") + data + b"\r\n")
+                    self.wfile.flush()
+                    next_time += period
+                    time.sleep(max(0.0, next_time - time.time()))
+            except (BrokenPipeError, ConnectionResetError):
+                pass
+
+        def log_message(self, format, *log_args):
+            pass
+
+    server = http.server.ThreadingHTTPServer((args.host, args.port), Handler)
+    print("Serving {} images at http://{host}:{port}/photo.jpg and http://{host}:{port}/video".format(
+        len(images), host=args.host, port=args.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()